@@ -1,43 +1,47 @@
 #include "AHT21Sensor.h"
 
-AHT21Sensor::AHT21Sensor() : _temp(0.0), _hum(0.0), lastReadTime(0), lastMeasurementTime(0), state(IDLE) {
-    // Constructor
+AHT21Sensor::AHT21Sensor(Hal &hal) : _hal(hal), _temp(0.0), _hum(0.0), lastReadTime(0), lastMeasurementTime(0), state(IDLE) {
+    transaction.done = true;
+    transaction.ok = false;
 }
 
+static const uint8_t INIT_COMMAND[] = {0xBE, 0x08, 0x00};    // Initialization command for AHT21
+static const uint8_t MEASURE_COMMAND[] = {0xAC, 0x33, 0x00}; // Command to trigger measurement
+
+// Every transfer is submitted to the bus owner, which may run it later in
+// slack time; the state machine waits for each one to complete.
 void AHT21Sensor::begin() {
-    Wire.begin();
-    Wire.beginTransmission(AHT21_ADDRESS);
-    Wire.write(0xBE); // Initialization command for AHT21
-    Wire.write(0x08);
-    Wire.write(0x00);
-    Wire.endTransmission();
-    lastReadTime = millis();
+    submit(INIT_COMMAND, sizeof(INIT_COMMAND), nullptr, 0);
+    lastReadTime = _hal.clock.millis();
     state = INITIALIZING;
 }
 
 void AHT21Sensor::update() {
-    unsigned long currentTime = millis();
+    unsigned long currentTime = _hal.clock.millis();
 
     // Trigger new measurement every second
     if (currentTime - lastMeasurementTime > 1000 && state == IDLE) {
-        triggerMeasurement();
-        lastMeasurementTime = currentTime;
+        if (triggerMeasurement()) {
+            lastMeasurementTime = currentTime;
+        }
     }
 
     switch (state) {
         case INITIALIZING:
-            if (currentTime - lastReadTime > 10) { // Wait for sensor to initialize
+            if (transaction.done && currentTime - lastReadTime > 10) { // Wait for sensor to initialize
                 state = IDLE;
             }
             break;
 
         case START_MEASUREMENT:
-            if (currentTime - lastReadTime > 80) { // Wait for measurement
-                Wire.requestFrom(AHT21_ADDRESS, 6);
-                if (Wire.available() == 6) {
-                    for (int i = 0; i < 6; i++) {
-                        dataBuffer[i] = Wire.read();
-                    }
+            if (transaction.done && currentTime - lastReadTime > 80) { // Wait for measurement
+                state = submit(nullptr, 0, dataBuffer, 6) ? READING : IDLE;
+            }
+            break;
+
+        case READING:
+            if (transaction.done) {
+                if (transaction.ok) {
                     processMeasurement();
                 }
                 state = IDLE;
@@ -50,16 +54,22 @@ void AHT21Sensor::update() {
     }
 }
 
-void AHT21Sensor::triggerMeasurement() {
-    if (state == IDLE) {
-        Wire.beginTransmission(AHT21_ADDRESS);
-        Wire.write(0xAC); // Command to trigger measurement
-        Wire.write(0x33);
-        Wire.write(0x00);
-        Wire.endTransmission();
-        lastReadTime = millis();
+bool AHT21Sensor::triggerMeasurement() {
+    if (state == IDLE && submit(MEASURE_COMMAND, sizeof(MEASURE_COMMAND), nullptr, 0)) {
+        lastReadTime = _hal.clock.millis();
         state = START_MEASUREMENT;
+        return true;
     }
+    return false;
+}
+
+bool AHT21Sensor::submit(const uint8_t *writeData, size_t writeLength, uint8_t *readBuffer, size_t readLength) {
+    transaction.address = AHT21_ADDRESS;
+    transaction.writeData = writeData;
+    transaction.writeLength = writeLength;
+    transaction.readBuffer = readBuffer;
+    transaction.readLength = readLength;
+    return _hal.i2c.submit(transaction);
 }
 
 void AHT21Sensor::processMeasurement() {
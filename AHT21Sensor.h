@@ -1,20 +1,23 @@
 #ifndef AHT21Sensor_h
 #define AHT21Sensor_h
 
-#include <Wire.h>
+#include "HAL.h"
 
 class AHT21Sensor {
 public:
-    AHT21Sensor();
+    AHT21Sensor(Hal &hal);
     void begin();
     void update();
     float readTemperature() const;
     float readHumidity() const;
 
 private:
+    Hal &_hal;
+
     enum SensorState {
         INITIALIZING,
         START_MEASUREMENT,
+        READING,
         IDLE
     };
 
@@ -24,9 +27,11 @@ private:
     unsigned long lastReadTime;
     unsigned long lastMeasurementTime;
     SensorState state;
+    I2CTransaction transaction;
     const uint8_t AHT21_ADDRESS = 0x38; // AHT21 I2C address
 
-    void triggerMeasurement();
+    bool triggerMeasurement();
+    bool submit(const uint8_t *writeData, size_t writeLength, uint8_t *readBuffer, size_t readLength);
     void processMeasurement();
 };
 
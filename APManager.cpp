@@ -1,11 +1,12 @@
 #include "APManager.h"
+#include "WebAssets.h"
 
 
 #define SSID_SIZE 32
 #define PASSWORD_SIZE 64
 #define MAX_ATTEMPTS 10
 
-APManager::APManager(const char* apSSID, ESP8266WebServer& server, EEPROMConfig& eepromConfig)
+APManager::APManager(const char* apSSID, HttpServer& server, EEPROMConfig& eepromConfig)
     : _apSSID(apSSID), _server(server), _eepromConfig(eepromConfig) {}
 
 
@@ -13,8 +14,8 @@ void APManager::startAPMode() {
     WiFi.softAP(_apSSID);
     Serial.println("Entered AP Mode. Connect to WiFi network: " + String(_apSSID));
 
-    _server.on("/", HTTP_GET, std::bind(&APManager::handleRoot, this));
-    _server.on("/setup", HTTP_POST, std::bind(&APManager::handleSetup, this));
+    _server.on("/", HttpServer::METHOD_GET, std::bind(&APManager::handleRoot, this));
+    _server.on("/setup", HttpServer::METHOD_POST, std::bind(&APManager::handleSetup, this));
 
     _server.begin(); // Start the web server
 
@@ -24,14 +25,9 @@ void APManager::handleClient() {
     _server.handleClient();
 }
 
+// Served from flash: the AP has no internet, so nothing may come from a CDN
 void APManager::handleRoot() {
-    String html = "<form action='/setup' method='post'>"
-                "<input name='ssid' length=32 placeholder='SSID'>"
-                "<input type='text' name='password' length=64 placeholder='Password'>"
-                "<input type='submit' value='Save'>"
-                "</form>";
-
-    _server.send(200, "text/html", html); 
+    sendWebAsset(_server, SETUP_PAGE);
 }
 
 void APManager::handleSetup() {
@@ -55,12 +51,12 @@ void APManager::handleSetup() {
 
     storeCredentials(ssidCharArray, passwordCharArray);
 
+    _server.whenSent([]() { ESP.restart(); });
     _server.send(200, "text/plain", "Saved. Restarting...");
-    delay(3000);
-    ESP.restart(); 
 }
 
 void APManager::storeCredentials(char* ssid, char* password) {
     _eepromConfig.writeSSID(ssid);
     _eepromConfig.writePassword(password);
+    _eepromConfig.commit();
 }
@@ -1,19 +1,19 @@
 #ifndef APManager_h
 #define APManager_h
 
-#include <ESP8266WebServer.h>
 #include <Arduino.h>
+#include "HttpServer.h"
 #include "EEPROMConfig.h"
 
 class APManager {
 public:
-    APManager(const char* apSSID, ESP8266WebServer& server, EEPROMConfig& eepromConfig);
+    APManager(const char* apSSID, HttpServer& server, EEPROMConfig& eepromConfig);
     void startAPMode();
     void handleClient();
 
 private:
     const char* _apSSID;
-    ESP8266WebServer& _server;
+    HttpServer& _server;
     EEPROMConfig& _eepromConfig;
 
     void handleRoot();
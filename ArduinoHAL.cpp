@@ -0,0 +1,163 @@
+#include "ArduinoHAL.h"
+
+extern "C" uint32_t _EEPROM_start; // From the linker script
+
+ArduinoI2CBus::ArduinoI2CBus(TwoWire &wire) : _wire(wire) {}
+
+void ArduinoI2CBus::begin()
+{
+  _wire.begin();
+}
+
+void ArduinoI2CBus::setClock(uint32_t hz)
+{
+  _wire.setClock(hz);
+}
+
+bool ArduinoI2CBus::write(uint8_t address, const uint8_t *data, size_t length, bool sendStop)
+{
+  _wire.beginTransmission(address);
+  _wire.write(data, length);
+  return _wire.endTransmission(sendStop) == 0;
+}
+
+size_t ArduinoI2CBus::read(uint8_t address, uint8_t *buffer, size_t length)
+{
+  _wire.requestFrom(address, static_cast<uint8_t>(length));
+  size_t count = 0;
+  while (_wire.available() && count < length)
+  {
+    buffer[count++] = _wire.read();
+  }
+  return count;
+}
+
+void ArduinoGpio::setMode(uint8_t pin, uint8_t mode)
+{
+  ::pinMode(pin, mode);
+}
+
+void ArduinoGpio::write(uint8_t pin, uint8_t level)
+{
+  ::digitalWrite(pin, level);
+}
+
+void ArduinoPwm::setDuty(uint8_t pin, int duty)
+{
+  ::analogWrite(pin, duty);
+}
+
+int ArduinoAnalog::read()
+{
+  return ::analogRead(A0);
+}
+
+uint8_t ArduinoPulseInput::_pin = 0;
+uint32_t ArduinoPulseInput::_riseCycles = 0;
+uint32_t ArduinoPulseInput::_pendingHighCycles = 0;
+volatile uint32_t ArduinoPulseInput::_highCycles = 0;
+volatile uint32_t ArduinoPulseInput::_periodCycles = 0;
+volatile unsigned long ArduinoPulseInput::_endMicros = 0;
+volatile uint32_t ArduinoPulseInput::_count = 0;
+volatile uint32_t ArduinoPulseInput::_edgeCycles = 0;
+
+ArduinoPulseInput::ArduinoPulseInput(uint8_t pin)
+{
+  _pin = pin;
+}
+
+void ArduinoPulseInput::begin()
+{
+  ::pinMode(_pin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(_pin), onEdge, CHANGE);
+}
+
+// A period runs from one rising edge to the next
+void IRAM_ATTR ArduinoPulseInput::onEdge()
+{
+  uint32_t now = ESP.getCycleCount();
+  if (GPIP(_pin))
+  {
+    if (_pendingHighCycles != 0)
+    {
+      _highCycles = _pendingHighCycles;
+      _periodCycles = now - _riseCycles;
+      _endMicros = ::micros();
+      _count = _count + 1;
+    }
+    _riseCycles = now;
+  }
+  else
+  {
+    _pendingHighCycles = now - _riseCycles;
+  }
+  _edgeCycles = _edgeCycles + (ESP.getCycleCount() - now);
+}
+
+// Masks interrupts rather than calling noInterrupts(), whose pair would turn
+// them back on inside the timer interrupt
+bool ArduinoPulseInput::read(Pulse &pulse)
+{
+  uint32_t savedLevel = xt_rsil(15);
+  pulse.highCycles = _highCycles;
+  pulse.periodCycles = _periodCycles;
+  pulse.endMicros = _endMicros;
+  pulse.count = _count;
+  xt_wsr_ps(savedLevel);
+  return pulse.count > 0;
+}
+
+uint32_t ArduinoPulseInput::getEdgeCycles()
+{
+  return _edgeCycles;
+}
+
+unsigned long ArduinoClock::millis()
+{
+  return ::millis();
+}
+
+unsigned long ArduinoClock::micros()
+{
+  return ::micros();
+}
+
+void ArduinoClock::delay(unsigned long ms)
+{
+  ::delay(ms);
+}
+
+uint32_t ArduinoClock::cycles()
+{
+  return ESP.getCycleCount();
+}
+
+ArduinoFlash::ArduinoFlash()
+    : _eepromSector(((uintptr_t)&_EEPROM_start - 0x40200000) / SPI_FLASH_SEC_SIZE)
+{
+}
+
+size_t ArduinoFlash::sectorSize() const
+{
+  return SPI_FLASH_SEC_SIZE;
+}
+
+uint32_t ArduinoFlash::address(uint8_t sector, size_t offset) const
+{
+  return (_eepromSector - sector) * SPI_FLASH_SEC_SIZE + offset;
+}
+
+bool ArduinoFlash::eraseSector(uint8_t sector)
+{
+  return sector < 2 && ESP.flashEraseSector(_eepromSector - sector);
+}
+
+bool ArduinoFlash::write(uint8_t sector, size_t offset, const uint32_t *data, size_t length)
+{
+  return sector < 2 && ESP.flashWrite(address(sector, offset), const_cast<uint32_t *>(data), length);
+}
+
+bool ArduinoFlash::read(uint8_t sector, size_t offset, uint32_t *data, size_t length)
+{
+  return sector < 2 && ESP.flashRead(address(sector, offset), data, length);
+}
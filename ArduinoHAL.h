@@ -0,0 +1,83 @@
+#ifndef ArduinoHAL_h
+#define ArduinoHAL_h
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "HAL.h"
+
+class ArduinoI2CBus : public I2CBus {
+public:
+    ArduinoI2CBus(TwoWire &wire);
+    void begin() override;
+    void setClock(uint32_t hz) override;
+    bool write(uint8_t address, const uint8_t *data, size_t length, bool sendStop = true) override;
+    size_t read(uint8_t address, uint8_t *buffer, size_t length) override;
+
+private:
+    TwoWire &_wire;
+};
+
+class ArduinoGpio : public GpioPort {
+public:
+    void setMode(uint8_t pin, uint8_t mode) override;
+    void write(uint8_t pin, uint8_t level) override;
+};
+
+class ArduinoPwm : public PwmOutput {
+public:
+    void setDuty(uint8_t pin, int duty) override;
+};
+
+class ArduinoAnalog : public AnalogInput {
+public:
+    int read() override;
+};
+
+// Pin-change interrupt on both edges. There is one instance: the interrupt
+// handler is static.
+class ArduinoPulseInput : public PulseInput {
+public:
+    ArduinoPulseInput(uint8_t pin);
+    void begin() override;
+    bool read(Pulse &pulse) override;
+    uint32_t getEdgeCycles() override;
+
+private:
+    static uint8_t _pin;
+    static uint32_t _riseCycles;
+    static uint32_t _pendingHighCycles; // Of the period in progress
+    static volatile uint32_t _highCycles;
+    static volatile uint32_t _periodCycles;
+    static volatile unsigned long _endMicros;
+    static volatile uint32_t _count;
+    static volatile uint32_t _edgeCycles;
+
+    static void IRAM_ATTR onEdge();
+};
+
+class ArduinoClock : public Clock {
+public:
+    unsigned long millis() override;
+    unsigned long micros() override;
+    void delay(unsigned long ms) override;
+    uint32_t cycles() override;
+};
+
+// Sector 0 is the one the EEPROM library used, so settings written by older
+// firmware can be migrated. Sector 1 is the one below it: the core's linker
+// scripts leave that sector unused between _FS_end and _EEPROM_start.
+class ArduinoFlash : public FlashDevice {
+public:
+    ArduinoFlash();
+    size_t sectorSize() const override;
+    bool eraseSector(uint8_t sector) override;
+    bool write(uint8_t sector, size_t offset, const uint32_t *data, size_t length) override;
+    bool read(uint8_t sector, size_t offset, uint32_t *data, size_t length) override;
+
+private:
+    uint32_t _eepromSector;
+
+    uint32_t address(uint8_t sector, size_t offset) const;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "AutoTuner.h"
+
+AutoTuner::AutoTuner()
+    : _state(IDLE), _lowDuty(0), _highDuty(0), _sampleTime(0.005f), _closedLoopTime(0),
+      _index(0), _settledSum(0), _settledCount(0), _initialSpeed(0), _finalSpeed(0), _error("")
+{
+  _result = Result();
+}
+
+void AutoTuner::start(int lowDuty, int highDuty, float sampleTimeSeconds, float closedLoopTime)
+{
+  _lowDuty = lowDuty;
+  _highDuty = highDuty;
+  _sampleTime = sampleTimeSeconds;
+  _closedLoopTime = closedLoopTime;
+  _index = 0;
+  _settledSum = 0;
+  _settledCount = 0;
+  _result = Result();
+  _error = "";
+  _state = SETTLING;
+}
+
+void AutoTuner::abort()
+{
+  if (isRunning())
+  {
+    _error = "aborted";
+    _state = FAILED;
+  }
+}
+
+int AutoTuner::update(float speed)
+{
+  if (_state == SETTLING)
+  {
+    // Average the last quarter of the settling time as the starting speed
+    if (_index >= SETTLE_SAMPLES * 3 / 4)
+    {
+      _settledSum += speed;
+      _settledCount++;
+    }
+    if (++_index < SETTLE_SAMPLES)
+    {
+      return _lowDuty;
+    }
+    _initialSpeed = _settledSum / _settledCount;
+    _index = 0;
+    _state = STEPPING;
+    return _highDuty;
+  }
+
+  if (_state == STEPPING)
+  {
+    // Sample i is the speed (i + 1) steps after the duty changed
+    _samples[_index] = static_cast<int16_t>(speed * SAMPLE_SCALE);
+    if (++_index < STEP_SAMPLES)
+    {
+      return _highDuty;
+    }
+    fit();
+  }
+
+  return 0;
+}
+
+// Time after the step at which the response first reaches level (0..1),
+// interpolated between samples, or -1 if it never does
+float AutoTuner::crossingTime(float level) const
+{
+  float initial = _initialSpeed * SAMPLE_SCALE;
+  float threshold = initial + level * (_finalSpeed - _initialSpeed) * SAMPLE_SCALE;
+  float previous = initial;
+  for (int i = 0; i < STEP_SAMPLES; i++)
+  {
+    if (_samples[i] >= threshold)
+    {
+      float fraction = (threshold - previous) / (_samples[i] - previous);
+      return (i + fraction) * _sampleTime;
+    }
+    previous = _samples[i];
+  }
+  return -1;
+}
+
+void AutoTuner::fit()
+{
+  // Average the last tenth of the recording as the final speed
+  const int tail = STEP_SAMPLES / 10;
+  float sum = 0;
+  for (int i = STEP_SAMPLES - tail; i < STEP_SAMPLES; i++)
+  {
+    sum += _samples[i];
+  }
+  _finalSpeed = sum / (tail * SAMPLE_SCALE);
+
+  float speedChange = _finalSpeed - _initialSpeed;
+  if (speedChange < 0.02f * (_highDuty - _lowDuty))
+  {
+    _error = "no response to the step, check the motor and encoder direction";
+    _state = FAILED;
+    return;
+  }
+
+  float t28 = crossingTime(0.283f);
+  float t63 = crossingTime(0.632f);
+  if (t28 < 0 || t63 <= t28)
+  {
+    _error = "response did not settle in the recording window";
+    _state = FAILED;
+    return;
+  }
+
+  Result &r = _result;
+  r.gain = speedChange / (_highDuty - _lowDuty);
+  r.timeConstant = 1.5f * (t63 - t28);
+  r.deadTime = t63 - r.timeConstant;
+  if (r.deadTime < 0)
+  {
+    r.deadTime = 0;
+  }
+
+  // SIMC: tau_c = theta, with at least two control steps so a very short
+  // dead time does not give runaway gains
+  float tc = _closedLoopTime > 0 ? _closedLoopTime : r.deadTime;
+  if (tc < 2 * _sampleTime)
+  {
+    tc = 2 * _sampleTime;
+  }
+  float integralTime = r.timeConstant < 4 * (tc + r.deadTime) ? r.timeConstant : 4 * (tc + r.deadTime);
+  r.kp = r.timeConstant / (r.gain * (tc + r.deadTime));
+  r.ki = r.kp / integralTime;
+  r.kd = 0;
+  r.kf = 1 / r.gain;
+  if (r.kf > 2)
+  {
+    r.kf = 2;
+  }
+  _state = COMPLETE;
+}
+
+AutoTuner::State AutoTuner::getState() const
+{
+  return _state;
+}
+
+bool AutoTuner::isRunning() const
+{
+  return _state == SETTLING || _state == STEPPING;
+}
+
+int AutoTuner::getProgress() const
+{
+  switch (_state)
+  {
+  case SETTLING:
+    return _index * 100 / (SETTLE_SAMPLES + STEP_SAMPLES);
+  case STEPPING:
+    return (SETTLE_SAMPLES + _index) * 100 / (SETTLE_SAMPLES + STEP_SAMPLES);
+  case COMPLETE:
+    return 100;
+  default:
+    return 0;
+  }
+}
+
+const AutoTuner::Result &AutoTuner::getResult() const
+{
+  return _result;
+}
+
+const char *AutoTuner::getError() const
+{
+  return _error;
+}
@@ -0,0 +1,71 @@
+#ifndef AutoTuner_h
+#define AutoTuner_h
+
+#include <stdint.h>
+
+// Open-loop step-response tuner. Holds a low duty until the speed settles,
+// steps to a high duty, records the response and fits a first order plus
+// dead time model (two-point method, 28.3% and 63.2% crossings). PI gains
+// follow the SIMC rules and the feed-forward gain is the inverse of the
+// steady-state gain.
+//
+// Driven once per control step with the measured speed in PWM units and
+// returns the duty to apply, so it runs without blocking and can be fed from
+// the motor simulator as well as the encoder.
+class AutoTuner {
+public:
+    static const int STEP_SAMPLES = 400; // 2 s at the 5 ms control period
+    static const int SETTLE_SAMPLES = 200;
+
+    enum State {
+        IDLE,
+        SETTLING,
+        STEPPING,
+        COMPLETE,
+        FAILED
+    };
+
+    struct Result {
+        float gain;         // Speed change over duty change, both in PWM units
+        float timeConstant; // s
+        float deadTime;     // s
+        float kp;
+        float ki;           // per s
+        float kd;           // s
+        float kf;
+    };
+
+    AutoTuner();
+    // Duties in PWM units; closedLoopTime (s) 0 picks the SIMC tight setting
+    void start(int lowDuty, int highDuty, float sampleTimeSeconds, float closedLoopTime);
+    void abort();
+    int update(float speed);
+
+    State getState() const;
+    bool isRunning() const;
+    int getProgress() const; // Percent
+    const Result &getResult() const;
+    const char *getError() const;
+
+private:
+    static const int SAMPLE_SCALE = 16; // Samples are speed * 16 to keep a fraction in an int16_t
+
+    State _state;
+    int _lowDuty;
+    int _highDuty;
+    float _sampleTime;
+    float _closedLoopTime;
+    int _index;
+    float _settledSum;
+    int _settledCount;
+    float _initialSpeed;
+    float _finalSpeed;
+    int16_t _samples[STEP_SAMPLES];
+    Result _result;
+    const char *_error;
+
+    float crossingTime(float level) const;
+    void fit();
+};
+
+#endif
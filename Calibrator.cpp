@@ -0,0 +1,240 @@
+#include "Calibrator.h"
+
+#define MAX_TEST_SPEED 600 // Reported as the minimum if the shaft never moves
+
+Calibrator::Calibrator()
+    : _phase(IDLE), _pwmPerRPM(0), _sweep(true), _step(0), _testSpeed(0), _startPosition(0),
+      _minimumDone(false), _maximumDone(false), _minimumSpeed(0), _maximumSpeed(0), _speedSum(0),
+      _sweepStage(COAST), _sweepDirection(0), _pointIndex(0), _duty(0), _tableDone(false)
+{
+  _table.clear();
+}
+
+void Calibrator::start(float pwmPerRPM, bool resume, bool sweep)
+{
+  _pwmPerRPM = pwmPerRPM;
+  _sweep = sweep;
+  if (!resume)
+  {
+    _minimumDone = false;
+    _maximumDone = false;
+  }
+  _tableDone = false;
+  _phase = STARTING; // The first update() picks the phase with the current position
+}
+
+void Calibrator::abort()
+{
+  if (isRunning())
+  {
+    _phase = ABORTED;
+  }
+}
+
+int Calibrator::beginPhase(Phase phase, int64_t position)
+{
+  if (phase == FIND_MINIMUM && _minimumDone)
+  {
+    phase = MEASURE_MAXIMUM;
+  }
+  if (phase == MEASURE_MAXIMUM && _maximumDone)
+  {
+    phase = SWEEP;
+  }
+  if (phase == SWEEP && !_sweep)
+  {
+    phase = COMPLETE;
+  }
+
+  _phase = phase;
+  _step = 0;
+  _testSpeed = 0;
+  _speedSum = 0;
+  _startPosition = position;
+  _sweepStage = COAST;
+  _sweepDirection = 0;
+  _pointIndex = 0;
+  _duty = 0;
+  return 0;
+}
+
+int Calibrator::update(int64_t position, float speedRPM)
+{
+  switch (_phase)
+  {
+  case STARTING:
+    return beginPhase(FIND_MINIMUM, position);
+
+  case FIND_MINIMUM:
+  {
+    int64_t moved = position - _startPosition;
+    bool moving = moved > MOVEMENT_TICKS || moved < -MOVEMENT_TICKS;
+    if (moving || _testSpeed >= MAX_MINIMUM_STEPS)
+    {
+      _minimumSpeed = moving ? _testSpeed : MAX_TEST_SPEED;
+      _minimumDone = true;
+      return beginPhase(MEASURE_MAXIMUM, position);
+    }
+    if (++_step >= STEP_HOLD)
+    {
+      _step = 0;
+      _testSpeed++;
+    }
+    return static_cast<int>(_testSpeed * _pwmPerRPM);
+  }
+
+  case MEASURE_MAXIMUM:
+    if (++_step > SPIN_UP_STEPS - AVERAGE_STEPS)
+    {
+      _speedSum += speedRPM;
+    }
+    if (_step < SPIN_UP_STEPS)
+    {
+      return 1023;
+    }
+    _maximumSpeed = _speedSum / AVERAGE_STEPS;
+    _maximumDone = true;
+    return beginPhase(SWEEP, position);
+
+  case SWEEP:
+    return updateSweep(speedRPM);
+
+  default:
+    return 0;
+  }
+}
+
+int Calibrator::updateSweep(float speedRPM)
+{
+  SpeedCurve &curve = _sweepDirection == 0 ? _table.forward : _table.reverse;
+  int sign = _sweepDirection == 0 ? 1 : -1;
+  float speed = sign * speedRPM;
+
+  switch (_sweepStage)
+  {
+  case COAST:
+    // Wait for the motor to stop, giving up after ten times the coast time
+    if (++_step < COAST_STEPS || ((speed > STOPPED_RPM || speed < -STOPPED_RPM) && _step < 10 * COAST_STEPS))
+    {
+      return 0;
+    }
+    _step = 0;
+    _duty = 0;
+    _sweepStage = DEADBAND;
+    return 0;
+
+  case DEADBAND:
+    if (speed > MOVING_RPM || _duty >= 1023)
+    {
+      curve.deadband = _duty;
+      _step = 0;
+      _speedSum = 0;
+      _pointIndex = 0;
+      _duty = curve.deadband + (1023 - curve.deadband) / SpeedCurve::POINTS;
+      _sweepStage = POINTS;
+      return sign * _duty;
+    }
+    if (++_step >= DEADBAND_HOLD)
+    {
+      _step = 0;
+      _duty += DEADBAND_INCREMENT;
+    }
+    return sign * _duty;
+
+  case POINTS:
+    if (++_step > SETTLE_STEPS)
+    {
+      _speedSum += speed;
+    }
+    if (_step < SETTLE_STEPS + AVERAGE_STEPS)
+    {
+      return sign * _duty;
+    }
+    curve.duty[_pointIndex] = _duty;
+    curve.rpm[_pointIndex] = static_cast<int16_t>(_speedSum / AVERAGE_STEPS);
+    _step = 0;
+    _speedSum = 0;
+    if (++_pointIndex < SpeedCurve::POINTS)
+    {
+      _duty = curve.deadband + (1023 - curve.deadband) * (_pointIndex + 1) / SpeedCurve::POINTS;
+      return sign * _duty;
+    }
+    correctDeadband(curve);
+    if (_sweepDirection == 0)
+    {
+      _sweepDirection = 1;
+      _sweepStage = COAST;
+      return 0;
+    }
+    _table.makeMonotonic();
+    _tableDone = true;
+    _phase = COMPLETE;
+    return 0;
+  }
+  return 0;
+}
+
+// The ramp only sees the motor moving once it is past MOVING_RPM, a few
+// duty steps late. The curve needs the duty at zero speed, so take it from
+// the line through the first two points, no higher than the one measured.
+void Calibrator::correctDeadband(SpeedCurve &curve)
+{
+  float slope = static_cast<float>(curve.rpm[1] - curve.rpm[0]) / (curve.duty[1] - curve.duty[0]);
+  if (slope <= 0)
+  {
+    return;
+  }
+  float zeroSpeedDuty = curve.duty[0] - curve.rpm[0] / slope;
+  if (zeroSpeedDuty >= 0 && zeroSpeedDuty < curve.deadband)
+  {
+    curve.deadband = static_cast<uint16_t>(zeroSpeedDuty + 0.5f);
+  }
+}
+
+Calibrator::Phase Calibrator::getPhase() const
+{
+  return _phase;
+}
+
+bool Calibrator::isRunning() const
+{
+  return _phase == STARTING || _phase == FIND_MINIMUM || _phase == MEASURE_MAXIMUM || _phase == SWEEP;
+}
+
+// Minimum search up to 20%, maximum up to 30%, the sweep the rest
+int Calibrator::getProgress() const
+{
+  switch (_phase)
+  {
+  case FIND_MINIMUM:
+    return _testSpeed * 20 / MAX_MINIMUM_STEPS;
+  case MEASURE_MAXIMUM:
+    return 20 + _step * 10 / SPIN_UP_STEPS;
+  case SWEEP:
+    return 30 + (_sweepDirection * (SpeedCurve::POINTS + 1) + (_sweepStage == POINTS ? _pointIndex + 1 : 0)) * 70 / (2 * (SpeedCurve::POINTS + 1));
+  case COMPLETE:
+    return 100;
+  default:
+    return 0;
+  }
+}
+
+float Calibrator::getMinimumSpeed() const
+{
+  return _minimumSpeed;
+}
+
+float Calibrator::getMaximumSpeed() const
+{
+  return _maximumSpeed;
+}
+
+bool Calibrator::hasSpeedTable() const
+{
+  return _tableDone;
+}
+
+const SpeedTable &Calibrator::getSpeedTable() const
+{
+  return _table;
+}
@@ -0,0 +1,86 @@
+#ifndef Calibrator_h
+#define Calibrator_h
+
+#include <stdint.h>
+#include "SpeedTable.h"
+
+// Calibration as a state machine advanced once per control step, so the web
+// server, OTA and the sensors keep running while it works. Phases:
+//
+//   FIND_MINIMUM     raise the speed 1 RPM every 50 ms until the shaft moves
+//   MEASURE_MAXIMUM  full duty for a second, then average the speed
+//   SWEEP            in each direction find the deadband duty, then measure
+//                    the settled speed at SpeedCurve::POINTS duties up to full
+//
+// An aborted run keeps the phases it finished, and start(resume) skips them.
+class Calibrator {
+public:
+    static const int STEP_HOLD = 10;         // Control steps per minimum-speed step, 50 ms
+    static const int MAX_MINIMUM_STEPS = 100;
+    static const int MOVEMENT_TICKS = 300;   // Encoder ticks that count as movement
+    static const int SPIN_UP_STEPS = 200;    // 1 s
+    static const int AVERAGE_STEPS = 20;     // Speeds are averaged over the last 100 ms
+
+    static const int COAST_STEPS = 100;      // Let the motor stop before each sweep
+    static const int DEADBAND_HOLD = 4;      // Control steps per deadband duty step, 20 ms
+    static const int DEADBAND_INCREMENT = 2; // Duty per deadband step
+    static const int MOVING_RPM = 30;
+    static const int STOPPED_RPM = 5;
+    static const int SETTLE_STEPS = 60;      // Time at each sweep duty before averaging
+
+    enum Phase {
+        IDLE,
+        STARTING,
+        FIND_MINIMUM,
+        MEASURE_MAXIMUM,
+        SWEEP,
+        COMPLETE,
+        ABORTED
+    };
+
+    Calibrator();
+    // pwmPerRPM converts the minimum-speed test speeds to duty, as rpmToPWM() does
+    void start(float pwmPerRPM, bool resume, bool sweep);
+    void abort();
+    int update(int64_t position, float speedRPM); // Returns the signed duty to apply
+
+    Phase getPhase() const;
+    bool isRunning() const;
+    int getProgress() const; // Percent
+    float getMinimumSpeed() const;
+    float getMaximumSpeed() const;
+    bool hasSpeedTable() const; // The last run finished a sweep
+    const SpeedTable &getSpeedTable() const;
+
+private:
+    enum SweepStage {
+        COAST,
+        DEADBAND,
+        POINTS
+    };
+
+    Phase _phase;
+    float _pwmPerRPM;
+    bool _sweep;
+    int _step;
+    int _testSpeed;
+    int64_t _startPosition;
+    bool _minimumDone;
+    bool _maximumDone;
+    float _minimumSpeed;
+    float _maximumSpeed;
+    float _speedSum;
+
+    SweepStage _sweepStage;
+    int _sweepDirection; // 0 forward, 1 reverse
+    int _pointIndex;
+    int _duty;
+    bool _tableDone;
+    SpeedTable _table;
+
+    int beginPhase(Phase phase, int64_t position);
+    int updateSweep(float speedRPM);
+    void correctDeadband(SpeedCurve &curve);
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include "CommandChannel.h"
+
+static uint32_t getU32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static float getFloat(const uint8_t *p)
+{
+  uint32_t bits = getU32(p);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static void putU32(uint8_t *p, uint32_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+static void putFloat(uint8_t *p, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putU32(p, bits);
+}
+
+CommandChannel::CommandChannel(MotorController &motorController)
+    : _motorController(motorController)
+{
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    _clients[i].active = false;
+  }
+  resetStats();
+}
+
+void CommandChannel::begin(uint16_t localPort)
+{
+  _udp.begin(localPort);
+}
+
+void CommandChannel::poll()
+{
+  unsigned long startTime = micros();
+  int frames = 0;
+  int length;
+  while (frames < MAX_FRAMES_PER_POLL && (length = _udp.parsePacket()) > 0)
+  {
+    // Oversized frames are truncated here and rejected by the count check
+    size_t received = _udp.read(_frame, sizeof(_frame));
+    handleFrame(received);
+    frames++;
+  }
+
+  if (frames > 0)
+  {
+    unsigned long elapsed = micros() - startTime;
+    if (elapsed > _stats.maxPollMicros)
+    {
+      _stats.maxPollMicros = elapsed;
+    }
+  }
+}
+
+CommandChannel::Client *CommandChannel::findClient(IPAddress address, uint16_t port)
+{
+  Client *oldest = &_clients[0];
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    Client &client = _clients[i];
+    if (client.active && client.address == address && client.port == port)
+    {
+      return &client;
+    }
+    if (!client.active)
+    {
+      oldest = &client;
+    }
+    else if (oldest->active && client.lastSeen - oldest->lastSeen > 0x80000000UL)
+    {
+      oldest = &client; // Seen before the current oldest, allowing for wrap
+    }
+  }
+
+  // New client: take a free slot or the one heard from least recently
+  oldest->active = false;
+  oldest->address = address;
+  oldest->port = port;
+  return oldest;
+}
+
+void CommandChannel::handleFrame(size_t length)
+{
+  uint8_t ack[ACK_SIZE];
+  _stats.frames++;
+
+  uint32_t sequence = length >= HEADER_SIZE ? getU32(_frame + 4) : 0;
+  uint8_t count = length >= HEADER_SIZE ? _frame[3] : 0;
+  if (length < HEADER_SIZE || _frame[0] != 'W' || _frame[1] != 'C' || _frame[2] != COMMAND_VERSION ||
+      count == 0 || count > MAX_COMMANDS || length < HEADER_SIZE + count * COMMAND_SIZE)
+  {
+    _stats.errors++;
+    encodeAck(ack, BAD_FRAME, sequence, 0);
+    sendAck(ack);
+    return;
+  }
+
+  _motorController.keepAlive(); // Any valid frame renews the lease, a NOP is a heartbeat
+  Client *client = findClient(_udp.remoteIP(), _udp.remotePort());
+  client->lastSeen = millis();
+  if (client->active)
+  {
+    int32_t age = static_cast<int32_t>(sequence - client->sequence);
+    if (age == 0)
+    {
+      _stats.duplicates++;
+      client->ack[3] = DUPLICATE;
+      sendAck(client->ack);
+      return;
+    }
+    if (age < 0)
+    {
+      _stats.stale++;
+      encodeAck(ack, STALE, sequence, 0);
+      sendAck(ack);
+      return;
+    }
+  }
+
+  uint8_t applied = 0;
+  Result result = OK;
+  for (; applied < count; applied++)
+  {
+    const uint8_t *command = _frame + HEADER_SIZE + applied * COMMAND_SIZE;
+    if (!apply(command[0], command + 4))
+    {
+      _stats.errors++;
+      result = BAD_COMMAND;
+      break;
+    }
+  }
+  _stats.commands += applied;
+
+  client->active = true;
+  client->sequence = sequence;
+  encodeAck(client->ack, result, sequence, applied);
+  sendAck(client->ack);
+}
+
+bool CommandChannel::apply(uint8_t opcode, const uint8_t *value)
+{
+  PIDGains gains = _motorController.getPIDGains();
+  switch (opcode)
+  {
+  case NOP:
+    break;
+  case SPEED:
+    _motorController.setTargetSpeed(getFloat(value));
+    break;
+  case FREE:
+    _motorController.free();
+    break;
+  case BRAKE:
+    _motorController.brake();
+    break;
+  case RELEASE:
+    _motorController.release();
+    break;
+  case HOLD:
+    _motorController.hold();
+    break;
+  case MOVE_TO:
+    _motorController.moveTo(static_cast<int32_t>(getU32(value)));
+    break;
+  case MOVE_BY:
+    _motorController.moveBy(static_cast<int32_t>(getU32(value)));
+    break;
+  case SET_KP:
+    _motorController.setPIDValues(getFloat(value), gains.ki, gains.kd);
+    break;
+  case SET_KI:
+    _motorController.setPIDValues(gains.kp, getFloat(value), gains.kd);
+    break;
+  case SET_KD:
+    _motorController.setPIDValues(gains.kp, gains.ki, getFloat(value));
+    break;
+  case SET_KF:
+    _motorController.setFeedForwardGain(getFloat(value));
+    break;
+  default:
+    return false;
+  }
+  return true;
+}
+
+void CommandChannel::encodeAck(uint8_t *ack, Result result, uint32_t sequence, uint8_t applied)
+{
+  const ControlSample &sample = _motorController.getLastSample();
+  ack[0] = 'W';
+  ack[1] = 'A';
+  ack[2] = COMMAND_VERSION;
+  ack[3] = result;
+  putU32(ack + 4, sequence);
+  ack[8] = applied;
+  ack[9] = 0;
+  ack[10] = 0;
+  ack[11] = 0;
+  putU32(ack + 12, micros());
+  putFloat(ack + 16, sample.speedRPM);
+  putFloat(ack + 20, sample.targetRPM);
+}
+
+void CommandChannel::sendAck(const uint8_t *ack)
+{
+  // Best effort like telemetry, a lost ack makes the client retransmit
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  _udp.write(ack, ACK_SIZE);
+  _udp.endPacket();
+}
+
+const CommandChannel::Stats &CommandChannel::getStats() const
+{
+  return _stats;
+}
+
+void CommandChannel::resetStats()
+{
+  _stats = Stats();
+}
@@ -0,0 +1,110 @@
+#ifndef CommandChannel_h
+#define CommandChannel_h
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "MotorController.h"
+
+// Binary motor commands over UDP, polled at the start of every control step
+// so a command takes effect on the next PWM update instead of waiting for the
+// web server. All fields are little-endian.
+//
+// Command frame, client to controller:
+//   offset size  field
+//   0      2     magic 'W','C'
+//   2      1     version (COMMAND_VERSION)
+//   3      1     command count, 1..MAX_COMMANDS
+//   4      4     sequence number, chosen by the client and increasing
+//   8      8*n   commands: opcode (1), reserved (3), value (4)
+//
+// The value is a float for SPEED and the gains, and int32 ticks for MOVE_TO
+// and MOVE_BY. Commands in a frame run in order.
+//
+// Ack, controller to client:
+//   0      2     magic 'W','A'
+//   2      1     version
+//   3      1     result (Result)
+//   4      4     sequence number of the frame being acknowledged
+//   8      1     commands applied
+//   9      3     reserved
+//   12     4     timestamp, micros()
+//   16     4     filtered speed, RPM, float  } from the last control step,
+//   20     4     target speed, RPM, float    } before these commands
+//
+// Retransmit a frame with the same sequence number if the ack is lost: the
+// controller answers with the ack it already sent and does not apply the
+// commands again. Frames older than the last one seen from a client are
+// acknowledged as STALE and ignored.
+class CommandChannel {
+public:
+    static const uint8_t COMMAND_VERSION = 1;
+    static const size_t HEADER_SIZE = 8;
+    static const size_t COMMAND_SIZE = 8;
+    static const size_t ACK_SIZE = 24;
+    static const int MAX_COMMANDS = 8;
+    static const int MAX_CLIENTS = 4;
+    static const int MAX_FRAMES_PER_POLL = 4; // Bounds the time taken from the control step
+
+    enum Opcode {
+        NOP = 0,
+        SPEED = 1,   // RPM
+        FREE = 2,
+        BRAKE = 3,
+        RELEASE = 4,
+        HOLD = 5,
+        MOVE_TO = 6, // Ticks
+        MOVE_BY = 7, // Ticks
+        SET_KP = 8,
+        SET_KI = 9,
+        SET_KD = 10,
+        SET_KF = 11
+    };
+
+    enum Result {
+        OK = 0,
+        DUPLICATE = 1,   // Already applied, the original ack is repeated
+        STALE = 2,
+        BAD_FRAME = 3,
+        BAD_COMMAND = 4  // Unknown opcode, the commands before it were applied
+    };
+
+    struct Stats {
+        unsigned long frames;
+        unsigned long commands;
+        unsigned long duplicates;
+        unsigned long stale;
+        unsigned long errors; // Bad frames and commands
+        unsigned long maxPollMicros;
+    };
+
+    CommandChannel(MotorController &motorController);
+    void begin(uint16_t localPort);
+    void poll(); // Call at the start of the control step
+    // Runs one command; false for an unknown opcode. Also used for group commands.
+    bool apply(uint8_t opcode, const uint8_t *value);
+    const Stats &getStats() const;
+    void resetStats();
+
+private:
+    struct Client {
+        bool active;
+        IPAddress address;
+        uint16_t port;
+        uint32_t sequence; // Last frame applied
+        unsigned long lastSeen; // millis
+        uint8_t ack[ACK_SIZE];
+    };
+
+    MotorController &_motorController;
+    WiFiUDP _udp;
+    Client _clients[MAX_CLIENTS];
+    Stats _stats;
+    uint8_t _frame[HEADER_SIZE + MAX_COMMANDS * COMMAND_SIZE];
+
+    Client *findClient(IPAddress address, uint16_t port);
+    void handleFrame(size_t length);
+    void encodeAck(uint8_t *ack, Result result, uint32_t sequence, uint8_t applied);
+    void sendAck(const uint8_t *ack);
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "ConfigStore.h"
+#include <string.h>
+
+ConfigStore::ConfigStore(FlashDevice &flash)
+    : _flash(flash), _activeSector(-1), _nextOffset(0), _sequence(0),
+      _eraseCount(0), _writeCount(0), _corruptRecords(0), _failedSaves(0)
+{
+}
+
+bool ConfigStore::load(void *data, size_t size, uint16_t &version)
+{
+  const size_t sectorSize = _flash.sectorSize();
+  RecordHeader *header = reinterpret_cast<RecordHeader *>(_buffer);
+  uint8_t *payload = reinterpret_cast<uint8_t *>(_buffer) + sizeof(RecordHeader);
+  bool found = false;
+  _activeSector = -1;
+  _corruptRecords = 0;
+
+  for (int sector = 0; sector < 2; sector++)
+  {
+    size_t offset = 0;
+    size_t freeOffset = sectorSize; // Full unless erased space is found
+    while (offset + sizeof(RecordHeader) <= sectorSize)
+    {
+      if (!_flash.read(sector, offset, _buffer, sizeof(RecordHeader)))
+      {
+        break;
+      }
+      if (header->magic == 0xFFFFFFFF)
+      {
+        freeOffset = offset;
+        break;
+      }
+      // Anything else is the old EEPROM layout or a torn header, stop here
+      if (header->magic != MAGIC || header->length > MAX_PAYLOAD || offset + recordSize(header->length) > sectorSize)
+      {
+        if (header->magic == MAGIC)
+        {
+          _corruptRecords++;
+        }
+        break;
+      }
+
+      size_t length = recordSize(header->length);
+      if (_flash.read(sector, offset + sizeof(RecordHeader), reinterpret_cast<uint32_t *>(payload), length - sizeof(RecordHeader)) &&
+          recordCrc(*header, payload) == header->crc)
+      {
+        if (!found || header->sequence > _sequence)
+        {
+          found = true;
+          _sequence = header->sequence;
+          _activeSector = sector;
+          version = header->version;
+          memcpy(data, payload, header->length < size ? header->length : size);
+        }
+      }
+      else
+      {
+        _corruptRecords++;
+      }
+      offset += length;
+    }
+    if (sector == _activeSector)
+    {
+      _nextOffset = freeOffset;
+    }
+  }
+  return found;
+}
+
+bool ConfigStore::save(const void *data, size_t size, uint16_t version)
+{
+  if (size > MAX_PAYLOAD)
+  {
+    _failedSaves++;
+    return false;
+  }
+
+  size_t length = recordSize(size);
+  memset(_buffer, 0xFF, length);
+  RecordHeader *header = reinterpret_cast<RecordHeader *>(_buffer);
+  uint8_t *payload = reinterpret_cast<uint8_t *>(_buffer) + sizeof(RecordHeader);
+  memcpy(payload, data, size);
+  header->magic = MAGIC;
+  header->sequence = _sequence + 1;
+  header->version = version;
+  header->length = size;
+  header->crc = recordCrc(*header, payload);
+
+  int sector = _activeSector;
+  size_t offset = _nextOffset;
+  if (sector < 0 || offset + length > _flash.sectorSize())
+  {
+    sector = sector == 1 ? 0 : 1;
+    offset = 0;
+    if (!_flash.eraseSector(sector))
+    {
+      _failedSaves++;
+      return false;
+    }
+    _eraseCount++;
+  }
+
+  _writeCount++;
+  if (!_flash.write(sector, offset, _buffer, length))
+  {
+    // A torn header ends the scan in load(), hiding any record after it, so
+    // the next save starts afresh in the other sector
+    _activeSector = sector;
+    _nextOffset = _flash.sectorSize();
+    _failedSaves++;
+    return false;
+  }
+
+  _activeSector = sector;
+  _nextOffset = offset + length;
+  _sequence = header->sequence;
+  return true;
+}
+
+bool ConfigStore::readRaw(size_t offset, void *buffer, size_t length)
+{
+  return _flash.read(0, offset, reinterpret_cast<uint32_t *>(buffer), length);
+}
+
+uint32_t ConfigStore::getSequence() const
+{
+  return _sequence;
+}
+
+uint32_t ConfigStore::getEraseCount() const
+{
+  return _eraseCount;
+}
+
+uint32_t ConfigStore::getWriteCount() const
+{
+  return _writeCount;
+}
+
+uint32_t ConfigStore::getCorruptRecords() const
+{
+  return _corruptRecords;
+}
+
+uint32_t ConfigStore::getFailedSaves() const
+{
+  return _failedSaves;
+}
+
+size_t ConfigStore::recordSize(size_t length)
+{
+  return (sizeof(RecordHeader) + length + 3) & ~static_cast<size_t>(3);
+}
+
+uint32_t ConfigStore::recordCrc(const RecordHeader &header, const void *payload)
+{
+  uint32_t crc = crc32(&header.sequence, sizeof(header.sequence) + sizeof(header.version) + sizeof(header.length));
+  return crc32(payload, header.length, crc);
+}
+
+// CRC-32 (IEEE, reflected), bitwise to avoid a 1 KB table
+uint32_t ConfigStore::crc32(const void *data, size_t length, uint32_t crc)
+{
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  crc = ~crc;
+  while (length--)
+  {
+    crc ^= *bytes++;
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
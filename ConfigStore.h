@@ -0,0 +1,61 @@
+#ifndef ConfigStore_h
+#define ConfigStore_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HAL.h"
+
+// Log-structured record store over the two sectors of a FlashDevice. Each
+// save appends a record (header plus payload, CRC-32 protected) to the free
+// space of the active sector. Only when that is full is the other sector
+// erased and the log moved over, so most saves cost no erase at all and a
+// save never costs more than one.
+//
+// A save never touches the previous record: a power cut mid-write leaves a
+// record that fails its CRC and load() falls back to the newest one that
+// passes. The first save goes to sector 1 so sector 0, which holds the old
+// EEPROM layout, stays readable until the log wraps round to it.
+class ConfigStore {
+public:
+    static const uint32_t MAGIC = 0x43434D57; // "WMCC"
+    static const size_t MAX_PAYLOAD = 512;
+
+    ConfigStore(FlashDevice &flash);
+    // Copies the newest valid record into data. A record from an older
+    // version that is shorter than size leaves the rest of data untouched.
+    bool load(void *data, size_t size, uint16_t &version);
+    bool save(const void *data, size_t size, uint16_t version);
+    bool readRaw(size_t offset, void *buffer, size_t length); // Sector 0, for migrating the EEPROM layout
+
+    uint32_t getSequence() const;
+    uint32_t getEraseCount() const;
+    uint32_t getWriteCount() const;
+    uint32_t getCorruptRecords() const; // Found by the last load()
+    uint32_t getFailedSaves() const;
+
+    static uint32_t crc32(const void *data, size_t length, uint32_t crc = 0);
+
+private:
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint16_t version;
+        uint16_t length; // Payload bytes
+        uint32_t crc;    // Over sequence, version, length and the payload
+    };
+
+    FlashDevice &_flash;
+    int _activeSector; // -1 until a record has been loaded or saved
+    size_t _nextOffset; // Start of the free space in the active sector
+    uint32_t _sequence;
+    uint32_t _eraseCount;
+    uint32_t _writeCount;
+    uint32_t _corruptRecords;
+    uint32_t _failedSaves;
+    uint32_t _buffer[(sizeof(RecordHeader) + MAX_PAYLOAD) / 4];
+
+    static size_t recordSize(size_t length);
+    static uint32_t recordCrc(const RecordHeader &header, const void *payload);
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "ControlScheduler.h"
+
+ControlScheduler *ControlScheduler::_timerOwner = nullptr;
+
+ControlScheduler::ControlScheduler(unsigned long periodMicros)
+    : _periodMicros(periodMicros), _slackTaskCount(0), _nextSlackTask(0), _lastExitMicros(0), _pendingTicks(0),
+      _tickMicros(0), _periodCycles(0), _nextCompare(0), _leadCycles(0), _skippedTicks(0), _tickHook(nullptr)
+{
+  _phases[CONTROL_PHASE].name = "control";
+  _phases[SYSTEM_PHASE].name = "system";
+  resetStats();
+}
+
+void ControlScheduler::begin()
+{
+  // timer1 drives the analogWrite() waveform generator, so the tick comes from
+  // timer0 (CCOMPARE0) which fires when the CPU cycle counter reaches the target.
+  _periodCycles = ESP.getCpuFreqMHz() * _periodMicros;
+  _leadCycles = ESP.getCpuFreqMHz() * MIN_LEAD_MICROS;
+  _pendingTicks = 0;
+  _skippedTicks = 0;
+  _lastTickMicros = micros();
+  _lastExitMicros = _lastTickMicros;
+
+  noInterrupts();
+  _timerOwner = this;
+  timer0_isr_init();
+  timer0_attachInterrupt(onTimer);
+  _nextCompare = ESP.getCycleCount() + _periodCycles;
+  timer0_write(_nextCompare);
+  interrupts();
+}
+
+void ControlScheduler::attachTimer()
+{
+  noInterrupts();
+  _timerOwner = this;
+  interrupts();
+}
+
+void IRAM_ATTR ControlScheduler::onTimer()
+{
+  _timerOwner->tick();
+}
+
+void IRAM_ATTR ControlScheduler::tick()
+{
+  // Re-arm from the previous compare value, not the current cycle count, so
+  // ISR latency does not accumulate into drift.
+  _nextCompare += _periodCycles;
+  uint32_t now = ESP.getCycleCount();
+  int32_t ahead = static_cast<int32_t>(_nextCompare - now);
+  if (ahead <= static_cast<int32_t>(_leadCycles))
+  {
+    // A period or more late (flash erase, WiFi, interrupts off): a compare
+    // value already passed would not fire until the counter wraps, 53s on,
+    // so the ticks in between are given up and counted as missed.
+    _skippedTicks = _skippedTicks + (ahead < 0 ? static_cast<uint32_t>(-ahead) / _periodCycles : 0) + 1;
+    _nextCompare = now + _periodCycles;
+  }
+  timer0_write(_nextCompare);
+  unsigned long tickMicros = micros();
+  _tickMicros = tickMicros;
+  _pendingTicks = _pendingTicks + 1;
+  if (_tickHook != nullptr)
+  {
+    _tickHook(tickMicros);
+  }
+}
+
+void ControlScheduler::setTickHook(TickHook hook)
+{
+  noInterrupts();
+  _tickHook = hook;
+  interrupts();
+}
+
+void ControlScheduler::setControlTask(Task task)
+{
+  _controlTask = task;
+}
+
+bool ControlScheduler::addSlackTask(Task task, unsigned long budgetMicros, const char *name)
+{
+  if (_slackTaskCount >= MAX_SLACK_TASKS || budgetMicros >= _periodMicros)
+  {
+    return false;
+  }
+  _slackTasks[_slackTaskCount].task = task;
+  _slackTasks[_slackTaskCount].budgetMicros = budgetMicros;
+  _phases[FIRST_SLACK_PHASE + _slackTaskCount].name = name;
+  _slackTaskCount++;
+  return true;
+}
+
+void ControlScheduler::run()
+{
+  unsigned long entryTime = micros();
+  recordPhase(SYSTEM_PHASE, _lastExitMicros, entryTime);
+
+  noInterrupts();
+  uint32_t ticks = _pendingTicks;
+  unsigned long tickMicros = _tickMicros;
+  _pendingTicks = 0;
+  uint32_t skipped = _skippedTicks;
+  _skippedTicks = 0;
+  interrupts();
+
+  _missedDeadlines += skipped;
+
+  if (ticks == 0)
+  {
+    runSlackTask();
+    _lastExitMicros = micros();
+    return;
+  }
+
+  // Anything more than one pending tick means a whole period was lost.
+  _missedDeadlines += ticks - 1;
+  _tickCount += ticks;
+  _lastTickMicros = tickMicros;
+
+  unsigned long startTime = micros();
+  _lastJitterMicros = startTime - tickMicros;
+  if (_lastJitterMicros > _maxJitterMicros)
+  {
+    _maxJitterMicros = _lastJitterMicros;
+  }
+
+  if (_controlTask)
+  {
+    _controlTask();
+  }
+
+  _lastExitMicros = micros();
+  recordPhase(CONTROL_PHASE, startTime, _lastExitMicros);
+}
+
+void ControlScheduler::runSlackTask()
+{
+  if (_slackTaskCount == 0)
+  {
+    return;
+  }
+
+  unsigned long elapsed = micros() - _lastTickMicros;
+  if (elapsed >= _periodMicros)
+  {
+    return; // Tick is due, leave the time to the control task
+  }
+  unsigned long remaining = _periodMicros - elapsed;
+
+  // Round-robin through the tasks, running at most one per call so the
+  // pending tick is re-checked between every piece of slack work.
+  for (int i = 0; i < _slackTaskCount; i++)
+  {
+    int index = _nextSlackTask;
+    SlackTask &slackTask = _slackTasks[index];
+    _nextSlackTask = (_nextSlackTask + 1) % _slackTaskCount;
+    if (slackTask.budgetMicros <= remaining)
+    {
+      unsigned long startTime = micros();
+      slackTask.task();
+      recordPhase(FIRST_SLACK_PHASE + index, startTime, micros());
+      return;
+    }
+  }
+}
+
+// Software watchdog: blames a phase that started before the next tick was
+// due and ran on past it
+void ControlScheduler::recordPhase(int phase, unsigned long startTime, unsigned long endTime)
+{
+  PhaseStats &stats = _phases[phase];
+  unsigned long elapsed = endTime - startTime;
+  if (elapsed > stats.maxMicros)
+  {
+    stats.maxMicros = elapsed;
+  }
+
+  unsigned long deadline = _lastTickMicros + _periodMicros;
+  long late = static_cast<long>(endTime - deadline);
+  if (static_cast<long>(deadline - startTime) > 0 && late > static_cast<long>(LATE_MARGIN_MICROS))
+  {
+    stats.overruns++;
+    if (static_cast<unsigned long>(late) > stats.maxLateMicros)
+    {
+      stats.maxLateMicros = late;
+    }
+    _overruns++;
+    _lastOverrunPhase = stats.name;
+    _lastOverrunLateMicros = late;
+  }
+}
+
+unsigned long ControlScheduler::getPeriodMicros() const
+{
+  return _periodMicros;
+}
+
+unsigned long ControlScheduler::getTickCount() const
+{
+  return _tickCount;
+}
+
+unsigned long ControlScheduler::getMissedDeadlines() const
+{
+  return _missedDeadlines;
+}
+
+unsigned long ControlScheduler::getLastJitterMicros() const
+{
+  return _lastJitterMicros;
+}
+
+unsigned long ControlScheduler::getMaxJitterMicros() const
+{
+  return _maxJitterMicros;
+}
+
+unsigned long ControlScheduler::getLastTickMicros() const
+{
+  return _lastTickMicros;
+}
+
+bool ControlScheduler::adjustPhase(long micros)
+{
+  const long cyclesPerMicro = _periodCycles / _periodMicros;
+  long limit = _periodMicros / 2;
+  micros = constrain(micros, -limit, limit);
+
+  noInterrupts();
+  uint32_t compare = _nextCompare + micros * cyclesPerMicro;
+  // Leave some margin: a compare value already passed would not fire until the counter wraps
+  bool ok = static_cast<int32_t>(compare - ESP.getCycleCount()) > static_cast<int32_t>(_leadCycles);
+  if (ok)
+  {
+    _nextCompare = compare;
+    timer0_write(_nextCompare);
+  }
+  interrupts();
+  return ok;
+}
+
+unsigned long ControlScheduler::getMaxControlMicros() const
+{
+  return _phases[CONTROL_PHASE].maxMicros;
+}
+
+int ControlScheduler::getPhaseCount() const
+{
+  return FIRST_SLACK_PHASE + _slackTaskCount;
+}
+
+const ControlScheduler::PhaseStats &ControlScheduler::getPhase(int index) const
+{
+  return _phases[index];
+}
+
+unsigned long ControlScheduler::getOverruns() const
+{
+  return _overruns;
+}
+
+const char *ControlScheduler::getLastOverrunPhase() const
+{
+  return _lastOverrunPhase;
+}
+
+unsigned long ControlScheduler::getLastOverrunLateMicros() const
+{
+  return _lastOverrunLateMicros;
+}
+
+void ControlScheduler::resetStats()
+{
+  _tickCount = 0;
+  _missedDeadlines = 0;
+  _lastJitterMicros = 0;
+  _maxJitterMicros = 0;
+  for (int i = 0; i < FIRST_SLACK_PHASE + MAX_SLACK_TASKS; i++)
+  {
+    _phases[i].maxMicros = 0;
+    _phases[i].overruns = 0;
+    _phases[i].maxLateMicros = 0;
+  }
+  _overruns = 0;
+  _lastOverrunPhase = nullptr;
+  _lastOverrunLateMicros = 0;
+}
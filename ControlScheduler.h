@@ -0,0 +1,107 @@
+#ifndef ControlScheduler_h
+#define ControlScheduler_h
+
+#include <Arduino.h>
+#include <functional>
+
+// Runs one control task at a fixed rate driven by a hardware timer tick and
+// fills the time between ticks with slack tasks (web server, sensors, OTA).
+// The timer ISR timestamps the tick and runs the tick hook, if one is set,
+// for work that must happen at the tick itself (sampling the encoder); the
+// control task runs from loop().
+//
+// Each part of the loop is timed as a phase: the control task, each slack
+// task and "system", the time between run() calls that the SDK spends on
+// WiFi. A phase that ends more than LATE_MARGIN_MICROS after the next tick
+// was due counts as an overrun against it, which shows what starves the
+// control loop.
+class ControlScheduler {
+public:
+    typedef std::function<void()> Task;
+    typedef void (*TickHook)(unsigned long tickMicros); // Runs inside the timer ISR: IRAM_ATTR and short
+
+    static const unsigned long LATE_MARGIN_MICROS = 200;
+
+    struct PhaseStats {
+        const char *name;
+        unsigned long maxMicros;
+        unsigned long overruns;
+        unsigned long maxLateMicros; // Past the tick
+    };
+
+    ControlScheduler(unsigned long periodMicros);
+    void begin();
+    void setControlTask(Task task);
+    void setTickHook(TickHook hook);
+    bool addSlackTask(Task task, unsigned long budgetMicros, const char *name); // budget must be less than the period
+    void run(); // Call from loop()
+
+    unsigned long getPeriodMicros() const;
+    unsigned long getTickCount() const;
+    unsigned long getMissedDeadlines() const;
+    unsigned long getLastJitterMicros() const;
+    unsigned long getMaxJitterMicros() const;
+    unsigned long getMaxControlMicros() const;
+    unsigned long getLastTickMicros() const;
+    int getPhaseCount() const; // Control, system, then the slack tasks in order
+    const PhaseStats &getPhase(int index) const;
+    unsigned long getOverruns() const;
+    const char *getLastOverrunPhase() const; // nullptr until one happens
+    unsigned long getLastOverrunLateMicros() const;
+    void resetStats();
+    // Moves the next tick earlier (negative) or later by up to half a period,
+    // used to line the ticks up with other controllers. Refused if the moved
+    // tick would already have passed.
+    bool adjustPhase(long micros);
+    // Points timer0 back at this scheduler without restarting its ticks.
+    // begin() does it; only needed where several schedulers take turns on
+    // one timer, as the simulated controllers in sim/ do.
+    void attachTimer();
+
+private:
+    static const int MAX_SLACK_TASKS = 8;
+    static const int CONTROL_PHASE = 0;
+    static const int SYSTEM_PHASE = 1;
+    static const int FIRST_SLACK_PHASE = 2;
+    static const unsigned long MIN_LEAD_MICROS = 50; // A tick is armed at least this far ahead
+
+    struct SlackTask {
+        Task task;
+        unsigned long budgetMicros;
+    };
+
+    unsigned long _periodMicros;
+    Task _controlTask;
+    SlackTask _slackTasks[MAX_SLACK_TASKS];
+    int _slackTaskCount;
+    int _nextSlackTask;
+
+    unsigned long _lastTickMicros;  // Timestamp of the tick that was last dispatched
+    unsigned long _tickCount;
+    unsigned long _missedDeadlines; // Ticks that arrived before the previous one was dispatched, or never fired
+    unsigned long _lastJitterMicros; // Delay between the tick and the start of the control task
+    unsigned long _maxJitterMicros;
+    PhaseStats _phases[FIRST_SLACK_PHASE + MAX_SLACK_TASKS];
+    unsigned long _overruns;
+    const char *_lastOverrunPhase;
+    unsigned long _lastOverrunLateMicros;
+    unsigned long _lastExitMicros; // When run() last returned
+
+    // Shared with the timer ISR
+    volatile uint32_t _pendingTicks;
+    volatile unsigned long _tickMicros;
+    uint32_t _periodCycles;
+    uint32_t _nextCompare;
+    uint32_t _leadCycles;
+    volatile uint32_t _skippedTicks; // Given up by a late ISR, not yet counted as missed
+    TickHook _tickHook;
+
+    static ControlScheduler *_timerOwner; // The scheduler timer0 ticks
+
+    static void IRAM_ATTR onTimer();
+    void IRAM_ATTR tick();
+    void runSlackTask();
+    void recordPhase(int phase, unsigned long startTime, unsigned long endTime);
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include "DashboardSocket.h"
+#include <Hash.h>
+#include "JsonWriter.h"
+
+static const char *WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static const uint8_t OPCODE_TEXT = 0x1;
+static const uint8_t OPCODE_CLOSE = 0x8;
+
+DashboardSocket::DashboardSocket(MotorController &motorController, AHT21Sensor &aht21Sensor)
+    : _motorController(motorController), _aht21Sensor(aht21Sensor), _server(0),
+      _pushInterval(50), _lastPush(0), _framesSent(0), _framesSkipped(0)
+{
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    _clients[i].state = UNUSED;
+  }
+}
+
+void DashboardSocket::begin(uint16_t port, unsigned long rateHz)
+{
+  _pushInterval = rateHz > 0 ? 1000 / rateHz : 50;
+  _server.begin(port);
+  _server.setNoDelay(true);
+}
+
+void DashboardSocket::service()
+{
+  accept();
+
+  unsigned long now = millis();
+  bool due = now - _lastPush >= _pushInterval;
+  long values[FIELD_COUNT];
+  if (due)
+  {
+    _lastPush = now;
+    const ControlSample &sample = _motorController.getLastSample();
+    values[FIELD_SPEED] = lroundf(sample.speedRPM * 10);
+    values[FIELD_TARGET] = lroundf(sample.targetRPM * 10);
+    values[FIELD_POSITION] = static_cast<long>(_motorController.getEncoder().getPosition());
+    values[FIELD_OUTPUT] = lroundf(sample.output * 10);
+    values[FIELD_TEMPERATURE] = lroundf(_aht21Sensor.readTemperature() * 10);
+  }
+
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    Client &client = _clients[i];
+    if (client.state == UNUSED)
+    {
+      continue;
+    }
+    if (!client.socket.connected())
+    {
+      close(client);
+      continue;
+    }
+    if (client.state == CLOSING)
+    {
+      if (client.socket.availableForWrite() >= client.sendBuffer || millis() - client.since > CLOSE_TIMEOUT_MS)
+      {
+        close(client);
+      }
+      continue;
+    }
+    if (client.state == UPGRADING)
+    {
+      readHandshake(client);
+      continue;
+    }
+    readFrames(client);
+    if (client.state == STREAMING && due)
+    {
+      push(client, values, now);
+    }
+  }
+}
+
+void DashboardSocket::accept()
+{
+  if (!_server.hasClient())
+  {
+    return;
+  }
+  WiFiClient socket = _server.accept();
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    Client &client = _clients[i];
+    if (client.state == UNUSED)
+    {
+      client.socket = socket;
+      client.socket.setNoDelay(true);
+      client.sendBuffer = client.socket.availableForWrite();
+      client.state = UPGRADING;
+      client.key[0] = '\0';
+      client.lineLength = 0;
+      client.since = millis();
+      client.primed = false;
+      client.headerLength = 0;
+      client.remaining = 0;
+      return;
+    }
+  }
+  socket.stop(); // Full
+}
+
+// Reads the upgrade request a line at a time; only the key is needed
+void DashboardSocket::readHandshake(Client &client)
+{
+  while (client.socket.available() > 0)
+  {
+    char c = client.socket.read();
+    if (c != '\n')
+    {
+      if (c != '\r' && client.lineLength < sizeof(client.line) - 1)
+      {
+        client.line[client.lineLength++] = c;
+      }
+      continue;
+    }
+
+    client.line[client.lineLength] = '\0';
+    if (client.lineLength == 0)
+    {
+      // End of the request
+      if (client.key[0] == '\0' || !sendHandshake(client))
+      {
+        client.socket.write(reinterpret_cast<const uint8_t *>("HTTP/1.1 400 Bad Request\r\n\r\n"), 28);
+        finish(client);
+        return;
+      }
+      client.state = STREAMING;
+      client.since = millis();
+      return;
+    }
+    static const char KEY_HEADER[] = "sec-websocket-key:";
+    if (strncasecmp(client.line, KEY_HEADER, sizeof(KEY_HEADER) - 1) == 0)
+    {
+      const char *value = client.line + sizeof(KEY_HEADER) - 1;
+      while (*value == ' ')
+      {
+        value++;
+      }
+      strncpy(client.key, value, sizeof(client.key) - 1);
+      client.key[sizeof(client.key) - 1] = '\0';
+    }
+    client.lineLength = 0;
+  }
+
+  if (millis() - client.since > HANDSHAKE_TIMEOUT_MS)
+  {
+    close(client);
+  }
+}
+
+static void base64Encode(const uint8_t *data, size_t length, char *out)
+{
+  static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (size_t i = 0; i < length; i += 3)
+  {
+    uint32_t triple = data[i] << 16;
+    triple |= i + 1 < length ? data[i + 1] << 8 : 0;
+    triple |= i + 2 < length ? data[i + 2] : 0;
+    *out++ = ALPHABET[(triple >> 18) & 0x3F];
+    *out++ = ALPHABET[(triple >> 12) & 0x3F];
+    *out++ = i + 1 < length ? ALPHABET[(triple >> 6) & 0x3F] : '=';
+    *out++ = i + 2 < length ? ALPHABET[triple & 0x3F] : '=';
+  }
+  *out = '\0';
+}
+
+bool DashboardSocket::sendHandshake(Client &client)
+{
+  char source[sizeof(client.key) + 36];
+  snprintf(source, sizeof(source), "%s%s", client.key, WEBSOCKET_GUID);
+  uint8_t hash[20];
+  sha1(reinterpret_cast<const uint8_t *>(source), strlen(source), hash);
+  char accept[29];
+  base64Encode(hash, sizeof(hash), accept);
+
+  char response[160];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 101 Switching Protocols\r\n"
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Accept: %s\r\n\r\n",
+                        accept);
+  return client.socket.write(reinterpret_cast<const uint8_t *>(response), length) == static_cast<size_t>(length);
+}
+
+// The page sends nothing but a close, so payloads are discarded unread
+void DashboardSocket::readFrames(Client &client)
+{
+  while (client.socket.available() > 0)
+  {
+    if (client.remaining > 0)
+    {
+      client.socket.read();
+      client.remaining--;
+      continue;
+    }
+
+    client.header[client.headerLength++] = client.socket.read();
+    if (client.headerLength < 2)
+    {
+      continue;
+    }
+    uint8_t lengthCode = client.header[1] & 0x7F;
+    size_t needed = 2 + (lengthCode == 126 ? 2 : lengthCode == 127 ? 8 : 0) + (client.header[1] & 0x80 ? 4 : 0);
+    if (client.headerLength < needed)
+    {
+      continue;
+    }
+
+    if ((client.header[0] & 0x0F) == OPCODE_CLOSE)
+    {
+      sendFrame(client, OPCODE_CLOSE, nullptr, 0);
+      finish(client);
+      return;
+    }
+    if (lengthCode == 127)
+    {
+      close(client); // Nothing the page sends is that large
+      return;
+    }
+    client.remaining = lengthCode == 126 ? (client.header[2] << 8) | client.header[3] : lengthCode;
+    client.headerLength = 0;
+  }
+}
+
+void DashboardSocket::push(Client &client, const long *values, unsigned long now)
+{
+  static const char *names[FIELD_COUNT] = {"speed", "target", "position", "output", "temperature"};
+
+  char payload[FRAME_BUFFER_SIZE];
+  JsonWriter json(payload, sizeof(payload));
+  json.beginObject();
+  json.addInteger("t", now);
+  for (int field = 0; field < FIELD_COUNT; field++)
+  {
+    if (client.primed && values[field] == client.sent[field])
+    {
+      continue;
+    }
+    if (field == FIELD_POSITION)
+    {
+      json.addInteger(names[field], values[field]);
+    }
+    else
+    {
+      json.addNumber(names[field], values[field] / 10.0, 1);
+    }
+  }
+  json.endObject();
+
+  if (!sendFrame(client, OPCODE_TEXT, reinterpret_cast<const uint8_t *>(json.c_str()), json.length()))
+  {
+    _framesSkipped++;
+    if (now - client.since > STALL_TIMEOUT_MS)
+    {
+      close(client);
+    }
+    return;
+  }
+  memcpy(client.sent, values, sizeof(client.sent));
+  client.primed = true;
+  client.since = now;
+  _framesSent++;
+}
+
+// Server frames are unmasked. Written only if the whole frame fits in the
+// send buffer, so the write cannot block.
+bool DashboardSocket::sendFrame(Client &client, uint8_t opcode, const uint8_t *payload, size_t length)
+{
+  uint8_t frame[4 + FRAME_BUFFER_SIZE];
+  size_t headerLength = length < 126 ? 2 : 4;
+  if (length > FRAME_BUFFER_SIZE || client.socket.availableForWrite() < headerLength + length)
+  {
+    return false;
+  }
+  frame[0] = 0x80 | opcode; // FIN
+  if (length < 126)
+  {
+    frame[1] = length;
+  }
+  else
+  {
+    frame[1] = 126;
+    frame[2] = length >> 8;
+    frame[3] = length;
+  }
+  if (length > 0)
+  {
+    memcpy(frame + headerLength, payload, length);
+  }
+  return client.socket.write(frame, headerLength + length) == headerLength + length;
+}
+
+// Lets the browser ack what was written before the connection is closed
+void DashboardSocket::finish(Client &client)
+{
+  client.state = CLOSING;
+  client.since = millis();
+}
+
+// stop() waits for unacked data to go, so anything still in flight is
+// dropped with abort() instead
+void DashboardSocket::close(Client &client)
+{
+  if (client.socket.connected() && client.socket.availableForWrite() < client.sendBuffer)
+  {
+    client.socket.abort();
+  }
+  else
+  {
+    client.socket.stop();
+  }
+  client.state = UNUSED;
+}
+
+int DashboardSocket::getClientCount() const
+{
+  int count = 0;
+  for (int i = 0; i < MAX_CLIENTS; i++)
+  {
+    if (_clients[i].state == STREAMING)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+unsigned long DashboardSocket::getFramesSent() const
+{
+  return _framesSent;
+}
+
+unsigned long DashboardSocket::getFramesSkipped() const
+{
+  return _framesSkipped;
+}
@@ -0,0 +1,97 @@
+#ifndef DashboardSocket_h
+#define DashboardSocket_h
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include "AHT21Sensor.h"
+#include "MotorController.h"
+
+// Push-only WebSocket feed for the /dashboard page. Each connected browser
+// gets a text frame every push period holding a JSON object with "t"
+// (millis) and whichever of the fields below changed since the last frame it
+// was sent, at the resolution they are shown with:
+//
+//   speed, target  RPM, 0.1
+//   position       multi-turn ticks
+//   output         PID output, PWM units, 0.1
+//   temperature    °C, 0.1
+//
+// The first frame after connecting has every field. Runs from a slack task
+// and never waits on the network: a frame is only written when the socket's
+// send buffer has room for all of it. Otherwise the push is skipped and the
+// change carries over to the next frame, so a slow browser sees fewer
+// updates rather than holding up the control loop. A browser that has not
+// taken a frame for STALL_TIMEOUT_MS is dropped.
+//
+// Closing never waits either: WiFiClient::stop() flushes first, which can
+// take up to 300ms while the browser leaves data unacked. A connection is
+// stopped only once everything sent has been acked, and one that is still
+// behind after CLOSE_TIMEOUT_MS, or has stalled, is aborted with a reset.
+class DashboardSocket {
+public:
+    static const int MAX_CLIENTS = 2;
+    static const size_t FRAME_BUFFER_SIZE = 160;
+    static const unsigned long STALL_TIMEOUT_MS = 5000;
+    static const unsigned long HANDSHAKE_TIMEOUT_MS = 2000;
+    static const unsigned long CLOSE_TIMEOUT_MS = 1000; // For the browser to ack the last frames
+
+    DashboardSocket(MotorController &motorController, AHT21Sensor &aht21Sensor);
+    void begin(uint16_t port, unsigned long rateHz);
+    void service(); // Slack task: accepts, reads control frames and pushes
+
+    int getClientCount() const;
+    unsigned long getFramesSent() const;
+    unsigned long getFramesSkipped() const; // Pushes held back by a full send buffer
+
+private:
+    enum Field {
+        FIELD_SPEED,
+        FIELD_TARGET,
+        FIELD_POSITION,
+        FIELD_OUTPUT,
+        FIELD_TEMPERATURE,
+        FIELD_COUNT
+    };
+
+    enum ClientState {
+        UNUSED,
+        UPGRADING,
+        STREAMING,
+        CLOSING    // Last frame written, waiting for the browser to ack it
+    };
+
+    struct Client {
+        ClientState state;
+        WiFiClient socket;
+        char key[32];         // Sec-WebSocket-Key
+        char line[80];        // Request header line being read, truncated
+        size_t lineLength;
+        unsigned long since;  // millis, connected, last frame taken or closing
+        size_t sendBuffer;    // Free send buffer when nothing is in flight
+        bool primed;          // A full frame has been sent
+        long sent[FIELD_COUNT];
+        uint8_t header[14];   // Header of the frame the browser is sending
+        size_t headerLength;
+        uint32_t remaining;   // Its payload still to be discarded
+    };
+
+    MotorController &_motorController;
+    AHT21Sensor &_aht21Sensor;
+    WiFiServer _server;
+    unsigned long _pushInterval; // ms
+    unsigned long _lastPush;
+    Client _clients[MAX_CLIENTS];
+    unsigned long _framesSent;
+    unsigned long _framesSkipped;
+
+    void accept();
+    void readHandshake(Client &client);
+    bool sendHandshake(Client &client);
+    void readFrames(Client &client);
+    void push(Client &client, const long *values, unsigned long now);
+    bool sendFrame(Client &client, uint8_t opcode, const uint8_t *payload, size_t length);
+    void finish(Client &client);
+    void close(Client &client);
+};
+
+#endif
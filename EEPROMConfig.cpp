@@ -1,122 +1,267 @@
 #include "EEPROMConfig.h"
 
-EEPROMConfig::EEPROMConfig() {
-  // Constructor
+EEPROMConfig::EEPROMConfig(FlashDevice& flash) : _store(flash), _dirty(false) {
+  setDefaults();
+}
+
+void EEPROMConfig::setDefaults() {
+  memset(&_data, 0, sizeof(_data));
+  _data.calibrationState = true; // Not calibrated
+  _data.failsafeRampMs = 500;
+  _data.currentLimits.peakCurrent = 20;
+  _data.currentLimits.thermalTimeConstant = 30;
+  _data.currentLimits.senseAmpsPerCount = 0.0266f;
+  _dirty = true;
 }
 
 void EEPROMConfig::begin() {
-  EEPROM.begin(512);  // Adjust size if needed
+  setDefaults();
+  uint16_t version;
+  if (_store.load(&_data, sizeof(_data), version)) {
+    _dirty = false;
+    return;
+  }
+  // First boot with the ConfigStore: carry over what the EEPROM layout held
+  if (migrateLegacy()) {
+    commit();
+  }
 }
 
-void EEPROMConfig::clearEEPROM() {
-  for (int i = 0; i < 512; i++) {
-    EEPROM.write(i, 0xFF);
+// Copies a string from the old layout, where erased bytes read as 0xFF
+static void copyLegacyString(char* dest, const uint8_t* src, int length) {
+  int i = 0;
+  for (; i < length && src[i] != 0 && src[i] != 0xFF; ++i) {
+    dest[i] = src[i];
   }
-  EEPROM.commit();
+  dest[i] = '\0';
 }
 
-void EEPROMConfig::writeSSID(char* ssid) {
-  for (int i = 0; i < 32; ++i) {
-    EEPROM.write(SSID_START + i, ssid[i]);
+bool EEPROMConfig::migrateLegacy() {
+  uint32_t words[LEGACY_SIZE / 4];
+  const uint8_t* legacy = reinterpret_cast<const uint8_t*>(words);
+  if (!_store.readRaw(0, words, sizeof(words))) {
+    return false;
+  }
+  int used = 0;
+  for (int i = 0; i < LEGACY_SIZE; ++i) {
+    used |= legacy[i] != 0xFF;
   }
-  EEPROM.commit();
+  if (!used) {
+    return false;
+  }
+
+  copyLegacyString(_data.ssid, legacy + LEGACY_SSID, 32);
+  copyLegacyString(_data.password, legacy + LEGACY_PASSWORD, 64);
+  if (legacy[LEGACY_GUID_MARKER] == GUID_MARKER) {
+    _data.hasGUID = true;
+    memcpy(_data.guid, legacy + LEGACY_GUID, 36);
+  }
+  copyLegacyString(_data.deviceName, legacy + LEGACY_DEVICE_NAME, 20);
+  memcpy(&_data.temperatureCutoff, legacy + LEGACY_TEMP_CUTOFF, sizeof(float));
+  memcpy(&_data.maxRPM, legacy + LEGACY_RPM_LIMIT, sizeof(int32_t));
+  memcpy(&_data.voltageCutoff, legacy + LEGACY_VOLT_CUTOFF, sizeof(float));
+  _data.calibrationState = legacy[LEGACY_CALIBRATION_STATE] != 0;
+  if (!_data.calibrationState) {
+    memcpy(&_data.minOperationalSpeed, legacy + LEGACY_MIN_SPEED, sizeof(double));
+    memcpy(&_data.maxOperationalSpeed, legacy + LEGACY_MAX_SPEED, sizeof(double));
+  }
+  if (legacy[LEGACY_PID_MARKER] == PID_GAINS_MARKER) {
+    _data.hasPIDGains = true;
+    memcpy(&_data.pidGains, legacy + LEGACY_PID_GAINS, sizeof(PIDGains));
+  }
+  if (legacy[LEGACY_TABLE_MARKER] == SPEED_TABLE_MARKER) {
+    memcpy(&_data.speedTable, legacy + LEGACY_TABLE, sizeof(SpeedTable));
+    _data.hasSpeedTable = _data.speedTable.isValid();
+  }
+  return true;
 }
 
-void EEPROMConfig::readSSID(char* ssid) {
-  for (int i = 0; i < 32; ++i) {
-    ssid[i] = EEPROM.read(SSID_START + i);
+bool EEPROMConfig::commit() {
+  if (!_dirty) {
+    return true;
+  }
+  if (!_store.save(&_data, sizeof(_data), CONFIG_VERSION)) {
+    Serial.println("Config save failed, settings kept in RAM only");
+    return false;
   }
-  ssid[32] = '\0';  // Ensure null termination
+  _dirty = false;
+  return true;
 }
 
-void EEPROMConfig::writePassword(char* password) {
-  for (int i = 0; i < 64; ++i) {
-    EEPROM.write(PASSWORD_START + i, password[i]);
+void EEPROMConfig::update(void* field, const void* value, size_t size) {
+  if (memcmp(field, value, size) != 0) {
+    memcpy(field, value, size);
+    _dirty = true;
   }
-  EEPROM.commit();
+}
+
+void EEPROMConfig::clearEEPROM() {
+  setDefaults();
+  commit();
+}
+
+void EEPROMConfig::writeSSID(char* ssid) {
+  char value[sizeof(_data.ssid)] = {0};
+  strncpy(value, ssid, sizeof(value) - 1);
+  update(_data.ssid, value, sizeof(value));
+}
+
+void EEPROMConfig::readSSID(char* ssid) {
+  strcpy(ssid, _data.ssid);
+}
+
+void EEPROMConfig::writePassword(char* password) {
+  char value[sizeof(_data.password)] = {0};
+  strncpy(value, password, sizeof(value) - 1);
+  update(_data.password, value, sizeof(value));
 }
 
 void EEPROMConfig::readPassword(char* password) {
-  for (int i = 0; i < 64; ++i) {
-    password[i] = EEPROM.read(PASSWORD_START + i);
-  }
-  password[64] = '\0';  // Ensure null termination
+  strcpy(password, _data.password);
+}
+
+bool EEPROMConfig::hasGUID() {
+  return _data.hasGUID;
 }
 
 void EEPROMConfig::writeGUID(const char* guid) {
-  for (int i = 0; i < GUID_LENGTH; ++i) {
-    EEPROM.write(GUID_START + i, guid[i]);
-  }
-  EEPROM.commit();
+  char value[sizeof(_data.guid)] = {0};
+  strncpy(value, guid, sizeof(value) - 1);
+  update(_data.guid, value, sizeof(value));
+  bool stored = true;
+  update(&_data.hasGUID, &stored, sizeof(stored));
 }
 
 void EEPROMConfig::readGUID(char* guid) {
-  for (int i = 0; i < GUID_LENGTH; ++i) {
-    guid[i] = EEPROM.read(GUID_START + i);
-  }
-  guid[GUID_LENGTH] = '\0';  // Ensure null termination
+  strcpy(guid, _data.guid);
+}
+
+void EEPROMConfig::clearGUID() {
+  char value[sizeof(_data.guid)] = {0};
+  bool stored = false;
+  update(_data.guid, value, sizeof(value));
+  update(&_data.hasGUID, &stored, sizeof(stored));
 }
 
 void EEPROMConfig::writeTemperatureCutoff(float temp) {
-  writeData<float>(TEMP_CUTOFF_ADDR, temp);
+  update(&_data.temperatureCutoff, &temp, sizeof(temp));
 }
 
 float EEPROMConfig::readTemperatureCutoff() {
-  return readData<float>(TEMP_CUTOFF_ADDR);
+  return _data.temperatureCutoff;
 }
 
 void EEPROMConfig::writeMaxRPM(int rpm) {
-  writeData<int>(RPM_LIMIT_ADDR, rpm);
+  int32_t value = rpm;
+  update(&_data.maxRPM, &value, sizeof(value));
 }
 
 int EEPROMConfig::readMaxRPM() {
-  return readData<int>(RPM_LIMIT_ADDR);
+  return _data.maxRPM;
 }
 
 void EEPROMConfig::writeVoltageCutoff(float voltage) {
-  writeData<float>(VOLT_CUTOFF_ADDR, voltage);
+  update(&_data.voltageCutoff, &voltage, sizeof(voltage));
 }
 
 float EEPROMConfig::readVoltageCutoff() {
-  return readData<float>(VOLT_CUTOFF_ADDR);
+  return _data.voltageCutoff;
 }
 
 void EEPROMConfig::writeDeviceName(const String& name) {
-  for (int i = 0; i < DEVICE_NAME_LENGTH; ++i) {
-    EEPROM.write(DEVICE_NAME_ADDR + i, i < name.length() ? name[i] : 0);
-  }
-  EEPROM.commit();
+  char value[sizeof(_data.deviceName)] = {0};
+  strncpy(value, name.c_str(), sizeof(value) - 1);
+  update(_data.deviceName, value, sizeof(value));
 }
 
 String EEPROMConfig::readDeviceName() {
-  char name[DEVICE_NAME_LENGTH + 1];
-  for (int i = 0; i < DEVICE_NAME_LENGTH; ++i) {
-    name[i] = EEPROM.read(DEVICE_NAME_ADDR + i);
-  }
-  name[DEVICE_NAME_LENGTH] = '\0';  // Ensure null termination
-  return String(name);
+  return String(_data.deviceName);
 }
 
 void EEPROMConfig::writeMinOperationalSpeed(double speed) {
-  writeData<double>(MIN_OPERATIONAL_SPEED_ADDR, speed);
+  update(&_data.minOperationalSpeed, &speed, sizeof(speed));
 }
 
 double EEPROMConfig::readMinOperationalSpeed() {
-  return readData<double>(MIN_OPERATIONAL_SPEED_ADDR);
+  return _data.minOperationalSpeed;
 }
 
 void EEPROMConfig::writeMaxOperationalSpeed(double speed) {
-  writeData<double>(MAX_OPERATIONAL_SPEED_ADDR, speed);
+  update(&_data.maxOperationalSpeed, &speed, sizeof(speed));
 }
 
 double EEPROMConfig::readMaxOperationalSpeed() {
-  return readData<double>(MAX_OPERATIONAL_SPEED_ADDR);
+  return _data.maxOperationalSpeed;
 }
 
 void EEPROMConfig::writeCalibrationState(bool state) {
-  writeData<bool>(CALIBRATION_STATE_ADDR, state);
+  update(&_data.calibrationState, &state, sizeof(state));
 }
 
 bool EEPROMConfig::readCalibrationState() {
-  return readData<bool>(CALIBRATION_STATE_ADDR);
+  return _data.calibrationState;
+}
+
+bool EEPROMConfig::readPIDGains(PIDGains& gains) {
+  if (!_data.hasPIDGains) {
+    return false;
+  }
+  gains = _data.pidGains;
+  return true;
+}
+
+void EEPROMConfig::writePIDGains(const PIDGains& gains) {
+  bool stored = true;
+  update(&_data.pidGains, &gains, sizeof(gains));
+  update(&_data.hasPIDGains, &stored, sizeof(stored));
+}
+
+bool EEPROMConfig::readSpeedTable(SpeedTable& table) {
+  if (!_data.hasSpeedTable) {
+    return false;
+  }
+  table = _data.speedTable;
+  return table.isValid();
+}
+
+void EEPROMConfig::writeSpeedTable(const SpeedTable& table) {
+  bool stored = true;
+  update(&_data.speedTable, &table, sizeof(table));
+  update(&_data.hasSpeedTable, &stored, sizeof(stored));
+}
+
+uint8_t EEPROMConfig::readGroups() {
+  return _data.groups;
+}
+
+void EEPROMConfig::writeGroups(uint8_t groups) {
+  update(&_data.groups, &groups, sizeof(groups));
+}
+
+uint32_t EEPROMConfig::readCommandTimeout() {
+  return _data.commandTimeoutMs;
+}
+
+void EEPROMConfig::writeCommandTimeout(uint32_t timeoutMs) {
+  update(&_data.commandTimeoutMs, &timeoutMs, sizeof(timeoutMs));
+}
+
+uint32_t EEPROMConfig::readFailsafeRamp() {
+  return _data.failsafeRampMs;
+}
+
+void EEPROMConfig::writeFailsafeRamp(uint32_t rampMs) {
+  update(&_data.failsafeRampMs, &rampMs, sizeof(rampMs));
+}
+
+void EEPROMConfig::readCurrentLimits(CurrentLimits& limits) {
+  limits = _data.currentLimits;
+}
+
+void EEPROMConfig::writeCurrentLimits(const CurrentLimits& limits) {
+  update(&_data.currentLimits, &limits, sizeof(limits));
+}
+
+const ConfigStore& EEPROMConfig::getStore() const {
+  return _store;
 }
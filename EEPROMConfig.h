@@ -2,14 +2,35 @@
 #define EEPROMConfig_h
 
 #include <Arduino.h>
-#include <EEPROM.h>
+#include "ConfigStore.h"
+#include "HAL.h"
+#include "SpeedTable.h"
+
+struct PIDGains {
+  float kp;
+  float ki;
+  float kd;
+  float kf;
+};
+
+struct CurrentLimits {
+  float ratedCurrent;        // A, 0 when the current sense is not wired
+  float peakCurrent;         // A
+  float thermalTimeConstant; // s
+  float senseAmpsPerCount;   // A0 scale
+};
 
+// Settings are held in RAM and written to the ConfigStore as one record by
+// commit(), so a batch of changes costs a single flash write. The write
+// methods only mark the settings dirty when a value actually changes. A
+// failed save is logged and leaves them dirty, so the next commit() retries.
 class EEPROMConfig {
 public:
-  EEPROMConfig();
+  EEPROMConfig(FlashDevice& flash);
 
   void begin();
-  void clearEEPROM();
+  void clearEEPROM(); // Back to defaults, committed straight away
+  bool commit();      // Saves pending changes, true if there were none
 
   void readSSID(char* ssid);
   void writeSSID(char* SSID);
@@ -17,8 +38,10 @@ public:
   void readPassword(char* password);
   void writePassword(char* password);
 
+  bool hasGUID();
   void readGUID(char* guid);
   void writeGUID(const char* guid);
+  void clearGUID();
 
   float readTemperatureCutoff();
   void writeTemperatureCutoff(float temp);
@@ -41,37 +64,80 @@ public:
   bool readCalibrationState();
   void writeCalibrationState(bool state);
 
+  bool readPIDGains(PIDGains& gains); // false if none have been stored
+  void writePIDGains(const PIDGains& gains);
+
+  bool readSpeedTable(SpeedTable& table); // false if no sweep has been stored
+  void writeSpeedTable(const SpeedTable& table);
+
+  uint8_t readGroups(); // Bit n set for membership of group n
+  void writeGroups(uint8_t groups);
+
+  uint32_t readCommandTimeout(); // ms, 0 when the failsafe is off
+  void writeCommandTimeout(uint32_t timeoutMs);
+  uint32_t readFailsafeRamp();   // ms
+  void writeFailsafeRamp(uint32_t rampMs);
+
+  void readCurrentLimits(CurrentLimits& limits);
+  void writeCurrentLimits(const CurrentLimits& limits);
+
+  const ConfigStore& getStore() const;
+
 private:
-  const int SSID_START = 0;
-  const int SSID_SIZE = 32;
-  const int PASSWORD_START = SSID_START + SSID_SIZE;
-  const int PASSWORD_SIZE = 64;
-
-  const int GUID_START = 100;
-  const int GUID_LENGTH = 36;
-
-  const int TEMP_CUTOFF_ADDR = GUID_START + GUID_LENGTH + 1;
-  const int RPM_LIMIT_ADDR = TEMP_CUTOFF_ADDR + sizeof(float);
-  const int VOLT_CUTOFF_ADDR = RPM_LIMIT_ADDR + sizeof(int);
-  const int DEVICE_NAME_ADDR = VOLT_CUTOFF_ADDR + sizeof(float);
-  const int DEVICE_NAME_LENGTH = 20;
-  const int MIN_OPERATIONAL_SPEED_ADDR = DEVICE_NAME_ADDR + DEVICE_NAME_LENGTH + 1;
-  const int MAX_OPERATIONAL_SPEED_ADDR = MIN_OPERATIONAL_SPEED_ADDR + sizeof(double);
-  const int CALIBRATION_STATE_ADDR = MAX_OPERATIONAL_SPEED_ADDR + sizeof(double);
+  // Stored as one record. Only ever append fields and bump CONFIG_VERSION:
+  // a record from older firmware leaves the new fields at their defaults.
+  static const uint16_t CONFIG_VERSION = 4;
+  struct ConfigData {
+    char ssid[33];
+    char password[65];
+    bool hasGUID;
+    char guid[37];
+    char deviceName[21];
+    float temperatureCutoff;
+    int32_t maxRPM;
+    float voltageCutoff;
+    double minOperationalSpeed;
+    double maxOperationalSpeed;
+    bool calibrationState; // false once calibrated, as in the old layout
+    bool hasPIDGains;
+    PIDGains pidGains;
+    bool hasSpeedTable;
+    SpeedTable speedTable;
+    uint8_t groups; // Version 2
+    uint32_t commandTimeoutMs; // Version 3
+    uint32_t failsafeRampMs;
+    CurrentLimits currentLimits; // Version 4
+  };
+  static_assert(sizeof(ConfigData) <= ConfigStore::MAX_PAYLOAD, "ConfigData no longer fits a ConfigStore record");
+
+  ConfigStore _store;
+  ConfigData _data;
+  bool _dirty;
+
+  void setDefaults();
+  bool migrateLegacy();
+  void update(void* field, const void* value, size_t size);
+
+  // Byte offsets of the EEPROM layout used before the ConfigStore
+  static const int LEGACY_SIZE = 512;
+  static const int LEGACY_SSID = 0;
+  static const int LEGACY_PASSWORD = 32;
+  static const int LEGACY_GUID_MARKER = 99;
+  static const int LEGACY_GUID = 100;
+  static const int LEGACY_TEMP_CUTOFF = 137;
+  static const int LEGACY_RPM_LIMIT = 141;
+  static const int LEGACY_VOLT_CUTOFF = 145;
+  static const int LEGACY_DEVICE_NAME = 149;
+  static const int LEGACY_MIN_SPEED = 170;
+  static const int LEGACY_MAX_SPEED = 178;
+  static const int LEGACY_CALIBRATION_STATE = 186;
+  static const int LEGACY_PID_MARKER = 187;
+  static const int LEGACY_PID_GAINS = 188;
+  static const int LEGACY_TABLE_MARKER = 204;
+  static const int LEGACY_TABLE = 205;
+  const uint8_t GUID_MARKER = 0xAA;
+  const uint8_t PID_GAINS_MARKER = 0xA5;
+  const uint8_t SPEED_TABLE_MARKER = 0xA6;
 };
 
-// Template function definitions
-template<typename T>
-T readData(int address) {
-  T value;
-  EEPROM.get(address, value);
-  return value;
-}
-
-template<typename T>
-void writeData(int address, const T& value) {
-  EEPROM.put(address, value);
-  EEPROM.commit();
-}
-
 #endif
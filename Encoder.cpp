@@ -1,34 +1,125 @@
 #include "Encoder.h"
-#include <Wire.h>
 
-#define AS5600_RAW_ANGLE_REG 0x0C // Register for the 12-bit raw angle
+// The OUT pin in its 10-90% range, through the NodeMCU's A0 divider that
+// reads 3.2V full scale: 0.33V to 2.97V of the 3.3V supply
+static const int ANALOG_LOW_COUNTS = 105;
+static const int ANALOG_HIGH_COUNTS = 950;
 
-Encoder::Encoder(uint8_t i2cAddress) : _i2cAddress(i2cAddress)
+// A PWM frame is 4351 clocks: 128 high, the angle over 4095, then 128 low
+static const uint32_t PWM_FRAME_CLOCKS = 4351;
+static const uint32_t PWM_HEADER_CLOCKS = 128;
+static const unsigned long PWM_TIMEOUT_MICROS = 5000; // About 5 frames without an edge: unplugged
+
+static const uint8_t OUTS_ANALOG_REDUCED = 0x10;
+static const uint8_t OUTS_PWM = 0x20;
+static const uint8_t PWMF_920HZ = 0xC0;
+
+// Readings further apart than this fail the cross-check: a few ADC counts,
+// or a PWM frame of movement at the cross-check speed limit
+static const int ANALOG_TOLERANCE_TICKS = 32;
+static const int PWM_TOLERANCE_TICKS = 8;
+static const float CROSS_CHECK_MAX_SPEED = 4096; // ticks per second, 60 RPM
+
+// A reading this far from the prediction always passes: the sensor's noise
+// and the estimate's error at constant speed
+static const int OUTLIER_MARGIN_TICKS = 16;
+// Never more than a quarter turn, however long since the last reading:
+// past that a glitched top bit could pass
+static const int MAX_DEVIATION_TICKS = 1024;
+
+// Each bad sample (outlier or failed read) adds to the score and each good
+// one takes 1 away: more than five bad in the last fifty distrusts the
+// encoder, and it is trusted again below one
+static const int BAD_SAMPLE_WEIGHT = 10;
+static const int MAX_BAD_SCORE = 100;
+static const int DISTRUST_SCORE = 50;
+static const int TRUST_SCORE = 10;
+static const unsigned long STALE_MICROS = 50000; // Ten control steps without a good sample
+
+// Difference between two angles, -2048..2047
+static int wrapTicks(int difference)
+{
+  return ((difference + 2048) & 0x0FFF) - 2048;
+}
+
+Encoder::Encoder(Hal &hal, uint8_t i2cAddress) : _hal(hal), _i2cAddress(i2cAddress)
 {
   _lastRawAngle = 0;
-  _totalRevolutions = 0;
+  _totalTicks = 0;
   _speed = 0.0;
-  _lastUpdateTime = millis();
+  _lastUpdateTime = 0;
+  _estimatorCycles = 0;
+  _nextSequence = 0;
+  _expectedSequence = 0;
+  _source = SOURCE_I2C;
+  _crossCheck = CrossCheck();
+  _lastCrossCheck = 0;
+  _maxAcceleration = DEFAULT_MAX_ACCELERATION;
+  _tickRate = 0;
+  _lastInterval = 0;
+  _outliers = 0;
+  _resyncSamples = 0;
+  _health = Health();
+  _health.trusted = true;
+  _badScore = 0;
+  _lastGoodMicros = 0;
+  _healthState = HEALTH_IDLE;
+  _healthTransaction.done = true;
+  _healthTransaction.ok = false;
+  _lastHealthRead = 0;
+  _benchmark = BenchmarkRun();
+  resetSampleStats();
 }
 
-void Encoder::begin()
+void Encoder::begin(Source source)
 {
-  Wire.begin();
+  _source = source;
   _lastSpeed = 0;
-  _lastRawAngle = readRawAngle(); // Initial reading
+  if (_source != SOURCE_I2C)
+  {
+    configureOutput();
+    checkAgainstBus(true);
+  }
+  unsigned long timestampMicros;
+  if (!readSource(_source, _lastRawAngle, timestampMicros)) // Initial reading
+  {
+    _lastRawAngle = -1;
+  }
+  _lastUpdateTime = _hal.clock.micros();
+  _lastCrossCheck = _lastUpdateTime;
+  _lastGoodMicros = _lastUpdateTime;
+  _estimator.reset(_totalTicks, _lastUpdateTime);
 }
 
-int Encoder::readRawAngle()
+Encoder::Source Encoder::getSource() const
+{
+  return _source;
+}
+
+// Sets the OUT pin mode, keeping the hysteresis and power mode bits
+void Encoder::configureOutput()
 {
-  Wire.beginTransmission(_i2cAddress);
-  Wire.write(AS5600_RAW_ANGLE_REG);
-  Wire.endTransmission(false);
+  uint8_t conf = 0;
+  _hal.i2c.readRegister(_i2cAddress, CONF_LOW_REG, &conf, 1);
+  conf &= 0x0F;
+  conf |= _source == SOURCE_PWM ? PWMF_920HZ | OUTS_PWM : OUTS_ANALOG_REDUCED;
+  uint8_t command[2] = {CONF_LOW_REG, conf};
+  _hal.i2c.write(_i2cAddress, command, 2);
 
-  Wire.requestFrom(static_cast<int>(_i2cAddress), 2);
-  if (Wire.available() == 2)
+  if (_source == SOURCE_PWM)
   {
-    uint16_t rawAngle = Wire.read() << 8;
-    rawAngle |= Wire.read();
+    _hal.pulse.begin();
+    _hal.clock.delay(5); // A few frames in the new mode
+  }
+}
+
+int Encoder::readRawAngle()
+{
+  uint8_t data[2];
+  if (_hal.i2c.readRegister(_i2cAddress, RAW_ANGLE_REG, data, 2))
+  {
+    uint16_t rawAngle = data[0] << 8;
+    rawAngle |= data[1];
     return static_cast<int>(rawAngle);
   }
   else
@@ -37,46 +128,487 @@ int Encoder::readRawAngle()
   }
 }
 
-void Encoder::update() {
-  unsigned long currentTime = millis();
-  int currentRawAngle = readRawAngle();
+// The OUT voltage, offset by the cross-check
+int Encoder::readAnalogAngle()
+{
+  int counts = _hal.analog.read();
+  int rawAngle = (counts - ANALOG_LOW_COUNTS) * 4096L / (ANALOG_HIGH_COUNTS - ANALOG_LOW_COUNTS);
+  rawAngle = rawAngle < 0 ? 0 : rawAngle > 4095 ? 4095 : rawAngle;
+  return (rawAngle + _crossCheck.offset) & 0x0FFF;
+}
+
+// The last PWM frame, offset by the cross-check and timestamped when it
+// ended. Interrupt safe.
+bool Encoder::readPwmAngle(int &rawAngle, unsigned long &timestampMicros)
+{
+  PulseInput::Pulse pulse;
+  if (!_hal.pulse.read(pulse) || pulse.periodCycles == 0 ||
+      _hal.clock.micros() - pulse.endMicros > PWM_TIMEOUT_MICROS)
+  {
+    return false;
+  }
+  // In sixteenths of a clock, for the resolution of the cycle counts
+  int32_t clocks = static_cast<uint64_t>(pulse.highCycles) * PWM_FRAME_CLOCKS * 16 / pulse.periodCycles;
+  int32_t angle = (clocks - static_cast<int32_t>(PWM_HEADER_CLOCKS * 16)) * 4096 / (4095 * 16);
+  angle = angle < 0 ? 0 : angle > 4095 ? 4095 : angle;
+  rawAngle = (angle + _crossCheck.offset) & 0x0FFF;
+  timestampMicros = pulse.endMicros;
+  return true;
+}
 
-  if (currentRawAngle != -1) {
-    // Handle wraparound
-    int angleDifference = currentRawAngle - _lastRawAngle;
-    if (angleDifference > 2048) { // More than half the encoder range in the negative direction
-      angleDifference -= 4096; // Adjust for wraparound in the negative direction
-    } else if (angleDifference < -2048) { // More than half the encoder range in the positive direction
-      angleDifference += 4096; // Adjust for wraparound in the positive direction
+bool Encoder::readSource(Source source, int &rawAngle, unsigned long &timestampMicros)
+{
+  switch (source)
+  {
+  case SOURCE_ANALOG:
+    rawAngle = readAnalogAngle();
+    timestampMicros = _hal.clock.micros();
+    return true;
+  case SOURCE_PWM:
+    return readPwmAngle(rawAngle, timestampMicros);
+  default:
+    uint8_t data[2];
+    if (!_hal.i2c.readRegister(_i2cAddress, RAW_ANGLE_REG, data, 2))
+    {
+      return false; // data was never filled in
     }
+    rawAngle = data[0] << 8 | data[1];
+    timestampMicros = _hal.clock.micros(); // Once the read has completed
+    return true;
+  }
+}
 
-    unsigned long timeDifference = currentTime - _lastUpdateTime;
+void IRAM_ATTR Encoder::sample(unsigned long tickMicros)
+{
+  EncoderSample tick;
+  tick.sequence = _nextSequence++;
+  tick.timestampMicros = tickMicros;
+  _samples.push(tick); // A full queue drops it; update() sees the gap
+}
 
-    // Ensure time difference is not zero to avoid division by zero
-    if (timeDifference > 0) {
-      // Calculate speed in ticks per millisecond, and then convert to ticks per second
-      float newSpeed = (angleDifference / static_cast<float>(timeDifference)) * 1000.0;
-      // Simple low-pass filter to smooth out speed reading
-      _speed = _speed * 0.9 + newSpeed * 0.1;
-    }
+void Encoder::update()
+{
+  int ticks = 0;
+  unsigned long tickMicros = 0;
+  EncoderSample tick;
+  while (_samples.pop(tick))
+  {
+    _samplesLost += tick.sequence - _expectedSequence;
+    _expectedSequence = tick.sequence + 1;
+    tickMicros = tick.timestampMicros;
+    ticks++;
+  }
 
-    // Update total revolutions and direction
-    if (angleDifference > 0) {
-      _totalRevolutions += angleDifference;
-      _direction = "CW";
-    } else if (angleDifference < 0) {
-      _totalRevolutions += angleDifference; // This will decrement since angleDifference is negative
-      _direction = "CCW";
+  // One angle for all the ticks picked up: if the loop ran late, angles
+  // for the older ticks would be no use by now
+  int currentRawAngle;
+  unsigned long currentTime;
+  if (!readSource(_source, currentRawAngle, currentTime))
+  {
+    _samplesSkipped += ticks;
+    _health.readErrors++;
+    recordBadSample();
+  }
+  else if (static_cast<long>(currentTime - _lastUpdateTime) > 0)
+  {
+    if (ticks > 0)
+    {
+      _samplesTaken++;
+      _samplesSkipped += ticks - 1;
+      unsigned long latency = currentTime - tickMicros;
+      _maxSampleLatency = latency > _maxSampleLatency ? latency : _maxSampleLatency;
+    }
+    else
+    {
+      _directReads++;
     }
+    applySample(currentRawAngle, currentTime);
+  }
+  else
+  {
+    _samplesSkipped += ticks; // The clock has not moved since the last angle
+  }
+
+  updateHealthRead();
+  updateTrust();
+
+  if (_source != SOURCE_I2C && _hal.clock.micros() - _lastCrossCheck >= CROSS_CHECK_INTERVAL_MICROS)
+  {
+    _lastCrossCheck = _hal.clock.micros();
+    checkAgainstBus(false);
+  }
+}
 
+// Compares a fresh OUT reading with the bus and moves the offset a quarter
+// of the way to close the gap, or all of it the first time. A PWM reading
+// can be a frame old, so the two only agree while the motor is slow.
+void Encoder::checkAgainstBus(bool initial)
+{
+  if (!initial && fabs(_speed) > CROSS_CHECK_MAX_SPEED)
+  {
+    _crossCheck.skipped++;
+    return;
+  }
+  int outAngle;
+  unsigned long timestampMicros;
+  if (!readSource(_source, outAngle, timestampMicros))
+  {
+    _crossCheck.failures++;
+    return;
+  }
+  int busAngle = readRawAngle();
+  if (busAngle == -1)
+  {
+    return;
+  }
+
+  int error = wrapTicks(busAngle - outAngle);
+  _crossCheck.count++;
+  _crossCheck.lastError = error;
+  if (abs(error) > _crossCheck.maxError)
+  {
+    _crossCheck.maxError = abs(error);
+  }
+  int tolerance = _source == SOURCE_PWM ? PWM_TOLERANCE_TICKS : ANALOG_TOLERANCE_TICKS;
+  if (!initial && abs(error) > tolerance)
+  {
+    _crossCheck.failures++;
+  }
+  _crossCheck.offset = wrapTicks(_crossCheck.offset + (initial ? error : error / 4));
+}
+
+// Unwraps the reading around where the last speed says the shaft should
+// be, rather than around the last angle. A reading further from that than
+// the maximum acceleration allows, such as a glitched high bit that looks
+// like a half-turn jump, is dropped. Outliers that outnumber the good
+// readings between them mean the prediction is what is wrong: the latest
+// reading becomes the reference and the next two are taken as they are, to
+// find the speed again. Going from the last good reading instead could
+// unwrap a long gap the wrong way and lock on to the alias.
+void Encoder::applySample(int currentRawAngle, unsigned long currentTime)
+{
+  if (_lastRawAngle < 0) // No reading yet to go from
+  {
     _lastRawAngle = currentRawAngle;
     _lastUpdateTime = currentTime;
+    return;
+  }
+
+  float interval = (currentTime - _lastUpdateTime) / 1000000.0f;
+  int angleDifference;
+  if (_resyncSamples > 0)
+  {
+    angleDifference = wrapTicks(currentRawAngle - _lastRawAngle);
+    _resyncSamples--;
+  }
+  else
+  {
+    int predicted = static_cast<int>(lroundf(_tickRate * interval));
+    int deviation = wrapTicks(currentRawAngle - _lastRawAngle - predicted);
+    float allowed = OUTLIER_MARGIN_TICKS + _maxAcceleration * interval * (interval + _lastInterval) / 2;
+    if (abs(deviation) > (allowed < MAX_DEVIATION_TICKS ? allowed : MAX_DEVIATION_TICKS))
+    {
+      _health.outliers++;
+      recordBadSample();
+      if (++_outliers >= RESYNC_OUTLIERS)
+      {
+        _outliers = 0;
+        _resyncSamples = 2;
+        _totalTicks += wrapTicks(currentRawAngle - _lastRawAngle); // The best guess at the travel
+        _lastRawAngle = currentRawAngle;
+        _lastUpdateTime = currentTime;
+      }
+      return;
+    }
+    angleDifference = predicted + deviation;
   }
+  if (_outliers > 0)
+  {
+    _outliers--;
+  }
+  recordGoodSample(currentTime);
+
+  // Update the multi-turn count and direction
+  _totalTicks += angleDifference;
+  if (angleDifference > 0) {
+    _direction = "CW";
+  } else if (angleDifference < 0) {
+    _direction = "CCW";
+  }
+
+  uint32_t startCycles = _hal.clock.cycles();
+  _speed = _estimator.update(_totalTicks, currentTime);
+  _estimatorCycles = _hal.clock.cycles() - startCycles;
+
+  _tickRate = interval > 0 ? angleDifference / interval : 0;
+  _lastInterval = interval;
+  _lastRawAngle = currentRawAngle;
+  _lastUpdateTime = currentTime;
+}
+
+void Encoder::recordGoodSample(unsigned long timestampMicros)
+{
+  _lastGoodMicros = timestampMicros;
+  if (_badScore > 0)
+  {
+    _badScore--;
+  }
+}
+
+void Encoder::recordBadSample()
+{
+  _badScore += BAD_SAMPLE_WEIGHT;
+  if (_badScore > MAX_BAD_SCORE)
+  {
+    _badScore = MAX_BAD_SCORE;
+  }
+}
+
+// STATUS, then AGC and MAGNITUDE, queued on the bus for slack time so the
+// control step never waits on them
+void Encoder::updateHealthRead()
+{
+  switch (_healthState)
+  {
+  case HEALTH_IDLE:
+    if (_hal.clock.micros() - _lastHealthRead >= HEALTH_INTERVAL_MICROS)
+    {
+      _lastHealthRead = _hal.clock.micros();
+      submitHealthRead(STATUS_REG, _healthData, 1, HEALTH_STATUS);
+    }
+    break;
+  case HEALTH_STATUS:
+    if (_healthTransaction.done)
+    {
+      if (_healthTransaction.ok)
+      {
+        _health.status = _healthData[0] & (STATUS_MAGNET_DETECTED | STATUS_MAGNET_WEAK | STATUS_MAGNET_STRONG);
+        submitHealthRead(AGC_REG, _healthData, 3, HEALTH_AGC);
+      }
+      else
+      {
+        _health.readErrors++;
+        _healthState = HEALTH_IDLE;
+      }
+    }
+    break;
+  case HEALTH_AGC:
+    if (_healthTransaction.done)
+    {
+      if (_healthTransaction.ok)
+      {
+        _health.agc = _healthData[0];
+        _health.magnitude = (_healthData[1] & 0x0F) << 8 | _healthData[2];
+        _health.checks++;
+      }
+      else
+      {
+        _health.readErrors++;
+      }
+      _healthState = HEALTH_IDLE;
+    }
+    break;
+  }
+}
+
+void Encoder::submitHealthRead(uint8_t reg, uint8_t *buffer, size_t length, HealthState next)
+{
+  _healthRegister = reg;
+  _healthTransaction.address = _i2cAddress;
+  _healthTransaction.writeData = &_healthRegister;
+  _healthTransaction.writeLength = 1;
+  _healthTransaction.readBuffer = buffer;
+  _healthTransaction.readLength = length;
+  _healthState = _hal.i2c.submit(_healthTransaction) ? next : HEALTH_IDLE;
+}
+
+// Distrusted at once on a missing or weak magnet, a run of bad samples or
+// no good one for a while; trusted again only once the bad samples have
+// mostly aged out
+void Encoder::updateTrust()
+{
+  bool magnetOk = _health.checks == 0 ||
+                  (_health.status & (STATUS_MAGNET_DETECTED | STATUS_MAGNET_WEAK)) == STATUS_MAGNET_DETECTED;
+  bool fresh = _hal.clock.micros() - _lastGoodMicros < STALE_MICROS;
+  if (_health.trusted && (!magnetOk || !fresh || _badScore > DISTRUST_SCORE))
+  {
+    _health.trusted = false;
+    _health.distrusts++;
+  }
+  else if (!_health.trusted && magnetOk && fresh && _badScore < TRUST_SCORE)
+  {
+    _health.trusted = true;
+  }
+}
+
+void Encoder::setEstimator(VelocityEstimator::Mode mode)
+{
+  _estimator.setMode(mode);
+}
+
+VelocityEstimator::Mode Encoder::getEstimator() const
+{
+  return _estimator.getMode();
+}
+
+uint32_t Encoder::getEstimatorCycles() const
+{
+  return _estimatorCycles;
+}
+
+unsigned long Encoder::getSamplesTaken() const
+{
+  return _samplesTaken;
+}
+
+unsigned long Encoder::getSamplesSkipped() const
+{
+  return _samplesSkipped;
+}
+
+unsigned long Encoder::getSamplesLost() const
+{
+  return _samplesLost;
+}
+
+unsigned long Encoder::getDirectReads() const
+{
+  return _directReads;
+}
+
+unsigned long Encoder::getMaxSampleLatency() const
+{
+  return _maxSampleLatency;
+}
+
+void Encoder::resetSampleStats()
+{
+  _samplesTaken = 0;
+  _samplesSkipped = 0;
+  _samplesLost = 0;
+  _directReads = 0;
+  _maxSampleLatency = 0;
+}
+
+void Encoder::setMaxAcceleration(float ticksPerSecondSquared)
+{
+  _maxAcceleration = ticksPerSecondSquared;
+}
+
+float Encoder::getMaxAcceleration() const
+{
+  return _maxAcceleration;
+}
+
+const Encoder::Health &Encoder::getHealth() const
+{
+  return _health;
+}
+
+bool Encoder::isTrusted() const
+{
+  return _health.trusted;
+}
+
+const Encoder::CrossCheck &Encoder::getCrossCheck() const
+{
+  return _crossCheck;
+}
+
+// A PWM angle can be read as often as wanted but only changes once a frame,
+// and each frame costs two edge interrupts
+bool Encoder::startBenchmark(int samples)
+{
+  if (_benchmark.running || samples <= 0)
+  {
+    return false;
+  }
+  unsigned long runs = _benchmark.runs;
+  _benchmark = BenchmarkRun();
+  _benchmark.runs = runs;
+  _benchmark.running = true;
+  _benchmark.samples = samples;
+  _benchmark.source = SOURCE_I2C;
+  return true;
+}
+
+// Only the reads are timed, so the figures do not depend on how the run
+// was sliced up
+void Encoder::serviceBenchmark()
+{
+  BenchmarkRun &run = _benchmark;
+  if (!run.running)
+  {
+    return;
+  }
+  Benchmark &result = run.results[run.source];
+  unsigned long startMicros = _hal.clock.micros();
+  uint32_t startCycles = _hal.clock.cycles();
+  for (int i = 0; i < BENCHMARK_SLICE_READS && run.reads < run.samples &&
+                  _hal.clock.micros() - startMicros < BENCHMARK_SLICE_MICROS;
+       i++)
+  {
+    int rawAngle;
+    unsigned long timestampMicros;
+    if (readSource(static_cast<Source>(run.source), rawAngle, timestampMicros))
+    {
+      result.samples++;
+    }
+    run.reads++;
+  }
+  run.cycles += _hal.clock.cycles() - startCycles;
+  run.micros += _hal.clock.micros() - startMicros;
+  if (run.reads < run.samples)
+  {
+    return;
+  }
+
+  finishBenchmark(result);
+  run.reads = 0;
+  run.micros = 0;
+  run.cycles = 0;
+  if (run.source < SOURCE_PWM)
+  {
+    run.source++;
+    return;
+  }
+  run.running = false;
+  run.runs++;
+}
+
+void Encoder::finishBenchmark(Benchmark &result)
+{
+  const BenchmarkRun &run = _benchmark;
+  result.microsPerSample = static_cast<float>(run.micros) / run.samples;
+  result.cyclesPerSample = run.cycles / run.samples;
+  if (run.source == SOURCE_PWM)
+  {
+    PulseInput::Pulse pulse;
+    if (result.samples > 0 && _hal.pulse.read(pulse))
+    {
+      result.cyclesPerSample += _hal.pulse.getEdgeCycles() / pulse.count;
+      result.maxRateHz = PWM_FREQUENCY_HZ;
+    }
+  }
+  else if (result.samples > 0 && run.micros > 0)
+  {
+    result.maxRateHz = static_cast<unsigned long>(1000000.0f / result.microsPerSample);
+  }
+}
+
+const Encoder::BenchmarkRun &Encoder::getBenchmarkRun() const
+{
+  return _benchmark;
+}
+
+int Encoder::getRawAngle()
+{
+  return _lastRawAngle;
 }
 
-long Encoder::getTotalRevolutions()
+int64_t Encoder::getPosition()
 {
-  return _totalRevolutions;
+  return -_totalTicks; // Inverted to match getSpeed()
 }
 
 float Encoder::getSpeed()
@@ -2,25 +2,177 @@
 #define Encoder_h
 
 #include <Arduino.h>
+#include "HAL.h"
+#include "VelocityEstimator.h"
+#include "EncoderSampleQueue.h"
 
+// AS5600 angle, unwrapped into a multi-turn position with a speed estimate.
+// sample() only queues the control tick from the timer interrupt: a bus
+// read there would block the interrupt for a transfer and run code from
+// flash. update() reads the angle from the control task, once for however
+// many ticks it found queued, and counts the ticks lost to a full queue.
+//
+// The angle can also come from the AS5600 OUT pin instead of the bus: as a
+// voltage on A0 or as a PWM duty timed by a pin-change interrupt. Either is
+// compared with the bus reading once a second while the motor is slow, and
+// the difference is taken out of the OUT readings as an offset.
+//
+// Health: STATUS, AGC and MAGNITUDE are read in slack time ten times a
+// second, and angles that would need an impossible acceleration are
+// dropped. A missing or weak magnet, a run of dropped or failed readings, or
+// no good reading for 50ms makes the encoder untrusted until it recovers.
 class Encoder {
 public:
-    Encoder(uint8_t i2cAddress);
-    void begin();
-    int readRawAngle();
-    void update();
-    long getTotalRevolutions();
+    static const uint8_t RAW_ANGLE_REG = 0x0C; // AS5600 12-bit raw angle, high byte first
+    static const uint8_t CONF_LOW_REG = 0x08;  // PWMF, OUTS, HYST, PM; not burned, so reset at power up
+    static const int PWM_FREQUENCY_HZ = 920;   // PWMF = 3, the fastest
+    static const unsigned long CROSS_CHECK_INTERVAL_MICROS = 1000000;
+    static const uint8_t STATUS_REG = 0x0B;
+    static const uint8_t AGC_REG = 0x1A;      // Followed by MAGNITUDE, 12 bits high byte first
+    static const uint8_t STATUS_MAGNET_DETECTED = 0x20; // MD
+    static const uint8_t STATUS_MAGNET_WEAK = 0x10;     // ML, AGC at maximum gain
+    static const uint8_t STATUS_MAGNET_STRONG = 0x08;   // MH, AGC at minimum gain
+    static const unsigned long HEALTH_INTERVAL_MICROS = 100000;
+    static const int RESYNC_OUTLIERS = 3;
+    static const int BENCHMARK_SLICE_READS = 8;              // A serviceBenchmark() call reads at most this many
+    static const unsigned long BENCHMARK_SLICE_MICROS = 400; // or stops once it has taken this long
+    // A little over what the 775 at 24V can do unloaded: 1.2Nm stall
+    // torque on the rotor's 6e-5 kg.m^2 is about 13M ticks/s^2
+    static constexpr float DEFAULT_MAX_ACCELERATION = 20e6f; // ticks/s^2
+
+    enum Source {
+        SOURCE_I2C,    // RAW ANGLE register
+        SOURCE_ANALOG, // OUT on A0 in place of the current sense, 10-90% range
+        SOURCE_PWM     // OUT as PWM on a pin-change interrupt
+    };
+
+    struct CrossCheck {
+        unsigned long count;
+        unsigned long skipped;  // Turning too fast to compare
+        unsigned long failures; // Further apart than the source's tolerance
+        int offset;             // Added to the OUT readings, ticks
+        int lastError;          // Bus reading minus the corrected OUT reading
+        int maxError;
+    };
+
+    struct Health {
+        bool trusted;            // Readings are fit to close the speed loop on
+        uint8_t status;          // STATUS bits: MD, ML, MH
+        uint8_t agc;
+        uint16_t magnitude;
+        unsigned long checks;    // STATUS, AGC and MAGNITUDE reads
+        unsigned long readErrors;
+        unsigned long outliers;  // Angles dropped by the acceleration limit
+        unsigned long distrusts; // Times trust was lost
+    };
+
+    struct Benchmark {
+        int samples;             // Successful reads
+        float microsPerSample;
+        uint32_t cyclesPerSample; // CPU, including the edge interrupts for PWM
+        unsigned long maxRateHz; // New angles a second
+    };
+
+    struct BenchmarkRun {
+        bool running;
+        int samples;          // Reads of each source
+        int source;           // Being read
+        int reads;            // Of it so far
+        unsigned long micros; // Its reads so far took
+        uint32_t cycles;
+        unsigned long runs;   // Finished
+        Benchmark results[SOURCE_PWM + 1]; // Zero until the source is done
+    };
+
+    Encoder(Hal &hal, uint8_t i2cAddress);
+    void begin(Source source = SOURCE_I2C);
+    Source getSource() const;
+    int readRawAngle(); // Over the bus, whatever the source
+    int getRawAngle(); // Angle from the last update(), no bus access
+    void sample(unsigned long tickMicros); // Timer interrupt only, touches no bus
+    void update(); // Control task
+    int64_t getPosition(); // Multi-turn position in ticks, same sign as getSpeed()
     float getSpeed();
     String getDirection();
+    void setEstimator(VelocityEstimator::Mode mode);
+    VelocityEstimator::Mode getEstimator() const;
+    uint32_t getEstimatorCycles() const; // Cost of the last speed estimate
+    unsigned long getSamplesTaken() const;   // Ticks queued by sample() that got an angle
+    unsigned long getSamplesSkipped() const; // Ticks that shared a later tick's angle, or whose read failed
+    unsigned long getSamplesLost() const;    // Dropped by a full queue
+    unsigned long getDirectReads() const;    // update() read the angle with no tick queued
+    unsigned long getMaxSampleLatency() const; // micros from a tick to its angle
+    void resetSampleStats();
+    const CrossCheck &getCrossCheck() const;
+    const Health &getHealth() const;
+    bool isTrusted() const;
+    void setMaxAcceleration(float ticksPerSecondSquared); // Plausibility limit between samples
+    float getMaxAcceleration() const;
+    // Times every source by reading it back to back, a slice of reads at a
+    // time from serviceBenchmark() in the slack time: an I2C read takes
+    // about 100us at 400kHz. The results stay until the next run.
+    bool startBenchmark(int samples); // False while a run is going
+    void serviceBenchmark(); // Slack task
+    const BenchmarkRun &getBenchmarkRun() const;
 
 private:
+    Hal &_hal;
     uint8_t _i2cAddress;
     int _lastRawAngle;
-    long _totalRevolutions;
-    float _speed;
-    unsigned long _lastUpdateTime;
+    int64_t _totalTicks; // Unwrapped raw angle
+    float _speed; // ticks per second
+    unsigned long _lastUpdateTime; // micros
+    VelocityEstimator _estimator;
+    uint32_t _estimatorCycles;
     String _direction;
     float _lastSpeed;
+
+    EncoderSampleQueue _samples;
+    uint32_t _nextSequence;     // Interrupt side
+    uint32_t _expectedSequence; // Control task side
+    unsigned long _samplesTaken;
+    unsigned long _samplesSkipped;
+    unsigned long _samplesLost;
+    unsigned long _directReads;
+    unsigned long _maxSampleLatency;
+
+    Source _source;
+    CrossCheck _crossCheck;
+    unsigned long _lastCrossCheck; // micros
+
+    enum HealthState {
+        HEALTH_IDLE,
+        HEALTH_STATUS, // STATUS read queued
+        HEALTH_AGC     // AGC and MAGNITUDE read queued
+    };
+
+    float _maxAcceleration;
+    float _tickRate;      // ticks/s over the last accepted interval
+    float _lastInterval;  // s
+    int _outliers;        // Each good sample takes one off
+    int _resyncSamples;   // Taken without the plausibility check
+    Health _health;
+    int _badScore;
+    unsigned long _lastGoodMicros;
+    HealthState _healthState;
+    I2CTransaction _healthTransaction;
+    uint8_t _healthRegister;
+    uint8_t _healthData[3];
+    unsigned long _lastHealthRead; // micros
+    BenchmarkRun _benchmark;
+
+    bool readSource(Source source, int &rawAngle, unsigned long &timestampMicros);
+    bool readPwmAngle(int &rawAngle, unsigned long &timestampMicros);
+    int readAnalogAngle();
+    void configureOutput();
+    void checkAgainstBus(bool initial);
+    void applySample(int rawAngle, unsigned long timestampMicros);
+    void recordGoodSample(unsigned long timestampMicros);
+    void recordBadSample();
+    void updateHealthRead();
+    void submitHealthRead(uint8_t reg, uint8_t *buffer, size_t length, HealthState next);
+    void updateTrust();
+    void finishBenchmark(Benchmark &result);
 };
 
 #endif
@@ -0,0 +1,62 @@
+#ifndef EncoderSampleQueue_h
+#define EncoderSampleQueue_h
+
+#include <stdint.h>
+#include <atomic>
+
+// One control tick as the timer interrupt saw it; the control task reads
+// the angle for it
+struct EncoderSample {
+    uint32_t sequence;             // One per tick, so a gap means samples were lost
+    unsigned long timestampMicros; // micros, at the tick
+};
+
+// Lock-free ring between one producer, the timer ISR, and one consumer, the
+// control task. Each side only writes its own index and publishes it after
+// the slot it covers, so the consumer never sees a half-written sample and
+// neither side has to turn interrupts off. A full queue refuses the new
+// sample; the consumer sees the gap in the sequence numbers.
+class EncoderSampleQueue {
+public:
+    static const uint32_t CAPACITY = 8; // Power of two, ticks of backlog
+
+    EncoderSampleQueue() : _head(0), _tail(0) {}
+
+    // Producer only. Always inlined, so the timer ISR's copy is in IRAM
+    // with it rather than out of line in flash.
+    __attribute__((always_inline)) bool push(const EncoderSample &sample)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= CAPACITY)
+        {
+            return false;
+        }
+        _samples[head & (CAPACITY - 1)] = sample;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(EncoderSample &sample) // Consumer only
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        sample = _samples[tail & (CAPACITY - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+private:
+    EncoderSample _samples[CAPACITY];
+    std::atomic<uint32_t> _head; // Next slot to write
+    std::atomic<uint32_t> _tail; // Next slot to read
+};
+
+#endif
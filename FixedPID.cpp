@@ -0,0 +1,115 @@
+#include "FixedPID.h"
+
+#define ONE (1L << FixedPID::FRACTION_BITS)
+
+int32_t FixedPID::fromFloat(float value)
+{
+  return static_cast<int32_t>(value * ONE + (value >= 0 ? 0.5f : -0.5f));
+}
+
+float FixedPID::toFloat(int32_t value)
+{
+  return value * (1.0f / ONE);
+}
+
+FixedPID::FixedPID()
+    : _kp(0), _ki(0), _kd(0), _integral(0), _lastInput(0), _feedForward(0),
+      _outputMin(-255 * ONE), _outputMax(255 * ONE), _output(0)
+{
+}
+
+void FixedPID::setTunings(float kp, float ki, float kd, float sampleTimeSeconds)
+{
+  if (kp < 0 || ki < 0 || kd < 0 || sampleTimeSeconds <= 0)
+  {
+    return;
+  }
+  float kiPerStep = ki * sampleTimeSeconds;
+  if (kiPerStep >= 1)
+  {
+    kiPerStep = 0.99999f;
+  }
+  _kp = fromFloat(kp);
+  _ki = static_cast<uint32_t>(kiPerStep * 4294967296.0f);
+  _kd = fromFloat(kd / sampleTimeSeconds);
+}
+
+void FixedPID::setOutputLimits(int32_t min, int32_t max)
+{
+  if (min >= max)
+  {
+    return;
+  }
+  _outputMin = min;
+  _outputMax = max;
+  // As PID_v1: the state is only clamped to the new limits, so a limit that
+  // moves every step does not disturb the integral
+  _output = _output < min ? min : _output > max ? max : _output;
+  int64_t integralMin = static_cast<int64_t>(min) << 16;
+  int64_t integralMax = static_cast<int64_t>(max) << 16;
+  _integral = _integral < integralMin ? integralMin : _integral > integralMax ? integralMax : _integral;
+}
+
+void FixedPID::setFeedForward(int32_t feedForward)
+{
+  _feedForward = feedForward;
+}
+
+void FixedPID::reset(int32_t input, int32_t output)
+{
+  _lastInput = input;
+  _output = output < _outputMin ? _outputMin : output > _outputMax ? _outputMax : output;
+  _integral = static_cast<int64_t>(_output - _feedForward) << 16;
+  int64_t min = static_cast<int64_t>(_outputMin) << 16;
+  int64_t max = static_cast<int64_t>(_outputMax) << 16;
+  _integral = _integral < min ? min : _integral > max ? max : _integral;
+}
+
+int32_t FixedPID::compute(int32_t setpoint, int32_t input)
+{
+  int32_t error = setpoint - input;
+  int32_t dInput = input - _lastInput;
+  _lastInput = input;
+
+  // Q16.16 * Q0.32 = Q16.48, kept as Q32.32 for the sum
+  int64_t step = (static_cast<int64_t>(error) * _ki) >> 16;
+  int64_t integral = _integral + step;
+  int64_t min = static_cast<int64_t>(_outputMin) << 16;
+  int64_t max = static_cast<int64_t>(_outputMax) << 16;
+  integral = integral < min ? min : integral > max ? max : integral;
+
+  int64_t proportional = (static_cast<int64_t>(_kp) * error) >> FRACTION_BITS;
+  int64_t derivative = (static_cast<int64_t>(_kd) * dInput) >> FRACTION_BITS;
+  int64_t output = _feedForward + proportional + (integral >> 16) - derivative;
+
+  if (output > _outputMax)
+  {
+    output = _outputMax;
+    if (step > 0)
+    {
+      integral = _integral; // Saturated high, do not wind further up
+    }
+  }
+  else if (output < _outputMin)
+  {
+    output = _outputMin;
+    if (step < 0)
+    {
+      integral = _integral;
+    }
+  }
+
+  _integral = integral;
+  _output = static_cast<int32_t>(output);
+  return _output;
+}
+
+int32_t FixedPID::getIntegral() const
+{
+  return static_cast<int32_t>(_integral >> 16);
+}
+
+int32_t FixedPID::getOutput() const
+{
+  return _output;
+}
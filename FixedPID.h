@@ -0,0 +1,44 @@
+#ifndef FixedPID_h
+#define FixedPID_h
+
+#include <stdint.h>
+
+// PID controller in Q16.16 fixed point for targets without an FPU. Gains are
+// given per second and folded into per-step values once, so compute() is
+// integer only and must be called every sample period.
+//
+// Follows PID_v1: proportional on error, derivative on measurement so a
+// setpoint step does not kick the output, integral clamped to the output
+// limits. On top of that the integral is held while the output is saturated
+// in the same direction (anti-windup), and a feed-forward term is added to
+// the output ahead of the clamp.
+class FixedPID {
+public:
+    static const int FRACTION_BITS = 16;
+
+    static int32_t fromFloat(float value);
+    static float toFloat(int32_t value);
+
+    FixedPID();
+    void setTunings(float kp, float ki, float kd, float sampleTimeSeconds);
+    void setOutputLimits(int32_t min, int32_t max);
+    void setFeedForward(int32_t feedForward);
+    void reset(int32_t input, int32_t output); // Bumpless restart from the current state
+    int32_t compute(int32_t setpoint, int32_t input);
+
+    int32_t getIntegral() const;
+    int32_t getOutput() const;
+
+private:
+    int32_t _kp;      // Q16.16
+    uint32_t _ki;     // Q0.32 per step, ki * sampleTime < 1
+    int32_t _kd;      // Q16.16 per step
+    int64_t _integral; // Q32.32
+    int32_t _lastInput;
+    int32_t _feedForward;
+    int32_t _outputMin;
+    int32_t _outputMax;
+    int32_t _output;
+};
+
+#endif
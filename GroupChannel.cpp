@@ -0,0 +1,258 @@
+#include "GroupChannel.h"
+
+static uint32_t getU32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void putU32(uint8_t *p, uint32_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+GroupChannel::GroupChannel(CommandChannel &commandChannel, ControlScheduler &scheduler, EEPROMConfig &config)
+    : _commandChannel(commandChannel), _scheduler(scheduler), _config(config), _groups(0),
+      _hasOffset(false), _offset(0), _syncTime(0), _phaseError(0), _lastSequence(0), _hasSequence(false)
+{
+  for (int i = 0; i < MAX_PENDING; i++)
+  {
+    _pending[i].active = false;
+  }
+  resetStats();
+}
+
+void GroupChannel::begin(IPAddress localAddress, IPAddress groupAddress, uint16_t port)
+{
+  _groups = _config.readGroups();
+  // Joins the multicast group; unicast sync messages arrive on the same port
+  _udp.beginMulticast(localAddress, groupAddress, port);
+}
+
+void GroupChannel::poll()
+{
+  int frames = 0;
+  int length;
+  while (frames++ < CommandChannel::MAX_FRAMES_PER_POLL && (length = _udp.parsePacket()) > 0)
+  {
+    unsigned long arrival = micros();
+    size_t received = _udp.read(_frame, sizeof(_frame));
+    if (received >= 4 && _frame[0] == 'W' && _frame[1] == 'S' && _frame[2] == GROUP_VERSION)
+    {
+      handleSync(received, arrival);
+    }
+    else
+    {
+      handleGroupFrame(received);
+    }
+  }
+}
+
+void GroupChannel::handleSync(size_t length, unsigned long arrival)
+{
+  uint8_t reply[16];
+  size_t replyLength = 8;
+  reply[0] = 'W';
+  reply[1] = 'S';
+  reply[2] = GROUP_VERSION;
+
+  if (length < 8)
+  {
+    _stats.errors++;
+    return;
+  }
+  switch (_frame[3])
+  {
+  case TIME_REQUEST:
+    _stats.syncRequests++;
+    reply[3] = TIME_REPLY;
+    memcpy(reply + 4, _frame + 4, 4);
+    putU32(reply + 8, arrival);
+    replyLength = 16;
+    break;
+  case TIME_SET:
+    _offset = static_cast<int32_t>(getU32(_frame + 4));
+    _hasOffset = true;
+    _syncTime = millis();
+    reply[3] = TIME_SET_ACK;
+    memcpy(reply + 4, _frame + 4, 4);
+    break;
+  default:
+    _stats.errors++;
+    return;
+  }
+
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  if (reply[3] == TIME_REPLY)
+  {
+    putU32(reply + 12, micros()); // As late as possible
+  }
+  _udp.write(reply, replyLength);
+  _udp.endPacket();
+}
+
+void GroupChannel::handleGroupFrame(size_t length)
+{
+  uint8_t count = length >= GROUP_HEADER_SIZE ? _frame[3] : 0;
+  if (length < GROUP_HEADER_SIZE || _frame[0] != 'W' || _frame[1] != 'G' || _frame[2] != GROUP_VERSION ||
+      count == 0 || count > CommandChannel::MAX_COMMANDS || length < GROUP_HEADER_SIZE + count * CommandChannel::COMMAND_SIZE)
+  {
+    _stats.errors++;
+    return;
+  }
+  if ((_frame[8] & _groups) == 0)
+  {
+    return; // For other controllers
+  }
+
+  uint32_t sequence = getU32(_frame + 4);
+  IPAddress sender = _udp.remoteIP();
+  if (_hasSequence && sender == _lastSender && static_cast<int32_t>(sequence - _lastSequence) <= 0)
+  {
+    _stats.duplicates++;
+    return;
+  }
+  _lastSender = sender;
+  _lastSequence = sequence;
+  _hasSequence = true;
+  _stats.frames++;
+
+  for (int i = 0; i < MAX_PENDING; i++)
+  {
+    Pending &pending = _pending[i];
+    if (!pending.active)
+    {
+      pending.active = true;
+      pending.activateAt = getU32(_frame + 12);
+      pending.count = count;
+      memcpy(pending.commands, _frame + GROUP_HEADER_SIZE, count * CommandChannel::COMMAND_SIZE);
+      return;
+    }
+  }
+  _stats.dropped++;
+}
+
+void GroupChannel::update()
+{
+  uint32_t groupTick = _scheduler.getLastTickMicros() - _offset;
+  if (isSynced())
+  {
+    alignTick(groupTick);
+  }
+
+  // Apply every frame due on this tick, earliest first. A frame is due on
+  // the tick nearest its activation time; ticks are a period apart.
+  const long halfPeriod = _scheduler.getPeriodMicros() / 2;
+  while (true)
+  {
+    Pending *next = nullptr;
+    for (int i = 0; i < MAX_PENDING; i++)
+    {
+      Pending &pending = _pending[i];
+      if (pending.active && static_cast<int32_t>(pending.activateAt - groupTick) <= halfPeriod &&
+          (next == nullptr || static_cast<int32_t>(pending.activateAt - next->activateAt) < 0))
+      {
+        next = &pending;
+      }
+    }
+    if (next == nullptr)
+    {
+      return;
+    }
+
+    long late = static_cast<int32_t>(groupTick - next->activateAt);
+    if (late > halfPeriod)
+    {
+      _stats.late++;
+      if (static_cast<unsigned long>(late) > _stats.maxLateMicros)
+      {
+        _stats.maxLateMicros = late;
+      }
+    }
+    for (int i = 0; i < next->count; i++)
+    {
+      const uint8_t *command = next->commands + i * CommandChannel::COMMAND_SIZE;
+      if (!_commandChannel.apply(command[0], command + 4))
+      {
+        _stats.errors++;
+        break;
+      }
+    }
+    _stats.applied++;
+    next->active = false;
+  }
+}
+
+// Slews the ticks onto multiples of the period in group time, half the
+// error at a time so timer jitter does not make the ticks wander
+void GroupChannel::alignTick(uint32_t groupTick)
+{
+  const long period = _scheduler.getPeriodMicros();
+  long error = groupTick % period;
+  if (error >= period / 2)
+  {
+    error -= period;
+  }
+  _phaseError = error;
+  if (error != 0)
+  {
+    _scheduler.adjustPhase(-error / 2);
+  }
+}
+
+uint8_t GroupChannel::getGroups() const
+{
+  return _groups;
+}
+
+void GroupChannel::setGroups(uint8_t groups)
+{
+  _groups = groups;
+  _config.writeGroups(groups);
+  _config.commit();
+}
+
+bool GroupChannel::isSynced() const
+{
+  return _hasOffset && millis() - _syncTime < SYNC_TIMEOUT_MS;
+}
+
+long GroupChannel::getOffset() const
+{
+  return _offset;
+}
+
+long GroupChannel::getPhaseError() const
+{
+  return _phaseError;
+}
+
+unsigned long GroupChannel::getSyncAge() const
+{
+  return _hasOffset ? millis() - _syncTime : 0;
+}
+
+int GroupChannel::getPendingCount() const
+{
+  int count = 0;
+  for (int i = 0; i < MAX_PENDING; i++)
+  {
+    if (_pending[i].active)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+const GroupChannel::Stats &GroupChannel::getStats() const
+{
+  return _stats;
+}
+
+void GroupChannel::resetStats()
+{
+  _stats = Stats();
+}
@@ -0,0 +1,107 @@
+#ifndef GroupChannel_h
+#define GroupChannel_h
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "CommandChannel.h"
+#include "ControlScheduler.h"
+#include "EEPROMConfig.h"
+
+// Commands for a group of controllers that all take effect on the same
+// control tick. A coordinator (a host, see apitest/groupClient.js) keeps the
+// group clock: it measures each controller's clock offset with an NTP-like
+// exchange and sends it back. Each controller then slews its control ticks
+// onto multiples of the period in group time, so controllers tick together,
+// and applies a group frame on the tick nearest its activation time.
+//
+// Sync messages, unicast, little-endian:
+//   0      2     magic 'W','S'
+//   2      1     version (GROUP_VERSION)
+//   3      1     type (SyncType)
+//   TIME_REQUEST   4  t1, coordinator micros when sent
+//   TIME_REPLY     4  t1 echoed, 8  t2 micros on arrival, 12  t3 micros when replying
+//   TIME_SET       4  offset, int32 micros: local clock minus group clock
+//   TIME_SET_ACK   4  offset echoed
+//
+// Group command frame, multicast or broadcast:
+//   0      2     magic 'W','G'
+//   2      1     version
+//   3      1     command count, 1..CommandChannel::MAX_COMMANDS
+//   4      4     sequence number, per sender
+//   8      1     groups the frame is for, as a bit mask
+//   9      3     reserved
+//   12     4     activation time, group clock micros
+//   16     8*n   commands, as CommandChannel
+//
+// Group frames are not acknowledged; senders repeat them a few times before
+// the activation time and repeats are dropped by sequence number.
+class GroupChannel {
+public:
+    static const uint8_t GROUP_VERSION = 1;
+    static const size_t GROUP_HEADER_SIZE = 16;
+    static const int MAX_PENDING = 4;
+    static const unsigned long SYNC_TIMEOUT_MS = 60000; // Offset is considered stale after this
+
+    enum SyncType {
+        TIME_REQUEST = 0,
+        TIME_REPLY = 1,
+        TIME_SET = 2,
+        TIME_SET_ACK = 3
+    };
+
+    struct Stats {
+        unsigned long frames;     // Group frames for this controller
+        unsigned long applied;
+        unsigned long late;       // Arrived after their activation tick
+        unsigned long maxLateMicros;
+        unsigned long duplicates;
+        unsigned long dropped;    // No free pending slot
+        unsigned long errors;
+        unsigned long syncRequests;
+    };
+
+    GroupChannel(CommandChannel &commandChannel, ControlScheduler &scheduler, EEPROMConfig &config);
+    void begin(IPAddress localAddress, IPAddress groupAddress, uint16_t port);
+    void poll();   // From the control step and as a slack task, for prompt sync timestamps
+    void update(); // Once per control step, after poll()
+
+    uint8_t getGroups() const;
+    void setGroups(uint8_t groups); // Stored in the config
+    bool isSynced() const;
+    long getOffset() const;
+    long getPhaseError() const;     // Group time of the last tick from a period boundary
+    unsigned long getSyncAge() const; // ms since the last TIME_SET
+    int getPendingCount() const;
+    const Stats &getStats() const;
+    void resetStats();
+
+private:
+    struct Pending {
+        bool active;
+        uint32_t activateAt; // Group clock
+        uint8_t count;
+        uint8_t commands[CommandChannel::MAX_COMMANDS * CommandChannel::COMMAND_SIZE];
+    };
+
+    CommandChannel &_commandChannel;
+    ControlScheduler &_scheduler;
+    EEPROMConfig &_config;
+    WiFiUDP _udp;
+    uint8_t _groups;
+    bool _hasOffset;
+    int32_t _offset;
+    unsigned long _syncTime; // millis of the last TIME_SET
+    long _phaseError;
+    IPAddress _lastSender;
+    uint32_t _lastSequence;
+    bool _hasSequence;
+    Pending _pending[MAX_PENDING];
+    Stats _stats;
+    uint8_t _frame[GROUP_HEADER_SIZE + CommandChannel::MAX_COMMANDS * CommandChannel::COMMAND_SIZE];
+
+    void handleSync(size_t length, unsigned long arrival);
+    void handleGroupFrame(size_t length);
+    void alignTick(uint32_t groupTick);
+};
+
+#endif
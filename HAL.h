@@ -0,0 +1,128 @@
+#ifndef HAL_h
+#define HAL_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Thin hardware abstraction used by MotorController, Encoder and AHT21Sensor.
+// ArduinoHAL.h binds it to the ESP8266 core; sim/ binds it to a motor model.
+// Kept free of Arduino headers so it also compiles on the host.
+
+// A write and/or read that may be deferred by the bus owner. The caller keeps
+// the transaction and its buffers alive until done is set.
+struct I2CTransaction {
+    uint8_t address;
+    const uint8_t *writeData;
+    size_t writeLength;
+    uint8_t *readBuffer;
+    size_t readLength;
+    volatile bool done;
+    bool ok;
+};
+
+class I2CBus {
+public:
+    virtual ~I2CBus() {}
+    virtual void begin() = 0;
+    virtual void setClock(uint32_t hz) = 0;
+    // Returns true when the device acknowledged every byte
+    virtual bool write(uint8_t address, const uint8_t *data, size_t length, bool sendStop = true) = 0;
+    // Returns the number of bytes actually read
+    virtual size_t read(uint8_t address, uint8_t *buffer, size_t length) = 0;
+
+    // Sets the register pointer and reads from it
+    virtual bool readRegister(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length)
+    {
+        return write(address, &reg, 1, false) && read(address, buffer, length) == length;
+    }
+
+    // Runs the transaction now; a bus manager may queue it instead
+    virtual bool submit(I2CTransaction &transaction)
+    {
+        transaction.done = false;
+        transaction.ok = true;
+        if (transaction.writeLength > 0)
+        {
+            transaction.ok = write(transaction.address, transaction.writeData, transaction.writeLength);
+        }
+        if (transaction.ok && transaction.readLength > 0)
+        {
+            transaction.ok = read(transaction.address, transaction.readBuffer, transaction.readLength) == transaction.readLength;
+        }
+        transaction.done = true;
+        return true;
+    }
+};
+
+class GpioPort {
+public:
+    virtual ~GpioPort() {}
+    virtual void setMode(uint8_t pin, uint8_t mode) = 0;
+    virtual void write(uint8_t pin, uint8_t level) = 0;
+};
+
+class PwmOutput {
+public:
+    virtual ~PwmOutput() {}
+    virtual void setDuty(uint8_t pin, int duty) = 0; // 0..1023
+};
+
+// The ESP8266 has a single ADC input, A0
+class AnalogInput {
+public:
+    virtual ~AnalogInput() {}
+    virtual int read() = 0; // 0..1023
+};
+
+// Times a PWM signal on one input pin from its edges, for the AS5600 OUT
+// pin in PWM mode
+class PulseInput {
+public:
+    struct Pulse {
+        uint32_t highCycles;     // CPU cycles
+        uint32_t periodCycles;
+        unsigned long endMicros; // When the period ended
+        uint32_t count;          // Periods timed so far
+    };
+
+    virtual ~PulseInput() {}
+    virtual void begin() = 0; // Starts timing edges
+    // The last complete period; false until there is one. Safe in an interrupt.
+    virtual bool read(Pulse &pulse) = 0;
+    virtual uint32_t getEdgeCycles() = 0; // CPU cycles spent timing edges so far
+};
+
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;
+    virtual void delay(unsigned long ms) = 0;
+    virtual uint32_t cycles() = 0; // Free-running CPU cycle counter, for overhead measurement
+};
+
+// Two erasable flash sectors for persistent storage. Like NOR flash, writes
+// can only clear bits, so a region must be erased (all 0xFF) before it is
+// written. Offsets and lengths are multiples of 4 and data is word aligned.
+class FlashDevice {
+public:
+    virtual ~FlashDevice() {}
+    virtual size_t sectorSize() const = 0;
+    virtual bool eraseSector(uint8_t sector) = 0; // sector is 0 or 1
+    virtual bool write(uint8_t sector, size_t offset, const uint32_t *data, size_t length) = 0;
+    virtual bool read(uint8_t sector, size_t offset, uint32_t *data, size_t length) = 0;
+};
+
+struct Hal {
+    Hal(I2CBus &i2c, GpioPort &gpio, PwmOutput &pwm, AnalogInput &analog, PulseInput &pulse, Clock &clock)
+        : i2c(i2c), gpio(gpio), pwm(pwm), analog(analog), pulse(pulse), clock(clock) {}
+
+    I2CBus &i2c;
+    GpioPort &gpio;
+    PwmOutput &pwm;
+    AnalogInput &analog;
+    PulseInput &pulse;
+    Clock &clock;
+};
+
+#endif
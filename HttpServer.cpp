@@ -0,0 +1,725 @@
+#include "HttpServer.h"
+
+static const char *reasonPhrase(int code)
+{
+  switch (code)
+  {
+  case 200: return "OK";
+  case 202: return "Accepted";
+  case 204: return "No Content";
+  case 304: return "Not Modified";
+  case 400: return "Bad Request";
+  case 404: return "Not Found";
+  case 409: return "Conflict";
+  case 413: return "Payload Too Large";
+  case 414: return "URI Too Long";
+  case 500: return "Internal Server Error";
+  case 501: return "Not Implemented";
+  case 503: return "Service Unavailable";
+  default: return "";
+  }
+}
+
+// The value of a "Name: value" line when it is that header, else nullptr
+static const char *headerValue(const char *line, const char *name)
+{
+  size_t length = strlen(name);
+  if (strncasecmp(line, name, length) != 0 || line[length] != ':')
+  {
+    return nullptr;
+  }
+  const char *value = line + length + 1;
+  while (*value == ' ')
+  {
+    value++;
+  }
+  return value;
+}
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// In place, as decoding only ever shortens the text
+static void urlDecode(char *text)
+{
+  char *out = text;
+  for (char *in = text; *in != '\0'; in++)
+  {
+    if (*in == '+')
+    {
+      *out++ = ' ';
+    }
+    else if (*in == '%' && hexValue(in[1]) >= 0 && hexValue(in[2]) >= 0)
+    {
+      *out++ = hexValue(in[1]) << 4 | hexValue(in[2]);
+      in += 2;
+    }
+    else
+    {
+      *out++ = *in;
+    }
+  }
+  *out = '\0';
+}
+
+HttpServer::HttpServer(uint16_t port)
+    : _server(port), _routeCount(0), _current(nullptr), _argCount(0), _body(nullptr), _responded(false),
+      _extraHeadersLength(0), _requestCount(0), _maxHandlerMicros(0)
+{
+  for (int i = 0; i < MAX_CONNECTIONS; i++)
+  {
+    _connections[i].state = UNUSED;
+  }
+  _extraHeaders[0] = '\0';
+}
+
+void HttpServer::on(const char *path, Method method, Handler handler)
+{
+  if (_routeCount < MAX_ROUTES)
+  {
+    _routes[_routeCount++] = {path, method, handler};
+  }
+}
+
+void HttpServer::begin()
+{
+  _server.begin();
+  _server.setNoDelay(true);
+}
+
+void HttpServer::handleClient()
+{
+  accept();
+
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_CONNECTIONS; i++)
+  {
+    Connection &connection = _connections[i];
+    switch (connection.state)
+    {
+    case UNUSED:
+      break;
+    case WRITING:
+      if (!connection.socket.connected())
+      {
+        close(connection);
+        break;
+      }
+      write(connection);
+      break;
+    case CLOSING:
+      if (!connection.socket.connected() || connection.socket.availableForWrite() >= connection.sendBuffer ||
+          now - connection.since > WRITE_TIMEOUT_MS)
+      {
+        close(connection);
+      }
+      break;
+    default:
+      if (!connection.socket.connected())
+      {
+        close(connection);
+        break;
+      }
+      read(connection);
+      if (connection.state == REQUEST_LINE && connection.requestLength == 0)
+      {
+        if (millis() - connection.since > KEEP_ALIVE_TIMEOUT_MS)
+        {
+          close(connection);
+        }
+      }
+      else if (connection.state < WRITING && millis() - connection.since > REQUEST_TIMEOUT_MS)
+      {
+        close(connection);
+      }
+      break;
+    }
+  }
+}
+
+// A new connection takes a free slot, or that of the kept-alive connection
+// idle the longest. Otherwise it stays in the backlog for a later pass.
+void HttpServer::accept()
+{
+  if (!_server.hasClient())
+  {
+    return;
+  }
+
+  Connection *slot = nullptr;
+  unsigned long now = millis();
+  for (int i = 0; i < MAX_CONNECTIONS && slot == nullptr; i++)
+  {
+    Connection &connection = _connections[i];
+    if (connection.state == UNUSED)
+    {
+      slot = &connection;
+    }
+  }
+  if (slot == nullptr)
+  {
+    for (int i = 0; i < MAX_CONNECTIONS; i++)
+    {
+      Connection &connection = _connections[i];
+      bool idle = connection.kept && connection.state == REQUEST_LINE && connection.requestLength == 0 &&
+                  now - connection.since > HANDOVER_IDLE_MS && connection.socket.available() == 0;
+      if (idle && (slot == nullptr || now - connection.since > now - slot->since))
+      {
+        slot = &connection;
+      }
+    }
+    if (slot == nullptr)
+    {
+      return;
+    }
+    close(*slot);
+  }
+
+  slot->socket = _server.accept();
+  slot->socket.setNoDelay(true);
+  slot->sendBuffer = slot->socket.availableForWrite();
+  slot->kept = false;
+  startRequest(*slot);
+}
+
+void HttpServer::startRequest(Connection &connection)
+{
+  connection.state = REQUEST_LINE;
+  connection.since = millis();
+  connection.requestLength = 0;
+  connection.bodyStart = 0;
+  connection.lineLength = 0;
+  connection.contentLength = 0;
+  connection.form = false;
+  connection.keepAlive = true;
+  connection.etag[0] = '\0';
+  connection.producer = nullptr;
+  connection.sent = nullptr;
+}
+
+// The request line goes straight into the request buffer, header lines
+// through the line buffer. The body is read in bulk, never past its end, so
+// a pipelined request stays in the socket until this one is answered.
+void HttpServer::read(Connection &connection)
+{
+  while (connection.state < WRITING && connection.socket.available() > 0)
+  {
+    if (connection.state == BODY)
+    {
+      size_t wanted = connection.bodyStart + connection.contentLength - connection.requestLength;
+      int got = connection.socket.read(reinterpret_cast<uint8_t *>(connection.request + connection.requestLength), wanted);
+      if (got <= 0)
+      {
+        return;
+      }
+      connection.requestLength += got;
+      if (connection.requestLength == connection.bodyStart + connection.contentLength)
+      {
+        connection.request[connection.requestLength] = '\0';
+        dispatch(connection);
+      }
+      continue;
+    }
+
+    char c = connection.socket.read();
+    if (connection.state == REQUEST_LINE)
+    {
+      if (connection.requestLength == 0)
+      {
+        if (c == '\r' || c == '\n')
+        {
+          continue; // Blank lines between requests
+        }
+        connection.since = millis();
+      }
+      if (c != '\n')
+      {
+        if (connection.requestLength >= REQUEST_BUFFER_SIZE - 1)
+        {
+          fail(connection, 414, "Request too long.");
+          return;
+        }
+        if (c != '\r')
+        {
+          connection.request[connection.requestLength++] = c;
+        }
+        continue;
+      }
+      connection.request[connection.requestLength] = '\0';
+      if (!readRequestLine(connection))
+      {
+        return;
+      }
+      connection.state = HEADERS;
+      continue;
+    }
+
+    if (c != '\n')
+    {
+      if (c != '\r' && connection.lineLength < LINE_BUFFER_SIZE - 1)
+      {
+        connection.line[connection.lineLength++] = c;
+      }
+      continue;
+    }
+    connection.line[connection.lineLength] = '\0';
+    readHeader(connection);
+    connection.lineLength = 0;
+  }
+}
+
+// "GET /path?query HTTP/1.1": keeps the method and moves the target to the
+// start of the request buffer
+bool HttpServer::readRequestLine(Connection &connection)
+{
+  char *target = strchr(connection.request, ' ');
+  char *version = target != nullptr ? strchr(target + 1, ' ') : nullptr;
+  if (version == nullptr)
+  {
+    fail(connection, 400, "Malformed request line.");
+    return false;
+  }
+  if (strncmp(connection.request, "GET ", 4) == 0)
+  {
+    connection.method = METHOD_GET;
+  }
+  else if (strncmp(connection.request, "POST ", 5) == 0)
+  {
+    connection.method = METHOD_POST;
+  }
+  else
+  {
+    fail(connection, 501, "Only GET and POST are supported.");
+    return false;
+  }
+
+  connection.keepAlive = strcmp(version + 1, "HTTP/1.0") != 0;
+  *version = '\0';
+  connection.requestLength = version - target - 1;
+  memmove(connection.request, target + 1, connection.requestLength + 1);
+  return true;
+}
+
+void HttpServer::readHeader(Connection &connection)
+{
+  if (connection.lineLength > 0)
+  {
+    const char *value;
+    if ((value = headerValue(connection.line, "Content-Length")) != nullptr)
+    {
+      connection.contentLength = strtoul(value, nullptr, 10);
+    }
+    else if ((value = headerValue(connection.line, "Content-Type")) != nullptr)
+    {
+      connection.form = strncasecmp(value, "application/x-www-form-urlencoded", 33) == 0;
+    }
+    else if ((value = headerValue(connection.line, "Connection")) != nullptr)
+    {
+      connection.keepAlive = strcasecmp(value, "close") != 0 && (connection.keepAlive || strcasecmp(value, "keep-alive") == 0);
+    }
+    else if ((value = headerValue(connection.line, "If-None-Match")) != nullptr)
+    {
+      strncpy(connection.etag, value, sizeof(connection.etag) - 1);
+      connection.etag[sizeof(connection.etag) - 1] = '\0';
+    }
+    return;
+  }
+
+  // End of the headers; the body follows the target's terminator
+  connection.bodyStart = connection.requestLength + 1;
+  if (connection.contentLength >= REQUEST_BUFFER_SIZE - connection.bodyStart)
+  {
+    fail(connection, 413, "Request body too large.");
+    return;
+  }
+  connection.requestLength = connection.bodyStart;
+  if (connection.contentLength > 0)
+  {
+    connection.state = BODY;
+    return;
+  }
+  dispatch(connection);
+}
+
+void HttpServer::dispatch(Connection &connection)
+{
+  _current = &connection;
+  _argCount = 0;
+  _body = nullptr;
+  _responded = false;
+  _extraHeaders[0] = '\0';
+  _extraHeadersLength = 0;
+
+  char *query = strchr(connection.request, '?');
+  if (query != nullptr)
+  {
+    *query = '\0';
+    parseArgs(query + 1);
+  }
+  if (connection.contentLength > 0)
+  {
+    char *body = connection.request + connection.bodyStart;
+    if (connection.form)
+    {
+      parseArgs(body);
+    }
+    else
+    {
+      _body = body;
+    }
+  }
+
+  const Route *route = nullptr;
+  for (int i = 0; i < _routeCount && route == nullptr; i++)
+  {
+    if (strcmp(_routes[i].path, connection.request) == 0 &&
+        (_routes[i].method == METHOD_ANY || _routes[i].method == connection.method))
+    {
+      route = &_routes[i];
+    }
+  }
+
+  unsigned long startTime = micros();
+  if (route != nullptr)
+  {
+    route->handler();
+  }
+  else
+  {
+    send(404, "text/plain", "Not found.");
+  }
+  unsigned long elapsed = micros() - startTime;
+  if (elapsed > _maxHandlerMicros)
+  {
+    _maxHandlerMicros = elapsed;
+  }
+  if (!_responded)
+  {
+    send(500, "text/plain", "No response.");
+  }
+  _current = nullptr;
+  _requestCount++;
+
+  write(connection); // Usually fits the send buffer straight away
+}
+
+void HttpServer::parseArgs(char *text)
+{
+  while (*text != '\0' && _argCount < MAX_ARGS)
+  {
+    char *end = strchr(text, '&');
+    if (end != nullptr)
+    {
+      *end = '\0';
+    }
+    char *value = strchr(text, '=');
+    if (value != nullptr)
+    {
+      *value++ = '\0';
+    }
+    else
+    {
+      value = text + strlen(text); // "?reset" is an empty value
+    }
+    urlDecode(text);
+    urlDecode(value);
+    _args[_argCount++] = {text, value};
+    if (end == nullptr)
+    {
+      return;
+    }
+    text = end + 1;
+  }
+}
+
+// Answers a request that could not be read and drops the connection, as
+// the rest of what the browser sent cannot be trusted
+void HttpServer::fail(Connection &connection, int code, const char *message)
+{
+  _current = &connection;
+  _responded = false;
+  _extraHeaders[0] = '\0';
+  _extraHeadersLength = 0;
+  connection.keepAlive = false;
+  send(code, "text/plain", message);
+  _current = nullptr;
+  write(connection);
+}
+
+bool HttpServer::hasArg(const char *name) const
+{
+  if (strcmp(name, "plain") == 0)
+  {
+    return _body != nullptr;
+  }
+  for (int i = 0; i < _argCount; i++)
+  {
+    if (strcmp(_args[i].name, name) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+String HttpServer::arg(const char *name) const
+{
+  if (strcmp(name, "plain") == 0)
+  {
+    return _body != nullptr ? String(_body) : String();
+  }
+  for (int i = 0; i < _argCount; i++)
+  {
+    if (strcmp(_args[i].name, name) == 0)
+    {
+      return String(_args[i].value);
+    }
+  }
+  return String();
+}
+
+String HttpServer::header(const char *name) const
+{
+  if (_current == nullptr || strcasecmp(name, "If-None-Match") != 0)
+  {
+    return String();
+  }
+  return String(_current->etag);
+}
+
+IPAddress HttpServer::remoteIP()
+{
+  return _current != nullptr ? _current->socket.remoteIP() : IPAddress();
+}
+
+void HttpServer::sendHeader(const char *name, const char *value)
+{
+  int length = snprintf(_extraHeaders + _extraHeadersLength, sizeof(_extraHeaders) - _extraHeadersLength, "%s: %s\r\n", name, value);
+  if (length > 0 && _extraHeadersLength + length < sizeof(_extraHeaders))
+  {
+    _extraHeadersLength += length;
+  }
+  else
+  {
+    _extraHeaders[_extraHeadersLength] = '\0'; // Dropped, it did not fit
+  }
+}
+
+// Writes the status line and headers into the connection's buffer. Without
+// a length the body ends when the connection closes.
+bool HttpServer::beginResponse(int code, const char *contentType, size_t length)
+{
+  if (_current == nullptr || _responded)
+  {
+    return false;
+  }
+  _responded = true;
+
+  Connection &connection = *_current;
+  if (getConnectionCount() == MAX_CONNECTIONS && _server.hasClient())
+  {
+    connection.keepAlive = false; // Hand the slot to a waiting browser
+  }
+  bool hasBody = code != 204 && code != 304;
+  if (length == CONTENT_LENGTH_UNKNOWN && hasBody)
+  {
+    connection.keepAlive = false;
+  }
+  char *out = reinterpret_cast<char *>(connection.response);
+  size_t size = sizeof(connection.response);
+  int used = snprintf(out, size, "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", code, reasonPhrase(code), contentType);
+  if (length != CONTENT_LENGTH_UNKNOWN && hasBody)
+  {
+    used += snprintf(out + used, size - used, "Content-Length: %u\r\n", static_cast<unsigned>(length));
+  }
+  used += snprintf(out + used, size - used, "Connection: %s\r\n%s\r\n", connection.keepAlive ? "keep-alive" : "close", _extraHeaders);
+
+  connection.state = WRITING;
+  connection.since = millis();
+  connection.responseLength = used;
+  connection.responseOffset = 0;
+  connection.flash = nullptr;
+  connection.flashRemaining = 0;
+  connection.producer = nullptr;
+  return true;
+}
+
+void HttpServer::send(int code, const char *contentType, const char *content, size_t length)
+{
+  if (!beginResponse(code, contentType, length))
+  {
+    return;
+  }
+  Connection &connection = *_current;
+  if (length > sizeof(connection.response) - connection.responseLength)
+  {
+    // Too big to queue; say so rather than send half of it
+    _responded = false;
+    _extraHeaders[0] = '\0';
+    _extraHeadersLength = 0;
+    send(500, "text/plain", "Response too large.");
+    return;
+  }
+  memcpy(connection.response + connection.responseLength, content, length);
+  connection.responseLength += length;
+}
+
+void HttpServer::send(int code, const char *contentType, const String &content)
+{
+  send(code, contentType, content.c_str(), content.length());
+}
+
+void HttpServer::send_P(int code, const char *contentType, PGM_P content, size_t length)
+{
+  if (beginResponse(code, contentType, length))
+  {
+    _current->flash = content;
+    _current->flashRemaining = length;
+  }
+}
+
+void HttpServer::sendStream(int code, const char *contentType, size_t length, Producer producer)
+{
+  if (beginResponse(code, contentType, length))
+  {
+    _current->producer = producer;
+  }
+}
+
+void HttpServer::whenSent(Handler callback)
+{
+  if (_current != nullptr)
+  {
+    _current->sent = callback;
+    _current->keepAlive = false;
+  }
+}
+
+// Writes what the send buffer has room for, refilling from flash or the
+// producer as the connection's buffer drains
+void HttpServer::write(Connection &connection)
+{
+  while (true)
+  {
+    if (connection.responseOffset == connection.responseLength && !refill(connection))
+    {
+      finish(connection);
+      return;
+    }
+    size_t space = connection.socket.availableForWrite();
+    if (space == 0)
+    {
+      break;
+    }
+    size_t length = min(space, connection.responseLength - connection.responseOffset);
+    size_t written = connection.socket.write(connection.response + connection.responseOffset, length);
+    if (written > 0)
+    {
+      connection.responseOffset += written;
+      connection.since = millis();
+    }
+    if (written < length)
+    {
+      break;
+    }
+  }
+
+  if (millis() - connection.since > WRITE_TIMEOUT_MS)
+  {
+    close(connection);
+  }
+}
+
+bool HttpServer::refill(Connection &connection)
+{
+  connection.responseLength = 0;
+  connection.responseOffset = 0;
+  if (connection.flashRemaining > 0)
+  {
+    size_t length = min(connection.flashRemaining, sizeof(connection.response));
+    memcpy_P(connection.response, connection.flash, length);
+    connection.flash += length;
+    connection.flashRemaining -= length;
+    connection.responseLength = length;
+    return true;
+  }
+  if (connection.producer)
+  {
+    connection.responseLength = connection.producer(connection.response, sizeof(connection.response));
+    if (connection.responseLength > 0)
+    {
+      return true;
+    }
+    connection.producer = nullptr;
+  }
+  return false;
+}
+
+void HttpServer::finish(Connection &connection)
+{
+  if (connection.keepAlive)
+  {
+    connection.kept = true;
+    startRequest(connection);
+    return;
+  }
+  // Closing now could wait in stop() for the browser's ack, so wait here instead
+  connection.state = CLOSING;
+  connection.since = millis();
+}
+
+// stop() waits for unacked data to go, so a connection closed with some
+// still in flight, on a timeout or a handover, is aborted instead
+void HttpServer::close(Connection &connection)
+{
+  if (connection.socket.connected() && connection.socket.availableForWrite() < connection.sendBuffer)
+  {
+    connection.socket.abort();
+  }
+  else
+  {
+    connection.socket.stop();
+  }
+  connection.state = UNUSED;
+  connection.producer = nullptr;
+  if (connection.sent)
+  {
+    Handler sent = connection.sent;
+    connection.sent = nullptr;
+    sent();
+  }
+}
+
+int HttpServer::getConnectionCount() const
+{
+  int count = 0;
+  for (int i = 0; i < MAX_CONNECTIONS; i++)
+  {
+    if (_connections[i].state != UNUSED)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+unsigned long HttpServer::getRequestCount() const
+{
+  return _requestCount;
+}
+
+unsigned long HttpServer::getMaxHandlerMicros() const
+{
+  return _maxHandlerMicros;
+}
+
+void HttpServer::resetStats()
+{
+  _requestCount = 0;
+  _maxHandlerMicros = 0;
+}
@@ -0,0 +1,162 @@
+#ifndef HttpServer_h
+#define HttpServer_h
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <functional>
+
+// Non-blocking HTTP/1.1 server for the slack time between control steps.
+// Each connection is a small state machine that handleClient() moves along
+// with whatever the socket has ready: reading the request, running its
+// handler, then writing the response only as fast as the send buffer takes
+// it. Nothing waits on the network, so a slow or stalled browser costs a
+// few microseconds a pass instead of holding up the control loop.
+//
+// Handlers use the same calls as ESP8266WebServer (arg, send, sendHeader)
+// but the response is queued rather than written: it is built in the
+// connection's buffer, so it must fit RESPONSE_BUFFER_SIZE with its
+// headers. Larger bodies come from flash (send_P) or from a producer that
+// is asked for the next piece whenever the buffer has drained (sendStream).
+//
+// Connections stay open between requests. Up to MAX_CONNECTIONS are served
+// at once; another waits in the TCP backlog until a slot frees up. While
+// one waits, responses close their connection instead of keeping it, and a
+// connection idle for HANDOVER_IDLE_MS is closed to make room.
+//
+// A connection is only stopped once the browser has acked everything, as
+// WiFiClient::stop() would wait up to 300ms for it. One closed with data
+// still in flight, after a timeout, is aborted with a reset instead.
+class HttpServer {
+public:
+    static const int MAX_CONNECTIONS = 4;
+    static const size_t REQUEST_BUFFER_SIZE = 1024;  // Request target and body
+    static const size_t RESPONSE_BUFFER_SIZE = 1536; // Headers and body, reused for streaming; holds a full /status
+    static const int MAX_ARGS = 16;
+    static const size_t CONTENT_LENGTH_UNKNOWN = static_cast<size_t>(-1);
+    static const unsigned long REQUEST_TIMEOUT_MS = 2000;    // To read a started request
+    static const unsigned long KEEP_ALIVE_TIMEOUT_MS = 5000; // Idle between requests
+    static const unsigned long WRITE_TIMEOUT_MS = 5000;      // Without the browser taking a byte
+    static const unsigned long HANDOVER_IDLE_MS = 500;       // Idle enough to close for a waiting browser
+
+    enum Method {
+        METHOD_GET,
+        METHOD_POST,
+        METHOD_ANY
+    };
+
+    typedef std::function<void()> Handler;
+    // Fills buffer with the next part of the body and returns its length,
+    // 0 once there is no more
+    typedef std::function<size_t(uint8_t *buffer, size_t size)> Producer;
+
+    HttpServer(uint16_t port);
+    void on(const char *path, Method method, Handler handler);
+    void begin();
+    void handleClient(); // Slack task
+
+    // For handlers, about the request being handled
+    bool hasArg(const char *name) const;
+    String arg(const char *name) const; // "plain" is a body that is not a form
+    String header(const char *name) const; // Only If-None-Match is kept
+    IPAddress remoteIP();
+
+    // Each handler sends one response
+    void sendHeader(const char *name, const char *value);
+    void send(int code, const char *contentType, const char *content, size_t length);
+    void send(int code, const char *contentType, const String &content);
+    void send_P(int code, const char *contentType, PGM_P content, size_t length);
+    void sendStream(int code, const char *contentType, size_t length, Producer producer); // Length may be CONTENT_LENGTH_UNKNOWN
+    // Runs once the browser has the response, or the connection is lost.
+    // The connection is closed after it, so a restart cannot cut it short.
+    void whenSent(Handler callback);
+
+    int getConnectionCount() const;
+    unsigned long getRequestCount() const;
+    unsigned long getMaxHandlerMicros() const;
+    void resetStats();
+
+private:
+    static const int MAX_ROUTES = 40;
+    static const size_t LINE_BUFFER_SIZE = 64;    // Header lines, truncated
+    static const size_t EXTRA_HEADERS_SIZE = 160; // From sendHeader
+
+    enum ConnectionState {
+        UNUSED,
+        REQUEST_LINE, // Also idle between requests
+        HEADERS,
+        BODY,
+        WRITING,
+        CLOSING       // Response written, waiting for the browser to ack it
+    };
+
+    struct Route {
+        const char *path;
+        Method method;
+        Handler handler;
+    };
+
+    struct Arg {
+        const char *name;
+        const char *value;
+    };
+
+    struct Connection {
+        ConnectionState state;
+        WiFiClient socket;
+        unsigned long since;  // millis, request started or last byte written
+        size_t sendBuffer;    // Free send buffer when nothing is in flight
+        bool kept;            // Kept open after a response
+        // Request
+        Method method;
+        char request[REQUEST_BUFFER_SIZE]; // Target, then the body
+        size_t requestLength;
+        size_t bodyStart;
+        char line[LINE_BUFFER_SIZE];
+        size_t lineLength;
+        size_t contentLength;
+        bool form;            // Body is application/x-www-form-urlencoded
+        bool keepAlive;
+        char etag[24];        // If-None-Match
+        // Response
+        uint8_t response[RESPONSE_BUFFER_SIZE];
+        size_t responseLength;
+        size_t responseOffset; // Written so far
+        PGM_P flash;           // Body still to copy from flash
+        size_t flashRemaining;
+        Producer producer;
+        Handler sent;
+    };
+
+    WiFiServer _server;
+    Route _routes[MAX_ROUTES];
+    int _routeCount;
+    Connection _connections[MAX_CONNECTIONS];
+
+    // The request being handled
+    Connection *_current;
+    Arg _args[MAX_ARGS];
+    int _argCount;
+    const char *_body;
+    bool _responded;
+    char _extraHeaders[EXTRA_HEADERS_SIZE];
+    size_t _extraHeadersLength;
+
+    unsigned long _requestCount;
+    unsigned long _maxHandlerMicros;
+
+    void accept();
+    void startRequest(Connection &connection);
+    void read(Connection &connection);
+    bool readRequestLine(Connection &connection);
+    void readHeader(Connection &connection);
+    void dispatch(Connection &connection);
+    void parseArgs(char *text);
+    void fail(Connection &connection, int code, const char *message);
+    bool beginResponse(int code, const char *contentType, size_t length);
+    void write(Connection &connection);
+    bool refill(Connection &connection);
+    void finish(Connection &connection);
+    void close(Connection &connection);
+};
+
+#endif
@@ -0,0 +1,180 @@
+#include "I2CBusManager.h"
+
+I2CBusManager::I2CBusManager(I2CBus &bus, Clock &clock)
+    : _bus(bus), _clock(clock), _started(false), _clockHz(100000),
+      _queueHead(0), _queueCount(0), _pointerHoldCount(0)
+{
+  resetStats();
+}
+
+void I2CBusManager::begin()
+{
+  if (_started)
+  {
+    return;
+  }
+  _bus.begin();
+  _bus.setClock(_clockHz);
+  _started = true;
+}
+
+void I2CBusManager::setClock(uint32_t hz)
+{
+  _clockHz = hz;
+  if (_started)
+  {
+    _bus.setClock(hz);
+  }
+}
+
+bool I2CBusManager::write(uint8_t address, const uint8_t *data, size_t length, bool sendStop)
+{
+  invalidatePointer(address); // Any write may move the register pointer
+  unsigned long startTime = _clock.micros();
+  bool ok = _bus.write(address, data, length, sendStop);
+  record(_directStats, startTime, _clock.micros(), ok);
+  return ok;
+}
+
+size_t I2CBusManager::read(uint8_t address, uint8_t *buffer, size_t length)
+{
+  invalidatePointer(address); // Plain reads auto-increment the pointer
+  unsigned long startTime = _clock.micros();
+  size_t count = _bus.read(address, buffer, length);
+  record(_directStats, startTime, _clock.micros(), count == length);
+  return count;
+}
+
+bool I2CBusManager::readRegister(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length)
+{
+  PointerHold *hold = nullptr;
+  for (int i = 0; i < _pointerHoldCount; i++)
+  {
+    if (_pointerHolds[i].address == address && _pointerHolds[i].reg == reg)
+    {
+      hold = &_pointerHolds[i];
+    }
+  }
+
+  unsigned long startTime = _clock.micros();
+  bool ok = true;
+  if (hold != nullptr && hold->valid)
+  {
+    _skippedPointerWrites++;
+  }
+  else
+  {
+    invalidatePointer(address);
+    ok = _bus.write(address, &reg, 1, false);
+  }
+  ok = ok && _bus.read(address, buffer, length) == length;
+  record(_directStats, startTime, _clock.micros(), ok);
+
+  if (hold != nullptr)
+  {
+    hold->valid = ok;
+  }
+  else
+  {
+    invalidatePointer(address);
+  }
+  return ok;
+}
+
+bool I2CBusManager::submit(I2CTransaction &transaction)
+{
+  if (_queueCount >= QUEUE_SIZE)
+  {
+    return false;
+  }
+  transaction.done = false;
+  transaction.ok = false;
+  _queue[(_queueHead + _queueCount) % QUEUE_SIZE] = &transaction;
+  _queueCount++;
+  return true;
+}
+
+void I2CBusManager::service()
+{
+  if (_queueCount == 0)
+  {
+    return;
+  }
+  I2CTransaction &transaction = *_queue[_queueHead];
+  _queueHead = (_queueHead + 1) % QUEUE_SIZE;
+  _queueCount--;
+
+  invalidatePointer(transaction.address);
+  unsigned long startTime = _clock.micros();
+  _bus.submit(transaction); // The underlying bus runs it immediately
+  record(_queuedStats, startTime, _clock.micros(), transaction.ok);
+}
+
+void I2CBusManager::setPointerHold(uint8_t address, uint8_t reg)
+{
+  if (_pointerHoldCount < MAX_POINTER_HOLDS)
+  {
+    _pointerHolds[_pointerHoldCount].address = address;
+    _pointerHolds[_pointerHoldCount].reg = reg;
+    _pointerHolds[_pointerHoldCount].valid = false;
+    _pointerHoldCount++;
+  }
+}
+
+void I2CBusManager::invalidatePointer(uint8_t address)
+{
+  for (int i = 0; i < _pointerHoldCount; i++)
+  {
+    if (_pointerHolds[i].address == address)
+    {
+      _pointerHolds[i].valid = false;
+    }
+  }
+}
+
+void I2CBusManager::record(Stats &stats, unsigned long startMicros, unsigned long endMicros, bool ok)
+{
+  unsigned long elapsed = endMicros - startMicros;
+  stats.count++;
+  stats.totalMicros += elapsed;
+  if (elapsed > stats.maxMicros)
+  {
+    stats.maxMicros = elapsed;
+  }
+  if (!ok)
+  {
+    stats.errors++;
+  }
+}
+
+uint32_t I2CBusManager::getClock() const
+{
+  return _clockHz;
+}
+
+int I2CBusManager::getQueueDepth() const
+{
+  return _queueCount;
+}
+
+const I2CBusManager::Stats &I2CBusManager::getDirectStats() const
+{
+  return _directStats;
+}
+
+const I2CBusManager::Stats &I2CBusManager::getQueuedStats() const
+{
+  return _queuedStats;
+}
+
+unsigned long I2CBusManager::getSkippedPointerWrites() const
+{
+  return _skippedPointerWrites;
+}
+
+void I2CBusManager::resetStats()
+{
+  _directStats = Stats();
+  _queuedStats = Stats();
+  _skippedPointerWrites = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef I2CBusManager_h
+#define I2CBusManager_h
+
+#include "HAL.h"
+
+// Owns the shared I2C bus. Direct calls (the encoder) run immediately;
+// submitted transactions (the AHT21) are queued and only run from service(),
+// which the scheduler calls in slack time, so they never delay an encoder read.
+//
+// Devices whose register pointer stays put after a read (the AS5600 output
+// registers) can be registered with setPointerHold(); repeated readRegister()
+// calls on them then skip the pointer write and cost a single read transfer.
+class I2CBusManager : public I2CBus {
+public:
+    struct Stats {
+        unsigned long count;
+        unsigned long errors;
+        unsigned long totalMicros;
+        unsigned long maxMicros;
+    };
+
+    static const int QUEUE_SIZE = 4;
+    static const int MAX_POINTER_HOLDS = 2;
+
+    I2CBusManager(I2CBus &bus, Clock &clock);
+
+    void begin() override; // Starts the bus once; later calls do nothing
+    void setClock(uint32_t hz) override;
+    bool write(uint8_t address, const uint8_t *data, size_t length, bool sendStop = true) override;
+    size_t read(uint8_t address, uint8_t *buffer, size_t length) override;
+    bool readRegister(uint8_t address, uint8_t reg, uint8_t *buffer, size_t length) override;
+    bool submit(I2CTransaction &transaction) override; // false when the queue is full
+
+    void setPointerHold(uint8_t address, uint8_t reg);
+    void service(); // Runs at most one queued transaction
+
+    uint32_t getClock() const;
+    int getQueueDepth() const;
+    const Stats &getDirectStats() const;
+    const Stats &getQueuedStats() const;
+    unsigned long getSkippedPointerWrites() const;
+    void resetStats();
+
+private:
+    struct PointerHold {
+        uint8_t address;
+        uint8_t reg;
+        bool valid; // The device pointer is known to be on reg
+    };
+
+    I2CBus &_bus;
+    Clock &_clock;
+    bool _started;
+    uint32_t _clockHz;
+
+    I2CTransaction *_queue[QUEUE_SIZE];
+    int _queueHead;
+    int _queueCount;
+
+    PointerHold _pointerHolds[MAX_POINTER_HOLDS];
+    int _pointerHoldCount;
+
+    Stats _directStats;
+    Stats _queuedStats;
+    unsigned long _skippedPointerWrites;
+
+    void invalidatePointer(uint8_t address);
+    static void record(Stats &stats, unsigned long startMicros, unsigned long endMicros, bool ok);
+};
+
+#endif
@@ -0,0 +1,245 @@
+#include "JsonWriter.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char *buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _overflow(false), _needsComma(false), _filter(nullptr), _depth(0),
+      _skipDepth(0)
+{
+  if (_size > 0)
+  {
+    _buffer[0] = '\0';
+  }
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+  begin(key, '{');
+}
+
+void JsonWriter::endObject()
+{
+  end('}');
+}
+
+void JsonWriter::beginArray(const char *key)
+{
+  begin(key, '[');
+}
+
+void JsonWriter::endArray()
+{
+  end(']');
+}
+
+void JsonWriter::begin(const char *key, char bracket)
+{
+  if (_skipDepth == 0 && skips(key))
+  {
+    _skipDepth = _depth + 1;
+  }
+  _depth++;
+  if (_skipDepth != 0)
+  {
+    return;
+  }
+  writeKey(key);
+  writeChar(bracket);
+  _needsComma = false;
+}
+
+void JsonWriter::end(char bracket)
+{
+  bool skipped = _skipDepth != 0;
+  if (_skipDepth == _depth)
+  {
+    _skipDepth = 0;
+  }
+  _depth--;
+  if (skipped)
+  {
+    return;
+  }
+  writeChar(bracket);
+  _needsComma = true;
+}
+
+void JsonWriter::addString(const char *key, const char *value)
+{
+  if (skips(key))
+  {
+    return;
+  }
+  writeKey(key);
+  writeChar('"');
+  writeEscaped(value);
+  writeChar('"');
+  _needsComma = true;
+}
+
+void JsonWriter::addNumber(const char *key, double value, int decimals)
+{
+  if (skips(key))
+  {
+    return;
+  }
+  writeKey(key);
+  if (isnan(value) || isinf(value))
+  {
+    writeRaw("null");
+  }
+  else
+  {
+    char number[24];
+    snprintf(number, sizeof(number), "%.*f", decimals, value);
+    writeRaw(number);
+  }
+  _needsComma = true;
+}
+
+void JsonWriter::addInteger(const char *key, long value)
+{
+  if (skips(key))
+  {
+    return;
+  }
+  writeKey(key);
+  char number[12];
+  snprintf(number, sizeof(number), "%ld", value);
+  writeRaw(number);
+  _needsComma = true;
+}
+
+void JsonWriter::addBool(const char *key, bool value)
+{
+  if (skips(key))
+  {
+    return;
+  }
+  writeKey(key);
+  writeRaw(value ? "true" : "false");
+  _needsComma = true;
+}
+
+void JsonWriter::addMembers(const char *members)
+{
+  if (_skipDepth != 0 || *members == '\0')
+  {
+    return;
+  }
+  writeKey(nullptr);
+  writeRaw(members);
+  _needsComma = true;
+}
+
+void JsonWriter::setFilter(const char *keys)
+{
+  _filter = keys;
+}
+
+bool JsonWriter::hasFilter() const
+{
+  return _filter != nullptr;
+}
+
+// Only members of the outermost object are filtered
+bool JsonWriter::skips(const char *key) const
+{
+  if (_skipDepth != 0)
+  {
+    return true;
+  }
+  if (_filter == nullptr || _depth != 1 || key == nullptr)
+  {
+    return false;
+  }
+  size_t length = strlen(key);
+  for (const char *entry = _filter; *entry != '\0';)
+  {
+    const char *end = strchr(entry, ',');
+    size_t entryLength = end != nullptr ? end - entry : strlen(entry);
+    if (entryLength == length && strncmp(entry, key, length) == 0)
+    {
+      return false;
+    }
+    if (end == nullptr)
+    {
+      break;
+    }
+    entry = end + 1;
+  }
+  return true;
+}
+
+const char *JsonWriter::c_str() const
+{
+  return _buffer;
+}
+
+size_t JsonWriter::length() const
+{
+  return _length;
+}
+
+bool JsonWriter::overflowed() const
+{
+  return _overflow;
+}
+
+void JsonWriter::writeKey(const char *key)
+{
+  if (_needsComma)
+  {
+    writeChar(',');
+  }
+  if (key != nullptr)
+  {
+    writeChar('"');
+    writeEscaped(key);
+    writeRaw("\":");
+  }
+}
+
+void JsonWriter::writeRaw(const char *text)
+{
+  while (*text)
+  {
+    writeChar(*text++);
+  }
+}
+
+void JsonWriter::writeChar(char c)
+{
+  // Always keep room for the terminator
+  if (_length + 1 >= _size)
+  {
+    _overflow = true;
+    return;
+  }
+  _buffer[_length++] = c;
+  _buffer[_length] = '\0';
+}
+
+void JsonWriter::writeEscaped(const char *text)
+{
+  for (; *text; text++)
+  {
+    char c = *text;
+    if (c == '"' || c == '\\')
+    {
+      writeChar('\\');
+      writeChar(c);
+    }
+    else if (static_cast<uint8_t>(c) < 0x20)
+    {
+      char escape[7];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      writeRaw(escape);
+    }
+    else
+    {
+      writeChar(c);
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef JsonWriter_h
+#define JsonWriter_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming JSON writer that formats straight into a caller-owned buffer.
+// Nothing is allocated; if the buffer is too small the output is truncated
+// and overflowed() reports it.
+//
+// Values inside an array are added with a nullptr key.
+//
+// A filter limits the members of the outermost object to a comma separated
+// list of keys; an object not on the list is skipped with everything in it.
+class JsonWriter {
+public:
+    JsonWriter(char *buffer, size_t size);
+
+    void beginObject(const char *key = nullptr);
+    void endObject();
+    void beginArray(const char *key = nullptr);
+    void endArray();
+
+    void addString(const char *key, const char *value);
+    void addNumber(const char *key, double value, int decimals = 2);
+    void addInteger(const char *key, long value);
+    void addBool(const char *key, bool value);
+    void addMembers(const char *members); // Pre-rendered "key":value pairs, not filtered
+
+    void setFilter(const char *keys); // nullptr writes everything
+    bool hasFilter() const;
+
+    const char *c_str() const;
+    size_t length() const;
+    bool overflowed() const;
+
+private:
+    char *_buffer;
+    size_t _size;
+    size_t _length;
+    bool _overflow;
+    bool _needsComma;
+    const char *_filter;
+    int _depth;     // Objects open
+    int _skipDepth; // Depth of the object being skipped, 0 if none
+
+    bool skips(const char *key) const;
+    void begin(const char *key, char bracket);
+    void end(char bracket);
+
+    void writeKey(const char *key);
+    void writeRaw(const char *text);
+    void writeChar(char c);
+    void writeEscaped(const char *text);
+};
+
+#endif
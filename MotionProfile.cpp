@@ -0,0 +1,83 @@
+#include "MotionProfile.h"
+#include <math.h>
+
+MotionProfile::MotionProfile()
+    : _start(0), _target(0), _direction(1), _distance(0), _acceleration(1), _peakVelocity(0), _accelTime(0),
+      _cruiseTime(0)
+{
+}
+
+void MotionProfile::plan(int64_t start, int64_t target, float maxVelocity, float acceleration)
+{
+  _start = start;
+  _target = target;
+  _direction = target >= start ? 1 : -1;
+  _acceleration = acceleration;
+
+  _distance = static_cast<double>(target >= start ? target - start : start - target);
+  if (_distance == 0 || maxVelocity <= 0 || acceleration <= 0)
+  {
+    // Nothing to move, or no way to: hold the target from the start rather
+    // than divide by zero
+    _start = target;
+    _distance = 0;
+    _peakVelocity = 0;
+    _accelTime = 0;
+    _cruiseTime = 0;
+  }
+  else if (_distance * acceleration < static_cast<double>(maxVelocity) * maxVelocity)
+  {
+    // Triangular: decelerate as soon as the peak is reached
+    _peakVelocity = sqrt(_distance * acceleration);
+    _accelTime = _peakVelocity / acceleration;
+    _cruiseTime = 0;
+  }
+  else
+  {
+    _peakVelocity = maxVelocity;
+    _accelTime = _peakVelocity / acceleration;
+    _cruiseTime = (_distance - _peakVelocity * _accelTime) / _peakVelocity;
+  }
+}
+
+void MotionProfile::sample(unsigned long elapsedMicros, int64_t &position, float &velocity) const
+{
+  double t = elapsedMicros * 1e-6;
+  double travelled;
+  double speed;
+  if (t < _accelTime)
+  {
+    travelled = 0.5 * _acceleration * t * t;
+    speed = _acceleration * t;
+  }
+  else if (t < _accelTime + _cruiseTime)
+  {
+    travelled = 0.5 * _peakVelocity * _accelTime + _peakVelocity * (t - _accelTime);
+    speed = _peakVelocity;
+  }
+  else if (t < getDuration())
+  {
+    double remaining = getDuration() - t;
+    travelled = _distance - 0.5 * _acceleration * remaining * remaining;
+    speed = _acceleration * remaining;
+  }
+  else
+  {
+    position = _target;
+    velocity = 0;
+    return;
+  }
+
+  position = _start + _direction * static_cast<int64_t>(llround(travelled));
+  velocity = static_cast<float>(_direction * speed);
+}
+
+double MotionProfile::getDuration() const
+{
+  return 2 * _accelTime + _cruiseTime;
+}
+
+int64_t MotionProfile::getTarget() const
+{
+  return _target;
+}
@@ -0,0 +1,34 @@
+#ifndef MotionProfile_h
+#define MotionProfile_h
+
+#include <stdint.h>
+
+// Trapezoidal move between two multi-turn positions, starting and ending at
+// rest. Positions are encoder ticks; velocity and acceleration are ticks/s
+// and ticks/s^2. Short moves that never reach the maximum velocity become
+// triangular. A move of no distance, or with no velocity or acceleration,
+// holds the target.
+//
+// Distances and times are doubles: a float holds whole ticks only up to
+// 2^24, 4096 turns, and seconds to a microsecond only up to 16s.
+class MotionProfile {
+public:
+    MotionProfile();
+    void plan(int64_t start, int64_t target, float maxVelocity, float acceleration);
+    // Reference position and velocity elapsedMicros after the start
+    void sample(unsigned long elapsedMicros, int64_t &position, float &velocity) const;
+    double getDuration() const; // Seconds
+    int64_t getTarget() const;
+
+private:
+    int64_t _start;
+    int64_t _target;
+    int _direction;      // +1 or -1
+    double _distance;    // Ticks, always positive
+    double _acceleration;
+    double _peakVelocity;
+    double _accelTime;   // Time spent accelerating, and again decelerating
+    double _cruiseTime;
+};
+
+#endif
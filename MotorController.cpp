@@ -1,25 +1,36 @@
 #include "MotorController.h"
 
-#define AS5600_ADDRESS 0x36
-#define AS5600_RAW_ANGLE_REG 0x0C // Register for the 12-bit raw angle
-
-#define CALIBRATION_DATA_START 136                 // Start address for calibration data
-#define CALIBRATION_DATA_LENGTH sizeof(double) * 2 // Assuming two double values for min and max speeds
-#define CALIBRATION_STATE_ADDRESS 152              // An address not used by other data
-
-double easeInOut(double currentTime, double startValue, double changeInValue, double duration)
-{
-  currentTime /= duration / 2;
-  if (currentTime < 1)
-    return changeInValue / 2 * currentTime * currentTime + startValue;
-  currentTime--;
-  return -changeInValue / 2 * (currentTime * (currentTime - 2) - 1) + startValue;
-}
-
-MotorController::MotorController(EEPROMConfig &eepromConfig, AHT21Sensor &aht21Sensor, Encoder &encoder)
-    : _eepromConfig(eepromConfig), _aht21Sensor(aht21Sensor), _encoder(encoder), _kp(2.0), _ki(0.1), _kd(0.1), _pid(&_actualSpeed, &_output, &_targetSpeed, _kp, _ki, _kd, DIRECT)
+MotorController::MotorController(Hal &hal, EEPROMConfig &eepromConfig, AHT21Sensor &aht21Sensor, Encoder &encoder)
+    : _kp(2.0), _ki(0.1), _kd(0.1), _kf(0), _hal(hal), _aht21Sensor(aht21Sensor), _eepromConfig(eepromConfig), _encoder(encoder)
 {
-  // ... rest of the constructor ...
+  _appliedPWM = 0;
+  _targetSpeed = 0;
+  _actualSpeed = 0;
+  _output = 0;
+  _pwmPerRPM = 0;
+  _feedForwardGain = 0;
+  _feedForward = 0;
+  _hasSpeedTable = false;
+  _isHolding = false;
+  _positionKp = 0.5;
+  _moveMaxRPM = 1000;
+  _moveAccelerationRPM = 5000;
+  _profileStartTime = 0;
+  _trajectoryOrigin = 0;
+  _bridgeEnabled = false;
+  _commandTimeout = 0;
+  _failsafeRamp = 0;
+  _lastCommandTime = 0;
+  _failsafeActive = false;
+  _failsafeTrips = 0;
+  _openLoop = false;
+  _openLoopEntries = 0;
+  _currentLimits = CurrentLimits();
+  _outputLimit = 1023;
+  _lastSample = ControlSample();
+  _staticStatus[0] = '\0';
+  memset(&_staticStatusKey, 0, sizeof(_staticStatusKey));
+  _staticStatusBuilds = 0;
 }
 
 void MotorController::init(int rpwmPin, int lpwmPin, int renPin, int lenPin)
@@ -32,29 +43,32 @@ void MotorController::init(int rpwmPin, int lpwmPin, int renPin, int lenPin)
   _renPin = renPin;
   _lenPin = lenPin;
 
-  Wire.begin();
-
   // Initialize the pins as outputs.
-  pinMode(_rpwmPin, OUTPUT);
-  pinMode(_lpwmPin, OUTPUT);
+  _hal.gpio.setMode(_rpwmPin, OUTPUT);
+  _hal.gpio.setMode(_lpwmPin, OUTPUT);
 
-  pinMode(_lenPin, OUTPUT);
-  pinMode(_renPin, OUTPUT);
-  digitalWrite(_lenPin, HIGH);
-  digitalWrite(_renPin, HIGH);
+  _hal.gpio.setMode(_lenPin, OUTPUT);
+  _hal.gpio.setMode(_renPin, OUTPUT);
+  _hal.gpio.write(_lenPin, HIGH);
+  _hal.gpio.write(_renPin, HIGH);
 
   // Initialization code...
-  _pid.SetOutputLimits(-1023, 1023); // Set output limits to match PWM range
-  _pid.SetSampleTime(SampleTime);    // Set how often the PID loop is updated (in milliseconds)
-  _pid.SetMode(AUTOMATIC);           // Set PID to automatic mode
+  _pid.setOutputLimits(-(1023L << FixedPID::FRACTION_BITS), 1023L << FixedPID::FRACTION_BITS); // PWM range
+  applyPIDTunings();
+  updateSpeedScale();
 
-  _lastUpdateTime = millis();
+  _lastUpdateTime = _hal.clock.micros();
   _lastPosition = 0;
 
   readGUID(_serialNumber);
   Serial.print("Serial Number: ");
   Serial.println(String(_serialNumber));
   loadCalibrationData();
+  _hasSpeedTable = _eepromConfig.readSpeedTable(_speedTable);
+  loadPIDGains();
+  _commandTimeout = _eepromConfig.readCommandTimeout();
+  _failsafeRamp = _eepromConfig.readFailsafeRamp();
+  loadProtection();
 }
 
 void MotorController::setPIDValues(double kp, double ki, double kd)
@@ -62,72 +76,379 @@ void MotorController::setPIDValues(double kp, double ki, double kd)
   _kp = kp;
   _ki = ki;
   _kd = kd;
-  _pid.SetTunings(_kp, _ki, _kd);
+  applyPIDTunings();
+}
+
+void MotorController::setFeedForwardGain(double kf)
+{
+  _kf = kf;
+  _feedForwardGain = FixedPID::fromFloat(kf);
+  updateFeedForward();
+}
+
+// Open-loop duty for the target, from the calibration sweep when there is
+// one, otherwise the linear map. Recalculated only when the target changes.
+void MotorController::updateFeedForward()
+{
+  if (_kf == 0)
+  {
+    _feedForward = 0;
+  }
+  else if (_hasSpeedTable)
+  {
+    _feedForward = FixedPID::fromFloat(_kf * _speedTable.dutyFor(_targetSpeedRPM));
+  }
+  else
+  {
+    _feedForward = (static_cast<int64_t>(_feedForwardGain) * _targetSpeed) >> FixedPID::FRACTION_BITS;
+  }
+}
+
+// The scheduler calls update() every SampleTime, so the per-step gains are
+// fixed at that period
+void MotorController::applyPIDTunings()
+{
+  _pid.setTunings(_kp, _ki, _kd, SampleTime / 1000.0f);
 }
 void MotorController::readGUID(char *guid)
 {
   _eepromConfig.readGUID(guid);
 }
 
-String MotorController::getStatusJson(String FIRMWARE_VERSION, String message)
+// The firmware version and serial number are fixed once running, so only
+// the settings are compared to decide whether to rebuild
+const char *MotorController::getStaticStatus(const String &firmwareVersion)
+{
+  StaticStatusKey key;
+  memset(&key, 0, sizeof(key)); // Padding too, for memcmp
+  key.kp = _kp;
+  key.ki = _ki;
+  key.kd = _kd;
+  key.kf = _kf;
+  key.minSpeed = _minOperationalSpeed;
+  key.maxSpeed = _maxOperationalSpeed;
+  key.calibrated = _isCalibrated;
+  key.hasSpeedTable = _hasSpeedTable;
+
+  if (_staticStatusBuilds == 0 || memcmp(&key, &_staticStatusKey, sizeof(key)) != 0)
+  {
+    JsonWriter json(_staticStatus, sizeof(_staticStatus));
+    writeStaticStatusFields(json, firmwareVersion);
+    _staticStatusKey = key;
+    _staticStatusBuilds++;
+  }
+  return _staticStatus;
+}
+
+void MotorController::writeStaticStatusFields(JsonWriter &json, const String &firmwareVersion)
+{
+  json.addString("firmwareVersion", firmwareVersion.c_str());
+  json.addString("serialNumber", _serialNumber);
+  json.addBool("calibrated", !_isCalibrated);
+  json.beginObject("pid");
+  json.addNumber("kp", _kp);
+  json.addNumber("ki", _ki);
+  json.addNumber("kd", _kd);
+  json.addNumber("kf", _kf);
+  json.addString("feedForward", _kf == 0 ? "off" : _hasSpeedTable ? "table" : "linear");
+  json.endObject();
+  json.addNumber("minSpeed", _minOperationalSpeed);
+  json.addNumber("maxSpeed", _maxOperationalSpeed);
+}
+
+unsigned long MotorController::getStaticStatusBuilds() const
+{
+  return _staticStatusBuilds;
+}
+
+// A filtered status writes the settings it asks for directly; the full one
+// copies them from the pre-rendered block
+void MotorController::writeStatusFields(JsonWriter &json, const String &firmwareVersion, const char *message)
 {
   double currentValue = _encoder.getSpeed();
 
   float temperature = _aht21Sensor.readTemperature();
   float humidity = _aht21Sensor.readHumidity();
 
-  String json = "{";
-  json += "\"firmwareVersion\":\"" + FIRMWARE_VERSION + "\",";
-  json += "\"serialNumber\":\"" + String(_serialNumber) + "\",";
-  json += "\"calibrated\":" + String(!_isCalibrated ? "true" : "false") + ",";
-  json += "\"pid\":{\"kp\":" + String(_kp) + ",\"ki\":" + String(_ki) + ",\"kd\":" + String(_kd) + "},";
-  json += "\"direction\":\"" + _direction + "\",";
-  json += "\"minSpeed\":" + String(_minOperationalSpeed) + ",";
-  json += "\"maxSpeed\":" + String(_maxOperationalSpeed) + ",";
-  json += "\"position\":" + String(currentPosition) + ",";
-  json += "\"actualSpeed\":" + String(_actualSpeed) + ",";
-  json += "\"targetSpeed\":" + String(_targetSpeed) + ",";
-  json += "\"actualSpeedRPM\":" + String(currentValue) + ",";
-  json += "\"targetSpeedRPM\":" + String(_targetSpeedRPM) + ",";
-  json += "\"temperature\":" + String(temperature) + ",";
-  json += "\"humidity\":" + String(humidity) + ",";
-  json += "\"message\":\"" + String(message) + "\"";
-  json += "}";
-  return json;
+  if (json.hasFilter())
+  {
+    writeStaticStatusFields(json, firmwareVersion);
+  }
+  else
+  {
+    json.addMembers(getStaticStatus(firmwareVersion));
+  }
+  json.addString("direction", _direction.c_str()); // Follows the encoder every step
+  json.addInteger("position", currentPosition);
+  json.addInteger("absolutePosition", static_cast<long>(_encoder.getPosition()));
+  json.addInteger("targetPosition", static_cast<long>(_profile.getTarget()));
+  json.addBool("positionMode", _isHolding);
+  json.addNumber("actualSpeed", FixedPID::toFloat(_actualSpeed));
+  json.addNumber("targetSpeed", FixedPID::toFloat(_targetSpeed));
+  json.addNumber("actualSpeedRPM", currentValue);
+  json.addNumber("targetSpeedRPM", _targetSpeedRPM);
+  json.addNumber("temperature", temperature);
+  json.addNumber("humidity", humidity);
+  const ConfigStore &store = _eepromConfig.getStore();
+  json.beginObject("config");
+  json.addInteger("sequence", store.getSequence());
+  json.addInteger("writes", store.getWriteCount());
+  json.addInteger("erases", store.getEraseCount());
+  json.addInteger("corruptRecords", store.getCorruptRecords());
+  json.addInteger("failedSaves", store.getFailedSaves());
+  json.endObject();
+  json.beginObject("failsafe");
+  json.addInteger("timeoutMs", _commandTimeout);
+  json.addInteger("rampMs", _failsafeRamp);
+  json.addInteger("idleMs", _hal.clock.millis() - _lastCommandTime);
+  json.addBool("active", _failsafeActive);
+  json.addInteger("trips", _failsafeTrips);
+  json.endObject();
+  json.beginObject("protection");
+  json.addNumber("current", _protection.getCurrent());
+  json.addNumber("load", _protection.getLoad());
+  json.addNumber("scale", _protection.getScale());
+  json.addString("fault", Protection::faultName(_protection.getFault()));
+  json.addString("lastFault", Protection::faultName(_protection.getLastFault()));
+  json.addInteger("trips", _protection.getTrips());
+  json.addNumber("ratedCurrent", _protection.getSettings().ratedCurrent);
+  json.addNumber("temperatureCutoff", _protection.getSettings().temperatureCutoff);
+  json.endObject();
+  json.beginObject("encoder");
+  json.addBool("trusted", _encoder.isTrusted());
+  json.addBool("openLoop", _openLoop);
+  json.addInteger("openLoopEntries", _openLoopEntries);
+  json.endObject();
+  json.addString("message", message);
+}
+
+// The values writeStatusFields() writes, at the resolution it writes them.
+// The firmware version and serial number never change, and idleMs changes
+// every millisecond, so it is left out: it is as old as the last full
+// status a poller was sent.
+void MotorController::trackStatusFields(StatusTracker &tracker)
+{
+  tracker.track("calibrated", static_cast<long>(_isCalibrated));
+  tracker.track("pid", _kp);
+  tracker.track("pid", _ki);
+  tracker.track("pid", _kd);
+  tracker.track("pid", _kf);
+  tracker.track("pid", static_cast<long>(_hasSpeedTable));
+  tracker.track("minSpeed", _minOperationalSpeed);
+  tracker.track("maxSpeed", _maxOperationalSpeed);
+  tracker.track("direction", _direction.c_str());
+  tracker.track("position", static_cast<long>(currentPosition));
+  tracker.track("absolutePosition", static_cast<long>(_encoder.getPosition()));
+  tracker.track("targetPosition", static_cast<long>(_profile.getTarget()));
+  tracker.track("positionMode", static_cast<long>(_isHolding));
+  tracker.track("actualSpeed", static_cast<double>(FixedPID::toFloat(_actualSpeed)));
+  tracker.track("targetSpeed", static_cast<double>(FixedPID::toFloat(_targetSpeed)));
+  tracker.track("actualSpeedRPM", _encoder.getSpeed());
+  tracker.track("targetSpeedRPM", _targetSpeedRPM);
+  tracker.track("temperature", static_cast<double>(_aht21Sensor.readTemperature()));
+  tracker.track("humidity", static_cast<double>(_aht21Sensor.readHumidity()));
+  const ConfigStore &store = _eepromConfig.getStore();
+  tracker.track("config", static_cast<long>(store.getSequence()));
+  tracker.track("config", static_cast<long>(store.getWriteCount()));
+  tracker.track("config", static_cast<long>(store.getEraseCount()));
+  tracker.track("config", static_cast<long>(store.getCorruptRecords()));
+  tracker.track("config", static_cast<long>(store.getFailedSaves()));
+  tracker.track("failsafe", static_cast<long>(_commandTimeout));
+  tracker.track("failsafe", static_cast<long>(_failsafeRamp));
+  tracker.track("failsafe", static_cast<long>(_failsafeActive));
+  tracker.track("failsafe", static_cast<long>(_failsafeTrips));
+  tracker.track("protection", static_cast<double>(_protection.getCurrent()));
+  tracker.track("protection", static_cast<double>(_protection.getLoad()));
+  tracker.track("protection", static_cast<double>(_protection.getScale()));
+  tracker.track("protection", static_cast<long>(_protection.getFault()));
+  tracker.track("protection", static_cast<long>(_protection.getLastFault()));
+  tracker.track("protection", static_cast<long>(_protection.getTrips()));
+  tracker.track("protection", static_cast<double>(_protection.getSettings().ratedCurrent));
+  tracker.track("protection", static_cast<double>(_protection.getSettings().temperatureCutoff));
+  tracker.track("encoder", static_cast<long>(_encoder.isTrusted()));
+  tracker.track("encoder", static_cast<long>(_openLoop));
+  tracker.track("encoder", static_cast<long>(_openLoopEntries));
 }
 
+// Holding is a zero-length move to the current multi-turn position
 void MotorController::hold()
 {
-  _holdPosition = _encoder.readRawAngle(); // Capture the current position
+  int64_t position = _encoder.getPosition();
+  moveTo(position);
+}
+
+// Cascaded position control: each control step samples the profile and the
+// outer loop turns its position error into a speed target for the speed PID.
+void MotorController::moveTo(int64_t target)
+{
+  const float rpmToTicksPerSecond = encoderCountsPerRevolution / 60.0f;
+  _profile.plan(_encoder.getPosition(), target, _moveMaxRPM * rpmToTicksPerSecond,
+                _moveAccelerationRPM * rpmToTicksPerSecond);
+  _profileStartTime = _hal.clock.micros();
+
   setTargetSpeed(0);
-  _isHolding = true; // Set the flag to indicate hold mode
+  _isHolding = true; // Position mode
+}
+
+void MotorController::moveBy(int64_t distance)
+{
+  // Relative to the current target so consecutive moves do not accumulate error
+  int64_t start = _isHolding ? _profile.getTarget() : _encoder.getPosition();
+  moveTo(start + distance);
+}
+
+void MotorController::setMoveLimits(double maxRPM, double accelerationRPMPerSecond)
+{
+  if (maxRPM > 0)
+  {
+    _moveMaxRPM = maxRPM;
+  }
+  if (accelerationRPMPerSecond > 0)
+  {
+    _moveAccelerationRPM = accelerationRPMPerSecond;
+  }
+}
+
+void MotorController::setPositionGain(double kp)
+{
+  _positionKp = kp;
+}
+
+bool MotorController::isPositionMode() const
+{
+  return _isHolding;
+}
+
+int64_t MotorController::getTargetPosition() const
+{
+  return _profile.getTarget();
+}
+
+void MotorController::updatePositionLoop(unsigned long currentTime)
+{
+  int64_t referencePosition;
+  float referenceVelocity;
+  _profile.sample(currentTime - _profileStartTime, referencePosition, referenceVelocity);
+
+  double speed = positionLoopSpeed(referencePosition, referenceVelocity);
+  double limit = _moveMaxRPM * 1.2; // Leave some headroom to catch up with the profile
+  setSpeedSetpoint(constrain(speed, -limit, limit));
+}
+
+// Speed target in RPM: reference velocity (ticks/s) plus the position correction
+double MotorController::positionLoopSpeed(int64_t referencePosition, float referenceVelocity)
+{
+  double speed = referenceVelocity * 60.0 / encoderCountsPerRevolution;
+  if (_openLoop)
+  {
+    return speed; // The position is not to be trusted: follow the profile's speed alone
+  }
+  double positionError = static_cast<double>(referencePosition - _encoder.getPosition());
+  return speed + _positionKp * positionError;
+}
+
+// Per-step setpoint change, unlike setTargetSpeed() this does not touch the bridge
+void MotorController::setSpeedSetpoint(double speed)
+{
+  _targetSpeedRPM = speed;
+  _targetSpeed = rpmToFixedPWM(speed);
+  updateFeedForward();
+}
+
+// Plays the queued waypoints from now. Velocity trajectories start from the
+// current speed target, position trajectories from the current position.
+bool MotorController::startTrajectory()
+{
+  if (_trajectory.getCount() == 0)
+  {
+    return false;
+  }
+  bool velocity = _trajectory.getMode() == TrajectoryQueue::VELOCITY;
+  double initialSpeed = _targetSpeedRPM;
+  setTargetSpeed(initialSpeed); // Enables the bridge, leaves position mode
+  _trajectoryOrigin = _encoder.getPosition();
+  _trajectory.start(_hal.clock.micros(), velocity ? initialSpeed : 0);
+  return true;
+}
+
+void MotorController::stopTrajectory()
+{
+  _trajectory.clear();
+}
+
+TrajectoryQueue &MotorController::getTrajectory()
+{
+  return _trajectory;
+}
+
+void MotorController::updateTrajectory(unsigned long currentTime)
+{
+  float value, rate;
+  bool running = _trajectory.sample(currentTime, value, rate);
+
+  if (_trajectory.getMode() == TrajectoryQueue::VELOCITY)
+  {
+    setSpeedSetpoint(value); // The last speed is kept once the queue runs out
+  }
+  else
+  {
+    int64_t referencePosition = _trajectoryOrigin + static_cast<int64_t>(lroundf(value));
+    setSpeedSetpoint(positionLoopSpeed(referencePosition, rate));
+    if (!running)
+    {
+      // Hold the final waypoint
+      _profile.plan(referencePosition, referencePosition, 0, 1);
+      _profileStartTime = currentTime;
+      _isHolding = true;
+    }
+  }
+
+  if (!running)
+  {
+    _trajectory.clear();
+  }
 }
 
 void MotorController::brake()
 {
   _isHolding = false;
-  digitalWrite(_lenPin, HIGH);
-  digitalWrite(_renPin, HIGH);
-  digitalWrite(_lpwmPin, HIGH);
-  digitalWrite(_rpwmPin, HIGH);
+  _bridgeEnabled = false;
+  _failsafeActive = false;
+  _trajectory.clear();
+  _autoTuner.abort();
+  _calibrator.abort();
+  _hal.gpio.write(_lenPin, HIGH);
+  _hal.gpio.write(_renPin, HIGH);
+  _hal.gpio.write(_lpwmPin, HIGH);
+  _hal.gpio.write(_rpwmPin, HIGH);
 }
 
 void MotorController::release()
 {
   _isHolding = false;
-  digitalWrite(_lenPin, LOW);
-  digitalWrite(_renPin, LOW);
-  digitalWrite(_lpwmPin, LOW);
-  digitalWrite(_rpwmPin, LOW);
+  _bridgeEnabled = false;
+  _failsafeActive = false;
+  _trajectory.clear();
+  _autoTuner.abort();
+  _calibrator.abort();
+  _hal.gpio.write(_lenPin, LOW);
+  _hal.gpio.write(_renPin, LOW);
+  _hal.gpio.write(_lpwmPin, LOW);
+  _hal.gpio.write(_rpwmPin, LOW);
 }
 
 void MotorController::free()
 {
   _isHolding = false;
-  analogWrite(_rpwmPin, 0);
-  analogWrite(_lpwmPin, 0);
-  digitalWrite(_lenPin, LOW);
-  digitalWrite(_renPin, LOW);
+  _bridgeEnabled = false;
+  _failsafeActive = false;
+  _trajectory.clear();
+  _autoTuner.abort();
+  _calibrator.abort();
+  _hal.pwm.setDuty(_rpwmPin, 0);
+  _hal.pwm.setDuty(_lpwmPin, 0);
+  _hal.gpio.write(_lenPin, LOW);
+  _hal.gpio.write(_renPin, LOW);
 }
 
 double MotorController::rpmToPWM(double rpm)
@@ -142,49 +463,370 @@ double MotorController::rpmToPWM(double rpm)
   return pwmValue;
 }
 
-void MotorController::update()
+void MotorController::updateSpeedScale()
+{
+  const float maxRPM = _maxOperationalSpeed > 100 ? _maxOperationalSpeed : 3500;
+  _pwmPerRPM = 1023 / maxRPM;
+}
+
+// Same scale as rpmToPWM() but keeps the fraction, clamped to the PWM range
+int32_t MotorController::rpmToFixedPWM(float rpm)
+{
+  float pwm = rpm * _pwmPerRPM;
+  pwm = pwm > 1023 ? 1023 : pwm < -1023 ? -1023 : pwm;
+  return FixedPID::fromFloat(pwm);
+}
+
+// Runs the step-response tuner in place of the PID. Duties are percent of
+// full PWM, closedLoopSeconds 0 lets the tuner pick the response time.
+bool MotorController::startAutoTune(int lowPercent, int highPercent, float closedLoopSeconds)
+{
+  if (lowPercent < 0 || highPercent > 100 || lowPercent >= highPercent)
+  {
+    return false;
+  }
+  _trajectory.clear();
+  _calibrator.abort();
+  _isHolding = false;
+  _targetSpeedRPM = 0;
+  _targetSpeed = 0;
+  updateFeedForward();
+  _hal.gpio.write(_lenPin, HIGH);
+  _hal.gpio.write(_renPin, HIGH);
+  _pid.reset(_actualSpeed, 0);
+  _autoTuner.start(lowPercent * 1023 / 100, highPercent * 1023 / 100, SampleTime / 1000.0f, closedLoopSeconds);
+  return true;
+}
+
+void MotorController::abortAutoTune()
+{
+  if (_autoTuner.isRunning())
+  {
+    _autoTuner.abort();
+    free();
+  }
+}
+
+AutoTuner &MotorController::getAutoTuner()
+{
+  return _autoTuner;
+}
+
+void MotorController::updateAutoTune()
+{
+  int duty = _autoTuner.update(FixedPID::toFloat(_actualSpeed));
+  _output = static_cast<int32_t>(duty) << FixedPID::FRACTION_BITS;
+  updateMotorPWM(duty);
+
+  if (_autoTuner.isRunning())
+  {
+    return;
+  }
+  free();
+  _pid.reset(_actualSpeed, 0);
+  if (_autoTuner.getState() == AutoTuner::COMPLETE)
+  {
+    const AutoTuner::Result &result = _autoTuner.getResult();
+    setPIDValues(result.kp, result.ki, result.kd);
+    // The fitted gain only corrects the linear map, the sweep table needs none
+    setFeedForwardGain(_hasSpeedTable ? 1 : result.kf);
+    // The motor is stopped, so the flash write stretching this step is harmless
+    savePIDGains();
+  }
+}
+
+void MotorController::setCommandTimeout(unsigned long timeoutMs, unsigned long rampMs)
 {
-  unsigned long currentTime = millis();
-  unsigned long timeChange = (currentTime - _lastUpdateTime);
+  _commandTimeout = timeoutMs;
+  _failsafeRamp = rampMs;
+  _eepromConfig.writeCommandTimeout(timeoutMs);
+  _eepromConfig.writeFailsafeRamp(rampMs);
+  _eepromConfig.commit();
+  keepAlive();
+}
 
-  if (timeChange >= SampleTime)
+void MotorController::keepAlive()
+{
+  _lastCommandTime = _hal.clock.millis();
+}
+
+bool MotorController::isFailsafeActive() const
+{
+  return _failsafeActive;
+}
+
+// Ramps a motor that has gone without commands for the timeout down to a
+// stop and frees it. Calibration and tuning finish by themselves.
+void MotorController::updateFailsafe()
+{
+  if (_failsafeActive)
   {
-    currentPosition = _encoder.readRawAngle();
-    double currentSpeedRPM = _encoder.getSpeed();
+    if (!_trajectory.isRunning())
+    {
+      free();
+    }
+    return;
+  }
 
-    // Use _encoder.getTotalRevolutions() if you need total revolutions count
+  bool driving = _bridgeEnabled && (_targetSpeedRPM != 0 || _isHolding || _trajectory.isRunning());
+  if (_commandTimeout == 0 || !driving || _autoTuner.isRunning() || _calibrator.isRunning() ||
+      _hal.clock.millis() - _lastCommandTime < _commandTimeout)
+  {
+    return;
+  }
 
-    if (_isHolding)
+  _failsafeTrips++;
+  _trajectory.clear();
+  _trajectory.setMode(TrajectoryQueue::VELOCITY);
+  if (_failsafeRamp > 0 && _trajectory.push(_failsafeRamp, 0) && startTrajectory())
+  {
+    _failsafeActive = true; // After startTrajectory(), which clears it
+  }
+  else
+  {
+    free();
+  }
+}
+
+void MotorController::setProtection(const CurrentLimits &limits, float temperatureCutoff)
+{
+  _eepromConfig.writeCurrentLimits(limits);
+  _eepromConfig.writeTemperatureCutoff(temperatureCutoff);
+  _eepromConfig.commit();
+  loadProtection();
+}
+
+CurrentLimits MotorController::getCurrentLimits() const
+{
+  return _currentLimits;
+}
+
+const Protection &MotorController::getProtection() const
+{
+  return _protection;
+}
+
+void MotorController::loadProtection()
+{
+  _eepromConfig.readCurrentLimits(_currentLimits);
+  Protection::Settings settings;
+  settings.ratedCurrent = _currentLimits.ratedCurrent;
+  settings.peakCurrent = _currentLimits.peakCurrent;
+  settings.thermalTimeConstant = _currentLimits.thermalTimeConstant;
+  settings.temperatureCutoff = _eepromConfig.readTemperatureCutoff();
+  _protection.configure(settings);
+}
+
+// Samples the current sense each step and scales the duty limit down as the
+// winding or the board heats up. The A0 filter averages the sense over the
+// PWM period, giving the motor current times the duty, so it is divided
+// back out; below 10% duty the estimate reads low, but so is the current.
+// The read costs about 100us of the step, so A0 is left alone when no
+// rated current is set, and when it carries the encoder instead.
+void MotorController::updateProtection()
+{
+  float current = 0;
+  if (_protection.getSettings().ratedCurrent > 0 && _encoder.getSource() != Encoder::SOURCE_ANALOG)
+  {
+    float duty = abs(_appliedPWM) / 1023.0f;
+    current = _hal.analog.read() * _currentLimits.senseAmpsPerCount / (duty > 0.1f ? duty : 0.1f);
+  }
+  float scale = _protection.update(current, _aht21Sensor.readTemperature(), SampleTime / 1000.0f);
+  int limit = static_cast<int>(1023 * scale + 0.5f);
+
+  // Nothing is left to drive with, so the bridge is freed outright
+  if ((_protection.isTripped() || limit == 0) && (_bridgeEnabled || _autoTuner.isRunning() || _calibrator.isRunning()))
+  {
+    free();
+  }
+
+  if (limit != _outputLimit)
+  {
+    _outputLimit = limit;
+    // The PID ignores an empty range; updateMotorPWM() holds the duty at 0
+    if (limit > 0)
     {
-      // Adjust target speed based on the difference from the hold position
-      int positionError = _holdPosition - currentPosition;
-      setTargetSpeed(positionError);
+      _pid.setOutputLimits(-static_cast<int32_t>(limit) << FixedPID::FRACTION_BITS,
+                           static_cast<int32_t>(limit) << FixedPID::FRACTION_BITS);
     }
+  }
+}
+
+PIDGains MotorController::getPIDGains() const
+{
+  PIDGains gains = {static_cast<float>(_kp), static_cast<float>(_ki), static_cast<float>(_kd), static_cast<float>(_kf)};
+  return gains;
+}
+
+void MotorController::savePIDGains()
+{
+  _eepromConfig.writePIDGains(getPIDGains());
+  _eepromConfig.commit();
+}
+
+void MotorController::loadPIDGains()
+{
+  PIDGains gains;
+  if (_eepromConfig.readPIDGains(gains))
+  {
+    setPIDValues(gains.kp, gains.ki, gains.kd);
+    setFeedForwardGain(gains.kf);
+  }
+}
+
+// Called once per control period by the ControlScheduler
+void MotorController::update()
+{
+  unsigned long currentTime = _hal.clock.micros();
+
+  currentPosition = _encoder.getRawAngle();
+  double currentSpeedRPM = _encoder.getSpeed();
+  updateProtection();
+  updateOpenLoop();
+
+  if (_trajectory.isRunning())
+  {
+    updateTrajectory(currentTime);
+  }
+  else if (_isHolding)
+  {
+    updatePositionLoop(currentTime);
+  }
 
-    // Update the PID controller
-    _actualSpeed = rpmToPWM(currentSpeedRPM);
-    _direction = _encoder.getDirection();
+  // Update the PID controller
+  _actualSpeed = rpmToFixedPWM(currentSpeedRPM);
+  _direction = _encoder.getDirection();
 
-    _pid.Compute();
+  _lastSample.speedRPM = currentSpeedRPM;
 
-    // Update motor PWM based on PID output
-    updateMotorPWM(_output);
+  if (_openLoop)
+  {
+    _output = openLoopOutput();
+    updateMotorPWM((_output + (1L << (FixedPID::FRACTION_BITS - 1))) >> FixedPID::FRACTION_BITS);
+  }
+  else if (_autoTuner.isRunning())
+  {
+    updateAutoTune();
+  }
+  else if (_calibrator.isRunning())
+  {
+    updateCalibration();
+  }
+  else
+  {
+    _pid.setFeedForward(_feedForward);
+    _output = _pid.compute(_targetSpeed, _actualSpeed);
 
-    // Save time for the next update
-    _lastUpdateTime = currentTime;
+    // Update motor PWM based on PID output, rounded to a whole duty step
+    updateMotorPWM((_output + (1L << (FixedPID::FRACTION_BITS - 1))) >> FixedPID::FRACTION_BITS);
   }
+
+  _lastSample.timestampMicros = currentTime;
+  _lastSample.rawAngle = currentPosition;
+  _lastSample.targetRPM = _targetSpeedRPM;
+  _lastSample.output = FixedPID::toFloat(_output);
+  _lastSample.pwm = _appliedPWM;
+
+  recordTrace(currentTime);
+  updateFailsafe();
+
+  // Save time for the next update
+  _lastUpdateTime = currentTime;
 }
 
-void MotorController::updateMotorPWM(double output)
+// Opens the speed loop when the encoder stops being trusted, and closes it
+// again without a bump once it is. Tuning and calibration measure through
+// the encoder, so they are stopped.
+void MotorController::updateOpenLoop()
+{
+  bool trusted = _encoder.isTrusted();
+  if (!trusted && !_openLoop)
+  {
+    _openLoop = true;
+    _openLoopEntries++;
+    _autoTuner.abort();
+    _calibrator.abort();
+  }
+  else if (trusted && _openLoop)
+  {
+    _openLoop = false;
+    _pid.setFeedForward(_feedForward);
+    _pid.reset(rpmToFixedPWM(_encoder.getSpeed()), _output);
+  }
+}
+
+// The duty the calibration sweep measured for the target, or the linear
+// map up to the calibrated maximum speed, within the derated limit. Before
+// a calibration the map's maximum is only a default, which can put the
+// motor at twice the target, so the motor is not driven.
+int32_t MotorController::openLoopOutput()
+{
+  int32_t output = 0;
+  if (_hasSpeedTable)
+  {
+    output = FixedPID::fromFloat(_speedTable.dutyFor(_targetSpeedRPM));
+  }
+  else if (_maxOperationalSpeed > 100)
+  {
+    output = _targetSpeed;
+  }
+  int32_t limit = static_cast<int32_t>(_outputLimit) << FixedPID::FRACTION_BITS;
+  return output > limit ? limit : output < -limit ? -limit : output;
+}
+
+bool MotorController::isOpenLoop() const
+{
+  return _openLoop;
+}
+
+unsigned long MotorController::getOpenLoopEntries() const
+{
+  return _openLoopEntries;
+}
+
+void MotorController::recordTrace(unsigned long currentTime)
+{
+  uint32_t startCycles = _hal.clock.cycles();
+
+  TraceSample sample;
+  sample.timestampMicros = currentTime;
+  sample.setpoint = _targetSpeedRPM;
+  sample.measured = _lastSample.speedRPM;
+  sample.output = FixedPID::toFloat(_output);
+  sample.errorIntegral = FixedPID::toFloat(_pid.getIntegral());
+  if (_trace.record(sample)) // Idle steps would water down the average
+  {
+    _trace.addRecordCycles(_hal.clock.cycles() - startCycles);
+  }
+}
+
+Encoder &MotorController::getEncoder()
+{
+  return _encoder;
+}
+
+TraceRecorder &MotorController::getTraceRecorder()
+{
+  return _trace;
+}
+
+const ControlSample &MotorController::getLastSample() const
+{
+  return _lastSample;
+}
+
+void MotorController::updateMotorPWM(int output)
 {
   bool isForward = output >= 0;
   int pwmValue = map(abs(output), 0, 1023, 0, 1023);
+  pwmValue = min(pwmValue, _outputLimit); // Tuning and calibration bypass the PID limits
 
   int activePin = isForward ? _rpwmPin : _lpwmPin;
-  int inactivePin = !isForward ? _lpwmPin : _rpwmPin;
+  int inactivePin = isForward ? _lpwmPin : _rpwmPin;
 
-  analogWrite(inactivePin, 0);
-  analogWrite(activePin, pwmValue);
+  _hal.pwm.setDuty(inactivePin, 0);
+  _hal.pwm.setDuty(activePin, pwmValue);
+  _appliedPWM = isForward ? pwmValue : -pwmValue;
 }
 
 void MotorController::setDirection(String direction)
@@ -194,12 +836,20 @@ void MotorController::setDirection(String direction)
 
 void MotorController::setTargetSpeed(double speed) // pass the speed as RPM but remember the PID works between -255 and +255
 {
+  _isHolding = false; // Leave position mode, moveTo() sets it again
+  _trajectory.stop();
+  _autoTuner.abort();
+  _calibrator.abort();
   _targetSpeedRPM = speed;
+  _trace.notifySetpointChange();
   _actualSpeed = 0;
-  _targetSpeed = rpmToPWM(speed);
-  _pid.SetMode(AUTOMATIC); // Enable the PID controller if not already enabled
-  digitalWrite(_lenPin, HIGH);
-  digitalWrite(_renPin, HIGH);
+  _targetSpeed = rpmToFixedPWM(speed);
+  updateFeedForward();
+  _hal.gpio.write(_lenPin, HIGH);
+  _hal.gpio.write(_renPin, HIGH);
+  _bridgeEnabled = true;
+  _failsafeActive = false;
+  keepAlive();
   setDirection(speed > 0 ? "CW" : speed < 0 ? "CCW"
                                             : "STOPPED");
 }
@@ -226,6 +876,7 @@ void MotorController::loadCalibrationData()
     _minOperationalSpeed = 0.0;
     _maxOperationalSpeed = 0.0;
   }
+  updateSpeedScale();
 }
 
 void MotorController::clearEEPROM()
@@ -247,72 +898,69 @@ void MotorController::saveCalibrationData()
   _eepromConfig.writeMinOperationalSpeed(_minOperationalSpeed);
   _eepromConfig.writeMaxOperationalSpeed(_maxOperationalSpeed);
   _eepromConfig.writeCalibrationState(false);
+  _eepromConfig.commit();
 }
 
-void MotorController::calibrate()
+// Starts the calibration state machine, update() advances it each step.
+// With resume, phases finished by an aborted run are skipped; sweep adds the
+// PWM -> RPM characterisation used for feed-forward.
+void MotorController::startCalibration(bool resume, bool sweep)
 {
-  // make sure the controller is on
-  digitalWrite(_lenPin, HIGH);
-  digitalWrite(_renPin, HIGH);
-
-  const int maxAttempts = 100; // Set an appropriate limit
-  int calibrationDelay = 50;
-  float maxTestSpeed = 600.0;
-  float speedIncrement = 1;
-  _minOperationalSpeed = maxTestSpeed;
-  int startPosition = _encoder.readRawAngle();
-  bool movementDetected = false;
-  int attempts = 0;
+  free();
+  _hal.gpio.write(_lenPin, HIGH); // make sure the controller is on
+  _hal.gpio.write(_renPin, HIGH);
+  _targetSpeedRPM = 0;
+  _targetSpeed = 0;
+  updateFeedForward();
+  _calibrator.start(_pwmPerRPM, resume, sweep);
+}
 
-  for (float speed = 0.0; speed <= maxTestSpeed && attempts < maxAttempts; speed += speedIncrement)
+void MotorController::abortCalibration()
+{
+  if (_calibrator.isRunning())
   {
-    float pwmValue = rpmToPWM(speed); // Convert percentage to PWM value
-    analogWrite(_rpwmPin, pwmValue);  // Set motor speed
-    delay(calibrationDelay);
-    attempts++;
-    currentPosition = _encoder.readRawAngle();
-    if (abs(currentPosition - startPosition) > 300)
-    {
-      _minOperationalSpeed = speed;
-      movementDetected = true;
-      break;
-    }
+    _calibrator.abort();
+    free();
   }
+}
 
-  // Data collection for curve fitting
-  std::vector<float> pwmPercentages = {1};//, 0.2, 0.3}; //, 0.4, 0.5}; // Example percentages
-  std::vector<float> recordedRpms;
+Calibrator &MotorController::getCalibrator()
+{
+  return _calibrator;
+}
 
-  float currentRpm = 0;
-  for (float pwmPercentage : pwmPercentages)
-  {
-    float pwmValue = pwmPercentage * 1023.0; // Scale percentage to PWM value
-    analogWrite(_rpwmPin, pwmValue);         // Set motor speed
+const SpeedTable *MotorController::getSpeedTable() const
+{
+  return _hasSpeedTable ? &_speedTable : nullptr;
+}
 
-    unsigned long startTime = millis();
-    unsigned long lastUpdateTime = 0;
-    while (millis() - startTime < 1000)
-    { // Loop for 1 second
-      unsigned long currentTime = millis();
-      if (currentTime - lastUpdateTime >= 10)
-      {                    // Every 5ms
-        _encoder.update(); // Update encoder reading
-        lastUpdateTime = currentTime;
-      }
-    }
+void MotorController::updateCalibration()
+{
+  int duty = _calibrator.update(_encoder.getPosition(), _lastSample.speedRPM);
+  _output = static_cast<int32_t>(duty) << FixedPID::FRACTION_BITS;
+  updateMotorPWM(duty);
 
-    _encoder.update(); // One final update after the stabilization period
-    currentRpm = _encoder.getSpeed();
-    recordedRpms.push_back(currentRpm);
+  if (_calibrator.isRunning())
+  {
+    return;
+  }
+  free();
+  _pid.reset(_actualSpeed, 0);
+  if (_calibrator.getPhase() == Calibrator::COMPLETE)
+  {
+    _minOperationalSpeed = _calibrator.getMinimumSpeed();
+    _maxOperationalSpeed = _calibrator.getMaximumSpeed();
+    updateSpeedScale();
+    if (_calibrator.hasSpeedTable())
+    {
+      _speedTable = _calibrator.getSpeedTable();
+      _hasSpeedTable = true;
+      _eepromConfig.writeSpeedTable(_speedTable);
+      setFeedForwardGain(1); // The table gives the whole open-loop duty
+      _eepromConfig.writePIDGains(getPIDGains());
+    }
+    saveCalibrationData(); // One flash write for the lot; the motor is stopped so it can take its time
   }
-
-  // Analyze the recorded RPM data to estimate the maximum speed
-  _maxOperationalSpeed = currentRpm; //estimateMaxSpeed(pwmPercentages, recordedRpms);
-
-  analogWrite(_rpwmPin, 0);
-  digitalWrite(_lenPin, LOW);
-  digitalWrite(_renPin, LOW);
-  saveCalibrationData();
 }
 
 // Fit the measured speeds to a straight line estimation
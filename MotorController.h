@@ -2,35 +2,89 @@
 #define MotorController_h
 
 #include "Arduino.h"
-#include <PID_v1.h>
 #include "AHT21Sensor.h"
+#include "AutoTuner.h"
+#include "Calibrator.h"
 #include "EEPROMConfig.h"
 #include "Encoder.h"
-
-#define GUID_LENGTH 36                // Length of the GUID string
-#define GUID_START 100                // EEPROM address to store the GUID
-#define GUID_MARKER 0xAA              // Example marker value
-#define MARKER_START (GUID_START - 1) // Assuming there's a byte space before GUID_START
+#include "FixedPID.h"
+#include "HAL.h"
+#include "JsonWriter.h"
+#include "TraceRecorder.h"
+#include "MotionProfile.h"
+#include "Protection.h"
+#include "StatusTracker.h"
+#include "TrajectoryQueue.h"
+
+// Snapshot of one control step, used by telemetry and tracing
+struct ControlSample
+{
+    unsigned long timestampMicros;
+    int rawAngle;
+    float speedRPM;  // Filtered speed from the encoder
+    float targetRPM;
+    float output;    // PID output
+    int pwm;         // Signed duty applied to the bridge, negative is CCW
+};
 
 class MotorController
 {
 public:
-    MotorController(EEPROMConfig &eepromConfig, AHT21Sensor &aht21Sensor, Encoder &encoder);
+    static const int SampleTime = 5; // Sample time in milliseconds for PID update
+
+    MotorController(Hal &hal, EEPROMConfig &eepromConfig, AHT21Sensor &aht21Sensor, Encoder &encoder);
     void init(int rpwmPin, int lpwmPin, int renPin, int lenPin);
     void setTargetSpeed(double speed);
     void hold();
+    void moveTo(int64_t target);   // Profiled move to a multi-turn position in ticks
+    void moveBy(int64_t distance);
+    void setMoveLimits(double maxRPM, double accelerationRPMPerSecond);
+    void setPositionGain(double kp); // RPM of speed target per tick of position error
+    bool isPositionMode() const;
+    int64_t getTargetPosition() const;
+    bool startTrajectory();
+    void stopTrajectory();
+    TrajectoryQueue &getTrajectory();
     void free();
     void brake();
     void release();
-    void update();    // Make this public so it can be called from loop()
-    void calibrate(); // Method for calibration
+    void update();    // Runs one control step, called by the ControlScheduler every SampleTime
+    // Failsafe: with a timeout set, a motor left running for that long
+    // without a command or keepAlive() ramps down over rampMs and is freed
+    void setCommandTimeout(unsigned long timeoutMs, unsigned long rampMs); // Stored, 0 turns it off
+    void keepAlive();
+    bool isFailsafeActive() const;
+    // Current and temperature protection, stored. A rated current of 0
+    // leaves A0 unread; a temperature cutoff of 0 turns that side off.
+    void setProtection(const CurrentLimits &limits, float temperatureCutoff);
+    CurrentLimits getCurrentLimits() const;
+    const Protection &getProtection() const;
+    // While the encoder is untrusted the speed loop is opened: the target
+    // is driven from the speed table, or the linear map, without feedback
+    bool isOpenLoop() const;
+    unsigned long getOpenLoopEntries() const;
+    void startCalibration(bool resume, bool sweep);
+    void abortCalibration();
+    Calibrator &getCalibrator();
+    const SpeedTable *getSpeedTable() const; // nullptr until a sweep has run
     void factoryReset();
 
     void setPIDParameters(double Kp, double Ki, double Kd);
     void clearEEPROM();
     void setPIDValues(double kp, double ki, double kd);
-
-    String getStatusJson(String FIRMWARE_VERSION, String message);
+    PIDGains getPIDGains() const;
+    void setFeedForwardGain(double kf); // Share of the open-loop PWM for the target added to the output
+    void savePIDGains();
+    bool startAutoTune(int lowPercent, int highPercent, float closedLoopSeconds);
+    void abortAutoTune();
+    AutoTuner &getAutoTuner();
+
+    const ControlSample &getLastSample() const;
+    TraceRecorder &getTraceRecorder();
+    Encoder &getEncoder();
+    void writeStatusFields(JsonWriter &json, const String &firmwareVersion, const char *message); // Inside the caller's object
+    unsigned long getStaticStatusBuilds() const;
+    void trackStatusFields(StatusTracker &tracker); // The fields above that change, without formatting them
 
 private:
     int _rpwmPin; // Right PWM pin
@@ -38,20 +92,30 @@ private:
     int _lenPin; // Left Enable pin 
     int _renPin; // Right Enable pin
 
-    double _targetSpeed; // Target speed set by the user
-    double _actualSpeed; // Actual speed read from the encoder
-    double _output;      // Output to the motor driver
+    // PID signals in PWM units (-1023..1023) as Q16.16
+    int32_t _targetSpeed; // Target speed set by the user
+    int32_t _actualSpeed; // Actual speed read from the encoder
+    int32_t _output;      // Output to the motor driver
+    float _pwmPerRPM;     // Open-loop scale from the calibrated maximum speed
     
     double _targetSpeedRPM; // Set value by user API
+    int _appliedPWM;        // Signed duty last written to the bridge
+    ControlSample _lastSample;
+    TraceRecorder _trace;
 
-    unsigned long _lastUpdateTime; // Time of the last PID update
+    unsigned long _lastUpdateTime; // Time of the last PID update (micros)
     int _lastPosition;             // Last position read from the encoder
-    int SampleTime = 5;          // Sample time in milliseconds for PID update
     char _serialNumber[37];
 
-    int _holdPosition; // Target position for holding
-    bool _isHolding;   // Flag to indicate if the motor is in hold mode
+    bool _isHolding;   // Position mode: hold, /position and /move
     int currentPosition; // raw value from the encoder
+    MotionProfile _profile;
+    unsigned long _profileStartTime; // micros
+    double _positionKp;
+    double _moveMaxRPM;
+    double _moveAccelerationRPM; // RPM/s
+    TrajectoryQueue _trajectory;
+    int64_t _trajectoryOrigin; // Position when a position trajectory started
 
     double _minOperationalSpeed; // Minimum operational speed
     double _maxOperationalSpeed; // Maximum operational speed
@@ -60,26 +124,80 @@ private:
 
     String _direction;
 
-    PID _pid; // PID controller object
+    FixedPID _pid;
+    AutoTuner _autoTuner;
+    Calibrator _calibrator;
     double _kp;
     double _ki;
     double _kd;
+    double _kf;
+    int32_t _feedForwardGain; // _kf as Q16.16
+    int32_t _feedForward;     // Q16.16 duty for the current target
+    SpeedTable _speedTable;
+    bool _hasSpeedTable;
+
+    bool _bridgeEnabled;            // Driving, as opposed to free, braked or released
+    unsigned long _commandTimeout;  // ms, 0 is off
+    unsigned long _failsafeRamp;    // ms
+    unsigned long _lastCommandTime; // millis
+    bool _failsafeActive;           // Ramping down after a timeout
+    unsigned long _failsafeTrips;
+
+    bool _openLoop;                  // Encoder untrusted
+    unsigned long _openLoopEntries;
+
+    Protection _protection;
+    CurrentLimits _currentLimits;
+    int _outputLimit; // Derated duty limit
+
+    // The status fields that only change with settings, pre-rendered and
+    // rebuilt when one of the values they come from changes
+    struct StaticStatusKey {
+        double kp, ki, kd, kf;
+        double minSpeed, maxSpeed;
+        bool calibrated;
+        bool hasSpeedTable;
+    };
+    static const size_t STATIC_STATUS_SIZE = 320;
+    char _staticStatus[STATIC_STATUS_SIZE];
+    StaticStatusKey _staticStatusKey;
+    unsigned long _staticStatusBuilds;
 
     const int encoderCountsPerRevolution = 4096;
 
+    Hal &_hal;
     AHT21Sensor &_aht21Sensor;
     EEPROMConfig &_eepromConfig;
     Encoder &_encoder;
 
+    void applyPIDTunings();
+    void loadPIDGains();
+    void updateFeedForward();
+    void updateAutoTune();
+    void updateCalibration();
+    void updateFailsafe();
+    void updateProtection();
+    void loadProtection();
+    void updateOpenLoop();
+    int32_t openLoopOutput();
+    void updateSpeedScale();
+    int32_t rpmToFixedPWM(float rpm);
+    void recordTrace(unsigned long currentTime);
+    void writeStaticStatusFields(JsonWriter &json, const String &firmwareVersion);
+    const char *getStaticStatus(const String &firmwareVersion);
+    void updatePositionLoop(unsigned long currentTime);
+    void updateTrajectory(unsigned long currentTime);
+    double positionLoopSpeed(int64_t referencePosition, float referenceVelocity);
+    void setSpeedSetpoint(double speed);
     int readEncoder(); // Method to read the encoder position
     double rpmToEncoderCountsPerSecond(double rpm);
     void readGUID(char *guid);
     void setDirection(String direction);
     double getRPM(double speed);
-    void saveCalibrationData(); // Save calibration data to EEPROM
-    void loadCalibrationData(); // Load calibration data from EEPROM
+    void saveCalibrationData(); // Save calibration data to flash
+    void loadCalibrationData(); // Load calibration data from the config
     float calculateRpm(int startPosition, int endPosition, unsigned long timeMillis);
-    void updateMotorPWM(double output);
+    void updateMotorPWM(int output);
     float estimateMaxSpeed(const std::vector<float>& pwmPercentages, const std::vector<float>& recordedRpms);
     double rpmToPWM(double rpm);
     double pwmToRPM(double speed);
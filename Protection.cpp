@@ -0,0 +1,151 @@
+#include "Protection.h"
+
+Protection::Protection()
+    : _current(0), _heat(0), _scale(1), _peakCount(0), _fault(NONE), _lastFault(NONE), _trips(0)
+{
+  _settings = Settings();
+}
+
+void Protection::configure(const Settings &settings)
+{
+  _settings = settings;
+}
+
+const Protection::Settings &Protection::getSettings() const
+{
+  return _settings;
+}
+
+bool Protection::currentSensed() const
+{
+  return _settings.ratedCurrent > 0;
+}
+
+// A cutoff that was never set reads as 0, or NaN from an erased EEPROM
+bool Protection::temperatureLimited() const
+{
+  return _settings.temperatureCutoff > 0;
+}
+
+float Protection::update(float current, float temperature, float dt)
+{
+  float scale = 1;
+
+  if (currentSensed())
+  {
+    _current = current;
+    float tau = _settings.thermalTimeConstant > dt ? _settings.thermalTimeConstant : dt;
+    _heat += (current * current - _heat) * dt / tau;
+
+    float load = getLoad();
+    if (load > DERATE_START)
+    {
+      float share = (load - DERATE_START) / (1 - DERATE_START);
+      float thermalScale = 1 - share * (1 - DERATE_FLOOR);
+      scale = thermalScale < scale ? thermalScale : scale;
+    }
+    if (load >= 1)
+    {
+      trip(OVERLOAD);
+    }
+
+    _peakCount = current > _settings.peakCurrent ? _peakCount + 1 : 0;
+    if (_peakCount >= PEAK_SAMPLES)
+    {
+      trip(OVERCURRENT);
+    }
+  }
+  else
+  {
+    _current = 0;
+    _heat = 0;
+  }
+
+  bool hot = false;
+  if (temperatureLimited())
+  {
+    float margin = _settings.temperatureCutoff - temperature;
+    if (margin < TEMPERATURE_BAND)
+    {
+      float temperatureScale = margin <= 0 ? DERATE_FLOOR : DERATE_FLOOR + margin / TEMPERATURE_BAND * (1 - DERATE_FLOOR);
+      scale = temperatureScale < scale ? temperatureScale : scale;
+    }
+    if (margin <= 0)
+    {
+      trip(OVERTEMPERATURE);
+    }
+    hot = margin < TEMPERATURE_BAND;
+  }
+
+  if (_fault != NONE && getLoad() < CLEAR_LOAD && !hot && _peakCount == 0)
+  {
+    _fault = NONE;
+  }
+
+  _scale = _fault != NONE ? 0 : scale;
+  return _scale;
+}
+
+void Protection::trip(Fault fault)
+{
+  if (_fault == NONE)
+  {
+    _trips++;
+  }
+  _fault = fault;
+  _lastFault = fault;
+}
+
+float Protection::getScale() const
+{
+  return _scale;
+}
+
+float Protection::getCurrent() const
+{
+  return _current;
+}
+
+float Protection::getLoad() const
+{
+  if (!currentSensed())
+  {
+    return 0;
+  }
+  return _heat / (_settings.ratedCurrent * _settings.ratedCurrent);
+}
+
+bool Protection::isTripped() const
+{
+  return _fault != NONE;
+}
+
+Protection::Fault Protection::getFault() const
+{
+  return _fault;
+}
+
+Protection::Fault Protection::getLastFault() const
+{
+  return _lastFault;
+}
+
+const char *Protection::faultName(Fault fault)
+{
+  switch (fault)
+  {
+  case OVERCURRENT:
+    return "overcurrent";
+  case OVERLOAD:
+    return "overload";
+  case OVERTEMPERATURE:
+    return "overtemperature";
+  default:
+    return "none";
+  }
+}
+
+unsigned long Protection::getTrips() const
+{
+  return _trips;
+}
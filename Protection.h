@@ -0,0 +1,72 @@
+#ifndef Protection_h
+#define Protection_h
+
+#include <stdint.h>
+
+// Current and temperature protection, advanced once per control step.
+//
+// The winding is modelled as a first order thermal lag on the current
+// squared (I^2.t): the load is the filtered I^2 over the rated current
+// squared, so 1.0 is the steady state of running at the rated current. From
+// DERATE_START the duty limit is scaled down towards DERATE_FLOOR, which
+// normally keeps a stalled motor below its rating. Should the load reach 1.0
+// anyway, the motor trips. Separately, the output is derated over the last
+// TEMPERATURE_BAND degrees below the temperature cutoff and trips at it, and
+// a current above the peak limit for PEAK_SAMPLES steps trips at once.
+//
+// A trip clears by itself once the motor has cooled, but the caller frees
+// the bridge, so it takes a new command to drive again.
+class Protection {
+public:
+    static constexpr float DERATE_START = 0.7f;
+    static constexpr float DERATE_FLOOR = 0.1f;
+    static constexpr float TEMPERATURE_BAND = 10.0f; // °C
+    static constexpr float CLEAR_LOAD = 0.5f;
+    static const int PEAK_SAMPLES = 3;
+
+    enum Fault {
+        NONE,
+        OVERCURRENT,
+        OVERLOAD,
+        OVERTEMPERATURE
+    };
+
+    struct Settings {
+        float ratedCurrent;        // A, 0 when there is no current sense
+        float peakCurrent;         // A
+        float thermalTimeConstant; // s
+        float temperatureCutoff;   // °C, 0 for none
+    };
+
+    Protection();
+    void configure(const Settings &settings);
+    const Settings &getSettings() const;
+    // current in A, temperature in °C, dt in s. Returns the share of the
+    // full duty range the output may use, 0 while tripped.
+    float update(float current, float temperature, float dt);
+
+    float getScale() const;
+    float getCurrent() const;
+    float getLoad() const;
+    bool isTripped() const;
+    Fault getFault() const;
+    Fault getLastFault() const;
+    static const char *faultName(Fault fault);
+    unsigned long getTrips() const;
+
+private:
+    Settings _settings;
+    float _current;
+    float _heat;  // Filtered I^2, A^2
+    float _scale;
+    int _peakCount;
+    Fault _fault;
+    Fault _lastFault;
+    unsigned long _trips;
+
+    bool currentSensed() const;
+    bool temperatureLimited() const;
+    void trip(Fault fault);
+};
+
+#endif
@@ -1,12 +1,11 @@
 #include "SerialNumberManager.h"
 
-SerialNumberManager::SerialNumberManager(int startAddress, int length, byte marker)
-    : _startAddress(startAddress), _length(length), _marker(marker), _isValid(false) {
-    // Ensure that the startAddress and length are within the EEPROM size limits.
+SerialNumberManager::SerialNumberManager(EEPROMConfig &config)
+    : _config(config), _isValid(false) {
+    // The config must have been begun before begin() is called
 }
 
 void SerialNumberManager::begin() {
-    EEPROM.begin(512); // Adjust size if needed
     if (!isSerialNumberStored()) {
         generateSerialNumber();
         storeSerialNumber();
@@ -17,8 +16,7 @@ void SerialNumberManager::begin() {
 }
 
 bool SerialNumberManager::isSerialNumberStored() {
-    // Ensure startAddress is correctly offset to avoid out-of-bounds access
-    return EEPROM.read(_startAddress - 1) == _marker;
+    return _config.hasGUID();
 }
 
 void SerialNumberManager::generateSerialNumber() {
@@ -26,26 +24,17 @@ void SerialNumberManager::generateSerialNumber() {
 }
 
 void SerialNumberManager::storeSerialNumber() {
-    EEPROM.write(_startAddress - 1, _marker);
-    for (int i = 0; i < _length; i++) {
-        EEPROM.write(_startAddress + i, _serialNumber[i]);
-    }
-    EEPROM.commit();
+    _config.writeGUID(_serialNumber);
+    _config.commit();
 }
 
 void SerialNumberManager::readSerialNumber(char *serialNumber) {
-    for (int i = 0; i < _length; i++) {
-        serialNumber[i] = char(EEPROM.read(_startAddress + i));
-    }
-    serialNumber[_length] = '\0'; // Ensure null termination
+    _config.readGUID(serialNumber);
 }
 
 void SerialNumberManager::resetSerialNumber() {
-    EEPROM.write(_startAddress - 1, 0xFF); // Clear the marker
-    for (int i = 0; i < _length; i++) {
-        EEPROM.write(_startAddress + i, 0xFF); // Clear each byte of the serial number
-    }
-    EEPROM.commit();
+    _config.clearGUID();
+    _config.commit();
     _isValid = false; // Invalidate the serial number
 }
 
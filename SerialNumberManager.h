@@ -1,12 +1,12 @@
 #ifndef SerialNumberManager_h
 #define SerialNumberManager_h
 
-#include <EEPROM.h>
 #include <Arduino.h>
+#include "EEPROMConfig.h"
 
 class SerialNumberManager {
 public:
-    SerialNumberManager(int startAddress, int length, byte marker);
+    SerialNumberManager(EEPROMConfig &config);
     void begin();
     bool isSerialNumberStored();
     void generateSerialNumber();
@@ -16,9 +16,7 @@ public:
     bool isValid();
 
 private:
-    int _startAddress;
-    int _length;
-    byte _marker;
+    EEPROMConfig &_config;
     char _serialNumber[37]; // Enough space for a 36-character serial number + null termination
     bool _isValid;
 
@@ -1,21 +1,48 @@
 #include "ServerManager.h"
+#include "WebAssets.h"
 
-ServerManager::ServerManager(ESP8266WebServer &server, MotorController &motorController, String FIRMWARE_VERSION)
-    : _server(server), _motorController(motorController), _FIRMWARE_VERSION(FIRMWARE_VERSION) {}
+ServerManager::ServerManager(HttpServer &server, MotorController &motorController, ControlScheduler &scheduler, TelemetryStream &telemetry, CommandChannel &commandChannel, GroupChannel &groupChannel, I2CBusManager &busManager, String FIRMWARE_VERSION)
+    : _server(server), _motorController(motorController), _scheduler(scheduler), _telemetry(telemetry), _commandChannel(commandChannel), _groupChannel(groupChannel), _busManager(busManager), _FIRMWARE_VERSION(FIRMWARE_VERSION),
+      _lastStatusBytes(0), _lastStatusMicros(0), _statusNotModified(0), _statusDeltas(0) {}
 
 void ServerManager::setupEndpoints()
 {
-  _server.on("/hold", HTTP_GET, std::bind(&ServerManager::handleHold, this));
-  _server.on("/speed", HTTP_GET, std::bind(&ServerManager::handleSpeed, this));
-  _server.on("/free", HTTP_GET, std::bind(&ServerManager::handleFree, this));
-  _server.on("/brake", HTTP_GET, std::bind(&ServerManager::handleBrake, this));
-  _server.on("/release", HTTP_GET, std::bind(&ServerManager::handleRelease, this));
-  _server.on("/status", HTTP_GET, std::bind(&ServerManager::handleStatus, this));
-  _server.on("/calibrate", HTTP_GET, std::bind(&ServerManager::handleCalibrate, this));
-  _server.on("/factory_reset", HTTP_GET, std::bind(&ServerManager::handleFactoryReset, this));
-  _server.on("/config", HTTP_GET, std::bind(&ServerManager::handleConfig, this));
-  _server.on("/setup", HTTP_POST, std::bind(&ServerManager::handleSetup, this));
-  _server.on("/setpid", HTTP_GET, std::bind(&ServerManager::handleSetPID, this));
+  _statusTracker.begin(ESP.random());
+  _server.on("/hold", HttpServer::METHOD_GET, std::bind(&ServerManager::handleHold, this));
+  _server.on("/position", HttpServer::METHOD_GET, std::bind(&ServerManager::handlePosition, this));
+  _server.on("/move", HttpServer::METHOD_GET, std::bind(&ServerManager::handleMove, this));
+  _server.on("/speed", HttpServer::METHOD_GET, std::bind(&ServerManager::handleSpeed, this));
+  _server.on("/free", HttpServer::METHOD_GET, std::bind(&ServerManager::handleFree, this));
+  _server.on("/brake", HttpServer::METHOD_GET, std::bind(&ServerManager::handleBrake, this));
+  _server.on("/release", HttpServer::METHOD_GET, std::bind(&ServerManager::handleRelease, this));
+  _server.on("/status", HttpServer::METHOD_GET, std::bind(&ServerManager::handleStatus, this));
+  _server.on("/calibrate", HttpServer::METHOD_GET, std::bind(&ServerManager::handleCalibrate, this));
+  _server.on("/calibrate/start", HttpServer::METHOD_GET, std::bind(&ServerManager::handleCalibrate, this));
+  _server.on("/calibrate/progress", HttpServer::METHOD_GET, std::bind(&ServerManager::handleCalibrateProgress, this));
+  _server.on("/calibrate/abort", HttpServer::METHOD_GET, std::bind(&ServerManager::handleCalibrateAbort, this));
+  _server.on("/calibrate/table", HttpServer::METHOD_GET, std::bind(&ServerManager::handleCalibrateTable, this));
+  _server.on("/factory_reset", HttpServer::METHOD_GET, std::bind(&ServerManager::handleFactoryReset, this));
+  _server.on("/config", HttpServer::METHOD_GET, std::bind(&ServerManager::handleConfig, this));
+  _server.on("/dashboard", HttpServer::METHOD_GET, std::bind(&ServerManager::handleDashboard, this));
+  _server.on("/setup", HttpServer::METHOD_POST, std::bind(&ServerManager::handleSetup, this));
+  _server.on("/setpid", HttpServer::METHOD_GET, std::bind(&ServerManager::handleSetPID, this));
+  _server.on("/autotune", HttpServer::METHOD_GET, std::bind(&ServerManager::handleAutoTune, this));
+  _server.on("/autotune/start", HttpServer::METHOD_GET, std::bind(&ServerManager::handleAutoTuneStart, this));
+  _server.on("/autotune/abort", HttpServer::METHOD_GET, std::bind(&ServerManager::handleAutoTuneAbort, this));
+  _server.on("/timing", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTiming, this));
+  _server.on("/keepalive", HttpServer::METHOD_GET, std::bind(&ServerManager::handleKeepAlive, this));
+  _server.on("/failsafe", HttpServer::METHOD_GET, std::bind(&ServerManager::handleFailsafe, this));
+  _server.on("/protection", HttpServer::METHOD_GET, std::bind(&ServerManager::handleProtection, this));
+  _server.on("/telemetry/subscribe", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTelemetrySubscribe, this));
+  _server.on("/telemetry/unsubscribe", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTelemetryUnsubscribe, this));
+  _server.on("/group", HttpServer::METHOD_GET, std::bind(&ServerManager::handleGroup, this));
+  _server.on("/encoder", HttpServer::METHOD_GET, std::bind(&ServerManager::handleEncoder, this));
+  _server.on("/encoder/benchmark", HttpServer::METHOD_GET, std::bind(&ServerManager::handleEncoderBenchmark, this));
+  _server.on("/i2c", HttpServer::METHOD_GET, std::bind(&ServerManager::handleI2C, this));
+  _server.on("/trajectory", HttpServer::METHOD_ANY, std::bind(&ServerManager::handleTrajectory, this));
+  _server.on("/trajectory/stop", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTrajectoryStop, this));
+  _server.on("/trace/arm", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTraceArm, this));
+  _server.on("/trace", HttpServer::METHOD_GET, std::bind(&ServerManager::handleTrace, this));
   _server.begin();
 }
 
@@ -27,8 +54,49 @@ void ServerManager::handleClient()
 void ServerManager::handleHold()
 {
   _motorController.hold();
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Hold Set");
-  _server.send(200, "application/json", statusJson);
+  sendStatus("Hold Set");
+}
+
+// Optional velocity (RPM), accel (RPM/s) and kp shared by /position and /move
+void ServerManager::applyMoveArgs()
+{
+  double velocity = _server.hasArg("velocity") ? _server.arg("velocity").toFloat() : 0;
+  double accel = _server.hasArg("accel") ? _server.arg("accel").toFloat() : 0;
+  _motorController.setMoveLimits(velocity, accel);
+  if (_server.hasArg("kp"))
+  {
+    _motorController.setPositionGain(_server.arg("kp").toFloat());
+  }
+}
+
+// Moves to an absolute multi-turn position in encoder ticks (4096 per turn)
+void ServerManager::handlePosition()
+{
+  if (_server.hasArg("target"))
+  {
+    applyMoveArgs();
+    _motorController.moveTo(atoll(_server.arg("target").c_str()));
+    sendStatus("Position Set");
+  }
+  else
+  {
+    _server.send(400, "text/plain", "Target position not provided.");
+  }
+}
+
+// Moves by a relative number of encoder ticks
+void ServerManager::handleMove()
+{
+  if (_server.hasArg("by"))
+  {
+    applyMoveArgs();
+    _motorController.moveBy(atoll(_server.arg("by").c_str()));
+    sendStatus("Move Set");
+  }
+  else
+  {
+    _server.send(400, "text/plain", "Move distance not provided.");
+  }
 }
 
 void ServerManager::handleSpeed()
@@ -36,9 +104,21 @@ void ServerManager::handleSpeed()
   if (_server.hasArg("value"))
   {
     double speed = _server.arg("value").toInt(); // Assumes speed values are passed as query parameters.
-    _motorController.setTargetSpeed(speed);
-    String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Speed Set");
-    _server.send(200, "application/json", statusJson);
+    long ramp = _server.hasArg("ramp") ? _server.arg("ramp").toInt() : 0;
+    if (ramp > 0)
+    {
+      // Ease to the new speed over ramp ms instead of stepping
+      TrajectoryQueue &trajectory = _motorController.getTrajectory();
+      _motorController.stopTrajectory();
+      trajectory.setMode(TrajectoryQueue::VELOCITY);
+      trajectory.push(ramp, speed);
+      _motorController.startTrajectory();
+    }
+    else
+    {
+      _motorController.setTargetSpeed(speed);
+    }
+    sendStatus("Speed Set");
   }
   else
   {
@@ -49,75 +129,154 @@ void ServerManager::handleSpeed()
 void ServerManager::handleFree()
 {
   _motorController.free();
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Free Set");
-  _server.send(200, "application/json", statusJson);
+  sendStatus("Free Set");
 }
 
 void ServerManager::handleBrake()
 {
   _motorController.brake();
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Brake Applied");
-  _server.send(200, "application/json", statusJson);
+  sendStatus("Brake Applied");
 }
 
 void ServerManager::handleRelease()
 {
   _motorController.release();
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Brake Released");
-  _server.send(200, "application/json", statusJson);
+  sendStatus("Brake Released");
 }
 
+// ?fields=actualSpeedRPM,position returns just those keys. The status
+// carries the sequence number of the last change to them, as "sequence"
+// and as the ETag, and both come from the tracker without formatting
+// anything: a poller sending the ETag back in If-None-Match gets a 304 with
+// no body until one of its fields changes, and ?since=<sequence> returns
+// only the fields changed after that one.
 void ServerManager::handleStatus()
 {
+  String fieldsArg = _server.arg("fields");
+  const char *fields = fieldsArg.length() > 0 ? fieldsArg.c_str() : nullptr;
+  trackStatus();
+  uint32_t sequence = _statusTracker.getSequence(fields);
+  char etag[13];
+  snprintf(etag, sizeof(etag), "\"%lu\"", static_cast<unsigned long>(sequence));
+
   _server.sendHeader("Access-Control-Allow-Origin", "*");
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "");
-  _server.send(200, "application/json", statusJson);
+  _server.sendHeader("ETag", etag);
+  _server.sendHeader("Cache-Control", "no-cache");
+  if (_server.header("If-None-Match") == etag)
+  {
+    _statusNotModified++;
+    _server.send(304, "application/json", "");
+    return;
+  }
+
+  char changed[STATUS_KEYS_SIZE];
+  if (_server.hasArg("since") &&
+      _statusTracker.changedSince(strtoul(_server.arg("since").c_str(), nullptr, 10), fields, changed, sizeof(changed)))
+  {
+    fields = changed;
+    _statusDeltas++;
+  }
+  size_t length = formatStatus("", fields, &sequence);
+  _server.send(200, "application/json", _statusBuffer, length);
+}
+
+void ServerManager::trackStatus()
+{
+  _statusTracker.beginPass();
+  _motorController.trackStatusFields(_statusTracker);
+  const char *lastOverrun = _scheduler.getLastOverrunPhase();
+  _statusTracker.track("watchdog", static_cast<long>(_scheduler.getMissedDeadlines()));
+  _statusTracker.track("watchdog", static_cast<long>(_scheduler.getOverruns()));
+  _statusTracker.track("watchdog", lastOverrun != nullptr ? lastOverrun : "");
+  _statusTracker.track("watchdog", static_cast<long>(_scheduler.getLastOverrunLateMicros()));
+  _statusTracker.endPass();
 }
 
+// Starts calibration and returns straight away, poll /calibrate/progress
 void ServerManager::handleCalibrate()
 {
-  _motorController.calibrate();
-  String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "Calibration Complete");
-  _server.send(200, "application/json", statusJson);  
+  _motorController.startCalibration(_server.hasArg("resume"), _server.arg("sweep") != "0");
+  handleCalibrateProgress();
+}
+
+void ServerManager::handleCalibrateAbort()
+{
+  _motorController.abortCalibration();
+  handleCalibrateProgress();
+}
+
+// The stored PWM -> RPM sweep, one curve per direction
+void ServerManager::handleCalibrateTable()
+{
+  const SpeedTable *table = _motorController.getSpeedTable();
+  if (table == nullptr)
+  {
+    _server.send(404, "text/plain", "No speed table, run /calibrate/start first.");
+    return;
+  }
+
+  char buffer[320];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  const SpeedCurve *curves[] = {&table->forward, &table->reverse};
+  const char *names[] = {"forward", "reverse"};
+  for (int c = 0; c < 2; c++)
+  {
+    json.beginObject(names[c]);
+    json.addInteger("deadband", curves[c]->deadband);
+    json.beginArray("points");
+    for (int i = 0; i < SpeedCurve::POINTS; i++)
+    {
+      json.beginArray();
+      json.addInteger(nullptr, curves[c]->duty[i]);
+      json.addInteger(nullptr, curves[c]->rpm[i]);
+      json.endArray();
+    }
+    json.endArray();
+    json.endObject();
+  }
+  json.endObject();
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+void ServerManager::handleCalibrateProgress()
+{
+  static const char *phaseNames[] = {"idle", "starting", "minimum", "maximum", "sweep", "complete", "aborted"};
+  static_assert(sizeof(phaseNames) / sizeof(phaseNames[0]) == Calibrator::ABORTED + 1, "One name per Calibrator::Phase");
+  Calibrator &calibrator = _motorController.getCalibrator();
+
+  char buffer[160];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addString("phase", phaseNames[calibrator.getPhase()]);
+  json.addInteger("progress", calibrator.getProgress());
+  json.addNumber("minSpeed", calibrator.getMinimumSpeed());
+  json.addNumber("maxSpeed", calibrator.getMaximumSpeed());
+  json.endObject();
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(200, "application/json", json.c_str(), json.length());
 }
 
 void ServerManager::handleFactoryReset()
 {
   _motorController.clearEEPROM();
+  _server.whenSent([]() { ESP.restart(); });
   _server.send(200, "text/plain", "Motor Controller reset to defaults");
-  delay(3000);
-  ESP.restart();
 }
 
+// The page is built from web/config.html into flash, see web/build.js
 void ServerManager::handleConfig()
 {
-  String html = "<!DOCTYPE html><html><head>"
-                "<title>Motor Controller Configuration</title>"
-                "<link rel='stylesheet' href='https://stackpath.bootstrapcdn.com/bootstrap/4.3.1/css/bootstrap.min.css'>"
-                "</head><body>"
-                "<div class='container'>"
-                "  <h2>Motor Controller Configuration</h2>"
-                "  <form action='/setup' method='post' class='form-group'>"
-                "    <div class=\"row\">"
-                "      <div class=\"col-6\"><label>SSID</label>"
-                "        <input class='form-control mb-2' name='ssid' value='' length=32 placeholder='SSID'>"
-                "      </div>"
-                "      <div class=\"col-6\"><label>Password</label>"
-                "        <input class='form-control mb-2' type='text' name='password' length=64 placeholder='Password'>"
-                "      </div>"
-                "    </div>"
-                //   "    <div class=\"row\">"
-                //   "      <div class=\"col-12\"><label>Name (short name to identify this motor controller)</label>"
-                //   "        <input class='form-control mb-2' name='name' length=32 placeholder='Name'>"
-                //   "      </div>"
-                //   "    </div>"
-
-                "    <div class=\"row right\">"
-                "      <input type='submit' value='Save' class='btn btn-primary'>"
-                "    </div>"
-                "  </form></div></body></html>";
-
-  _server.send(200, "text/html", html);
+  sendWebAsset(_server, CONFIG_PAGE);
+}
+
+// Live chart fed by the DashboardSocket, built from web/dashboard.html
+void ServerManager::handleDashboard()
+{
+  sendWebAsset(_server, DASHBOARD_PAGE);
 }
 
 void ServerManager::handleSetup()
@@ -135,13 +294,687 @@ void ServerManager::handleSetPID()
     double kd = _server.arg("kd").toDouble();
 
     _motorController.setPIDValues(kp, ki, kd);
+    if (_server.hasArg("kf"))
+    {
+      _motorController.setFeedForwardGain(_server.arg("kf").toDouble());
+    }
+    _motorController.savePIDGains();
 
-    String statusJson = _motorController.getStatusJson(_FIRMWARE_VERSION, "PID Updated");
     _server.sendHeader("Access-Control-Allow-Origin", "*");
-    _server.send(200, "application/json", statusJson);
+    sendStatus("PID Updated");
   }
   else
   {
     _server.send(400, "text/plain", "PID values not provided.");
   }
-}
\ No newline at end of file
+}
+
+// Steps the motor from low to high percent duty open loop, fits the response
+// and stores the resulting gains. ?tc= sets the closed-loop response in ms.
+void ServerManager::handleAutoTuneStart()
+{
+  int low = _server.hasArg("low") ? _server.arg("low").toInt() : 20;
+  int high = _server.hasArg("high") ? _server.arg("high").toInt() : 50;
+  float closedLoopSeconds = _server.hasArg("tc") ? _server.arg("tc").toFloat() / 1000.0f : 0;
+  if (!_motorController.startAutoTune(low, high, closedLoopSeconds))
+  {
+    _server.send(400, "text/plain", "Duties must satisfy 0 <= low < high <= 100.");
+    return;
+  }
+  handleAutoTune();
+}
+
+void ServerManager::handleAutoTuneAbort()
+{
+  _motorController.abortAutoTune();
+  handleAutoTune();
+}
+
+void ServerManager::handleAutoTune()
+{
+  static const char *stateNames[] = {"idle", "settling", "stepping", "complete", "failed"};
+  AutoTuner &tuner = _motorController.getAutoTuner();
+
+  char buffer[320];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addString("state", stateNames[tuner.getState()]);
+  json.addInteger("progress", tuner.getProgress());
+  if (tuner.getState() == AutoTuner::COMPLETE)
+  {
+    const AutoTuner::Result &result = tuner.getResult();
+    json.beginObject("model");
+    json.addNumber("gain", result.gain, 3);
+    json.addNumber("timeConstantMs", result.timeConstant * 1000, 1);
+    json.addNumber("deadTimeMs", result.deadTime * 1000, 1);
+    json.endObject();
+    json.beginObject("pid");
+    json.addNumber("kp", result.kp, 3);
+    json.addNumber("ki", result.ki, 3);
+    json.addNumber("kd", result.kd, 3);
+    json.addNumber("kf", result.kf, 3);
+    json.endObject();
+  }
+  else if (tuner.getState() == AutoTuner::FAILED)
+  {
+    json.addString("error", tuner.getError());
+  }
+  json.endObject();
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+// Written into the status buffer: it is copied into the response on send
+void ServerManager::handleTiming()
+{
+  JsonWriter json(_statusBuffer, sizeof(_statusBuffer));
+  json.beginObject();
+  json.addInteger("periodMicros", _scheduler.getPeriodMicros());
+  json.addInteger("ticks", _scheduler.getTickCount());
+  json.addInteger("missedDeadlines", _scheduler.getMissedDeadlines());
+  json.addInteger("jitterMicros", _scheduler.getLastJitterMicros());
+  json.addInteger("maxJitterMicros", _scheduler.getMaxJitterMicros());
+  json.addInteger("maxControlMicros", _scheduler.getMaxControlMicros());
+  json.addInteger("statusBytes", _lastStatusBytes);
+  json.addInteger("statusMicros", _lastStatusMicros);
+  json.addInteger("statusNotModified", _statusNotModified);
+  json.addInteger("statusDeltas", _statusDeltas);
+  json.addInteger("staticStatusBuilds", _motorController.getStaticStatusBuilds());
+  json.addInteger("telemetrySubscribers", _telemetry.getSubscriberCount());
+  json.addInteger("telemetryDropped", _telemetry.getDroppedFrames());
+  const CommandChannel::Stats &commands = _commandChannel.getStats();
+  json.addInteger("commandFrames", commands.frames);
+  json.addInteger("commands", commands.commands);
+  json.addInteger("commandDuplicates", commands.duplicates);
+  json.addInteger("commandStale", commands.stale);
+  json.addInteger("commandErrors", commands.errors);
+  json.addInteger("maxCommandMicros", commands.maxPollMicros);
+  json.addInteger("httpConnections", _server.getConnectionCount());
+  json.addInteger("httpRequests", _server.getRequestCount());
+  json.addInteger("maxHandlerMicros", _server.getMaxHandlerMicros());
+  json.addInteger("overruns", _scheduler.getOverruns());
+  json.beginObject("phases");
+  for (int i = 0; i < _scheduler.getPhaseCount(); i++)
+  {
+    const ControlScheduler::PhaseStats &phase = _scheduler.getPhase(i);
+    json.beginObject(phase.name);
+    json.addInteger("maxMicros", phase.maxMicros);
+    json.addInteger("overruns", phase.overruns);
+    json.addInteger("maxLateMicros", phase.maxLateMicros);
+    json.endObject();
+  }
+  json.endObject();
+  json.endObject();
+
+  if (_server.hasArg("reset"))
+  {
+    _scheduler.resetStats();
+    _commandChannel.resetStats();
+    _server.resetStats();
+  }
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+// Renews the command lease without changing anything
+void ServerManager::handleKeepAlive()
+{
+  _motorController.keepAlive();
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(204, "text/plain", "");
+}
+
+// Command lease: with timeout > 0 a running motor that gets no command or
+// keepalive for that many ms ramps down over ramp ms and is freed
+void ServerManager::handleFailsafe()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  if (_server.hasArg("timeout"))
+  {
+    long timeout = _server.arg("timeout").toInt();
+    long ramp = _server.hasArg("ramp") ? _server.arg("ramp").toInt() : 500;
+    if (timeout < 0 || ramp < 0)
+    {
+      _server.send(400, "text/plain", "Timeout and ramp must not be negative.");
+      return;
+    }
+    _motorController.setCommandTimeout(timeout, ramp);
+    sendStatus("Failsafe Set");
+    return;
+  }
+  sendStatus("");
+}
+
+// Any of rated, peak (A), tau (s), scale (A per A0 count) and temp (°C)
+// changes that setting and stores the lot; the others keep their values
+void ServerManager::handleProtection()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  if (!_server.hasArg("rated") && !_server.hasArg("peak") && !_server.hasArg("tau") &&
+      !_server.hasArg("scale") && !_server.hasArg("temp"))
+  {
+    sendStatus("");
+    return;
+  }
+
+  CurrentLimits limits = _motorController.getCurrentLimits();
+  float temperatureCutoff = _motorController.getProtection().getSettings().temperatureCutoff;
+  limits.ratedCurrent = _server.hasArg("rated") ? _server.arg("rated").toFloat() : limits.ratedCurrent;
+  limits.peakCurrent = _server.hasArg("peak") ? _server.arg("peak").toFloat() : limits.peakCurrent;
+  limits.thermalTimeConstant = _server.hasArg("tau") ? _server.arg("tau").toFloat() : limits.thermalTimeConstant;
+  limits.senseAmpsPerCount = _server.hasArg("scale") ? _server.arg("scale").toFloat() : limits.senseAmpsPerCount;
+  temperatureCutoff = _server.hasArg("temp") ? _server.arg("temp").toFloat() : temperatureCutoff;
+
+  if (limits.ratedCurrent < 0 || limits.peakCurrent <= limits.ratedCurrent || limits.thermalTimeConstant <= 0 ||
+      limits.senseAmpsPerCount <= 0 || temperatureCutoff < 0)
+  {
+    _server.send(400, "text/plain", "Peak must exceed rated current; tau and scale must be positive.");
+    return;
+  }
+  if (limits.ratedCurrent > 0 && _motorController.getEncoder().getSource() == Encoder::SOURCE_ANALOG)
+  {
+    _server.send(400, "text/plain", "A0 carries the encoder, so there is no current sense.");
+    return;
+  }
+  _motorController.setProtection(limits, temperatureCutoff);
+  sendStatus("Protection Set");
+}
+
+// Frames are sent to the caller's address on the UDP port it asks for
+void ServerManager::handleTelemetrySubscribe()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  if (!_server.hasArg("port"))
+  {
+    _server.send(400, "text/plain", "Port not provided.");
+    return;
+  }
+
+  uint16_t port = _server.arg("port").toInt();
+  unsigned long rate = _server.hasArg("rate") ? _server.arg("rate").toInt() : 0;
+  if (_telemetry.subscribe(_server.remoteIP(), port, rate))
+  {
+    sendStatus("Telemetry Subscribed");
+  }
+  else
+  {
+    _server.send(503, "text/plain", "Too many telemetry subscribers.");
+  }
+}
+
+void ServerManager::handleTelemetryUnsubscribe()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  if (!_server.hasArg("port"))
+  {
+    _server.send(400, "text/plain", "Port not provided.");
+    return;
+  }
+
+  _telemetry.unsubscribe(_server.remoteIP(), _server.arg("port").toInt());
+  sendStatus("Telemetry Unsubscribed");
+}
+
+// Group membership and clock sync. ?groups= takes a bit mask, bit n for group n.
+void ServerManager::handleGroup()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  if (_server.hasArg("groups"))
+  {
+    long groups = _server.arg("groups").toInt();
+    if (groups < 0 || groups > 255)
+    {
+      _server.send(400, "text/plain", "Groups must be a mask from 0 to 255.");
+      return;
+    }
+    _groupChannel.setGroups(groups);
+  }
+  if (_server.hasArg("reset"))
+  {
+    _groupChannel.resetStats();
+  }
+
+  const GroupChannel::Stats &stats = _groupChannel.getStats();
+  char buffer[384];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addInteger("groups", _groupChannel.getGroups());
+  json.addBool("synced", _groupChannel.isSynced());
+  json.addInteger("offsetMicros", _groupChannel.getOffset());
+  json.addInteger("phaseErrorMicros", _groupChannel.getPhaseError());
+  json.addInteger("syncAgeMillis", _groupChannel.getSyncAge());
+  json.addInteger("pending", _groupChannel.getPendingCount());
+  json.addInteger("frames", stats.frames);
+  json.addInteger("applied", stats.applied);
+  json.addInteger("late", stats.late);
+  json.addInteger("maxLateMicros", stats.maxLateMicros);
+  json.addInteger("duplicates", stats.duplicates);
+  json.addInteger("dropped", stats.dropped);
+  json.addInteger("errors", stats.errors);
+  json.addInteger("syncRequests", stats.syncRequests);
+  json.endObject();
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+static const char *encoderSourceNames[] = {"i2c", "analog", "pwm"};
+
+// Reports, and with ?estimator= selects, the speed estimation method.
+// samples counts the timer-interrupt readings; ?reset clears them.
+// crossCheck compares an OUT pin source with the bus. health has the
+// AS5600 magnet status and the plausibility filter, whose limit ?maxAccel=
+// sets in revolutions/s^2 until the next restart.
+void ServerManager::handleEncoder()
+{
+  static const char *estimatorNames[] = {"lowpass", "observer", "lsq"};
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  Encoder &encoder = _motorController.getEncoder();
+
+  if (_server.hasArg("estimator"))
+  {
+    String name = _server.arg("estimator");
+    bool found = false;
+    for (int i = 0; i < 3; i++)
+    {
+      if (name == estimatorNames[i])
+      {
+        encoder.setEstimator(static_cast<VelocityEstimator::Mode>(i));
+        found = true;
+      }
+    }
+    if (!found)
+    {
+      _server.send(400, "text/plain", "Unknown estimator.");
+      return;
+    }
+  }
+  if (_server.hasArg("maxAccel"))
+  {
+    float maxAccel = _server.arg("maxAccel").toFloat();
+    if (maxAccel <= 0)
+    {
+      _server.send(400, "text/plain", "maxAccel must be positive.");
+      return;
+    }
+    encoder.setMaxAcceleration(maxAccel * 4096);
+  }
+
+  char buffer[768];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addString("source", encoderSourceNames[encoder.getSource()]);
+  json.addString("estimator", estimatorNames[encoder.getEstimator()]);
+  json.addNumber("speedRPM", encoder.getSpeed());
+  json.addInteger("estimatorCycles", encoder.getEstimatorCycles());
+  json.beginObject("samples");
+  json.addInteger("taken", encoder.getSamplesTaken());
+  json.addInteger("skipped", encoder.getSamplesSkipped());
+  json.addInteger("lost", encoder.getSamplesLost());
+  json.addInteger("directReads", encoder.getDirectReads());
+  json.addInteger("maxLatencyMicros", encoder.getMaxSampleLatency());
+  json.endObject();
+  if (encoder.getSource() != Encoder::SOURCE_I2C)
+  {
+    const Encoder::CrossCheck &check = encoder.getCrossCheck();
+    json.beginObject("crossCheck");
+    json.addInteger("count", check.count);
+    json.addInteger("skipped", check.skipped);
+    json.addInteger("failures", check.failures);
+    json.addInteger("offset", check.offset);
+    json.addInteger("lastError", check.lastError);
+    json.addInteger("maxError", check.maxError);
+    json.endObject();
+  }
+  const Encoder::Health &health = encoder.getHealth();
+  json.beginObject("health");
+  json.addBool("trusted", health.trusted);
+  json.addBool("magnetDetected", (health.status & Encoder::STATUS_MAGNET_DETECTED) != 0);
+  json.addBool("magnetWeak", (health.status & Encoder::STATUS_MAGNET_WEAK) != 0);
+  json.addBool("magnetStrong", (health.status & Encoder::STATUS_MAGNET_STRONG) != 0);
+  json.addInteger("agc", health.agc);
+  json.addInteger("magnitude", health.magnitude);
+  json.addInteger("checks", health.checks);
+  json.addInteger("readErrors", health.readErrors);
+  json.addInteger("outliers", health.outliers);
+  json.addInteger("distrusts", health.distrusts);
+  json.addNumber("maxAccel", encoder.getMaxAcceleration() / 4096);
+  json.endObject();
+  json.endObject();
+
+  if (_server.hasArg("reset"))
+  {
+    encoder.resetSampleStats();
+  }
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+// ?samples=n (1 to 200) starts timing each encoder source over n back to
+// back reads; the encoder's slack task reads a slice at a time so the
+// control loop is not held up. Without it, or while the run goes on, this
+// reports its progress and the figures of each source done: the time and
+// CPU cycles per read and how many new angles a second it can deliver.
+// Reads that fail, an OUT pin mode that is not set up, are left out of
+// samples.
+void ServerManager::handleEncoderBenchmark()
+{
+  Encoder &encoder = _motorController.getEncoder();
+  int code = 200;
+  if (_server.hasArg("samples"))
+  {
+    int samples = _server.arg("samples").toInt();
+    if (samples < 1 || samples > 200)
+    {
+      _server.send(400, "text/plain", "Samples must be 1 to 200.");
+      return;
+    }
+    code = encoder.startBenchmark(samples) ? 202 : 409;
+  }
+  const Encoder::BenchmarkRun &run = encoder.getBenchmarkRun();
+
+  char buffer[448];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addString("source", encoderSourceNames[encoder.getSource()]);
+  json.addBool("running", run.running);
+  json.addInteger("runs", run.runs);
+  json.addInteger("samples", run.samples);
+  if (run.running)
+  {
+    json.addString("reading", encoderSourceNames[run.source]);
+  }
+  for (int i = Encoder::SOURCE_I2C; i <= Encoder::SOURCE_PWM; i++)
+  {
+    const Encoder::Benchmark &result = run.results[i];
+    if (run.running ? i >= run.source : run.runs == 0)
+    {
+      continue; // Not read yet
+    }
+    json.beginObject(encoderSourceNames[i]);
+    json.addInteger("samples", result.samples);
+    json.addNumber("microsPerSample", result.microsPerSample);
+    json.addInteger("cyclesPerSample", result.cyclesPerSample);
+    json.addInteger("maxRateHz", result.maxRateHz);
+    json.endObject();
+  }
+  json.endObject();
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(code, "application/json", json.c_str(), json.length());
+}
+
+// Bus transfer timing. maxSampleRate is the encoder read rate the bus alone could sustain.
+void ServerManager::handleI2C()
+{
+  const I2CBusManager::Stats &direct = _busManager.getDirectStats();
+  const I2CBusManager::Stats &queued = _busManager.getQueuedStats();
+  unsigned long averageMicros = direct.count == 0 ? 0 : direct.totalMicros / direct.count;
+
+  char buffer[384];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addInteger("clockHz", _busManager.getClock());
+  json.beginObject("direct");
+  json.addInteger("count", direct.count);
+  json.addInteger("errors", direct.errors);
+  json.addInteger("averageMicros", averageMicros);
+  json.addInteger("maxMicros", direct.maxMicros);
+  json.endObject();
+  json.beginObject("queued");
+  json.addInteger("count", queued.count);
+  json.addInteger("errors", queued.errors);
+  json.addInteger("maxMicros", queued.maxMicros);
+  json.addInteger("depth", _busManager.getQueueDepth());
+  json.endObject();
+  json.addInteger("skippedPointerWrites", _busManager.getSkippedPointerWrites());
+  json.addInteger("maxSampleRate", averageMicros == 0 ? 0 : 1000000UL / averageMicros);
+  json.endObject();
+
+  if (_server.hasArg("reset"))
+  {
+    _busManager.resetStats();
+  }
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(200, "application/json", json.c_str(), json.length());
+}
+
+// Loads a batch of waypoints, "t,value" pairs separated by newlines or ';',
+// from the request body or ?points=. Times are ms from the start of the
+// trajectory. ?append adds to the playing queue, ?start=0 loads without
+// starting and ?append&start=1 starts a loaded queue. With no points it
+// reports the queue state.
+void ServerManager::handleTrajectory()
+{
+  TrajectoryQueue &trajectory = _motorController.getTrajectory();
+  String points = _server.hasArg("points") ? _server.arg("points") : _server.arg("plain");
+  if (points.length() == 0)
+  {
+    sendTrajectoryStatus(200, 0);
+    return;
+  }
+
+  bool append = _server.hasArg("append");
+  _motorController.keepAlive(); // Streamed batches keep a long trajectory alive
+  TrajectoryQueue::Mode mode = _server.arg("mode") == "position" ? TrajectoryQueue::POSITION : TrajectoryQueue::VELOCITY;
+  if (!append)
+  {
+    _motorController.stopTrajectory();
+  }
+  if (!trajectory.setMode(mode))
+  {
+    sendTrajectoryStatus(409, 0);
+    return;
+  }
+
+  int accepted = 0;
+  const char *cursor = points.c_str();
+  while (*cursor != '\0')
+  {
+    char *end;
+    unsigned long timeMs = strtoul(cursor, &end, 10);
+    if (end == cursor || *end != ',')
+    {
+      break;
+    }
+    cursor = end + 1;
+    float value = strtod(cursor, &end);
+    if (end == cursor || !trajectory.push(timeMs, value))
+    {
+      break;
+    }
+    accepted++;
+    cursor = end;
+    while (*cursor == ';' || *cursor == '\n' || *cursor == '\r' || *cursor == ' ')
+    {
+      cursor++;
+    }
+  }
+
+  if (*cursor != '\0')
+  {
+    // Keep what was accepted so a streaming client can resend the rest
+    sendTrajectoryStatus(accepted == 0 ? 400 : 409, accepted);
+    return;
+  }
+  bool start = append ? _server.arg("start") == "1" : _server.arg("start") != "0";
+  if (start && !trajectory.isRunning())
+  {
+    _motorController.startTrajectory();
+  }
+  sendTrajectoryStatus(200, accepted);
+}
+
+void ServerManager::handleTrajectoryStop()
+{
+  _motorController.stopTrajectory();
+  sendTrajectoryStatus(200, 0);
+}
+
+void ServerManager::sendTrajectoryStatus(int code, int accepted)
+{
+  TrajectoryQueue &trajectory = _motorController.getTrajectory();
+  char buffer[160];
+  JsonWriter json(buffer, sizeof(buffer));
+  json.beginObject();
+  json.addString("mode", trajectory.getMode() == TrajectoryQueue::POSITION ? "position" : "velocity");
+  json.addBool("running", trajectory.isRunning());
+  json.addInteger("accepted", accepted);
+  json.addInteger("queued", trajectory.getCount());
+  json.addInteger("free", TrajectoryQueue::CAPACITY - trajectory.getCount());
+  json.addInteger("elapsedMs", trajectory.getElapsedMs());
+  json.addInteger("lastTimeMs", trajectory.getLastTime());
+  json.endObject();
+
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  _server.send(code, "application/json", json.c_str(), json.length());
+}
+
+void ServerManager::handleTraceArm()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  String trigger = _server.hasArg("trigger") ? _server.arg("trigger") : "setpoint";
+  float threshold = _server.hasArg("threshold") ? _server.arg("threshold").toFloat() : 0;
+  size_t post = _server.hasArg("post") ? _server.arg("post").toInt() : TraceRecorder::CAPACITY / 2;
+
+  TraceRecorder &trace = _motorController.getTraceRecorder();
+  if (trigger == "immediate")
+  {
+    trace.arm(TraceRecorder::TRIGGER_IMMEDIATE, 0, TraceRecorder::CAPACITY);
+  }
+  else if (trigger == "setpoint")
+  {
+    trace.arm(TraceRecorder::TRIGGER_SETPOINT, 0, post);
+  }
+  else if (trigger == "error")
+  {
+    trace.arm(TraceRecorder::TRIGGER_ERROR, threshold, post);
+  }
+  else
+  {
+    _server.send(400, "text/plain", "Unknown trigger.");
+    return;
+  }
+  sendStatus("Trace Armed");
+}
+
+void ServerManager::handleTrace()
+{
+  _server.sendHeader("Access-Control-Allow-Origin", "*");
+  TraceRecorder &trace = _motorController.getTraceRecorder();
+  if (trace.getState() != TraceRecorder::COMPLETE)
+  {
+    static const char *stateNames[] = {"idle", "armed", "triggered", "complete"};
+    _server.send(409, "text/plain", String("Trace not complete: ") + stateNames[trace.getState()]);
+    return;
+  }
+
+  if (_server.arg("format") == "bin")
+  {
+    sendTraceBinary(trace);
+  }
+  else
+  {
+    sendTraceCsv(trace);
+  }
+}
+
+// The capture is produced a buffer at a time as the browser takes it, so it
+// is never held in a String. Both formats stop at the count when the
+// download started, should the trace be rearmed meanwhile.
+void ServerManager::sendTraceCsv(TraceRecorder &trace)
+{
+  size_t count = trace.getCount();
+  _server.sendStream(200, "text/csv", HttpServer::CONTENT_LENGTH_UNKNOWN,
+                     [&trace, count, next = size_t(0), started = false](uint8_t *buffer, size_t size) mutable -> size_t
+                     {
+                       char *chunk = reinterpret_cast<char *>(buffer);
+                       size_t length = 0;
+                       if (!started)
+                       {
+                         int written = snprintf(chunk, size, "# recordCycles avg=%u max=%u\nt_us,setpoint,measured,output,errorIntegral\n",
+                                                static_cast<unsigned>(trace.getAverageRecordCycles()), static_cast<unsigned>(trace.getMaxRecordCycles()));
+                         length = written < 0 ? 0 : static_cast<size_t>(written) < size ? written : size - 1;
+                         started = true;
+                       }
+                       for (; next < count; next++)
+                       {
+                         const TraceSample &sample = trace.getSample(next);
+                         int written = snprintf(chunk + length, size - length, "%u,%.2f,%.2f,%.2f,%.3f\n",
+                                                static_cast<unsigned>(sample.timestampMicros), sample.setpoint, sample.measured, sample.output, sample.errorIntegral);
+                         if (written < 0 || static_cast<size_t>(written) >= size - length)
+                         {
+                           break; // Truncated: the line goes out whole in the next buffer
+                         }
+                         length += written;
+                       }
+                       return length;
+                     });
+}
+
+// Header: 'W','R', version, 0, uint16 count, uint16 sample size, uint32 average
+// and uint32 maximum record cycles; then count TraceSamples, all little-endian.
+void ServerManager::sendTraceBinary(TraceRecorder &trace)
+{
+  size_t count = trace.getCount();
+  _server.sendStream(200, "application/octet-stream", 16 + count * sizeof(TraceSample),
+                     [&trace, count, next = size_t(0), started = false](uint8_t *buffer, size_t size) mutable -> size_t
+                     {
+                       size_t length = 0;
+                       if (!started)
+                       {
+                         uint8_t header[16] = {'W', 'R', 1, 0};
+                         uint16_t headerCount = count;
+                         uint16_t sampleSize = sizeof(TraceSample);
+                         uint32_t averageCycles = trace.getAverageRecordCycles();
+                         uint32_t maxCycles = trace.getMaxRecordCycles();
+                         memcpy(header + 4, &headerCount, 2);
+                         memcpy(header + 6, &sampleSize, 2);
+                         memcpy(header + 8, &averageCycles, 4);
+                         memcpy(header + 12, &maxCycles, 4);
+                         memcpy(buffer, header, sizeof(header));
+                         length = sizeof(header);
+                         started = true;
+                       }
+                       for (; next < count && length + sizeof(TraceSample) <= size; next++)
+                       {
+                         memcpy(buffer + length, &trace.getSample(next), sizeof(TraceSample));
+                         length += sizeof(TraceSample);
+                       }
+                       return length;
+                     });
+}
+
+// Formats the status into the preallocated buffer, recording its size and
+// cost. fields, if not null, lists the top-level keys to include.
+size_t ServerManager::formatStatus(const char *message, const char *fields, const uint32_t *sequence)
+{
+  unsigned long startTime = micros();
+  JsonWriter json(_statusBuffer, sizeof(_statusBuffer));
+  json.setFilter(fields);
+  json.beginObject();
+  if (sequence != nullptr)
+  {
+    char member[24];
+    snprintf(member, sizeof(member), "\"sequence\":%lu", static_cast<unsigned long>(*sequence));
+    json.addMembers(member); // Whatever the filter
+  }
+  _motorController.writeStatusFields(json, _FIRMWARE_VERSION, message);
+  json.beginObject("watchdog");
+  json.addInteger("missedDeadlines", _scheduler.getMissedDeadlines());
+  json.addInteger("overruns", _scheduler.getOverruns());
+  const char *lastOverrun = _scheduler.getLastOverrunPhase();
+  json.addString("lastOverrun", lastOverrun != nullptr ? lastOverrun : "");
+  json.addInteger("lastOverrunLateMicros", _scheduler.getLastOverrunLateMicros());
+  json.endObject();
+  json.endObject();
+  _lastStatusMicros = micros() - startTime;
+  _lastStatusBytes = json.length();
+  return json.length();
+}
+
+void ServerManager::sendStatus(const char *message)
+{
+  size_t length = formatStatus(message, nullptr);
+  _server.send(200, "application/json", _statusBuffer, length);
+}
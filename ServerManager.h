@@ -1,31 +1,81 @@
 #ifndef ServerManager_h
 #define ServerManager_h
 
-#include <ESP8266WebServer.h>
+#include "HttpServer.h"
 #include "MotorController.h"
+#include "ControlScheduler.h"
+#include "TelemetryStream.h"
+#include "CommandChannel.h"
+#include "GroupChannel.h"
+#include "I2CBusManager.h"
+#include "StatusTracker.h"
 
 class ServerManager {
 public:
-    ServerManager(ESP8266WebServer& server, MotorController& motorController, String FIRMWARE_VERSION);
+    ServerManager(HttpServer& server, MotorController& motorController, ControlScheduler& scheduler, TelemetryStream& telemetry, CommandChannel& commandChannel, GroupChannel& groupChannel, I2CBusManager& busManager, String FIRMWARE_VERSION);
     void setupEndpoints();
     void handleClient();
 
 private:
-    ESP8266WebServer& _server;
+    HttpServer& _server;
     MotorController& _motorController;
+    ControlScheduler& _scheduler;
+    TelemetryStream& _telemetry;
+    CommandChannel& _commandChannel;
+    GroupChannel& _groupChannel;
+    I2CBusManager& _busManager;
     String _FIRMWARE_VERSION;
 
+    static const size_t STATUS_BUFFER_SIZE = 1280;
+    static const size_t STATUS_KEYS_SIZE = 256; // Every tracked key, for a /status?since= filter
+    char _statusBuffer[STATUS_BUFFER_SIZE]; // Reused by every status and /timing response
+    size_t _lastStatusBytes;
+    unsigned long _lastStatusMicros;
+    unsigned long _statusNotModified; // 304s sent for /status
+    unsigned long _statusDeltas;      // /status?since= answered with the changes alone
+    StatusTracker _statusTracker;
+
     void handleHold();
+    void handlePosition();
+    void handleMove();
+    void applyMoveArgs();
     void handleSpeed();
     void handleFree();
     void handleBrake();
     void handleRelease();
     void handleStatus();
     void handleCalibrate();
+    void handleCalibrateProgress();
+    void handleCalibrateAbort();
+    void handleCalibrateTable();
     void handleFactoryReset();
     void handleConfig();
+    void handleDashboard();
     void handleSetup();
     void handleSetPID();
+    void handleAutoTune();
+    void handleAutoTuneStart();
+    void handleAutoTuneAbort();
+    void handleTiming();
+    void handleKeepAlive();
+    void handleFailsafe();
+    void handleProtection();
+    void handleTelemetrySubscribe();
+    void handleTelemetryUnsubscribe();
+    void handleGroup();
+    void handleEncoder();
+    void handleEncoderBenchmark();
+    void handleI2C();
+    void handleTraceArm();
+    void handleTrajectory();
+    void handleTrajectoryStop();
+    void sendTrajectoryStatus(int code, int accepted);
+    void handleTrace();
+    void sendTraceCsv(TraceRecorder &trace);
+    void sendTraceBinary(TraceRecorder &trace);
+    void trackStatus();
+    size_t formatStatus(const char *message, const char *fields, const uint32_t *sequence = nullptr);
+    void sendStatus(const char *message);
 };
 
 #endif
@@ -0,0 +1,65 @@
+#include "SpeedTable.h"
+
+void SpeedTable::clear()
+{
+  forward = SpeedCurve();
+  reverse = SpeedCurve();
+}
+
+bool SpeedTable::isValid() const
+{
+  return forward.rpm[SpeedCurve::POINTS - 1] > 0 && reverse.rpm[SpeedCurve::POINTS - 1] > 0;
+}
+
+float SpeedTable::dutyFor(float rpm) const
+{
+  if (rpm > 0)
+  {
+    return curveDuty(forward, rpm);
+  }
+  if (rpm < 0)
+  {
+    return -curveDuty(reverse, -rpm);
+  }
+  return 0;
+}
+
+float SpeedTable::curveDuty(const SpeedCurve &curve, float rpm)
+{
+  if (rpm < DEADBAND_RAMP_RPM)
+  {
+    return curveDuty(curve, DEADBAND_RAMP_RPM) * rpm / DEADBAND_RAMP_RPM;
+  }
+
+  float lowRPM = 0;
+  float lowDuty = curve.deadband;
+  for (int i = 0; i < SpeedCurve::POINTS; i++)
+  {
+    if (rpm <= curve.rpm[i])
+    {
+      return lowDuty + (curve.duty[i] - lowDuty) * (rpm - lowRPM) / (curve.rpm[i] - lowRPM);
+    }
+    lowRPM = curve.rpm[i];
+    lowDuty = curve.duty[i];
+  }
+  return 1023;
+}
+
+// Measurements are noisy near the top of the curve; interpolation needs
+// strictly increasing speeds
+void SpeedTable::makeMonotonic()
+{
+  SpeedCurve *curves[] = {&forward, &reverse};
+  for (SpeedCurve *curve : curves)
+  {
+    int16_t previous = 0;
+    for (int i = 0; i < SpeedCurve::POINTS; i++)
+    {
+      if (curve->rpm[i] <= previous)
+      {
+        curve->rpm[i] = previous + 1;
+      }
+      previous = curve->rpm[i];
+    }
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef SpeedTable_h
+#define SpeedTable_h
+
+#include <stdint.h>
+
+// Measured duty -> speed curve for one direction. The motor starts to turn
+// at the deadband duty; the points above it are evenly spaced up to full duty.
+struct SpeedCurve {
+    static const int POINTS = 8;
+
+    uint16_t deadband;
+    uint16_t duty[POINTS];
+    int16_t rpm[POINTS]; // Strictly increasing
+};
+
+// PWM -> RPM characterisation from calibration, kept as plain data so it can
+// be copied into the stored config. dutyFor() inverts it to give the open-loop
+// duty for a target speed, used as the feed-forward term of the speed loop.
+class SpeedTable {
+public:
+    static const int DEADBAND_RAMP_RPM = 10; // Fade the deadband in so small targets do not chatter
+
+    SpeedCurve forward;
+    SpeedCurve reverse;
+
+    void clear();
+    bool isValid() const;
+    float dutyFor(float rpm) const; // Signed, -1023..1023
+    void makeMonotonic();
+
+private:
+    static float curveDuty(const SpeedCurve &curve, float rpm);
+};
+
+#endif
@@ -0,0 +1,170 @@
+#include "StatusTracker.h"
+#include <math.h>
+#include <string.h>
+
+static const uint32_t FNV_OFFSET = 2166136261UL;
+static const uint32_t FNV_PRIME = 16777619UL;
+
+StatusTracker::StatusTracker() : _count(0), _first(0), _sequence(0)
+{
+}
+
+void StatusTracker::begin(uint32_t seed)
+{
+  _count = 0;
+  _first = seed;
+  _sequence = seed;
+}
+
+void StatusTracker::beginPass()
+{
+  for (int i = 0; i < _count; i++)
+  {
+    _fields[i].passHash = FNV_OFFSET;
+  }
+}
+
+// A field seen for the first time counts as changed
+StatusTracker::Field *StatusTracker::find(const char *key)
+{
+  for (int i = 0; i < _count; i++)
+  {
+    if (_fields[i].key == key)
+    {
+      return &_fields[i];
+    }
+  }
+  if (_count == MAX_FIELDS)
+  {
+    return nullptr;
+  }
+  Field &field = _fields[_count++];
+  field.key = key;
+  field.hash = FNV_OFFSET;
+  field.passHash = FNV_OFFSET;
+  field.changedAt = _sequence + 1;
+  return &field;
+}
+
+void StatusTracker::mix(const char *key, const uint8_t *data, size_t length)
+{
+  Field *field = find(key);
+  if (field == nullptr)
+  {
+    return;
+  }
+  for (size_t i = 0; i < length; i++)
+  {
+    field->passHash = (field->passHash ^ data[i]) * FNV_PRIME;
+  }
+}
+
+void StatusTracker::track(const char *key, long value)
+{
+  mix(key, reinterpret_cast<const uint8_t *>(&value), sizeof(value));
+}
+
+void StatusTracker::track(const char *key, double value, int decimals)
+{
+  static const double scales[] = {1, 10, 100, 1000, 10000};
+  long quantized = isfinite(value) ? lround(value * scales[decimals < 0 ? 0 : decimals > 4 ? 4 : decimals]) : 0;
+  track(key, quantized);
+}
+
+void StatusTracker::track(const char *key, const char *value)
+{
+  mix(key, reinterpret_cast<const uint8_t *>(value), strlen(value) + 1);
+}
+
+// All the fields changed in one pass share its sequence number
+void StatusTracker::endPass()
+{
+  bool changed = false;
+  for (int i = 0; i < _count; i++)
+  {
+    Field &field = _fields[i];
+    if (field.passHash != field.hash || field.changedAt == _sequence + 1)
+    {
+      field.hash = field.passHash;
+      field.changedAt = _sequence + 1;
+      changed = true;
+    }
+  }
+  if (changed)
+  {
+    _sequence++;
+  }
+}
+
+uint32_t StatusTracker::getSequence() const
+{
+  return _sequence;
+}
+
+uint32_t StatusTracker::getSequence(const char *filter) const
+{
+  if (filter == nullptr)
+  {
+    return _sequence;
+  }
+  uint32_t latest = _first;
+  for (int i = 0; i < _count; i++)
+  {
+    if (selects(filter, _fields[i].key) && _fields[i].changedAt - _first > latest - _first)
+    {
+      latest = _fields[i].changedAt;
+    }
+  }
+  return latest;
+}
+
+bool StatusTracker::changedSince(uint32_t since, const char *filter, char *keys, size_t size) const
+{
+  if (since - _first > _sequence - _first)
+  {
+    return false;
+  }
+  size_t length = 0;
+  keys[0] = '\0';
+  for (int i = 0; i < _count; i++)
+  {
+    const Field &field = _fields[i];
+    if (field.changedAt - _first <= since - _first || (filter != nullptr && !selects(filter, field.key)))
+    {
+      continue;
+    }
+    size_t keyLength = strlen(field.key);
+    if (length + keyLength + 2 > size)
+    {
+      return false; // Too many to list, send everything
+    }
+    if (length > 0)
+    {
+      keys[length++] = ',';
+    }
+    memcpy(keys + length, field.key, keyLength + 1);
+    length += keyLength;
+  }
+  return true;
+}
+
+// As JsonWriter matches its filter
+bool StatusTracker::selects(const char *filter, const char *key)
+{
+  size_t length = strlen(key);
+  for (const char *entry = filter; *entry != '\0';)
+  {
+    const char *end = strchr(entry, ',');
+    size_t entryLength = end != nullptr ? end - entry : strlen(entry);
+    if (entryLength == length && strncmp(entry, key, length) == 0)
+    {
+      return true;
+    }
+    if (end == nullptr)
+    {
+      break;
+    }
+    entry = end + 1;
+  }
+  return false;
+}
@@ -0,0 +1,56 @@
+#ifndef StatusTracker_h
+#define StatusTracker_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Change sequence for the top-level /status fields, so a poller can be told
+// that nothing changed, or sent only what did, without formatting the
+// status. Each pass between begin() and end() tracks every field's values
+// at the resolution the status shows them; the values of one field are
+// hashed together, and each field whose hash differs from the last pass
+// takes the next sequence number. Keys are compared by pointer, so they
+// must be the same literals on every pass.
+//
+// The sequence starts from a random value at boot, so one a poller kept
+// from before a restart reads as unknown rather than as a recent one.
+class StatusTracker {
+public:
+    static const int MAX_FIELDS = 32;
+
+    StatusTracker();
+    void begin(uint32_t seed);
+
+    void beginPass();
+    void track(const char *key, long value);
+    void track(const char *key, double value, int decimals = 2); // Quantized as written
+    void track(const char *key, const char *value);
+    void endPass();
+
+    uint32_t getSequence() const; // Of the last change to any field
+    // Of the last change to the fields a JsonWriter filter selects
+    uint32_t getSequence(const char *filter) const;
+    // Comma separated keys of the fields changed after since, limited to
+    // those the filter selects, for JsonWriter::setFilter(). False if since
+    // is not a sequence of this boot, so the poller needs everything.
+    bool changedSince(uint32_t since, const char *filter, char *keys, size_t size) const;
+
+private:
+    struct Field {
+        const char *key;
+        uint32_t hash;      // Last pass
+        uint32_t passHash;  // This pass
+        uint32_t changedAt;
+    };
+
+    Field _fields[MAX_FIELDS];
+    int _count;
+    uint32_t _first;    // Sequence at boot
+    uint32_t _sequence;
+
+    Field *find(const char *key);
+    void mix(const char *key, const uint8_t *data, size_t length);
+    static bool selects(const char *filter, const char *key);
+};
+
+#endif
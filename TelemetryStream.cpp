@@ -0,0 +1,152 @@
+#include "TelemetryStream.h"
+
+static void putU16(uint8_t *p, uint16_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+static void putFloat(uint8_t *p, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  putU32(p, bits);
+}
+
+TelemetryStream::TelemetryStream(unsigned long controlRateHz)
+    : _controlRateHz(controlRateHz), _droppedFrames(0)
+{
+  for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+  {
+    _subscribers[i].active = false;
+  }
+}
+
+void TelemetryStream::begin(uint16_t localPort)
+{
+  _udp.begin(localPort);
+}
+
+TelemetryStream::Subscriber *TelemetryStream::findSubscriber(IPAddress address, uint16_t port)
+{
+  for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+  {
+    if (_subscribers[i].active && _subscribers[i].address == address && _subscribers[i].port == port)
+    {
+      return &_subscribers[i];
+    }
+  }
+  return nullptr;
+}
+
+bool TelemetryStream::subscribe(IPAddress address, uint16_t port, unsigned long rateHz)
+{
+  Subscriber *subscriber = findSubscriber(address, port);
+  if (subscriber == nullptr)
+  {
+    for (int i = 0; i < MAX_SUBSCRIBERS && subscriber == nullptr; i++)
+    {
+      if (!_subscribers[i].active)
+      {
+        subscriber = &_subscribers[i];
+        subscriber->address = address;
+        subscriber->port = port;
+        subscriber->sequence = 0;
+      }
+    }
+    if (subscriber == nullptr)
+    {
+      return false; // No free slot
+    }
+  }
+
+  if (rateHz == 0 || rateHz > _controlRateHz)
+  {
+    rateHz = _controlRateHz;
+  }
+  subscriber->decimation = _controlRateHz / rateHz;
+  subscriber->countdown = 0;
+  subscriber->active = true;
+  return true;
+}
+
+bool TelemetryStream::unsubscribe(IPAddress address, uint16_t port)
+{
+  Subscriber *subscriber = findSubscriber(address, port);
+  if (subscriber == nullptr)
+  {
+    return false;
+  }
+  subscriber->active = false;
+  return true;
+}
+
+void TelemetryStream::publish(const ControlSample &sample)
+{
+  uint8_t frame[FRAME_SIZE];
+  for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+  {
+    Subscriber &subscriber = _subscribers[i];
+    if (!subscriber.active)
+    {
+      continue;
+    }
+    if (subscriber.countdown > 0)
+    {
+      subscriber.countdown--;
+      continue;
+    }
+    subscriber.countdown = subscriber.decimation - 1;
+
+    size_t length = encodeFrame(frame, subscriber.sequence++, sample);
+    // UDP never blocks on the peer; if lwIP is out of buffers the frame is dropped
+    if (!_udp.beginPacket(subscriber.address, subscriber.port) ||
+        _udp.write(frame, length) != length ||
+        !_udp.endPacket())
+    {
+      _droppedFrames++;
+    }
+  }
+}
+
+size_t TelemetryStream::encodeFrame(uint8_t *frame, uint32_t sequence, const ControlSample &sample)
+{
+  frame[0] = 'W';
+  frame[1] = 'T';
+  frame[2] = TELEMETRY_VERSION;
+  frame[3] = 0;
+  putU32(frame + 4, sequence);
+  putU32(frame + 8, sample.timestampMicros);
+  putU16(frame + 12, static_cast<uint16_t>(sample.rawAngle));
+  putU16(frame + 14, static_cast<uint16_t>(static_cast<int16_t>(sample.pwm)));
+  putFloat(frame + 16, sample.speedRPM);
+  putFloat(frame + 20, sample.targetRPM);
+  putFloat(frame + 24, sample.output);
+  return FRAME_SIZE;
+}
+
+int TelemetryStream::getSubscriberCount() const
+{
+  int count = 0;
+  for (int i = 0; i < MAX_SUBSCRIBERS; i++)
+  {
+    if (_subscribers[i].active)
+    {
+      count++;
+    }
+  }
+  return count;
+}
+
+unsigned long TelemetryStream::getDroppedFrames() const
+{
+  return _droppedFrames;
+}
@@ -0,0 +1,56 @@
+#ifndef TelemetryStream_h
+#define TelemetryStream_h
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "MotorController.h"
+
+// Pushes one compact binary frame per control step (or every Nth step) to
+// each subscribed UDP client. All fields are little-endian:
+//
+//   offset size  field
+//   0      2     magic 'W','T'
+//   2      1     version (TELEMETRY_VERSION)
+//   3      1     flags (reserved, 0)
+//   4      4     sequence number, per subscriber
+//   8      4     timestamp, micros()
+//   12     2     raw angle, 0..4095
+//   14     2     PWM duty, signed, negative is CCW
+//   16     4     filtered speed, RPM, float
+//   20     4     target speed, RPM, float
+//   24     4     PID output, float
+class TelemetryStream {
+public:
+    static const uint8_t TELEMETRY_VERSION = 1;
+    static const size_t FRAME_SIZE = 28;
+    static const int MAX_SUBSCRIBERS = 4;
+
+    TelemetryStream(unsigned long controlRateHz);
+    void begin(uint16_t localPort);
+    // rateHz is clamped to the control rate. Re-subscribing updates the rate.
+    bool subscribe(IPAddress address, uint16_t port, unsigned long rateHz);
+    bool unsubscribe(IPAddress address, uint16_t port);
+    void publish(const ControlSample &sample); // Call once per control step
+    int getSubscriberCount() const;
+    unsigned long getDroppedFrames() const;
+
+private:
+    struct Subscriber {
+        bool active;
+        IPAddress address;
+        uint16_t port;
+        uint16_t decimation; // Send every Nth control step
+        uint16_t countdown;
+        uint32_t sequence;
+    };
+
+    WiFiUDP _udp;
+    unsigned long _controlRateHz;
+    Subscriber _subscribers[MAX_SUBSCRIBERS];
+    unsigned long _droppedFrames; // Frames the UDP stack could not queue
+
+    Subscriber *findSubscriber(IPAddress address, uint16_t port);
+    static size_t encodeFrame(uint8_t *frame, uint32_t sequence, const ControlSample &sample);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "TraceRecorder.h"
+#include <math.h>
+
+TraceRecorder::TraceRecorder()
+    : _state(IDLE), _trigger(TRIGGER_IMMEDIATE), _errorThreshold(0), _postTriggerSamples(CAPACITY),
+      _remaining(0), _head(0), _count(0), _setpointChanged(false),
+      _maxRecordCycles(0), _totalRecordCycles(0), _recordCount(0)
+{
+}
+
+void TraceRecorder::arm(Trigger trigger, float errorThreshold, size_t postTriggerSamples)
+{
+  _state = IDLE; // Stop the writer while the capture is reset
+  _trigger = trigger;
+  _errorThreshold = errorThreshold;
+  _postTriggerSamples = postTriggerSamples == 0 || postTriggerSamples > CAPACITY ? CAPACITY : postTriggerSamples;
+  _remaining = _postTriggerSamples;
+  _head = 0;
+  _count = 0;
+  _setpointChanged = false;
+  _maxRecordCycles = 0;
+  _totalRecordCycles = 0;
+  _recordCount = 0;
+  _state = trigger == TRIGGER_IMMEDIATE ? TRIGGERED : ARMED;
+}
+
+void TraceRecorder::disarm()
+{
+  _state = IDLE;
+}
+
+void TraceRecorder::notifySetpointChange()
+{
+  _setpointChanged = true;
+}
+
+bool TraceRecorder::record(const TraceSample &sample)
+{
+  if (_state == IDLE || _state == COMPLETE)
+  {
+    return false;
+  }
+
+  _samples[_head] = sample;
+  _head = (_head + 1) % CAPACITY;
+  if (_count < CAPACITY)
+  {
+    _count++;
+  }
+
+  if (_state == ARMED)
+  {
+    bool fire = false;
+    if (_trigger == TRIGGER_SETPOINT)
+    {
+      fire = _setpointChanged;
+    }
+    else if (_trigger == TRIGGER_ERROR)
+    {
+      fire = fabsf(sample.setpoint - sample.measured) > _errorThreshold;
+    }
+    if (!fire)
+    {
+      return true;
+    }
+    _state = TRIGGERED;
+  }
+
+  // The triggering sample counts as the first post-trigger sample
+  if (--_remaining == 0)
+  {
+    _state = COMPLETE;
+  }
+  return true;
+}
+
+void TraceRecorder::addRecordCycles(uint32_t cycles)
+{
+  if (cycles > _maxRecordCycles)
+  {
+    _maxRecordCycles = cycles;
+  }
+  _totalRecordCycles += cycles;
+  _recordCount++;
+}
+
+TraceRecorder::State TraceRecorder::getState() const
+{
+  return _state;
+}
+
+size_t TraceRecorder::getCount() const
+{
+  return _count;
+}
+
+const TraceSample &TraceRecorder::getSample(size_t index) const
+{
+  size_t oldest = _count < CAPACITY ? 0 : _head;
+  return _samples[(oldest + index) % CAPACITY];
+}
+
+uint32_t TraceRecorder::getMaxRecordCycles() const
+{
+  return _maxRecordCycles;
+}
+
+uint32_t TraceRecorder::getAverageRecordCycles() const
+{
+  return _recordCount == 0 ? 0 : static_cast<uint32_t>(_totalRecordCycles / _recordCount);
+}
+
+uint32_t TraceRecorder::getRecordCount() const
+{
+  return _recordCount;
+}
@@ -0,0 +1,69 @@
+#ifndef TraceRecorder_h
+#define TraceRecorder_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One control step as captured by the recorder. Packed to 20 bytes so the
+// binary dump is the raw array on a little-endian target.
+struct TraceSample {
+    uint32_t timestampMicros;
+    float setpoint;      // RPM
+    float measured;      // RPM
+    float output;        // PID output
+    float errorIntegral; // The PID's integral term, PWM duty
+};
+
+// Fixed-size ring buffer filled once per control step. It keeps recording
+// while armed so the capture includes samples from before the trigger, then
+// freezes after the post-trigger samples are in. The control step is the only
+// writer and only writes until the capture is complete; readers only read a
+// complete capture, so no locking is needed.
+class TraceRecorder {
+public:
+    static const size_t CAPACITY = 256; // 1.28 s at the 5 ms control period
+
+    enum Trigger {
+        TRIGGER_IMMEDIATE,
+        TRIGGER_SETPOINT, // Next setTargetSpeed()
+        TRIGGER_ERROR     // |setpoint - measured| above the threshold
+    };
+
+    enum State {
+        IDLE,
+        ARMED,
+        TRIGGERED,
+        COMPLETE
+    };
+
+    TraceRecorder();
+    void arm(Trigger trigger, float errorThreshold, size_t postTriggerSamples);
+    void disarm();
+    void notifySetpointChange();
+    bool record(const TraceSample &sample); // False when idle or complete: nothing stored
+    void addRecordCycles(uint32_t cycles); // Caller's measurement of a record() that stored a sample
+
+    State getState() const;
+    size_t getCount() const;
+    const TraceSample &getSample(size_t index) const; // 0 is the oldest sample of the capture
+    uint32_t getMaxRecordCycles() const;     // Since arm()
+    uint32_t getAverageRecordCycles() const;
+    uint32_t getRecordCount() const;
+
+private:
+    TraceSample _samples[CAPACITY];
+    volatile State _state;
+    Trigger _trigger;
+    float _errorThreshold;
+    size_t _postTriggerSamples;
+    size_t _remaining;    // Post-trigger samples still to record
+    size_t _head;         // Next slot to write
+    size_t _count;
+    bool _setpointChanged;
+
+    uint32_t _maxRecordCycles;
+    uint64_t _totalRecordCycles; // A uint32_t would wrap within hours of an armed wait
+    uint32_t _recordCount;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "TrajectoryQueue.h"
+
+double easeInOut(double currentTime, double startValue, double changeInValue, double duration)
+{
+  double s = currentTime / duration;
+  if (s <= 0)
+    return startValue;
+  if (s >= 1)
+    return startValue + changeInValue;
+  return changeInValue * s * s * s * (10 + s * (6 * s - 15)) + startValue;
+}
+
+TrajectoryQueue::TrajectoryQueue()
+    : _head(0), _count(0), _hasPrevious(false), _mode(VELOCITY), _running(false), _startMicros(0), _elapsedMs(0)
+{
+}
+
+void TrajectoryQueue::clear()
+{
+  _running = false;
+  _head = 0;
+  _count = 0;
+  _hasPrevious = false;
+  _elapsedMs = 0;
+}
+
+bool TrajectoryQueue::setMode(Mode mode)
+{
+  if (_count > 0)
+  {
+    return mode == _mode;
+  }
+  _mode = mode;
+  return true;
+}
+
+TrajectoryQueue::Mode TrajectoryQueue::getMode() const
+{
+  return _mode;
+}
+
+bool TrajectoryQueue::push(uint32_t timeMs, float value)
+{
+  if (_count == CAPACITY || (_count > 0 && timeMs <= getLastTime()))
+  {
+    return false;
+  }
+  Waypoint &point = _points[(_head + _count) % CAPACITY];
+  point.timeMs = timeMs;
+  point.value = value;
+  _count++;
+  return true;
+}
+
+void TrajectoryQueue::start(unsigned long nowMicros, float initialValue)
+{
+  // Begin from the current state unless the first waypoint is at time zero
+  if (_count > 0 && _points[_head].timeMs > 0 && _count < CAPACITY)
+  {
+    _head = (_head + CAPACITY - 1) % CAPACITY;
+    _points[_head].timeMs = 0;
+    _points[_head].value = initialValue;
+    _count++;
+  }
+  _hasPrevious = false;
+  _startMicros = nowMicros;
+  _elapsedMs = 0;
+  _running = _count > 0;
+}
+
+void TrajectoryQueue::stop()
+{
+  _running = false;
+}
+
+bool TrajectoryQueue::sample(unsigned long nowMicros, float &value, float &rate)
+{
+  float t = (nowMicros - _startMicros) / 1000.0f;
+  _elapsedMs = static_cast<uint32_t>(t);
+
+  // Drop segments that are already over
+  while (_count > 1 && at(1).timeMs <= t)
+  {
+    _previous = _points[_head];
+    _hasPrevious = true;
+    _head = (_head + 1) % CAPACITY;
+    _count--;
+  }
+
+  const Waypoint &p0 = at(0);
+  if (_count == 1 || t < p0.timeMs)
+  {
+    value = p0.value;
+    rate = 0;
+    if (_count == 1 && t >= p0.timeMs)
+    {
+      _running = false;
+    }
+    return _running;
+  }
+
+  const Waypoint &p1 = at(1);
+  float duration = p1.timeMs - p0.timeMs;
+  float s = (t - p0.timeMs) / duration;
+  float s2 = s * s;
+  float s3 = s2 * s;
+
+  if (_mode == VELOCITY)
+  {
+    value = easeInOut(t - p0.timeMs, p0.value, p1.value - p0.value, duration);
+    rate = (p1.value - p0.value) * 30 * s2 * (1 - s) * (1 - s) / duration * 1000.0f;
+    return true;
+  }
+
+  // Quintic Hermite with zero acceleration at the waypoints
+  float m0 = slopeAt(0) * duration;
+  float m1 = slopeAt(1) * duration;
+  float h5 = s3 * (10 + s * (6 * s - 15));
+  float h1 = s - s3 * (6 + s * (3 * s - 8));
+  float h4 = s3 * (-4 + s * (7 - 3 * s));
+  value = p0.value + (p1.value - p0.value) * h5 + m0 * h1 + m1 * h4;
+
+  float dh5 = 30 * s2 * (1 - s) * (1 - s);
+  float dh1 = 1 - s2 * (18 + s * (15 * s - 32));
+  float dh4 = s2 * (-12 + s * (28 - 15 * s));
+  rate = ((p1.value - p0.value) * dh5 + m0 * dh1 + m1 * dh4) / duration * 1000.0f;
+  return true;
+}
+
+bool TrajectoryQueue::isRunning() const
+{
+  return _running;
+}
+
+size_t TrajectoryQueue::getCount() const
+{
+  return _count;
+}
+
+uint32_t TrajectoryQueue::getElapsedMs() const
+{
+  return _elapsedMs;
+}
+
+uint32_t TrajectoryQueue::getLastTime() const
+{
+  return _count == 0 ? 0 : at(_count - 1).timeMs;
+}
+
+const TrajectoryQueue::Waypoint &TrajectoryQueue::at(size_t index) const
+{
+  return _points[(_head + index) % CAPACITY];
+}
+
+// Catmull-Rom slope, zero at the ends so the path starts and stops at rest
+float TrajectoryQueue::slopeAt(size_t index) const
+{
+  if (index + 1 >= _count)
+  {
+    return 0;
+  }
+  const Waypoint &next = at(index + 1);
+  if (index == 0)
+  {
+    if (!_hasPrevious)
+    {
+      return 0;
+    }
+    return (next.value - _previous.value) / (next.timeMs - _previous.timeMs);
+  }
+  const Waypoint &before = at(index - 1);
+  return (next.value - before.value) / (next.timeMs - before.timeMs);
+}
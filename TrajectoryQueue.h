@@ -0,0 +1,64 @@
+#ifndef TrajectoryQueue_h
+#define TrajectoryQueue_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Jerk-limited ease from startValue to startValue + changeInValue over
+// duration (quintic smootherstep: zero slope and curvature at both ends)
+double easeInOut(double currentTime, double startValue, double changeInValue, double duration);
+
+// Streamed trajectory: waypoints of (time, value) played back at the control
+// rate. Times are milliseconds from start(). In VELOCITY mode values are RPM
+// and each segment eases from one speed to the next. In POSITION mode values
+// are ticks relative to the position at start and the path passes through
+// every waypoint with continuous velocity and acceleration.
+//
+// Clients may keep appending while it plays. A waypoint's slope depends on
+// the one after it, so stay at least two waypoints ahead of the playback.
+class TrajectoryQueue {
+public:
+    static const size_t CAPACITY = 64;
+
+    enum Mode {
+        VELOCITY,
+        POSITION
+    };
+
+    TrajectoryQueue();
+    void clear();
+    bool setMode(Mode mode); // Only while empty
+    Mode getMode() const;
+    bool push(uint32_t timeMs, float value); // false if full or time is not after the last waypoint
+    void start(unsigned long nowMicros, float initialValue);
+    void stop();
+    // Reference value and its rate of change per second; returns false once
+    // the last waypoint has been reached
+    bool sample(unsigned long nowMicros, float &value, float &rate);
+
+    bool isRunning() const;
+    size_t getCount() const;
+    uint32_t getElapsedMs() const;
+    uint32_t getLastTime() const;
+
+private:
+    struct Waypoint {
+        uint32_t timeMs;
+        float value;
+    };
+
+    Waypoint _points[CAPACITY];
+    size_t _head; // Oldest waypoint, the start of the current segment
+    size_t _count;
+    Waypoint _previous; // Waypoint before _head, for the slope at _head
+    bool _hasPrevious;
+    Mode _mode;
+    bool _running;
+    unsigned long _startMicros;
+    uint32_t _elapsedMs;
+
+    const Waypoint &at(size_t index) const;
+    float slopeAt(size_t index) const; // value per ms
+};
+
+#endif
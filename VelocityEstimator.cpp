@@ -0,0 +1,131 @@
+#include "VelocityEstimator.h"
+
+#define OBSERVER_BANDWIDTH (2.0f * 3.14159265f * 10.0f) // rad/s
+
+VelocityEstimator::VelocityEstimator()
+    : _mode(LOW_PASS), _speed(0), _lastPosition(0), _lastTime(0), _estimateOffset(0),
+      _observerKp(2.0f * OBSERVER_BANDWIDTH), _observerKi(OBSERVER_BANDWIDTH * OBSERVER_BANDWIDTH),
+      _head(0), _count(0)
+{
+}
+
+void VelocityEstimator::setMode(Mode mode)
+{
+  if (mode != _mode)
+  {
+    _mode = mode;
+    // Keep the current speed so switching does not cause a step; the
+    // least squares fit starts from the last sample, so its first update
+    // is a fresh slope rather than the old mode's speed
+    _estimateOffset = 0;
+    startWindow();
+  }
+}
+
+VelocityEstimator::Mode VelocityEstimator::getMode() const
+{
+  return _mode;
+}
+
+void VelocityEstimator::reset(int64_t position, unsigned long timeMicros)
+{
+  _speed = 0;
+  _lastPosition = position;
+  _lastTime = timeMicros;
+  _estimateOffset = 0;
+  startWindow();
+}
+
+void VelocityEstimator::startWindow()
+{
+  _positions[0] = _lastPosition;
+  _times[0] = _lastTime;
+  _head = 1;
+  _count = 1;
+}
+
+float VelocityEstimator::update(int64_t position, unsigned long timeMicros)
+{
+  unsigned long elapsed = timeMicros - _lastTime;
+  if (elapsed == 0)
+  {
+    return _speed; // Avoid division by zero
+  }
+
+  float dt = elapsed / 1000000.0f;
+  long delta = static_cast<long>(position - _lastPosition);
+
+  switch (_mode)
+  {
+  case LOW_PASS:
+    _speed = updateLowPass(delta, dt);
+    break;
+  case TRACKING_OBSERVER:
+    _speed = updateObserver(delta, dt);
+    break;
+  case LEAST_SQUARES:
+    _speed = updateLeastSquares(position, timeMicros);
+    break;
+  }
+
+  _lastPosition = position;
+  _lastTime = timeMicros;
+  return _speed;
+}
+
+float VelocityEstimator::getSpeed() const
+{
+  return _speed;
+}
+
+float VelocityEstimator::updateLowPass(long delta, float dt)
+{
+  float newSpeed = delta / dt;
+  return _speed * 0.9f + newSpeed * 0.1f;
+}
+
+float VelocityEstimator::updateObserver(long delta, float dt)
+{
+  // Predict, then correct position and speed from the measured position error
+  _estimateOffset += _speed * dt;
+  float error = delta - _estimateOffset;
+  _estimateOffset += _observerKp * dt * error;
+  float speed = _speed + _observerKi * dt * error;
+  // Re-base on the new measured position
+  _estimateOffset -= delta;
+  return speed;
+}
+
+float VelocityEstimator::updateLeastSquares(int64_t position, unsigned long timeMicros)
+{
+  _positions[_head] = position;
+  _times[_head] = timeMicros;
+  _head = (_head + 1) % WINDOW;
+  if (_count < WINDOW)
+  {
+    _count++;
+  }
+  if (_count < 2)
+  {
+    return _speed;
+  }
+
+  // Work relative to the newest sample to keep the sums small
+  float sumT = 0, sumP = 0, sumTT = 0, sumTP = 0;
+  for (int i = 0; i < _count; i++)
+  {
+    int index = (_head - 1 - i + WINDOW) % WINDOW;
+    float t = -static_cast<float>(timeMicros - _times[index]) / 1000000.0f;
+    float p = static_cast<float>(_positions[index] - position);
+    sumT += t;
+    sumP += p;
+    sumTT += t * t;
+    sumTP += t * p;
+  }
+  float denominator = _count * sumTT - sumT * sumT;
+  if (denominator <= 0)
+  {
+    return _speed;
+  }
+  return (_count * sumTP - sumT * sumP) / denominator;
+}
@@ -0,0 +1,53 @@
+#ifndef VelocityEstimator_h
+#define VelocityEstimator_h
+
+#include <stdint.h>
+
+// Estimates shaft speed in ticks per second from unwrapped encoder positions
+// and microsecond timestamps. The method can be switched at runtime:
+//
+//   LOW_PASS           single difference smoothed by speed*0.9 + new*0.1 (original behaviour)
+//   TRACKING_OBSERVER  second-order tracking loop (PLL) on position, ~10 Hz bandwidth
+//   LEAST_SQUARES      slope of a straight line fitted to the last WINDOW samples
+class VelocityEstimator {
+public:
+    enum Mode {
+        LOW_PASS,
+        TRACKING_OBSERVER,
+        LEAST_SQUARES
+    };
+
+    static const int WINDOW = 8;
+
+    VelocityEstimator();
+    void setMode(Mode mode);
+    Mode getMode() const;
+    void reset(int64_t position, unsigned long timeMicros);
+    float update(int64_t position, unsigned long timeMicros);
+    float getSpeed() const; // ticks/s
+
+private:
+    Mode _mode;
+    float _speed;
+    int64_t _lastPosition;
+    unsigned long _lastTime;
+
+    // Tracking observer: position estimate held relative to _lastPosition so
+    // a float keeps full resolution however far the shaft has turned.
+    float _estimateOffset;
+    float _observerKp;
+    float _observerKi;
+
+    // Least squares window
+    int64_t _positions[WINDOW];
+    unsigned long _times[WINDOW];
+    int _head;
+    int _count;
+
+    float updateLowPass(long delta, float dt);
+    float updateObserver(long delta, float dt);
+    float updateLeastSquares(int64_t position, unsigned long timeMicros);
+    void startWindow(); // Holds just the last sample
+};
+
+#endif
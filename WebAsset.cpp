@@ -0,0 +1,16 @@
+#include "WebAsset.h"
+
+// no-cache still lets the browser keep the page, it just asks each time,
+// which costs a 304 until the firmware brings a new version
+void sendWebAsset(HttpServer &server, const WebAsset &asset)
+{
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == asset.etag)
+  {
+    server.send(304, asset.contentType, "");
+    return;
+  }
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send_P(200, asset.contentType, reinterpret_cast<PGM_P>(asset.data), asset.length);
+}
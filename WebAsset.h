@@ -0,0 +1,18 @@
+#ifndef WebAsset_h
+#define WebAsset_h
+
+#include "HttpServer.h"
+
+// A page compressed into flash by web/build.js (see WebAssets.h)
+struct WebAsset {
+    const char *contentType;
+    const uint8_t *data; // PROGMEM, gzip
+    size_t length;
+    const char *etag;    // Quoted hash of the uncompressed page
+};
+
+// Streams the asset from flash without copying it to RAM, or answers 304
+// when the browser already has this version
+void sendWebAsset(HttpServer &server, const WebAsset &asset);
+
+#endif
@@ -0,0 +1,187 @@
+// Generated by web/build.js from the files in web/. Do not edit.
+#include "WebAssets.h"
+
+static const uint8_t CONFIG_PAGE_DATA[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x54, 0x4d, 0x6f, 0xdb, 0x30,
+    0x0c, 0xbd, 0xe7, 0x57, 0x70, 0x2a, 0x76, 0x9b, 0x63, 0xc7, 0x4b, 0xbb, 0xd5, 0x5f, 0x97, 0x76,
+    0x87, 0x1d, 0x86, 0x15, 0xe8, 0x2e, 0xc3, 0xb0, 0x83, 0x6c, 0xd1, 0xb1, 0x56, 0x59, 0x32, 0x24,
+    0x3a, 0x71, 0x16, 0xf4, 0xbf, 0x17, 0xb2, 0x9d, 0x26, 0x2d, 0x3a, 0x0c, 0x02, 0x6c, 0x89, 0x22,
+    0xdf, 0x23, 0xf9, 0x68, 0x67, 0xef, 0x6e, 0xbf, 0xdf, 0xfc, 0xf8, 0x79, 0xf7, 0x05, 0x1a, 0x6a,
+    0x55, 0xb1, 0xc8, 0x8e, 0x2f, 0xe4, 0xa2, 0x58, 0x64, 0x2d, 0x12, 0x87, 0xaa, 0xe1, 0xd6, 0x21,
+    0xe5, 0xac, 0xa7, 0x3a, 0xf8, 0xcc, 0x8e, 0x66, 0xcd, 0x5b, 0xcc, 0xd9, 0x56, 0xe2, 0xae, 0x33,
+    0x96, 0x18, 0x54, 0x46, 0x13, 0x6a, 0xca, 0xd9, 0x4e, 0x0a, 0x6a, 0x72, 0x81, 0x5b, 0x59, 0x61,
+    0x30, 0x1e, 0x3e, 0x80, 0xd4, 0x92, 0x24, 0x57, 0x81, 0xab, 0xb8, 0xc2, 0x7c, 0xe5, 0x41, 0x48,
+    0x92, 0xc2, 0xe2, 0x9b, 0x21, 0x63, 0xe1, 0xc6, 0x68, 0xb2, 0x46, 0x29, 0x1c, 0xb7, 0xb5, 0xdc,
+    0xf4, 0x96, 0x93, 0x34, 0x3a, 0x0b, 0x27, 0xaf, 0x45, 0xe6, 0x68, 0xef, 0xdf, 0xa5, 0x11, 0x7b,
+    0x38, 0x40, 0x6d, 0x34, 0x05, 0x35, 0x6f, 0xa5, 0xda, 0x27, 0xe0, 0xb8, 0x76, 0x81, 0x43, 0x2b,
+    0xeb, 0x14, 0x5a, 0x6e, 0x37, 0x52, 0x27, 0x10, 0xa5, 0x50, 0xf2, 0xea, 0x61, 0x63, 0x4d, 0xaf,
+    0x45, 0x02, 0x17, 0xf5, 0xda, 0xaf, 0x14, 0x2a, 0xa3, 0x8c, 0x4d, 0xe0, 0x22, 0x8e, 0xe3, 0x14,
+    0x1e, 0x17, 0x4b, 0x9f, 0x34, 0x97, 0x1a, 0x2d, 0x1c, 0xa0, 0xe5, 0xc3, 0x94, 0x6e, 0x02, 0xeb,
+    0x08, 0xdb, 0x33, 0x30, 0xe0, 0x3d, 0x99, 0x14, 0x3a, 0x2e, 0x84, 0xd4, 0x9b, 0x04, 0x56, 0xfe,
+    0xf6, 0x71, 0xb1, 0xb4, 0x66, 0x07, 0x07, 0x10, 0xd2, 0x75, 0x8a, 0xef, 0x13, 0xa8, 0x15, 0x0e,
+    0x29, 0x6c, 0x78, 0x37, 0x7b, 0xf8, 0x73, 0xb0, 0xb3, 0xfe, 0xec, 0x9f, 0xcf, 0x21, 0x05, 0x08,
+    0xb9, 0xf5, 0x55, 0x28, 0x1c, 0x12, 0x58, 0xf9, 0x75, 0x39, 0x21, 0x2a, 0x5e, 0xa2, 0x3a, 0x87,
+    0x2c, 0x95, 0xa9, 0x1e, 0x8e, 0x99, 0x04, 0xa5, 0x21, 0x32, 0x6d, 0x02, 0xcb, 0x78, 0xf6, 0x97,
+    0xba, 0xeb, 0x09, 0x0e, 0x50, 0x9a, 0x21, 0x70, 0xf2, 0xef, 0x98, 0x5c, 0x69, 0xac, 0x40, 0x1b,
+    0x94, 0x66, 0x48, 0x61, 0x2e, 0x67, 0x15, 0x45, 0xef, 0xcf, 0xd2, 0x5f, 0x5e, 0x9e, 0xaa, 0x3b,
+    0x61, 0x7e, 0x1a, 0xad, 0x53, 0x74, 0x02, 0xab, 0x6e, 0x00, 0x67, 0x94, 0x14, 0x70, 0x51, 0x55,
+    0xd5, 0xd1, 0x1e, 0x58, 0x2e, 0x64, 0xef, 0x12, 0x58, 0x77, 0xc3, 0x33, 0xff, 0x2f, 0xda, 0x77,
+    0x98, 0xbb, 0xbe, 0x6c, 0x25, 0xfd, 0x86, 0xc3, 0x91, 0xf4, 0x55, 0xcf, 0x3c, 0x29, 0xac, 0x26,
+    0xea, 0x17, 0xd2, 0x44, 0xd1, 0xd5, 0xb5, 0xb8, 0x3e, 0x49, 0x53, 0xd7, 0xf5, 0x29, 0x8d, 0x28,
+    0x85, 0xaa, 0xb7, 0xce, 0x5f, 0x74, 0x46, 0x6a, 0x42, 0x3b, 0x75, 0x51, 0x6e, 0x1a, 0x5f, 0xf7,
+    0x9f, 0xde, 0x91, 0xac, 0xf7, 0xc1, 0x3c, 0x7b, 0x93, 0x04, 0x01, 0x6a, 0xe1, 0xbd, 0xb2, 0x70,
+    0x1e, 0x9a, 0x2c, 0x9c, 0xc7, 0xd9, 0x4f, 0x4f, 0xb1, 0xc8, 0x7c, 0xf7, 0x2b, 0xc5, 0x9d, 0xcb,
+    0xd9, 0xb3, 0xfe, 0xac, 0x58, 0x00, 0x64, 0x4d, 0xfc, 0xdf, 0x81, 0x6c, 0xe2, 0xd1, 0xb3, 0x36,
+    0xb6, 0x05, 0x5e, 0x79, 0x5b, 0xce, 0x42, 0x87, 0xd4, 0x77, 0x0c, 0x5a, 0xa4, 0xc6, 0x88, 0x9c,
+    0x75, 0xc6, 0xd1, 0x08, 0x08, 0x70, 0x4e, 0x66, 0xcd, 0x6e, 0xb6, 0x4e, 0xf6, 0x22, 0x1b, 0xf5,
+    0x2e, 0xee, 0xef, 0xbf, 0xde, 0x66, 0xe1, 0xb4, 0x9f, 0xaf, 0x01, 0xb2, 0x49, 0xdb, 0xe9, 0x2b,
+    0x73, 0x4e, 0x0a, 0xe6, 0x07, 0x54, 0xa1, 0xde, 0x50, 0x93, 0xb3, 0x8f, 0x31, 0x83, 0x4e, 0xf1,
+    0x0a, 0x1b, 0xa3, 0x04, 0xda, 0x9c, 0x79, 0x8c, 0x13, 0x78, 0xe8, 0xd1, 0xdf, 0x60, 0xba, 0xe3,
+    0xce, 0xed, 0x8c, 0x15, 0xff, 0x62, 0x1b, 0x95, 0x64, 0x84, 0x03, 0xb1, 0x99, 0xb9, 0x9b, 0x23,
+    0x5e, 0xb0, 0x5f, 0xad, 0x5f, 0xb1, 0x1f, 0x71, 0xdf, 0xca, 0xe0, 0x7c, 0xfb, 0xb2, 0x19, 0x30,
+    0xca, 0x78, 0x8a, 0x39, 0xcf, 0x61, 0x1a, 0x27, 0x06, 0x5b, 0xae, 0x7a, 0xcc, 0xd9, 0x3d, 0xdf,
+    0x22, 0x7b, 0x85, 0x97, 0x85, 0x5e, 0x04, 0x2f, 0xef, 0x68, 0xc8, 0xc2, 0x59, 0xde, 0x70, 0xfa,
+    0x87, 0x3d, 0x01, 0xb1, 0x8e, 0xa4, 0x69, 0xdb, 0x04, 0x00, 0x00,
+};
+const WebAsset CONFIG_PAGE = {"text/html", CONFIG_PAGE_DATA, sizeof(CONFIG_PAGE_DATA), "\"a6a5eec9f9e48528\""};
+
+static const uint8_t SETUP_PAGE_DATA[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x65, 0x52, 0x4d, 0x8f, 0xd3, 0x30,
+    0x10, 0xbd, 0xe7, 0x57, 0x0c, 0xae, 0xb8, 0x91, 0x4d, 0x1a, 0xca, 0xc2, 0xe6, 0xa3, 0x97, 0x5d,
+    0x90, 0x38, 0xa0, 0x5d, 0xa9, 0x48, 0x2b, 0x84, 0x38, 0x38, 0xf6, 0xa4, 0xb1, 0x88, 0xed, 0xc8,
+    0x9e, 0xb4, 0x29, 0xd5, 0xfe, 0x77, 0xe4, 0xa4, 0xa5, 0x05, 0xe4, 0xc3, 0xc8, 0x6f, 0x3c, 0x6f,
+    0xfc, 0xde, 0x4c, 0xf9, 0xea, 0xe1, 0xf1, 0xfe, 0xeb, 0xb7, 0xa7, 0x8f, 0xd0, 0x92, 0xee, 0xd6,
+    0x51, 0x79, 0x0e, 0xc8, 0xe5, 0x3a, 0x2a, 0x35, 0x12, 0x07, 0xd1, 0x72, 0xe7, 0x91, 0x2a, 0x36,
+    0x50, 0x13, 0x7f, 0x60, 0x67, 0xd8, 0x70, 0x8d, 0x15, 0xdb, 0x29, 0xdc, 0xf7, 0xd6, 0x11, 0x03,
+    0x61, 0x0d, 0xa1, 0xa1, 0x8a, 0xed, 0x95, 0xa4, 0xb6, 0x92, 0xb8, 0x53, 0x02, 0xe3, 0xe9, 0xf2,
+    0x06, 0x94, 0x51, 0xa4, 0x78, 0x17, 0x7b, 0xc1, 0x3b, 0xac, 0x96, 0x81, 0x84, 0x14, 0x75, 0xb8,
+    0x7e, 0xfe, 0x72, 0x0f, 0xcf, 0xea, 0x93, 0x82, 0x0d, 0xd2, 0xd0, 0x97, 0xc9, 0x8c, 0x46, 0xa5,
+    0xa7, 0x43, 0x88, 0xb5, 0x95, 0x07, 0x38, 0x42, 0x63, 0x0d, 0xc5, 0x0d, 0xd7, 0xaa, 0x3b, 0xe4,
+    0xe0, 0xb9, 0xf1, 0xb1, 0x47, 0xa7, 0x9a, 0x02, 0x34, 0x77, 0x5b, 0x65, 0x72, 0x48, 0x0b, 0xa8,
+    0xb9, 0xf8, 0xb9, 0x75, 0x76, 0x30, 0x32, 0x87, 0x45, 0xb3, 0x0a, 0xa7, 0x00, 0x61, 0x3b, 0xeb,
+    0x72, 0x58, 0x64, 0x59, 0x56, 0xc0, 0x4b, 0xd4, 0x58, 0xa7, 0xe1, 0x08, 0x9a, 0x8f, 0xf3, 0xc7,
+    0x72, 0xc8, 0x52, 0xd4, 0x17, 0x9a, 0x0c, 0x35, 0xf0, 0x81, 0x6c, 0x01, 0x3d, 0x97, 0x52, 0x99,
+    0x6d, 0x0e, 0xcb, 0x90, 0x7f, 0x89, 0x94, 0xe9, 0x07, 0x82, 0x23, 0xd4, 0x76, 0x8c, 0xbd, 0xfa,
+    0x35, 0xa5, 0x6a, 0xeb, 0x24, 0xba, 0xb8, 0xb6, 0x63, 0x01, 0x27, 0xba, 0x65, 0x9a, 0xbe, 0xbe,
+    0x2a, 0xbe, 0x79, 0x77, 0x61, 0x8f, 0x6b, 0x4b, 0x64, 0x75, 0x0e, 0x37, 0xef, 0x27, 0x74, 0xae,
+    0xce, 0x61, 0xd9, 0x8f, 0xe0, 0x6d, 0xa7, 0x24, 0x2c, 0x84, 0x10, 0x67, 0x3c, 0x76, 0x5c, 0xaa,
+    0xc1, 0xe7, 0xb0, 0xea, 0xc7, 0x3f, 0xfd, 0xbf, 0xd3, 0xa1, 0xc7, 0xca, 0x0f, 0xb5, 0x56, 0xf4,
+    0x23, 0x7c, 0xe6, 0x5a, 0x72, 0x9a, 0xde, 0xde, 0xc9, 0xbb, 0x8b, 0xe4, 0xa6, 0x69, 0x2e, 0x4d,
+    0xd2, 0x02, 0xc4, 0xe0, 0x7c, 0x48, 0xf4, 0x56, 0x19, 0x42, 0x17, 0x48, 0xcb, 0xe4, 0x64, 0x73,
+    0x99, 0x9c, 0x06, 0x1e, 0xfc, 0x5e, 0x47, 0xe5, 0xe4, 0x13, 0x17, 0xa4, 0xac, 0xa9, 0x58, 0xe2,
+    0xc3, 0x68, 0x18, 0x68, 0xa4, 0xd6, 0xca, 0x8a, 0xf5, 0xd6, 0x13, 0x5b, 0x47, 0x00, 0x65, 0x9b,
+    0xad, 0xaf, 0x67, 0xd7, 0x66, 0x13, 0x3a, 0x5b, 0x35, 0xaf, 0x87, 0xf7, 0x4a, 0xb2, 0xe0, 0x77,
+    0x87, 0x66, 0x4b, 0x6d, 0xc5, 0xde, 0x66, 0x0c, 0xfa, 0x8e, 0x0b, 0x6c, 0x6d, 0x27, 0xd1, 0x55,
+    0x6c, 0xb3, 0xf9, 0xfc, 0xc0, 0xae, 0xea, 0x26, 0x89, 0x8c, 0x70, 0x24, 0x76, 0xe2, 0xe8, 0xb9,
+    0xf7, 0x7b, 0xeb, 0xfe, 0xe6, 0xb9, 0x5d, 0xfd, 0xc3, 0xf3, 0x74, 0x7e, 0xf5, 0x1f, 0xd7, 0xec,
+    0x17, 0x83, 0x1d, 0xef, 0x06, 0xac, 0xd8, 0x86, 0xef, 0x30, 0xec, 0x5f, 0x12, 0x44, 0x86, 0x78,
+    0xd2, 0x9c, 0xcc, 0xab, 0xff, 0x1b, 0x9e, 0x53, 0x63, 0x90, 0x12, 0x03, 0x00, 0x00,
+};
+const WebAsset SETUP_PAGE = {"text/html", SETUP_PAGE_DATA, sizeof(SETUP_PAGE_DATA), "\"272c7c43bc8e26ab\""};
+
+static const uint8_t DASHBOARD_PAGE_DATA[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x57, 0xeb, 0x8e, 0xe3, 0xb6,
+    0x15, 0xfe, 0xaf, 0xa7, 0x38, 0xd5, 0xa2, 0x90, 0x94, 0xd8, 0xb2, 0xec, 0xcd, 0x6c, 0x33, 0xb2,
+    0xe5, 0x20, 0xd9, 0x0b, 0x9a, 0xa2, 0xdb, 0x1d, 0x74, 0x06, 0x08, 0x8a, 0xc1, 0xfc, 0xa0, 0xa5,
+    0x23, 0x89, 0xb1, 0x44, 0xaa, 0x24, 0x3d, 0xb6, 0x63, 0xcc, 0x3b, 0xe5, 0x19, 0xfa, 0x64, 0x05,
+    0x2f, 0xb2, 0x65, 0xcf, 0xec, 0x0e, 0x0c, 0xc8, 0xe2, 0xe1, 0x77, 0x3e, 0xf2, 0x5c, 0x78, 0x0e,
+    0xb5, 0xf8, 0xcb, 0x87, 0x2f, 0xef, 0xef, 0xfe, 0x73, 0xf3, 0x11, 0x6a, 0xd5, 0x36, 0x4b, 0x6f,
+    0xd1, 0xff, 0x21, 0x29, 0x96, 0xde, 0xa2, 0x45, 0x45, 0x20, 0xaf, 0x89, 0x90, 0xa8, 0x32, 0x7f,
+    0xa3, 0xca, 0xf1, 0x8f, 0x7e, 0x2f, 0x66, 0xa4, 0xc5, 0xcc, 0x7f, 0xa4, 0xb8, 0xed, 0xb8, 0x50,
+    0x3e, 0xe4, 0x9c, 0x29, 0x64, 0x2a, 0xf3, 0xb7, 0xb4, 0x50, 0x75, 0x56, 0xe0, 0x23, 0xcd, 0x71,
+    0x6c, 0x06, 0x23, 0xa0, 0x8c, 0x2a, 0x4a, 0x9a, 0xb1, 0xcc, 0x49, 0x83, 0xd9, 0x54, 0x93, 0x28,
+    0xaa, 0x1a, 0x5c, 0x7e, 0xe6, 0x8a, 0x0b, 0xf8, 0x40, 0x64, 0xbd, 0xe2, 0x44, 0x14, 0x8b, 0x89,
+    0x15, 0x7b, 0x0b, 0xa9, 0xf6, 0xfa, 0x7f, 0xc5, 0x8b, 0x3d, 0x1c, 0xa0, 0xe4, 0x4c, 0x8d, 0x4b,
+    0xd2, 0xd2, 0x66, 0x9f, 0x82, 0x24, 0x4c, 0x8e, 0x25, 0x0a, 0x5a, 0xce, 0xa1, 0x25, 0xa2, 0xa2,
+    0x2c, 0x85, 0x64, 0x0e, 0x2b, 0x92, 0xaf, 0x2b, 0xc1, 0x37, 0xac, 0x48, 0xe1, 0x4d, 0xf9, 0x83,
+    0xfe, 0xcd, 0x21, 0xe7, 0x0d, 0x17, 0x29, 0xbc, 0x99, 0xcd, 0x66, 0x73, 0x78, 0xf2, 0xb4, 0x5d,
+    0x28, 0xe0, 0x70, 0x0e, 0x4e, 0x92, 0x77, 0xd7, 0xc5, 0xf5, 0x09, 0x5c, 0x96, 0xe5, 0x1c, 0x3a,
+    0x52, 0x14, 0x94, 0x55, 0x29, 0xc4, 0x57, 0xd8, 0xc2, 0x14, 0xdb, 0x39, 0x14, 0x54, 0x76, 0x0d,
+    0xd9, 0xa7, 0x50, 0x36, 0xb8, 0x9b, 0xc3, 0xef, 0x1b, 0xa9, 0x68, 0xb9, 0x1f, 0x3b, 0xcb, 0x53,
+    0x90, 0x1d, 0xc9, 0x71, 0xbc, 0x42, 0xb5, 0x45, 0x64, 0x73, 0x20, 0x0d, 0xad, 0xd8, 0x98, 0x2a,
+    0x6c, 0x65, 0x0a, 0x39, 0x32, 0x85, 0xc2, 0xec, 0x61, 0x06, 0x87, 0xe1, 0xbe, 0x9f, 0xbc, 0x58,
+    0x33, 0x10, 0xca, 0xcc, 0xce, 0x8e, 0xeb, 0x9a, 0x25, 0x9f, 0xbc, 0x58, 0xf0, 0x2d, 0x1c, 0x2e,
+    0xd7, 0xae, 0x48, 0xe7, 0x10, 0x7a, 0x3c, 0xde, 0x0a, 0x3d, 0xd6, 0xcf, 0xde, 0x25, 0xe3, 0x15,
+    0x57, 0x8a, 0xb7, 0xe7, 0x34, 0x4b, 0x28, 0xe8, 0xa3, 0x76, 0x67, 0x83, 0xbb, 0x14, 0xa6, 0xfa,
+    0x97, 0xb8, 0xe9, 0x47, 0xd2, 0x6c, 0xb0, 0xf7, 0xb4, 0xa4, 0x7f, 0x60, 0x0a, 0x53, 0x6d, 0xb9,
+    0x9e, 0xcc, 0x09, 0x7b, 0x24, 0x12, 0x0e, 0x60, 0xa2, 0x99, 0xc2, 0x34, 0x49, 0xfe, 0x3a, 0x87,
+    0x1a, 0x69, 0x55, 0xab, 0x14, 0xde, 0x26, 0x49, 0xb7, 0xbb, 0x74, 0xbf, 0xf6, 0xe0, 0x8a, 0x8b,
+    0x02, 0x45, 0x0a, 0xd3, 0x6e, 0x07, 0x92, 0x37, 0xb4, 0x80, 0x37, 0x79, 0x9e, 0x6b, 0x42, 0xca,
+    0xba, 0x8d, 0xba, 0x57, 0xfb, 0x0e, 0x33, 0x41, 0x58, 0x85, 0x0f, 0x97, 0xdc, 0x4f, 0x5e, 0x4c,
+    0x72, 0xb5, 0x21, 0x0d, 0x1c, 0xfa, 0xa8, 0x88, 0x6a, 0x15, 0xfe, 0xed, 0x6a, 0x04, 0xd3, 0xeb,
+    0x99, 0x79, 0x44, 0x06, 0xa5, 0x88, 0xa8, 0x50, 0x9d, 0xa3, 0x66, 0x57, 0x57, 0x23, 0xb8, 0xbe,
+    0x1e, 0xc1, 0xf4, 0xad, 0x45, 0x2d, 0x26, 0x2e, 0x9b, 0x16, 0x13, 0x97, 0xd8, 0x3a, 0xad, 0x5c,
+    0x9a, 0xa3, 0x58, 0x2e, 0xea, 0xd9, 0xf3, 0x44, 0xac, 0x67, 0xcb, 0x85, 0xec, 0x08, 0x03, 0x5a,
+    0x64, 0xbe, 0x54, 0x44, 0xa1, 0xbf, 0xcc, 0x39, 0x63, 0x98, 0x2b, 0xca, 0xaa, 0xc5, 0x44, 0xcf,
+    0x2d, 0x2d, 0x21, 0x8a, 0xa5, 0xb7, 0xd0, 0x9e, 0xcd, 0x1b, 0x22, 0x65, 0xe6, 0x1f, 0xc3, 0xe9,
+    0x2f, 0x3d, 0x80, 0xe1, 0x8c, 0xe0, 0x5b, 0x23, 0xb3, 0xd2, 0xe5, 0x6d, 0x87, 0x58, 0x0c, 0xe7,
+    0x6d, 0x14, 0xac, 0xe9, 0xfe, 0x70, 0x7d, 0x0d, 0xf4, 0x97, 0x63, 0xb7, 0x2c, 0xfc, 0xfb, 0xe6,
+    0xf3, 0x62, 0xa2, 0x19, 0xec, 0xf3, 0xc4, 0x78, 0x67, 0xfc, 0xf1, 0x9c, 0xd2, 0xfa, 0x69, 0x48,
+    0xd9, 0x4b, 0x5e, 0xe7, 0xbc, 0xe1, 0x92, 0x2a, 0xca, 0xd9, 0x33, 0xd6, 0x21, 0x5d, 0xe7, 0x40,
+    0x27, 0xc2, 0xaf, 0x90, 0xfd, 0xfa, 0x01, 0xf8, 0x46, 0x75, 0x1b, 0xf5, 0x4d, 0x3a, 0x0b, 0x79,
+    0x8d, 0xec, 0x0e, 0xdb, 0x0e, 0x05, 0x51, 0x1b, 0x81, 0xdf, 0x64, 0x53, 0x27, 0xdc, 0xc0, 0xe0,
+    0xff, 0xfd, 0xf9, 0xfe, 0x82, 0xf6, 0xf4, 0xe2, 0x52, 0x5e, 0x2b, 0xeb, 0xfa, 0xa7, 0x3d, 0x37,
+    0xb1, 0xb2, 0x57, 0x42, 0xba, 0x68, 0xc8, 0x0a, 0x1b, 0x1b, 0x59, 0xb8, 0x08, 0xe0, 0xd8, 0x6d,
+    0x2c, 0x39, 0x73, 0xb9, 0x55, 0x30, 0x0c, 0x00, 0x0b, 0x73, 0x34, 0xc0, 0x1c, 0x0d, 0xdf, 0x9c,
+    0x0d, 0x7f, 0xa0, 0x2f, 0x1b, 0x5a, 0xa0, 0xf0, 0xa1, 0xa5, 0x2c, 0xf3, 0xc7, 0x6f, 0xaf, 0x92,
+    0xc4, 0x87, 0x96, 0xec, 0x32, 0xdf, 0xbe, 0x1a, 0xfa, 0xcc, 0x4f, 0x7c, 0x90, 0x0a, 0xbb, 0xcc,
+    0x9f, 0x26, 0xfd, 0xce, 0x2e, 0xfc, 0xb6, 0x58, 0x6d, 0x94, 0xe2, 0x76, 0x67, 0xa5, 0x40, 0xf4,
+    0x97, 0x9f, 0x04, 0xe2, 0x62, 0x62, 0xc5, 0xcf, 0xfc, 0xd1, 0xff, 0xc9, 0x5c, 0xd0, 0x4e, 0x2d,
+    0xbd, 0xc9, 0x04, 0x3e, 0x09, 0xd2, 0xa2, 0x84, 0x9c, 0x08, 0xb1, 0x07, 0xce, 0x9a, 0x3d, 0xa8,
+    0x1a, 0xa1, 0xa4, 0xd8, 0x14, 0x12, 0x54, 0x4d, 0x94, 0x6e, 0x1b, 0xac, 0xc2, 0x62, 0x04, 0x92,
+    0xc3, 0x1a, 0xb1, 0x33, 0x80, 0x86, 0x48, 0x05, 0xbc, 0x04, 0x24, 0x79, 0xed, 0xe5, 0x9c, 0x49,
+    0x05, 0xb7, 0x3f, 0x7f, 0xbe, 0xf9, 0xe7, 0xc7, 0x5b, 0xc8, 0x74, 0x21, 0x71, 0x32, 0xc7, 0x93,
+    0xc1, 0x01, 0x8c, 0xe1, 0x29, 0x24, 0x23, 0x97, 0xc2, 0xe6, 0xb5, 0x4f, 0x36, 0x33, 0xb0, 0xa9,
+    0x62, 0x21, 0xa7, 0x38, 0xa7, 0x90, 0xe8, 0xca, 0x65, 0xe8, 0x6a, 0x2a, 0x15, 0x17, 0x7b, 0xc8,
+    0xe0, 0xfe, 0xc1, 0x89, 0x4c, 0x50, 0x21, 0x83, 0x82, 0xe7, 0x9b, 0x16, 0x99, 0x8a, 0x2b, 0x54,
+    0x1f, 0x1b, 0xd4, 0xaf, 0xbf, 0xec, 0x7f, 0x2d, 0xc2, 0xc0, 0x00, 0x82, 0xc8, 0xc1, 0xcd, 0xf9,
+    0xff, 0x16, 0xdc, 0x00, 0x82, 0xc8, 0xf3, 0xca, 0x0d, 0xcb, 0xf5, 0xd6, 0xa0, 0x10, 0x64, 0x0b,
+    0x61, 0x04, 0x07, 0x0f, 0xc0, 0x92, 0x98, 0x0a, 0x07, 0x99, 0x5d, 0x3b, 0x3e, 0x1f, 0xe5, 0x0d,
+    0x45, 0xa6, 0x7e, 0xd3, 0xb2, 0x23, 0xde, 0x16, 0xd8, 0x23, 0xe4, 0x62, 0x68, 0x35, 0xfe, 0x6e,
+    0x84, 0x47, 0x15, 0xd3, 0x8a, 0x76, 0x27, 0x50, 0x85, 0xea, 0xbd, 0x15, 0x85, 0xc1, 0xac, 0x08,
+    0x22, 0x0f, 0xa0, 0x41, 0x05, 0x0d, 0xdf, 0x42, 0x06, 0x89, 0x1b, 0xd5, 0xb4, 0xd2, 0x1b, 0x99,
+    0x26, 0x5a, 0x50, 0x72, 0x01, 0xa1, 0x25, 0xeb, 0x38, 0x65, 0x26, 0x5a, 0xce, 0x7f, 0xd6, 0x16,
+    0x70, 0xda, 0x9f, 0x89, 0xaa, 0xe3, 0x96, 0xb2, 0xb0, 0xe1, 0xdb, 0x91, 0xc5, 0xc6, 0x26, 0x58,
+    0xfd, 0xc0, 0xc6, 0x2b, 0x32, 0x2a, 0x6e, 0x09, 0xab, 0x43, 0x76, 0xa1, 0x1e, 0xbf, 0xa2, 0xf4,
+    0x74, 0x34, 0x4a, 0x07, 0x2e, 0x34, 0xb9, 0x1d, 0x41, 0xb6, 0xec, 0xdd, 0x32, 0x86, 0x69, 0x02,
+    0x63, 0x37, 0x01, 0x63, 0xbd, 0xab, 0x08, 0x26, 0x60, 0xa8, 0xfb, 0xe1, 0x77, 0x10, 0x1e, 0xd1,
+    0xb3, 0x24, 0xb2, 0x8c, 0xda, 0x1b, 0xb1, 0x54, 0x82, 0xaf, 0xf1, 0x56, 0xb7, 0x05, 0xc8, 0x20,
+    0x78, 0x53, 0x14, 0x45, 0x30, 0x98, 0x5e, 0x61, 0x45, 0xd9, 0x0d, 0x51, 0x75, 0x38, 0x54, 0x6a,
+    0xf9, 0x23, 0xde, 0xf1, 0x30, 0x19, 0xc1, 0x3e, 0x4c, 0xa2, 0xe1, 0x4c, 0x43, 0x99, 0x9e, 0x71,
+    0xb7, 0x9d, 0xcb, 0x59, 0xbb, 0x98, 0xa1, 0x1a, 0xb8, 0xf7, 0x7e, 0x8d, 0xfb, 0x91, 0xe9, 0x5b,
+    0x1b, 0xf1, 0xa0, 0xdd, 0x7c, 0x7f, 0x1f, 0x58, 0xf3, 0x83, 0x11, 0x04, 0xcf, 0x1a, 0x59, 0xf0,
+    0x30, 0x82, 0xfb, 0xc0, 0x38, 0xab, 0x9f, 0x3f, 0x6b, 0x87, 0xc1, 0xc3, 0x43, 0x1f, 0xa0, 0x97,
+    0x8d, 0xb4, 0x2b, 0x9d, 0x01, 0xce, 0xcd, 0x84, 0x3e, 0xd0, 0x71, 0xc9, 0xc5, 0x47, 0x92, 0xd7,
+    0x61, 0x68, 0x82, 0x32, 0x02, 0x6a, 0x1c, 0x7f, 0x70, 0x35, 0xca, 0x6e, 0x7f, 0x07, 0x19, 0x50,
+    0xf8, 0xce, 0x65, 0xf5, 0x04, 0xc2, 0xfe, 0x20, 0x8f, 0x61, 0x1a, 0x39, 0x24, 0x2d, 0x21, 0xa4,
+    0x90, 0x65, 0x19, 0x24, 0xd1, 0xa5, 0x17, 0x77, 0xda, 0x4f, 0x86, 0x5f, 0x3b, 0xe2, 0x21, 0xea,
+    0x75, 0xb0, 0x91, 0x78, 0xe9, 0xd7, 0x97, 0xb1, 0x4f, 0xd1, 0x0b, 0xd6, 0x86, 0x83, 0xdc, 0x31,
+    0xe2, 0x92, 0x36, 0xcd, 0x29, 0xce, 0xef, 0xde, 0xbd, 0x0b, 0x2e, 0x26, 0xef, 0xf4, 0xe9, 0xd0,
+    0x59, 0x13, 0x2b, 0xfe, 0x89, 0xee, 0xb0, 0x08, 0x93, 0x68, 0x04, 0x3f, 0x8c, 0x60, 0x3a, 0x8b,
+    0x5e, 0x82, 0x36, 0x7c, 0x7b, 0x89, 0x3c, 0x25, 0x59, 0xe4, 0x3d, 0x0d, 0x6a, 0x80, 0xbb, 0x2f,
+    0x9c, 0x97, 0x01, 0xc9, 0xf3, 0x35, 0xea, 0x23, 0xca, 0x70, 0x0b, 0xbf, 0xe1, 0xea, 0xd6, 0x8c,
+    0xc3, 0x60, 0x2b, 0xd3, 0xc9, 0x24, 0x80, 0xef, 0xa1, 0xe1, 0x39, 0xd1, 0xea, 0x71, 0xcd, 0xa5,
+    0xd2, 0xd7, 0x6c, 0xf8, 0x1e, 0x82, 0xf4, 0xc7, 0xe9, 0xc4, 0x9c, 0x5f, 0xab, 0x1e, 0x73, 0xc6,
+    0x3b, 0x64, 0xfa, 0x64, 0xd8, 0xd8, 0xd8, 0x12, 0x15, 0xeb, 0xad, 0xbe, 0xb7, 0xf7, 0x51, 0x6d,
+    0x6f, 0x43, 0x1f, 0x31, 0x30, 0xee, 0x38, 0xaa, 0xe5, 0x0d, 0x97, 0x78, 0xd2, 0x33, 0x2e, 0x7c,
+    0x51, 0x57, 0xe0, 0xe9, 0xba, 0x13, 0x58, 0x18, 0xaa, 0x3b, 0xda, 0x22, 0xdf, 0xa8, 0xd0, 0x4d,
+    0x8d, 0x74, 0xd5, 0x48, 0x7a, 0x97, 0x1f, 0xd7, 0x68, 0x51, 0x4a, 0x52, 0x99, 0x55, 0xf0, 0x11,
+    0x99, 0x1a, 0x2c, 0xf5, 0x65, 0xf5, 0x3b, 0xe6, 0x2a, 0x26, 0x52, 0xd2, 0x8a, 0x85, 0xb6, 0xd0,
+    0x8f, 0xe0, 0x1f, 0xb7, 0x5f, 0xfe, 0x15, 0x77, 0xfa, 0x3b, 0xc3, 0x2a, 0xc4, 0x05, 0x51, 0xc4,
+    0x85, 0x79, 0x70, 0x64, 0xd6, 0xb8, 0xd7, 0x07, 0xc5, 0x71, 0xac, 0x71, 0x2f, 0x1d, 0x43, 0x14,
+    0x1d, 0xb3, 0xf3, 0x6b, 0x25, 0x7a, 0x8d, 0xfb, 0xe8, 0xc2, 0x44, 0x4d, 0xa7, 0x93, 0x33, 0xe8,
+    0xfb, 0x49, 0x00, 0x3f, 0xb9, 0xde, 0x63, 0xf2, 0x0c, 0xd2, 0xe1, 0xe8, 0x18, 0x74, 0x97, 0xde,
+    0x4f, 0x67, 0x47, 0xa6, 0xdb, 0xc8, 0x3a, 0x3c, 0xb6, 0x2b, 0xab, 0xd6, 0x97, 0xb6, 0xbe, 0x73,
+    0x39, 0xa9, 0xbb, 0xb3, 0xba, 0xf4, 0xd5, 0x67, 0xa4, 0x27, 0x69, 0x90, 0x55, 0xaa, 0x86, 0x65,
+    0xdf, 0x14, 0xa3, 0x23, 0xbd, 0xac, 0x69, 0xa9, 0x5c, 0x6e, 0x0f, 0x33, 0x8c, 0x30, 0xda, 0xea,
+    0xd6, 0xe4, 0x32, 0x4c, 0x37, 0x1d, 0x83, 0x12, 0xf8, 0xdf, 0x0d, 0x4a, 0xf5, 0xb3, 0x99, 0xa6,
+    0x9c, 0x99, 0x7e, 0x1d, 0x3a, 0xb4, 0x49, 0x52, 0x97, 0x8c, 0xe6, 0x46, 0xf1, 0xcd, 0xce, 0x36,
+    0xb8, 0x79, 0x04, 0x91, 0x67, 0x5f, 0x62, 0xce, 0xec, 0x45, 0xe5, 0x94, 0x7f, 0xaf, 0x10, 0x98,
+    0x32, 0x1d, 0x5c, 0x46, 0xc0, 0xb1, 0xd9, 0x1a, 0xfe, 0x74, 0x22, 0xb7, 0x97, 0x87, 0x23, 0x7b,
+    0x89, 0x2a, 0xaf, 0xc3, 0x60, 0x62, 0xa8, 0x7e, 0xb2, 0xd7, 0x1c, 0x7d, 0x52, 0x86, 0xea, 0x91,
+    0xf7, 0xd5, 0x1d, 0xe8, 0x2b, 0x4e, 0x10, 0x99, 0xdc, 0xa7, 0xf9, 0xfa, 0x2c, 0xf7, 0xcf, 0x36,
+    0x60, 0x5b, 0xe2, 0xb9, 0x85, 0xb6, 0x6a, 0xbb, 0xf5, 0x2d, 0x91, 0xf3, 0x9e, 0xce, 0xff, 0x30,
+    0xf2, 0x9c, 0x4f, 0xc3, 0x48, 0x7f, 0x66, 0xb8, 0x0b, 0xd2, 0x62, 0xe2, 0x3e, 0x30, 0x26, 0xf6,
+    0x7b, 0xfa, 0xff, 0xda, 0x0b, 0x61, 0x89, 0x67, 0x0f, 0x00, 0x00,
+};
+const WebAsset DASHBOARD_PAGE = {"text/html", DASHBOARD_PAGE_DATA, sizeof(DASHBOARD_PAGE_DATA), "\"5ef26e8630cb4beb\""};
@@ -0,0 +1,11 @@
+// Generated by web/build.js from the files in web/. Do not edit.
+#ifndef WebAssets_h
+#define WebAssets_h
+
+#include "WebAsset.h"
+
+extern const WebAsset CONFIG_PAGE; // config.html, 1243 bytes, 635 gzipped
+extern const WebAsset SETUP_PAGE; // setup.html, 786 bytes, 478 gzipped
+extern const WebAsset DASHBOARD_PAGE; // dashboard.html, 3943 bytes, 1643 gzipped
+
+#endif
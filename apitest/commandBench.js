@@ -0,0 +1,62 @@
+const axios = require('axios')
+const { CommandClient, speed, setKp, setKi, setKd, setKf, free } = require('./commandClient')
+const { createStandIn } = require('./commandStandIn')
+
+// Round-trip latency of HTTP /speed against the binary UDP command channel.
+// Without an address a local stand-in is started, which measures the
+// protocols and the 5ms control step but not the ESP8266's web server.
+//
+//   node commandBench.js [motor-ip] [count]
+
+function summarise (name, samples) {
+  const sorted = samples.slice().sort((a, b) => a - b)
+  const at = (q) => sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))]
+  const mean = sorted.reduce((a, b) => a + b, 0) / sorted.length
+  console.log(`${name.padEnd(22)} n=${sorted.length} mean=${mean.toFixed(2)}ms p50=${at(0.5).toFixed(2)}ms ` +
+    `p99=${at(0.99).toFixed(2)}ms max=${sorted[sorted.length - 1].toFixed(2)}ms`)
+}
+
+async function time (fn) {
+  const start = process.hrtime.bigint()
+  await fn()
+  return Number(process.hrtime.bigint() - start) / 1e6
+}
+
+async function bench (address, count, httpPort) {
+  const client = new CommandClient(address)
+  const http = []
+  const single = []
+  const batch = []
+  let retries = 0
+
+  for (let i = 0; i < count; i++) {
+    const rpm = (i % 2 ? 1 : -1) * 500
+    http.push(await time(() => axios.get(`http://${address}:${httpPort}/speed?value=${rpm}`)))
+    single.push(await time(async () => {
+      const ack = await client.send([speed(rpm)])
+      retries += ack.attempts - 1
+    }))
+    // The /setpid plus /speed sequence that takes two HTTP requests
+    batch.push(await time(() => client.send([setKp(2), setKi(0.1), setKd(0.1), setKf(1), speed(rpm)])))
+  }
+  await client.send([free()])
+  client.close()
+
+  summarise('HTTP /speed', http)
+  summarise('UDP, 1 command', single)
+  summarise('UDP, 5 commands', batch)
+  console.log(`UDP retransmissions: ${retries}`)
+}
+
+if (require.main === module) {
+  const [address, count] = process.argv.slice(2)
+  const samples = Number(count) || 200
+  if (address) {
+    bench(address, samples, 80).catch((error) => console.error(error.message))
+  } else {
+    const standIn = createStandIn({ httpPort: 8080 })
+    bench('127.0.0.1', samples, 8080)
+      .catch((error) => console.error(error.message))
+      .finally(() => standIn.close())
+  }
+}
@@ -0,0 +1,194 @@
+const dgram = require('dgram')
+
+// Client for the binary UDP command channel (see CommandChannel.h)
+//
+//   const client = new CommandClient('192.168.1.121')
+//   await client.send([speed(1200)])
+//   await client.send([setKp(2), setKi(0.5), speed(-800)]) // One frame, one ack
+
+const COMMAND_PORT = 5602
+const VERSION = 1
+const HEADER_SIZE = 8
+const COMMAND_SIZE = 8
+const ACK_SIZE = 24
+const MAX_COMMANDS = 8
+
+const Opcode = {
+  NOP: 0,
+  SPEED: 1,
+  FREE: 2,
+  BRAKE: 3,
+  RELEASE: 4,
+  HOLD: 5,
+  MOVE_TO: 6,
+  MOVE_BY: 7,
+  SET_KP: 8,
+  SET_KI: 9,
+  SET_KD: 10,
+  SET_KF: 11
+}
+
+const Result = ['ok', 'duplicate', 'stale', 'badFrame', 'badCommand']
+
+const INTEGER_OPCODES = [Opcode.MOVE_TO, Opcode.MOVE_BY]
+
+const speed = (rpm) => ({ opcode: Opcode.SPEED, value: rpm })
+const free = () => ({ opcode: Opcode.FREE, value: 0 })
+const brake = () => ({ opcode: Opcode.BRAKE, value: 0 })
+const release = () => ({ opcode: Opcode.RELEASE, value: 0 })
+const hold = () => ({ opcode: Opcode.HOLD, value: 0 })
+const moveTo = (ticks) => ({ opcode: Opcode.MOVE_TO, value: ticks })
+const moveBy = (ticks) => ({ opcode: Opcode.MOVE_BY, value: ticks })
+const setKp = (kp) => ({ opcode: Opcode.SET_KP, value: kp })
+const setKi = (ki) => ({ opcode: Opcode.SET_KI, value: ki })
+const setKd = (kd) => ({ opcode: Opcode.SET_KD, value: kd })
+const setKf = (kf) => ({ opcode: Opcode.SET_KF, value: kf })
+
+function encodeFrame (sequence, commands) {
+  const frame = Buffer.alloc(HEADER_SIZE + commands.length * COMMAND_SIZE)
+  frame.write('WC', 0, 'ascii')
+  frame.writeUInt8(VERSION, 2)
+  frame.writeUInt8(commands.length, 3)
+  frame.writeUInt32LE(sequence >>> 0, 4)
+  commands.forEach((command, i) => {
+    const offset = HEADER_SIZE + i * COMMAND_SIZE
+    frame.writeUInt8(command.opcode, offset)
+    if (INTEGER_OPCODES.includes(command.opcode)) {
+      frame.writeInt32LE(command.value, offset + 4)
+    } else {
+      frame.writeFloatLE(command.value, offset + 4)
+    }
+  })
+  return frame
+}
+
+function decodeFrame (buffer) {
+  if (buffer.length < HEADER_SIZE || buffer[0] !== 0x57 || buffer[1] !== 0x43) {
+    return null
+  }
+  const count = buffer.readUInt8(3)
+  if (buffer.readUInt8(2) !== VERSION || count === 0 || count > MAX_COMMANDS ||
+      buffer.length < HEADER_SIZE + count * COMMAND_SIZE) {
+    return null
+  }
+  const commands = []
+  for (let i = 0; i < count; i++) {
+    const offset = HEADER_SIZE + i * COMMAND_SIZE
+    const opcode = buffer.readUInt8(offset)
+    const value = INTEGER_OPCODES.includes(opcode) ? buffer.readInt32LE(offset + 4) : buffer.readFloatLE(offset + 4)
+    commands.push({ opcode, value })
+  }
+  return { sequence: buffer.readUInt32LE(4), commands }
+}
+
+function encodeAck (result, sequence, applied, timestampMicros, speedRPM, targetRPM) {
+  const ack = Buffer.alloc(ACK_SIZE)
+  ack.write('WA', 0, 'ascii')
+  ack.writeUInt8(VERSION, 2)
+  ack.writeUInt8(result, 3)
+  ack.writeUInt32LE(sequence >>> 0, 4)
+  ack.writeUInt8(applied, 8)
+  ack.writeUInt32LE(timestampMicros >>> 0, 12)
+  ack.writeFloatLE(speedRPM, 16)
+  ack.writeFloatLE(targetRPM, 20)
+  return ack
+}
+
+function decodeAck (buffer) {
+  if (buffer.length < ACK_SIZE || buffer[0] !== 0x57 || buffer[1] !== 0x41 || buffer.readUInt8(2) !== VERSION) {
+    return null
+  }
+  return {
+    result: Result[buffer.readUInt8(3)] || 'unknown',
+    sequence: buffer.readUInt32LE(4),
+    applied: buffer.readUInt8(8),
+    timestampMicros: buffer.readUInt32LE(12),
+    speedRPM: buffer.readFloatLE(16),
+    targetRPM: buffer.readFloatLE(20)
+  }
+}
+
+// One frame in flight at a time. A frame is resent with the same sequence
+// number until its ack arrives, so a lost ack never applies commands twice.
+class CommandClient {
+  constructor (address, { port = COMMAND_PORT, timeoutMs = 20, retries = 5 } = {}) {
+    this.address = address
+    this.port = port
+    this.timeoutMs = timeoutMs
+    this.retries = retries
+    this.sequence = Math.floor(Math.random() * 0x10000) // Any start point, increasing from there
+    this.pending = null
+    this.socket = dgram.createSocket('udp4')
+    this.socket.on('message', (message) => this.onMessage(message))
+  }
+
+  send (commands) {
+    if (commands.length === 0 || commands.length > MAX_COMMANDS) {
+      return Promise.reject(new Error(`A frame carries 1 to ${MAX_COMMANDS} commands`))
+    }
+    if (this.pending) {
+      return Promise.reject(new Error('A frame is already waiting for its ack'))
+    }
+    this.sequence = (this.sequence + 1) >>> 0
+    const frame = encodeFrame(this.sequence, commands)
+    return new Promise((resolve, reject) => {
+      this.pending = { sequence: this.sequence, frame, resolve, reject, attempts: 0, timer: null }
+      this.transmit()
+    })
+  }
+
+  transmit () {
+    const pending = this.pending
+    if (pending.attempts > this.retries) {
+      this.pending = null
+      pending.reject(new Error(`No ack for frame ${pending.sequence}`))
+      return
+    }
+    pending.attempts++
+    this.socket.send(pending.frame, this.port, this.address)
+    pending.timer = setTimeout(() => this.transmit(), this.timeoutMs)
+  }
+
+  onMessage (message) {
+    const ack = decodeAck(message)
+    const pending = this.pending
+    if (!ack || !pending || ack.sequence !== pending.sequence) {
+      return // Late ack for a frame already retried or given up on
+    }
+    clearTimeout(pending.timer)
+    this.pending = null
+    ack.attempts = pending.attempts
+    pending.resolve(ack)
+  }
+
+  close () {
+    if (this.pending) {
+      clearTimeout(this.pending.timer)
+      this.pending.reject(new Error('Client closed'))
+      this.pending = null
+    }
+    this.socket.close()
+  }
+}
+
+module.exports = {
+  COMMAND_PORT,
+  Opcode,
+  Result,
+  CommandClient,
+  encodeFrame,
+  decodeFrame,
+  encodeAck,
+  decodeAck,
+  speed,
+  free,
+  brake,
+  release,
+  hold,
+  moveTo,
+  moveBy,
+  setKp,
+  setKi,
+  setKd,
+  setKf
+}
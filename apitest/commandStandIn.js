@@ -0,0 +1,117 @@
+const dgram = require('dgram')
+const express = require('express')
+const { COMMAND_PORT, Opcode, decodeFrame, encodeAck } = require('./commandClient')
+
+// Local stand-in for the controller's command paths, for trying clients and
+// benchmarking without hardware. Like the firmware, UDP frames are picked up
+// at the start of each 5ms control step and acked straight away, with the
+// same duplicate and stale handling; HTTP commands answer with a status JSON.
+//
+//   node commandStandIn.js [udpPort] [httpPort]
+
+const CONTROL_PERIOD_MS = 5
+const MAX_FRAMES_PER_POLL = 4
+
+function createStandIn ({ udpPort = COMMAND_PORT, httpPort = 8080 } = {}) {
+  const state = { targetRPM: 0, speedRPM: 0, kp: 2, ki: 0.1, kd: 0.1, kf: 0 }
+  const clients = new Map() // "address:port" -> { sequence, ack }
+  const queue = []
+  const started = process.hrtime.bigint()
+  const micros = () => Number((process.hrtime.bigint() - started) / 1000n) >>> 0
+
+  function apply ({ opcode, value }) {
+    switch (opcode) {
+      case Opcode.NOP: case Opcode.HOLD: case Opcode.MOVE_TO: case Opcode.MOVE_BY: case Opcode.RELEASE: break
+      case Opcode.SPEED: state.targetRPM = value; break
+      case Opcode.FREE: case Opcode.BRAKE: state.targetRPM = 0; break
+      case Opcode.SET_KP: state.kp = value; break
+      case Opcode.SET_KI: state.ki = value; break
+      case Opcode.SET_KD: state.kd = value; break
+      case Opcode.SET_KF: state.kf = value; break
+      default: return false
+    }
+    return true
+  }
+
+  function handleFrame (message, rinfo) {
+    const frame = decodeFrame(message)
+    const reply = (ack) => udp.send(ack, rinfo.port, rinfo.address)
+    if (!frame) {
+      const sequence = message.length >= 8 ? message.readUInt32LE(4) : 0
+      reply(encodeAck(3, sequence, 0, micros(), state.speedRPM, state.targetRPM))
+      return
+    }
+
+    const key = `${rinfo.address}:${rinfo.port}`
+    const client = clients.get(key)
+    if (client) {
+      const age = (frame.sequence - client.sequence) | 0
+      if (age === 0) {
+        client.ack.writeUInt8(1, 3) // Duplicate
+        reply(client.ack)
+        return
+      }
+      if (age < 0) {
+        reply(encodeAck(2, frame.sequence, 0, micros(), state.speedRPM, state.targetRPM))
+        return
+      }
+    }
+
+    const ack = encodeAck(0, frame.sequence, 0, micros(), state.speedRPM, state.targetRPM)
+    let applied = 0
+    while (applied < frame.commands.length && apply(frame.commands[applied])) {
+      applied++
+    }
+    ack.writeUInt8(applied < frame.commands.length ? 4 : 0, 3)
+    ack.writeUInt8(applied, 8)
+    clients.set(key, { sequence: frame.sequence, ack })
+    reply(ack)
+  }
+
+  const udp = dgram.createSocket('udp4')
+  udp.on('message', (message, rinfo) => queue.push({ message, rinfo }))
+  udp.bind(udpPort)
+
+  const timer = setInterval(() => {
+    for (let i = 0; i < MAX_FRAMES_PER_POLL && queue.length > 0; i++) {
+      const { message, rinfo } = queue.shift()
+      handleFrame(message, rinfo)
+    }
+    state.speedRPM += (state.targetRPM - state.speedRPM) * 0.1
+  }, CONTROL_PERIOD_MS)
+
+  const app = express()
+  const status = (message) => ({
+    firmwareVersion: 'stand-in',
+    pid: { kp: state.kp, ki: state.ki, kd: state.kd, kf: state.kf },
+    actualSpeedRPM: state.speedRPM,
+    targetSpeedRPM: state.targetRPM,
+    message
+  })
+  app.get('/speed', (req, res) => {
+    state.targetRPM = Number(req.query.value) || 0
+    res.json(status('Speed Set'))
+  })
+  app.get('/free', (req, res) => {
+    state.targetRPM = 0
+    res.json(status('Free Set'))
+  })
+  const http = app.listen(httpPort)
+
+  return {
+    state,
+    close () {
+      clearInterval(timer)
+      udp.close()
+      http.close()
+    }
+  }
+}
+
+if (require.main === module) {
+  const [udpPort, httpPort] = process.argv.slice(2).map(Number)
+  createStandIn({ udpPort: udpPort || COMMAND_PORT, httpPort: httpPort || 8080 })
+  console.log(`Command stand-in on UDP ${udpPort || COMMAND_PORT} and HTTP ${httpPort || 8080}`)
+}
+
+module.exports = { createStandIn }
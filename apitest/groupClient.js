@@ -0,0 +1,159 @@
+const dgram = require('dgram')
+const { encodeFrame } = require('./commandClient')
+
+// Coordinator for group commands (see GroupChannel.h). The coordinator's
+// clock is the group clock: sync() measures a controller's offset from it
+// and sends it back, send() multicasts commands with an activation time.
+//
+//   const group = new GroupCoordinator()
+//   await group.syncAll(['192.168.1.121', '192.168.1.122'])
+//   group.keepSynced(['192.168.1.121', '192.168.1.122'])
+//   await group.send(0x01, [speed(1200)])
+
+const GROUP_PORT = 5603
+const GROUP_ADDRESS = '239.255.87.67'
+const VERSION = 1
+const GROUP_HEADER_SIZE = 16
+const CONTROL_PERIOD_MICROS = 5000
+
+const SyncType = { TIME_REQUEST: 0, TIME_REPLY: 1, TIME_SET: 2, TIME_SET_ACK: 3 }
+
+const started = process.hrtime.bigint()
+const hostMicros = () => Number((process.hrtime.bigint() - started) / 1000n) >>> 0
+const nextTick = (micros) => (Math.ceil(micros / CONTROL_PERIOD_MICROS) * CONTROL_PERIOD_MICROS) >>> 0
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+function encodeSync (type, value) {
+  const message = Buffer.alloc(8)
+  message.write('WS', 0, 'ascii')
+  message.writeUInt8(VERSION, 2)
+  message.writeUInt8(type, 3)
+  message.writeUInt32LE(value >>> 0, 4)
+  return message
+}
+
+function encodeGroupFrame (sequence, groups, activateAt, commands) {
+  // Same command encoding as the unicast channel, behind a longer header
+  const commandFrame = encodeFrame(sequence, commands)
+  const frame = Buffer.alloc(GROUP_HEADER_SIZE + commandFrame.length - 8)
+  frame.write('WG', 0, 'ascii')
+  frame.writeUInt8(VERSION, 2)
+  frame.writeUInt8(commands.length, 3)
+  frame.writeUInt32LE(sequence >>> 0, 4)
+  frame.writeUInt8(groups, 8)
+  frame.writeUInt32LE(activateAt >>> 0, 12)
+  commandFrame.copy(frame, GROUP_HEADER_SIZE, 8)
+  return frame
+}
+
+// NTP-style estimate from one exchange. t1 and t4 are coordinator times,
+// t2 and t3 the controller's. The offset is controller minus coordinator.
+function estimate (t1, t2, t3, t4) {
+  const forward = (t2 - t1) | 0
+  const back = (t3 - t4) | 0
+  return { offset: Math.round((forward + back) / 2) | 0, delay: ((t4 - t1) | 0) - ((t3 - t2) | 0) }
+}
+
+class GroupCoordinator {
+  // Without targets group frames are multicast; with them they are sent to
+  // each address in turn, for networks (or simulations) without multicast.
+  constructor ({ port = GROUP_PORT, groupAddress = GROUP_ADDRESS, targets = null, repeats = 3 } = {}) {
+    this.port = port
+    this.groupAddress = groupAddress
+    this.targets = targets
+    this.repeats = repeats
+    this.sequence = Math.floor(Math.random() * 0x10000)
+    this.waiting = null
+    this.timer = null
+    this.socket = dgram.createSocket('udp4')
+    this.socket.on('message', (message) => {
+      if (this.waiting && message.length >= 8 && message.toString('ascii', 0, 2) === 'WS') {
+        const waiting = this.waiting
+        this.waiting = null
+        waiting({ message, t4: hostMicros() })
+      }
+    })
+  }
+
+  request (message, address, timeoutMs = 50) {
+    return new Promise((resolve) => {
+      const timer = setTimeout(() => {
+        this.waiting = null
+        resolve(null)
+      }, timeoutMs)
+      this.waiting = (reply) => {
+        clearTimeout(timer)
+        resolve(reply)
+      }
+      this.socket.send(message, this.port, address)
+    })
+  }
+
+  // Keeps the exchange with the smallest round trip: it had the least
+  // queueing, so the least asymmetry between the two directions
+  async sync (address, { samples = 16 } = {}) {
+    let best = null
+    for (let i = 0; i < samples; i++) {
+      const t1 = hostMicros()
+      const reply = await this.request(encodeSync(SyncType.TIME_REQUEST, t1), address)
+      if (!reply || reply.message.length < 16 || reply.message.readUInt8(3) !== SyncType.TIME_REPLY ||
+          reply.message.readUInt32LE(4) !== t1) {
+        continue
+      }
+      const result = estimate(t1, reply.message.readUInt32LE(8), reply.message.readUInt32LE(12), reply.t4)
+      if (!best || result.delay < best.delay) {
+        best = result
+      }
+      await sleep(2)
+    }
+    if (!best) {
+      throw new Error(`No time replies from ${address}`)
+    }
+    const ack = await this.request(encodeSync(SyncType.TIME_SET, best.offset), address)
+    if (!ack || ack.message.readUInt8(3) !== SyncType.TIME_SET_ACK) {
+      throw new Error(`Offset not acknowledged by ${address}`)
+    }
+    return best
+  }
+
+  async syncAll (addresses, options) {
+    const results = {}
+    for (const address of addresses) {
+      results[address] = await this.sync(address, options)
+    }
+    return results
+  }
+
+  // Crystals drift apart by tens of microseconds a second, so keep re-syncing
+  keepSynced (addresses, intervalMs = 2000) {
+    const run = () => this.syncAll(addresses, { samples: 8 })
+      .catch((error) => console.error('Sync failed:', error.message))
+      .finally(() => { this.timer = setTimeout(run, intervalMs) })
+    this.timer = setTimeout(run, intervalMs)
+  }
+
+  // Sends the commands to apply on the first control tick at least delayMs
+  // from now, or at activateAt, repeated in case a copy is lost. Returns the
+  // activation time.
+  async send (groups, commands, { delayMs = 50, activateAt = null } = {}) {
+    if (activateAt === null) {
+      activateAt = nextTick(hostMicros() + delayMs * 1000)
+    }
+    this.sequence = (this.sequence + 1) >>> 0
+    const frame = encodeGroupFrame(this.sequence, groups, activateAt, commands)
+    for (let i = 0; i < this.repeats; i++) {
+      for (const address of this.targets || [this.groupAddress]) {
+        this.socket.send(frame, this.port, address)
+      }
+      await sleep(2)
+    }
+    return activateAt
+  }
+
+  close () {
+    clearTimeout(this.timer)
+    this.socket.close()
+  }
+}
+
+module.exports = { GROUP_PORT, GROUP_ADDRESS, SyncType, GroupCoordinator, encodeSync, encodeGroupFrame, estimate, hostMicros, nextTick }
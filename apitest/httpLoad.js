@@ -0,0 +1,120 @@
+const http = require('http')
+
+// HTTP load against the controller's web server, and what it does to the
+// control loop. The scheduler's stats are reset and read back from /timing
+// twice: once over an idle period, then while the connections hammer the
+// path as fast as they are answered. Run it against two firmware builds to
+// compare them; --close opens a connection per request as a browser without
+// keep-alive would.
+//
+//   node httpLoad.js <motor-ip[:port]> [connections] [seconds] [--close] [--path=/status]
+
+function parseArgs (argv) {
+  const options = { connections: 4, seconds: 10, keepAlive: true, path: '/status' }
+  const positional = []
+  for (const arg of argv) {
+    if (arg === '--close') options.keepAlive = false
+    else if (arg.startsWith('--path=')) options.path = arg.slice(7)
+    else positional.push(arg)
+  }
+  const [host, port] = (positional[0] || '').split(':')
+  options.host = host
+  options.port = Number(port) || 80
+  options.connections = Number(positional[1]) || options.connections
+  options.seconds = Number(positional[2]) || options.seconds
+  return options
+}
+
+function get (agent, options, path) {
+  // Node asks for keep-alive whenever maxSockets is set, so say close outright
+  const headers = agent.keepAlive ? {} : { Connection: 'close' }
+  return new Promise((resolve, reject) => {
+    const request = http.get({ host: options.host, port: options.port, path, agent, headers, timeout: 10000 }, (response) => {
+      const chunks = []
+      response.on('data', (chunk) => chunks.push(chunk))
+      response.on('end', () => resolve({ status: response.statusCode, body: Buffer.concat(chunks).toString() }))
+      response.on('error', reject)
+    })
+    request.on('timeout', () => request.destroy(new Error('timeout')))
+    request.on('error', reject)
+  })
+}
+
+const sleep = (ms) => new Promise((resolve) => setTimeout(resolve, ms))
+
+// Stats over a period: reset at the start, read at the end
+async function timing (options, during) {
+  const agent = new http.Agent({ keepAlive: false })
+  await get(agent, options, '/timing?reset')
+  const result = await during()
+  const response = await get(agent, options, '/timing')
+  return { result, timing: JSON.parse(response.body) }
+}
+
+async function load (options) {
+  const agent = new http.Agent({ keepAlive: options.keepAlive, maxSockets: options.connections })
+  const latencies = []
+  const errors = {}
+  const end = Date.now() + options.seconds * 1000
+  const start = process.hrtime.bigint()
+
+  async function worker () {
+    while (Date.now() < end) {
+      const sent = process.hrtime.bigint()
+      try {
+        const response = await get(agent, options, options.path)
+        if (response.status !== 200) errors[response.status] = (errors[response.status] || 0) + 1
+        latencies.push(Number(process.hrtime.bigint() - sent) / 1e6)
+      } catch (error) {
+        errors[error.code || error.message] = (errors[error.code || error.message] || 0) + 1
+      }
+    }
+  }
+
+  await Promise.all(Array.from({ length: options.connections }, worker))
+  agent.destroy()
+  return { latencies, errors, elapsed: Number(process.hrtime.bigint() - start) / 1e9 }
+}
+
+function summarise (latencies) {
+  const sorted = latencies.slice().sort((a, b) => a - b)
+  const at = (q) => sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))].toFixed(1) : '-'
+  return `p50=${at(0.5)}ms p99=${at(0.99)}ms max=${at(1)}ms`
+}
+
+function loopLine (name, timing) {
+  const web = timing.phases && timing.phases.web
+  const fields = [
+    `jitter=${timing.jitterMicros}us`,
+    `maxJitter=${timing.maxJitterMicros}us`,
+    `missed=${timing.missedDeadlines}`,
+    `overruns=${timing.overruns === undefined ? '-' : timing.overruns}`,
+    `webMax=${web ? web.maxMicros + 'us' : '-'}`,
+    `maxHandler=${timing.maxHandlerMicros === undefined ? '-' : timing.maxHandlerMicros + 'us'}`
+  ]
+  console.log(`${name.padEnd(8)} ${fields.join(' ')}`)
+}
+
+async function run (options) {
+  console.log(`${options.host}:${options.port}${options.path}, ${options.connections} connections, ` +
+    `${options.seconds}s, ${options.keepAlive ? 'keep-alive' : 'connection per request'}`)
+
+  const idle = await timing(options, () => sleep(options.seconds * 1000))
+  const loaded = await timing(options, () => load(options))
+  const { latencies, errors, elapsed } = loaded.result
+
+  console.log(`requests ${latencies.length} in ${elapsed.toFixed(1)}s = ${(latencies.length / elapsed).toFixed(1)} req/s, ${summarise(latencies)}`)
+  if (Object.keys(errors).length) console.log('errors', errors)
+  console.log('control loop')
+  loopLine('idle', idle.timing)
+  loopLine('loaded', loaded.timing)
+}
+
+if (require.main === module) {
+  const options = parseArgs(process.argv.slice(2))
+  if (!options.host) {
+    console.log('usage: node httpLoad.js <motor-ip[:port]> [connections] [seconds] [--close] [--path=/status]')
+    process.exit(1)
+  }
+  run(options).catch((error) => console.error(error.message))
+}
@@ -0,0 +1,112 @@
+const dgram = require('dgram')
+const fs = require('fs')
+const axios = require('axios')
+
+// Decoder and recorder for the binary telemetry stream (see TelemetryStream.h)
+//
+//   node telemetry.js record <motor-ip> [rateHz] [file.csv]
+//   node telemetry.js replay <file.csv>
+
+const LOCAL_PORT = 5601
+const FRAME_SIZE = 28
+const SUPPORTED_VERSION = 1
+const CSV_HEADER = 'sequence,timestampMicros,rawAngle,pwm,speedRPM,targetRPM,output'
+
+function decodeFrame (buffer) {
+  if (buffer.length < FRAME_SIZE || buffer[0] !== 0x57 || buffer[1] !== 0x54) {
+    return null // Not a WT frame
+  }
+  const version = buffer.readUInt8(2)
+  if (version !== SUPPORTED_VERSION) {
+    return null
+  }
+  return {
+    version,
+    sequence: buffer.readUInt32LE(4),
+    timestampMicros: buffer.readUInt32LE(8),
+    rawAngle: buffer.readUInt16LE(12),
+    pwm: buffer.readInt16LE(14),
+    speedRPM: buffer.readFloatLE(16),
+    targetRPM: buffer.readFloatLE(20),
+    output: buffer.readFloatLE(24)
+  }
+}
+
+function toCsv (frame) {
+  return [frame.sequence, frame.timestampMicros, frame.rawAngle, frame.pwm,
+    frame.speedRPM.toFixed(2), frame.targetRPM.toFixed(2), frame.output.toFixed(2)].join(',')
+}
+
+function fromCsv (line) {
+  const [sequence, timestampMicros, rawAngle, pwm, speedRPM, targetRPM, output] = line.split(',').map(Number)
+  return { sequence, timestampMicros, rawAngle, pwm, speedRPM, targetRPM, output }
+}
+
+// Frame loss from sequence gaps and the spread of the device-side sample interval
+function summarise (frames) {
+  let lost = 0
+  const intervals = []
+  for (let i = 1; i < frames.length; i++) {
+    lost += frames[i].sequence - frames[i - 1].sequence - 1
+    intervals.push((frames[i].timestampMicros - frames[i - 1].timestampMicros) >>> 0)
+  }
+  const mean = intervals.reduce((a, b) => a + b, 0) / (intervals.length || 1)
+  return {
+    frames: frames.length,
+    lost,
+    meanIntervalMicros: Math.round(mean),
+    minIntervalMicros: Math.min(...intervals),
+    maxIntervalMicros: Math.max(...intervals)
+  }
+}
+
+async function record (address, rate, file) {
+  const socket = dgram.createSocket('udp4')
+  const frames = []
+  const out = file ? fs.createWriteStream(file) : null
+  if (out) out.write(CSV_HEADER + '\n')
+
+  socket.on('message', (message) => {
+    const frame = decodeFrame(message)
+    if (!frame) return
+    frames.push(frame)
+    if (out) out.write(toCsv(frame) + '\n')
+  })
+
+  socket.bind(LOCAL_PORT, async () => {
+    await axios.get(`http://${address}/telemetry/subscribe?port=${LOCAL_PORT}&rate=${rate}`)
+    console.log(`Recording from ${address} at ${rate}Hz, Ctrl-C to stop`)
+  })
+
+  process.on('SIGINT', async () => {
+    try {
+      await axios.get(`http://${address}/telemetry/unsubscribe?port=${LOCAL_PORT}`)
+    } catch (error) {
+      console.error('Unsubscribe failed:', error.message)
+    }
+    socket.close()
+    if (out) out.end()
+    console.log(summarise(frames))
+    process.exit(0)
+  })
+}
+
+function replay (file) {
+  const lines = fs.readFileSync(file, 'utf8').trim().split('\n')
+  const frames = lines.slice(1).map(fromCsv)
+  console.log(summarise(frames))
+}
+
+if (require.main === module) {
+  const [mode, target, rate, file] = process.argv.slice(2)
+  if (mode === 'record' && target) {
+    record(target, rate || 200, file)
+  } else if (mode === 'replay' && target) {
+    replay(target)
+  } else {
+    console.log('Usage: node telemetry.js record <motor-ip> [rateHz] [file.csv]')
+    console.log('       node telemetry.js replay <file.csv>')
+  }
+}
+
+module.exports = { decodeFrame, toCsv, fromCsv, summarise }
@@ -0,0 +1,91 @@
+#include "FlashEmulator.h"
+#include <string.h>
+
+FlashEmulator::FlashEmulator()
+    : _powerCut(-1)
+{
+  memset(_sectors, 0xFF, sizeof(_sectors));
+  memset(_erases, 0, sizeof(_erases));
+  memset(_writes, 0, sizeof(_writes));
+}
+
+size_t FlashEmulator::sectorSize() const
+{
+  return SECTOR_SIZE;
+}
+
+bool FlashEmulator::valid(uint8_t sector, size_t offset, size_t length) const
+{
+  return sector < 2 && offset % 4 == 0 && length % 4 == 0 && offset + length <= SECTOR_SIZE;
+}
+
+bool FlashEmulator::eraseSector(uint8_t sector)
+{
+  if (sector >= 2)
+  {
+    return false;
+  }
+  memset(_sectors[sector], 0xFF, SECTOR_SIZE);
+  _erases[sector]++;
+  return true;
+}
+
+bool FlashEmulator::write(uint8_t sector, size_t offset, const uint32_t *data, size_t length)
+{
+  if (!valid(sector, offset, length))
+  {
+    return false;
+  }
+  _writes[sector]++;
+
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < length; i++)
+  {
+    if (_powerCut == 0)
+    {
+      _powerCut = -1;
+      return false;
+    }
+    if (_powerCut > 0)
+    {
+      _powerCut--;
+    }
+    _sectors[sector][offset + i] &= bytes[i]; // Programming only clears bits
+  }
+  return true;
+}
+
+bool FlashEmulator::read(uint8_t sector, size_t offset, uint32_t *data, size_t length)
+{
+  if (!valid(sector, offset, length))
+  {
+    return false;
+  }
+  memcpy(data, &_sectors[sector][offset], length);
+  return true;
+}
+
+void FlashEmulator::cutPowerAfter(size_t bytes)
+{
+  _powerCut = bytes;
+}
+
+void FlashEmulator::flipBit(uint8_t sector, size_t offset, uint8_t bit)
+{
+  _sectors[sector][offset] ^= 1 << bit;
+}
+
+uint8_t *FlashEmulator::data(uint8_t sector)
+{
+  return _sectors[sector];
+}
+
+unsigned long FlashEmulator::getEraseCount(uint8_t sector) const
+{
+  return _erases[sector];
+}
+
+unsigned long FlashEmulator::getWriteCount(uint8_t sector) const
+{
+  return _writes[sector];
+}
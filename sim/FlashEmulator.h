@@ -0,0 +1,40 @@
+#ifndef FlashEmulator_h
+#define FlashEmulator_h
+
+#include <stdint.h>
+#include "../HAL.h"
+
+// Host-side FlashDevice with NOR semantics: erase sets a sector to 0xFF and
+// writes can only clear bits. Counts erases and writes per sector, and can
+// cut the power part way through a write or flip bits to exercise the
+// ConfigStore recovery paths.
+class FlashEmulator : public FlashDevice {
+public:
+    static const size_t SECTOR_SIZE = 4096;
+
+    FlashEmulator();
+
+    size_t sectorSize() const override;
+    bool eraseSector(uint8_t sector) override;
+    bool write(uint8_t sector, size_t offset, const uint32_t *data, size_t length) override;
+    bool read(uint8_t sector, size_t offset, uint32_t *data, size_t length) override;
+
+    // The next write stops after this many bytes and fails, as on a power cut
+    void cutPowerAfter(size_t bytes);
+    void flipBit(uint8_t sector, size_t offset, uint8_t bit);
+    // Raw access, e.g. to lay down the old EEPROM layout in sector 0
+    uint8_t *data(uint8_t sector);
+
+    unsigned long getEraseCount(uint8_t sector) const;
+    unsigned long getWriteCount(uint8_t sector) const;
+
+private:
+    uint8_t _sectors[2][SECTOR_SIZE];
+    unsigned long _erases[2];
+    unsigned long _writes[2];
+    long _powerCut; // Bytes left before the cut, -1 for none
+
+    bool valid(uint8_t sector, size_t offset, size_t length) const;
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "MotorSimulator.h"
+#include <math.h>
+
+MotorSimulator::MotorSimulator(uint8_t rpwmPin, uint8_t lpwmPin, uint8_t renPin, uint8_t lenPin,
+                               const MotorParameters &parameters)
+    : _p(parameters), _rpwmPin(rpwmPin), _lpwmPin(lpwmPin), _renPin(renPin), _lenPin(lenPin),
+      _timeMicros(0), _pendingMicros(0), _omega(0), _theta(0), _current(0), _voltage(0), _loadTorque(0), _temperature(25), _locked(false),
+      _as5600Pointer(0), _as5600Conf(0), _outOnA0(false), _angleNoise(0), _magnetMissing(false), _glitchReads(0), _latchedAngle(0), _noiseState(1), _ahtMeasureStart(0), _i2cTransactions(0)
+{
+  for (int i = 0; i < PIN_COUNT; i++)
+  {
+    _duty[i] = 0;
+  }
+}
+
+void MotorSimulator::begin()
+{
+}
+
+void MotorSimulator::setClock(uint32_t hz)
+{
+  _p.i2cClockHz = hz;
+}
+
+// Start/address/stop overhead plus 9 clocks per byte
+void MotorSimulator::busDelay(size_t bytes)
+{
+  double seconds = (bytes + 2) * 9.0 / _p.i2cClockHz;
+  advanceMicros(static_cast<unsigned long>(seconds * 1e6));
+  _i2cTransactions++;
+}
+
+bool MotorSimulator::write(uint8_t address, const uint8_t *data, size_t length, bool /* sendStop */)
+{
+  busDelay(length);
+  if (address == AS5600_ADDRESS)
+  {
+    if (length > 0)
+    {
+      _as5600Pointer = data[0];
+    }
+    if (length > 1 && data[0] == 0x08)
+    {
+      _as5600Conf = data[1];
+    }
+    return true;
+  }
+  if (address == AHT21_ADDRESS)
+  {
+    if (length > 0 && data[0] == 0xAC)
+    {
+      _ahtMeasureStart = _timeMicros;
+    }
+    return true;
+  }
+  return false; // No device, NACK
+}
+
+size_t MotorSimulator::read(uint8_t address, uint8_t *buffer, size_t length)
+{
+  busDelay(length);
+  if (address == AS5600_ADDRESS)
+  {
+    uint8_t start = _as5600Pointer;
+    for (size_t i = 0; i < length; i++)
+    {
+      buffer[i] = as5600Register(_as5600Pointer);
+      _as5600Pointer++;
+      // The output registers wrap back to their high byte so they can be
+      // polled repeatedly without rewriting the address pointer.
+      if ((start == 0x0C || start == 0x0E || start == 0x1B) && _as5600Pointer == start + 2)
+      {
+        _as5600Pointer = start;
+      }
+    }
+    return length;
+  }
+  if (address == AHT21_ADDRESS)
+  {
+    bool busy = _timeMicros - _ahtMeasureStart < 80000;
+    uint32_t humidity = static_cast<uint32_t>(40.0 / 100.0 * 1048576.0);
+    uint32_t temperature = static_cast<uint32_t>((_temperature + 50.0) / 200.0 * 1048576.0);
+    uint8_t frame[6];
+    frame[0] = busy ? 0x80 : 0x18;
+    frame[1] = humidity >> 12;
+    frame[2] = humidity >> 4;
+    frame[3] = ((humidity & 0x0F) << 4) | ((temperature >> 16) & 0x0F);
+    frame[4] = temperature >> 8;
+    frame[5] = temperature;
+    size_t count = length < 6 ? length : 6;
+    for (size_t i = 0; i < count; i++)
+    {
+      buffer[i] = frame[i];
+    }
+    return count;
+  }
+  return 0;
+}
+
+// The AS5600 looks at the back of the shaft, so the raw angle falls when the
+// motor runs forward. Encoder::getSpeed() flips the sign back.
+uint16_t MotorSimulator::rawAngle()
+{
+  double turns = -_theta / (2.0 * M_PI);
+  double fraction = turns - floor(turns);
+  int raw = static_cast<int>(fraction * 4096.0);
+  if (_angleNoise > 0 || _magnetMissing)
+  {
+    _noiseState = _noiseState * 1664525u + 1013904223u;
+    int noise = _magnetMissing ? 2048 : _angleNoise;
+    raw += static_cast<int>(_noiseState >> 16) % (2 * noise + 1) - noise;
+  }
+  return static_cast<uint16_t>(raw & 0x0FFF);
+}
+
+uint8_t MotorSimulator::as5600Register(uint8_t reg)
+{
+  switch (reg)
+  {
+  case 0x08:
+    return _as5600Conf;
+  case 0x0B:
+    return _magnetMissing ? 0x10 : 0x20; // STATUS: too weak, or detected
+  case 0x0C:
+  case 0x0E:
+    _latchedAngle = rawAngle();
+    if (_glitchReads > 0)
+    {
+      _latchedAngle ^= 0x0800;
+      _glitchReads--;
+    }
+    return _latchedAngle >> 8;
+  case 0x0D:
+  case 0x0F:
+    return _latchedAngle & 0xFF; // The low byte of the same reading
+  case 0x1A:
+    return _magnetMissing ? 0xFF : 0x80; // AGC at full gain, or mid-range
+  case 0x1B:
+    return _magnetMissing ? 0x00 : 0x08;
+  case 0x1C:
+    return _magnetMissing ? 0x40 : 0x00;
+  default:
+    return 0;
+  }
+}
+
+void MotorSimulator::setMode(uint8_t /* pin */, uint8_t /* mode */)
+{
+}
+
+void MotorSimulator::write(uint8_t pin, uint8_t level)
+{
+  setDuty(pin, level ? 1023 : 0);
+}
+
+void MotorSimulator::setDuty(uint8_t pin, int duty)
+{
+  if (pin < PIN_COUNT)
+  {
+    _duty[pin] = duty < 0 ? 0 : duty > 1023 ? 1023 : duty;
+  }
+}
+
+// The sense current only flows while the high side conducts, so after the
+// RC filter A0 sees the motor current times the duty. The OUT pin instead
+// gives the angle over the supply, or 10-90% of it, through the 3.2V divider.
+// The input is sampled at the start of the conversion.
+int MotorSimulator::read()
+{
+  int counts = sampleA0();
+  advanceMicros(_p.adcMicros);
+  return counts;
+}
+
+int MotorSimulator::sampleA0()
+{
+  if (_outOnA0)
+  {
+    double fraction = rawAngle() / 4096.0;
+    if ((_as5600Conf & 0x30) == 0x10)
+    {
+      fraction = 0.1 + 0.8 * fraction;
+    }
+    int counts = static_cast<int>(fraction * 3.3 / 3.2 * 1023.0 + 0.5);
+    return counts > 1023 ? 1023 : counts;
+  }
+
+  int duty = _duty[_rpwmPin] > _duty[_lpwmPin] ? _duty[_rpwmPin] : _duty[_lpwmPin];
+  bool enabled = _duty[_renPin] > 0 && _duty[_lenPin] > 0;
+  double sensed = enabled ? fabs(_current) * duty / 1023.0 : 0;
+  int counts = static_cast<int>(sensed / _p.senseAmpsPerCount + 0.5);
+  return counts > 1023 ? 1023 : counts;
+}
+
+// A frame of 4351 clocks, 128 high, the angle over 4095, 128 low, at
+// 115Hz doubled by each PWMF step. The angle is the current one rather than
+// the one a frame ago.
+bool MotorSimulator::read(Pulse &pulse)
+{
+  if ((_as5600Conf & 0x30) != 0x20)
+  {
+    return false;
+  }
+  double frequency = 115.0 * (1 << (_as5600Conf >> 6));
+  uint64_t periodMicros = static_cast<uint64_t>(1e6 / frequency);
+  pulse.periodCycles = static_cast<uint32_t>(80e6 / frequency);
+  pulse.highCycles = static_cast<uint32_t>((128 + rawAngle() * 4095.0 / 4096.0) / 4351.0 * pulse.periodCycles);
+  pulse.count = static_cast<uint32_t>(_timeMicros / periodMicros);
+  pulse.endMicros = static_cast<unsigned long>(pulse.count * periodMicros);
+  return pulse.count > 0;
+}
+
+// Two edges a frame at a guessed 150 cycles each on the ESP8266
+uint32_t MotorSimulator::getEdgeCycles()
+{
+  Pulse pulse;
+  return read(pulse) ? pulse.count * 300 : 0;
+}
+
+unsigned long MotorSimulator::millis()
+{
+  return static_cast<unsigned long>(_timeMicros / 1000);
+}
+
+unsigned long MotorSimulator::micros()
+{
+  return static_cast<unsigned long>(_timeMicros);
+}
+
+void MotorSimulator::delay(unsigned long ms)
+{
+  advanceMicros(ms * 1000);
+}
+
+// Simulated time at the ESP8266's 80 MHz
+uint32_t MotorSimulator::cycles()
+{
+  return static_cast<uint32_t>(_timeMicros * 80);
+}
+
+void MotorSimulator::advanceMicros(unsigned long us)
+{
+  _timeMicros += us;
+  _pendingMicros += us;
+  while (_pendingMicros >= _p.stepMicros)
+  {
+    step(_p.stepMicros * 1e-6);
+    _pendingMicros -= _p.stepMicros;
+  }
+}
+
+// One explicit Euler step. The winding inductance is ignored: its time
+// constant is far below the 5 ms control period.
+void MotorSimulator::step(double dt)
+{
+  bool enabled = _duty[_renPin] > 0 && _duty[_lenPin] > 0;
+  if (enabled)
+  {
+    // Averaged PWM: each half-bridge switches its leg between B+ and B-
+    _voltage = _p.supplyVoltage * (_duty[_rpwmPin] - _duty[_lpwmPin]) / 1023.0;
+    _current = (_voltage - _p.torqueConstant * _omega) / _p.resistance;
+  }
+  else
+  {
+    // Both half-bridges off: the motor is open circuit and coasts
+    _current = 0;
+    _voltage = _p.torqueConstant * _omega;
+  }
+
+  if (_locked)
+  {
+    _omega = 0;
+    return;
+  }
+
+  double driveTorque = _p.torqueConstant * _current - _p.viscousFriction * _omega - _loadTorque;
+  if (fabs(_omega) < 1e-3 && fabs(driveTorque) <= _p.coulombFriction)
+  {
+    _omega = 0; // Static friction holds the shaft
+    return;
+  }
+  double friction = _omega > 0 ? _p.coulombFriction : _omega < 0 ? -_p.coulombFriction
+                                                                : (driveTorque > 0 ? _p.coulombFriction : -_p.coulombFriction);
+  double previousOmega = _omega;
+  _omega += (driveTorque - friction) / _p.inertia * dt;
+  if ((previousOmega > 0 && _omega < 0) || (previousOmega < 0 && _omega > 0))
+  {
+    _omega = 0; // Friction stops the shaft, it does not reverse it
+  }
+  _theta += _omega * dt;
+}
+
+void MotorSimulator::setLoadTorque(double torque)
+{
+  _loadTorque = torque;
+}
+
+void MotorSimulator::setAngleNoise(int lsb)
+{
+  _angleNoise = lsb;
+}
+
+void MotorSimulator::setLocked(bool locked)
+{
+  _locked = locked;
+}
+
+void MotorSimulator::setOutOnA0(bool wired)
+{
+  _outOnA0 = wired;
+}
+
+void MotorSimulator::setMagnetMissing(bool missing)
+{
+  _magnetMissing = missing;
+}
+
+void MotorSimulator::glitchAngle(int reads)
+{
+  _glitchReads = reads;
+}
+
+void MotorSimulator::setTemperature(double celsius)
+{
+  _temperature = celsius;
+}
+
+double MotorSimulator::getSpeedRPM() const
+{
+  return _omega * 60.0 / (2.0 * M_PI);
+}
+
+double MotorSimulator::getAngle() const
+{
+  return _theta;
+}
+
+double MotorSimulator::getCurrent() const
+{
+  return _current;
+}
+
+double MotorSimulator::getVoltage() const
+{
+  return _voltage;
+}
+
+unsigned long MotorSimulator::getI2CTransactions() const
+{
+  return _i2cTransactions;
+}
@@ -0,0 +1,109 @@
+#ifndef MotorSimulator_h
+#define MotorSimulator_h
+
+#include <stdint.h>
+#include "../HAL.h"
+
+// Host-side stand-in for the 775 motor, BTS7960 bridge, AS5600 encoder and
+// AHT21 sensor. It implements every HAL interface so the firmware classes can
+// be constructed against it instead of the ESP8266 core. Simulated time only
+// moves through delay(), I2C transfers (bus latency) and A0 conversions, or
+// advanceMicros().
+struct MotorParameters {
+    double supplyVoltage = 24.0;    // V
+    double resistance = 0.6;        // Ohm, winding resistance
+    double torqueConstant = 0.031;  // Nm/A, equal to the back-EMF constant in V.s/rad
+    double inertia = 6.0e-5;        // kg.m^2, rotor plus encoder magnet hub
+    double viscousFriction = 2.0e-5; // Nm.s/rad
+    double coulombFriction = 4.0e-3; // Nm
+    double i2cClockHz = 100000.0;
+    double senseAmpsPerCount = 0.0266; // A0 counts of the filtered current sense, see pins.md
+    unsigned long adcMicros = 70;   // An analogRead(), roughly: the SDK does not document it
+    unsigned long stepMicros = 20;  // Integration step
+};
+
+class MotorSimulator : public I2CBus, public GpioPort, public PwmOutput, public AnalogInput, public PulseInput, public Clock {
+public:
+    MotorSimulator(uint8_t rpwmPin, uint8_t lpwmPin, uint8_t renPin, uint8_t lenPin,
+                   const MotorParameters &parameters = MotorParameters());
+
+    // I2CBus
+    void begin() override;
+    void setClock(uint32_t hz) override;
+    bool write(uint8_t address, const uint8_t *data, size_t length, bool sendStop = true) override;
+    size_t read(uint8_t address, uint8_t *buffer, size_t length) override;
+
+    // GpioPort
+    void setMode(uint8_t pin, uint8_t mode) override;
+    void write(uint8_t pin, uint8_t level) override;
+
+    // PwmOutput
+    void setDuty(uint8_t pin, int duty) override;
+
+    // AnalogInput: the BTS7960 current sense on A0, or the AS5600 OUT pin
+    int read() override;
+
+    // PulseInput: the AS5600 OUT pin once CONF selects PWM. begin() is shared
+    // with the I2C bus and does nothing.
+    bool read(Pulse &pulse) override;
+    uint32_t getEdgeCycles() override;
+
+    // Clock
+    unsigned long millis() override;
+    unsigned long micros() override;
+    void delay(unsigned long ms) override;
+    uint32_t cycles() override;
+
+    void advanceMicros(unsigned long us);
+    void setLoadTorque(double torque);
+    void setAngleNoise(int lsb);
+    void setTemperature(double celsius); // Reported by the AHT21
+    void setLocked(bool locked);         // Stalled rotor: the shaft is held still
+    void setOutOnA0(bool wired);         // A0 reads the AS5600 OUT pin instead of the current sense
+    void setMagnetMissing(bool missing); // STATUS, AGC and MAGNITUDE say so and the angle is noise
+    void glitchAngle(int reads);         // The next reads flip the angle's top bit, a half turn
+
+    double getSpeedRPM() const;
+    double getAngle() const;       // Radians, multi-turn
+    double getCurrent() const;     // A, positive when driving forward
+    double getVoltage() const;     // V across the motor terminals
+    unsigned long getI2CTransactions() const;
+
+private:
+    static const uint8_t AS5600_ADDRESS = 0x36;
+    static const uint8_t AHT21_ADDRESS = 0x38;
+    static const int PIN_COUNT = 17;
+
+    MotorParameters _p;
+    uint8_t _rpwmPin, _lpwmPin, _renPin, _lenPin;
+    int _duty[PIN_COUNT];
+
+    uint64_t _timeMicros;
+    unsigned long _pendingMicros; // Time not yet integrated (less than one step)
+    double _omega;    // rad/s
+    double _theta;    // rad
+    double _current;  // A
+    double _voltage;  // V
+    double _loadTorque;
+    double _temperature; // °C
+    bool _locked;
+
+    uint8_t _as5600Pointer;
+    uint8_t _as5600Conf; // CONF low byte: PWMF, OUTS, HYST, PM
+    bool _outOnA0;
+    int _angleNoise;
+    bool _magnetMissing;
+    int _glitchReads;
+    uint16_t _latchedAngle; // Read with the high byte, for the low byte
+    uint32_t _noiseState;
+    uint64_t _ahtMeasureStart;
+    unsigned long _i2cTransactions;
+
+    void step(double dt);
+    void busDelay(size_t bytes);
+    int sampleA0();
+    uint8_t as5600Register(uint8_t reg);
+    uint16_t rawAngle();
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// Stands in until a test binds its own clock: time never moves
+class StoppedClock : public Clock {
+public:
+    unsigned long millis() override { return 0; }
+    unsigned long micros() override { return 0; }
+    void delay(unsigned long) override {}
+    uint32_t cycles() override { return 0; }
+};
+
+static StoppedClock stoppedClock;
+static Clock *hostClock = &stoppedClock;
+
+static bool interruptsEnabled = true;
+static timercallback timerCallback = nullptr;
+static uint32_t timerCompare = 0;
+static uint32_t timerCheckedCount = 0; // Count the compare was last checked against
+
+static HostCpu *hostCpu = nullptr; // Selected, if the test runs several
+
+// Keeps the selected CPU's timer for when it is selected again
+static void storeTimer()
+{
+  if (hostCpu != nullptr)
+  {
+    hostCpu->timerCallback = timerCallback;
+    hostCpu->timerCompare = timerCompare;
+    hostCpu->timerCheckedCount = timerCheckedCount;
+    hostCpu = nullptr;
+  }
+}
+
+void hostSetClock(Clock &clock)
+{
+  storeTimer();
+  hostClock = &clock;
+  timerCheckedCount = clock.cycles();
+}
+
+HostCpu::HostCpu(Clock &clock)
+    : clock(clock), timerCallback(nullptr), timerCompare(0), timerCheckedCount(clock.cycles())
+{
+}
+
+void hostSelectCpu(HostCpu &cpu)
+{
+  storeTimer();
+  hostCpu = &cpu;
+  hostClock = &cpu.clock;
+  timerCallback = cpu.timerCallback;
+  timerCompare = cpu.timerCompare;
+  timerCheckedCount = cpu.timerCheckedCount;
+}
+
+void hostServiceTimer()
+{
+  if (!interruptsEnabled || timerCallback == nullptr)
+  {
+    return;
+  }
+  uint32_t count = hostClock->cycles();
+  // Whether the compare value lies in (checked, count], across a wrap too
+  bool reached = timerCompare - timerCheckedCount - 1 < count - timerCheckedCount;
+  timerCheckedCount = count;
+  if (reached)
+  {
+    interruptsEnabled = false;
+    timerCallback();
+    interruptsEnabled = true;
+  }
+}
+
+unsigned long millis()
+{
+  return hostClock->millis();
+}
+
+unsigned long micros()
+{
+  return hostClock->micros();
+}
+
+void delay(unsigned long ms)
+{
+  hostClock->delay(ms);
+}
+
+void yield()
+{
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long howBig)
+{
+  return howBig > 0 ? rand() % howBig : 0;
+}
+
+long random(long howSmall, long howBig)
+{
+  return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall);
+}
+
+void noInterrupts()
+{
+  interruptsEnabled = false;
+}
+
+void interrupts()
+{
+  interruptsEnabled = true;
+}
+
+void timer0_isr_init()
+{
+}
+
+void timer0_attachInterrupt(timercallback callback)
+{
+  timerCallback = callback;
+}
+
+void timer0_detachInterrupt()
+{
+  timerCallback = nullptr;
+}
+
+void timer0_write(uint32_t count)
+{
+  timerCompare = count;
+  timerCheckedCount = hostClock->cycles();
+}
+
+String::String(double value, unsigned char decimals)
+{
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  _text = buffer;
+}
+
+void HardwareSerial::begin(unsigned long)
+{
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+  return fputs(text, stdout) >= 0 ? strlen(text) : 0;
+}
+
+size_t HardwareSerial::print(const String &text)
+{
+  return print(text.c_str());
+}
+
+size_t HardwareSerial::print(long value)
+{
+  return printf("%ld", value);
+}
+
+size_t HardwareSerial::print(double value, int decimals)
+{
+  return printf("%.*f", decimals, value);
+}
+
+size_t HardwareSerial::println(const char *text)
+{
+  return print(text) + print("\n");
+}
+
+size_t HardwareSerial::println(const String &text)
+{
+  return println(text.c_str());
+}
+
+size_t HardwareSerial::println(long value)
+{
+  return print(value) + print("\n");
+}
+
+size_t HardwareSerial::println(double value, int decimals)
+{
+  return print(value, decimals) + print("\n");
+}
+
+size_t HardwareSerial::printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int length = vprintf(format, args);
+  va_end(args);
+  return length > 0 ? length : 0;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return hostClock->cycles();
+}
+
+uint8_t EspClass::getCpuFreqMHz()
+{
+  return 80;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return 40000;
+}
+
+uint32_t EspClass::random()
+{
+  return static_cast<uint32_t>(rand()) << 16 ^ rand();
+}
+
+void EspClass::restart()
+{
+  hostRestarts++;
+}
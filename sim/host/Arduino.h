@@ -0,0 +1,146 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// The part of the ESP8266 Arduino core the firmware classes use, for the
+// host build in sim/. Time comes from whatever Clock the test binds with
+// hostSetClock(), usually a MotorSimulator, and the timer0 interrupt only
+// fires from hostServiceTimer(), so a test decides when interrupts happen.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <string>
+#include "../../HAL.h"
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define PGM_P const char *
+#define memcpy_P memcpy
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+#define CHANGE 0x03
+#define A0 17
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long howBig);
+long random(long howSmall, long howBig);
+void noInterrupts();
+void interrupts();
+
+typedef void (*timercallback)(void);
+void timer0_isr_init();
+void timer0_attachInterrupt(timercallback callback);
+void timer0_detachInterrupt();
+void timer0_write(uint32_t count);
+
+class String {
+public:
+    String(const char *text = "") : _text(text != nullptr ? text : "") {}
+    String(const std::string &text) : _text(text) {}
+    explicit String(char c) : _text(1, c) {}
+    explicit String(int value) : _text(std::to_string(value)) {}
+    explicit String(unsigned int value) : _text(std::to_string(value)) {}
+    explicit String(long value) : _text(std::to_string(value)) {}
+    explicit String(unsigned long value) : _text(std::to_string(value)) {}
+    explicit String(double value, unsigned char decimals = 2);
+
+    const char *c_str() const { return _text.c_str(); }
+    unsigned int length() const { return _text.length(); }
+    bool isEmpty() const { return _text.empty(); }
+    void reserve(unsigned int size) { _text.reserve(size); }
+    long toInt() const { return atol(_text.c_str()); }
+    float toFloat() const { return atof(_text.c_str()); }
+    double toDouble() const { return atof(_text.c_str()); }
+    char operator[](unsigned int index) const { return index < _text.length() ? _text[index] : 0; }
+
+    String &operator+=(const String &other) { _text += other._text; return *this; }
+    String &operator+=(const char *other) { _text += other; return *this; }
+    String &operator+=(char c) { _text += c; return *this; }
+    friend String operator+(const String &a, const String &b) { return String(a._text + b._text); }
+    friend String operator+(const String &a, const char *b) { return String(a._text + b); }
+    friend String operator+(const char *a, const String &b) { return String(a + b._text); }
+
+    bool operator==(const String &other) const { return _text == other._text; }
+    bool operator==(const char *other) const { return _text == other; }
+    bool operator!=(const String &other) const { return _text != other._text; }
+    bool operator!=(const char *other) const { return _text != other; }
+
+private:
+    std::string _text;
+};
+
+// Written to stdout
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    size_t print(const char *text);
+    size_t print(const String &text);
+    size_t print(long value);
+    size_t print(double value, int decimals = 2);
+    size_t println(const char *text = "");
+    size_t println(const String &text);
+    size_t println(long value);
+    size_t println(double value, int decimals = 2);
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getCycleCount();
+    uint8_t getCpuFreqMHz();
+    uint32_t getFreeHeap();
+    uint32_t random();
+    void restart();
+
+    unsigned long hostRestarts = 0; // Host only: restart() just counts
+};
+
+extern EspClass ESP;
+
+// Host only: binds millis(), micros() and ESP.getCycleCount() to a clock
+void hostSetClock(Clock &clock);
+
+// Host only: one of several simulated ESP8266s in a test, its clock and its
+// timer0. hostSelectCpu() binds them before the test runs that CPU's code;
+// its timer carries on from where it was when another CPU was selected.
+struct HostCpu {
+    explicit HostCpu(Clock &clock);
+
+    Clock &clock;
+    timercallback timerCallback;
+    uint32_t timerCompare;
+    uint32_t timerCheckedCount;
+};
+
+void hostSelectCpu(HostCpu &cpu);
+// Host only: runs the timer0 interrupt if the cycle count has reached its
+// compare value since the last call and interrupts are enabled. Like
+// CCOMPARE0, a compare value that was already behind the count when it was
+// written does not fire until the count wraps round to it.
+void hostServiceTimer();
+
+#endif
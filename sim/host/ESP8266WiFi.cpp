@@ -0,0 +1,244 @@
+#include "ESP8266WiFi.h"
+#include <deque>
+#include <map>
+#include <stdio.h>
+
+struct HostConnection {
+    std::string input;     // From the peer, not read yet
+    std::string inFlight;  // To the peer, not acked yet
+    std::string acked;     // To the peer, not received yet
+    IPAddress remoteAddress;
+    uint16_t remotePort;
+    bool stalled;
+    bool closed;           // By the firmware
+    bool aborted;
+    bool peerClosed;
+};
+
+// Connections waiting to be accepted, by port; a port is listening once it
+// has an entry
+static std::map<uint16_t, std::deque<std::shared_ptr<HostConnection>>> backlog;
+
+String IPAddress::toString() const
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(text);
+}
+
+uint8_t WiFiClient::connected()
+{
+  if (!_connection || _connection->closed)
+  {
+    return 0;
+  }
+  return !_connection->peerClosed || !_connection->input.empty();
+}
+
+WiFiClient::operator bool()
+{
+  return connected();
+}
+
+int WiFiClient::available()
+{
+  return _connection && !_connection->closed ? _connection->input.size() : 0;
+}
+
+int WiFiClient::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size)
+{
+  size_t length = min(size, static_cast<size_t>(available()));
+  memcpy(buffer, _connection->input.data(), length);
+  _connection->input.erase(0, length);
+  return length;
+}
+
+size_t WiFiClient::availableForWrite()
+{
+  return connected() ? SEND_BUFFER_SIZE - _connection->inFlight.size() : 0;
+}
+
+size_t WiFiClient::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+// What does not fit waits for acks that a stalled peer never sends
+size_t WiFiClient::write(const uint8_t *buffer, size_t size)
+{
+  if (!connected() || _connection->peerClosed)
+  {
+    return 0;
+  }
+  size_t length = min(size, availableForWrite());
+  _connection->inFlight.append(reinterpret_cast<const char *>(buffer), length);
+  if (!_connection->stalled)
+  {
+    _connection->acked += _connection->inFlight;
+    _connection->inFlight.clear();
+  }
+  if (length < size)
+  {
+    delay(WRITE_TIMEOUT_MS);
+  }
+  return length;
+}
+
+size_t WiFiClient::write(const char *text)
+{
+  return write(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+void WiFiClient::setNoDelay(bool)
+{
+}
+
+IPAddress WiFiClient::remoteIP()
+{
+  return _connection ? _connection->remoteAddress : IPAddress();
+}
+
+uint16_t WiFiClient::remotePort()
+{
+  return _connection ? _connection->remotePort : 0;
+}
+
+// Flushes first, as the core does: with data unacked that is the whole wait
+bool WiFiClient::stop(unsigned int maxWaitMs)
+{
+  if (!_connection || _connection->closed)
+  {
+    return true;
+  }
+  bool flushed = _connection->inFlight.empty() || _connection->peerClosed;
+  if (!flushed)
+  {
+    delay(maxWaitMs > 0 ? maxWaitMs : FLUSH_WAIT_MS);
+  }
+  _connection->closed = true;
+  return flushed;
+}
+
+void WiFiClient::abort()
+{
+  if (_connection && !_connection->closed)
+  {
+    _connection->closed = true; // What is in flight is never acked
+    _connection->aborted = true;
+  }
+}
+
+WiFiServer::WiFiServer(uint16_t port) : _port(port)
+{
+}
+
+void WiFiServer::begin()
+{
+  backlog[_port];
+}
+
+void WiFiServer::begin(uint16_t port)
+{
+  _port = port;
+  begin();
+}
+
+void WiFiServer::setNoDelay(bool)
+{
+}
+
+bool WiFiServer::hasClient()
+{
+  auto pending = backlog.find(_port);
+  return pending != backlog.end() && !pending->second.empty();
+}
+
+WiFiClient WiFiServer::accept()
+{
+  if (!hasClient())
+  {
+    return WiFiClient();
+  }
+  std::deque<std::shared_ptr<HostConnection>> &pending = backlog[_port];
+  WiFiClient client(pending.front());
+  pending.pop_front();
+  return client;
+}
+
+bool HostPeer::connect(uint16_t port, IPAddress address)
+{
+  auto pending = backlog.find(port);
+  if (pending == backlog.end())
+  {
+    return false;
+  }
+  static uint16_t nextPort = 50000;
+  _connection = std::make_shared<HostConnection>();
+  _connection->remoteAddress = address;
+  _connection->remotePort = nextPort++;
+  _connection->stalled = false;
+  _connection->closed = false;
+  _connection->aborted = false;
+  _connection->peerClosed = false;
+  pending->second.push_back(_connection);
+  return true;
+}
+
+void HostPeer::send(const char *text)
+{
+  send(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+void HostPeer::send(const uint8_t *data, size_t length)
+{
+  if (_connection && !_connection->closed && !_connection->peerClosed)
+  {
+    _connection->input.append(reinterpret_cast<const char *>(data), length);
+  }
+}
+
+std::string HostPeer::receive()
+{
+  std::string received;
+  if (_connection)
+  {
+    received.swap(_connection->acked);
+  }
+  return received;
+}
+
+void HostPeer::setStalled(bool stalled)
+{
+  _connection->stalled = stalled;
+  if (!stalled && !_connection->aborted)
+  {
+    _connection->acked += _connection->inFlight;
+    _connection->inFlight.clear();
+  }
+}
+
+void HostPeer::close()
+{
+  _connection->peerClosed = true;
+}
+
+bool HostPeer::isOpen() const
+{
+  return _connection && !_connection->closed;
+}
+
+bool HostPeer::wasAborted() const
+{
+  return _connection && _connection->aborted;
+}
+
+size_t HostPeer::inFlight() const
+{
+  return _connection ? _connection->inFlight.size() : 0;
+}
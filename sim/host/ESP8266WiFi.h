@@ -0,0 +1,99 @@
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+// TCP for the host build: WiFiServer and WiFiClient as the ESP8266 core has
+// them, over connections a test opens and drives from the other end with
+// HostPeer. The firmware's writes sit in a send buffer of SEND_BUFFER_SIZE
+// until the peer acks them, which it does at once unless it is stalled.
+// The blocking the core does is modelled on the bound clock: stop() waits
+// for unacked data up to FLUSH_WAIT_MS, and a write larger than the free
+// buffer waits out the write timeout, so a test can see either.
+
+#include "Arduino.h"
+#include <memory>
+#include <string>
+
+class IPAddress {
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address(a | (b << 8) | (c << 16) | (static_cast<uint32_t>(d) << 24)) {}
+
+    operator uint32_t() const { return _address; }
+    uint8_t operator[](int index) const { return _address >> (8 * index); }
+    bool operator==(const IPAddress &other) const { return _address == other._address; }
+    bool operator!=(const IPAddress &other) const { return _address != other._address; }
+    bool isSet() const { return _address != 0; }
+    String toString() const;
+
+private:
+    uint32_t _address; // First octet in the low byte, as lwIP keeps it
+};
+
+struct HostConnection;
+
+class WiFiClient {
+public:
+    static const size_t SEND_BUFFER_SIZE = 2920; // TCP_SND_BUF, two segments
+    static const unsigned long FLUSH_WAIT_MS = 300; // WIFICLIENT_MAX_FLUSH_WAIT_MS
+    static const unsigned long WRITE_TIMEOUT_MS = 5000;
+
+    WiFiClient() {}
+    explicit WiFiClient(const std::shared_ptr<HostConnection> &connection) : _connection(connection) {}
+
+    uint8_t connected();
+    operator bool();
+    int available();
+    int read();
+    int read(uint8_t *buffer, size_t size);
+    size_t availableForWrite();
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text);
+    void setNoDelay(bool noDelay);
+    IPAddress remoteIP();
+    uint16_t remotePort();
+    bool stop(unsigned int maxWaitMs = 0);
+    void abort();
+
+private:
+    std::shared_ptr<HostConnection> _connection;
+};
+
+class WiFiServer {
+public:
+    WiFiServer(uint16_t port);
+    void begin();
+    void begin(uint16_t port);
+    void setNoDelay(bool noDelay);
+    bool hasClient();
+    WiFiClient accept();
+    WiFiClient available() { return accept(); }
+
+private:
+    uint16_t _port;
+};
+
+// Host only: the browser's end of a connection
+class HostPeer {
+public:
+    HostPeer() {}
+    // Queues a connection on the server listening on the port; false if none
+    bool connect(uint16_t port, IPAddress address = IPAddress(192, 168, 4, 2));
+    void send(const char *text);
+    void send(const uint8_t *data, size_t length);
+    std::string receive(); // Whatever has been acked since the last call
+    // A stalled peer acks nothing more until it is let go, when it acks
+    // everything in flight
+    void setStalled(bool stalled);
+    void close();
+    bool isOpen() const;     // The firmware has not closed it
+    bool wasAborted() const; // Closed with a reset rather than stop()
+    size_t inFlight() const; // Written by the firmware, not acked yet or lost to a reset
+
+private:
+    std::shared_ptr<HostConnection> _connection;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "Hash.h"
+#include <string.h>
+
+static uint32_t rotateLeft(uint32_t value, int bits)
+{
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1Block(uint32_t state[5], const uint8_t block[64])
+{
+  uint32_t w[80];
+  for (int i = 0; i < 16; i++)
+  {
+    w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | block[4 * i + 1] << 16 | block[4 * i + 2] << 8 | block[4 * i + 3];
+  }
+  for (int i = 16; i < 80; i++)
+  {
+    w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+  for (int i = 0; i < 80; i++)
+  {
+    uint32_t f, k;
+    if (i < 20)
+    {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999;
+    }
+    else if (i < 40)
+    {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1;
+    }
+    else if (i < 60)
+    {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDC;
+    }
+    else
+    {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6;
+    }
+    uint32_t next = rotateLeft(a, 5) + f + e + k + w[i];
+    e = d;
+    d = c;
+    c = rotateLeft(b, 30);
+    b = a;
+    a = next;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+void sha1(const uint8_t *data, uint32_t size, uint8_t hash[20])
+{
+  uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  uint32_t offset = 0;
+  for (; size - offset >= 64; offset += 64)
+  {
+    sha1Block(state, data + offset);
+  }
+
+  // The tail, a one bit, zeros and the length in bits
+  uint8_t block[128] = {0};
+  uint32_t tail = size - offset;
+  memcpy(block, data + offset, tail);
+  block[tail] = 0x80;
+  uint32_t blocks = tail + 9 > 64 ? 2 : 1;
+  uint64_t bits = static_cast<uint64_t>(size) * 8;
+  for (int i = 0; i < 8; i++)
+  {
+    block[blocks * 64 - 1 - i] = bits >> (8 * i);
+  }
+  for (uint32_t i = 0; i < blocks; i++)
+  {
+    sha1Block(state, block + 64 * i);
+  }
+  for (int i = 0; i < 20; i++)
+  {
+    hash[i] = state[i / 4] >> (24 - 8 * (i % 4));
+  }
+}
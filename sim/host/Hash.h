@@ -0,0 +1,10 @@
+#ifndef Hash_h
+#define Hash_h
+
+// The SHA-1 of the ESP8266 core's Hash library, for the WebSocket handshake
+
+#include <stdint.h>
+
+void sha1(const uint8_t *data, uint32_t size, uint8_t hash[20]);
+
+#endif
@@ -0,0 +1,139 @@
+#include "WiFiUdp.h"
+#include <algorithm>
+#include <vector>
+
+static const IPAddress DEFAULT_ADDRESS(192, 168, 4, 1);
+static const size_t MAX_DATAGRAM = 1472; // One Ethernet frame
+
+static std::vector<WiFiUDP *> sockets; // Open ones
+
+WiFiUDP::WiFiUDP() : _localAddress(DEFAULT_ADDRESS), _port(0), _open(false), _readOffset(0), _toPort(0), _writing(false)
+{
+}
+
+WiFiUDP::~WiFiUDP()
+{
+  stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+  stop();
+  _port = port;
+  _open = true;
+  sockets.push_back(this);
+  return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress localAddress, IPAddress groupAddress, uint16_t port)
+{
+  begin(port);
+  if (localAddress.isSet())
+  {
+    _localAddress = localAddress;
+  }
+  _groupAddress = groupAddress;
+  return 1;
+}
+
+void WiFiUDP::stop()
+{
+  if (_open)
+  {
+    sockets.erase(std::find(sockets.begin(), sockets.end(), this));
+    _open = false;
+    _received.clear();
+  }
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port)
+{
+  _toAddress = address;
+  _toPort = port;
+  _sending.clear();
+  _writing = true;
+  return 1;
+}
+
+size_t WiFiUDP::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
+{
+  if (!_writing)
+  {
+    return 0;
+  }
+  size = min(size, MAX_DATAGRAM - _sending.size());
+  _sending.append(reinterpret_cast<const char *>(buffer), size);
+  return size;
+}
+
+int WiFiUDP::endPacket()
+{
+  if (!_writing)
+  {
+    return 0;
+  }
+  _writing = false;
+  Datagram datagram = {_localAddress, _port, _sending};
+  for (WiFiUDP *socket : sockets)
+  {
+    bool addressed = socket->_localAddress == _toAddress || (socket->_groupAddress.isSet() && socket->_groupAddress == _toAddress);
+    if (socket != this && socket->_port == _toPort && addressed)
+    {
+      socket->_received.push_back(datagram);
+    }
+  }
+  return 1;
+}
+
+int WiFiUDP::parsePacket()
+{
+  if (_received.empty())
+  {
+    _current.data.clear();
+    _readOffset = 0;
+    return 0;
+  }
+  _current = _received.front();
+  _received.pop_front();
+  _readOffset = 0;
+  return _current.data.size();
+}
+
+int WiFiUDP::available()
+{
+  return _current.data.size() - _readOffset;
+}
+
+int WiFiUDP::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t size)
+{
+  size_t length = min(size, static_cast<size_t>(available()));
+  memcpy(buffer, _current.data.data() + _readOffset, length);
+  _readOffset += length;
+  return length;
+}
+
+IPAddress WiFiUDP::remoteIP()
+{
+  return _current.from;
+}
+
+uint16_t WiFiUDP::remotePort()
+{
+  return _current.fromPort;
+}
+
+void WiFiUDP::setLocalAddress(IPAddress address)
+{
+  _localAddress = address;
+}
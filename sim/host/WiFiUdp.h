@@ -0,0 +1,54 @@
+#ifndef WiFiUdp_h
+#define WiFiUdp_h
+
+// UDP for the host build: datagrams between WiFiUDP sockets in the same
+// process, delivered at once. A socket receives what is sent to its port,
+// at its local address or the group it joined; a sender does not hear its
+// own multicast. A test takes part with a WiFiUDP of its own.
+
+#include "ESP8266WiFi.h"
+#include <deque>
+#include <string>
+
+class WiFiUDP {
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+    uint8_t begin(uint16_t port);
+    uint8_t beginMulticast(IPAddress localAddress, IPAddress groupAddress, uint16_t port);
+    void stop();
+    int beginPacket(IPAddress address, uint16_t port);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    int endPacket();
+    int parsePacket(); // Size of the next datagram, 0 if none
+    int available();
+    int read();
+    int read(uint8_t *buffer, size_t size);
+    IPAddress remoteIP();
+    uint16_t remotePort();
+
+    // Host only: the address datagrams from this socket come from
+    void setLocalAddress(IPAddress address);
+
+private:
+    struct Datagram {
+        IPAddress from;
+        uint16_t fromPort;
+        std::string data;
+    };
+
+    IPAddress _localAddress;
+    IPAddress _groupAddress;
+    uint16_t _port;
+    bool _open;
+    std::deque<Datagram> _received;
+    Datagram _current;   // Being read
+    size_t _readOffset;
+    IPAddress _toAddress; // Being written
+    uint16_t _toPort;
+    std::string _sending;
+    bool _writing;
+};
+
+#endif
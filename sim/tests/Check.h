@@ -0,0 +1,40 @@
+#ifndef Check_h
+#define Check_h
+
+#include <stdio.h>
+
+// Minimal checks for the host tests: a failed check is printed and the test
+// carries on, then main() returns checkResult() so make stops on it.
+
+static int checkFailures = 0;
+
+#define CHECK(condition)                                                      \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            checkFailures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance)                                \
+    do {                                                                      \
+        double checkValue = (value), checkExpected = (expected);              \
+        if (!(checkValue >= checkExpected - (tolerance) && checkValue <= checkExpected + (tolerance))) { \
+            printf("%s:%d: check failed: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__, \
+                   #value, checkValue, checkExpected, static_cast<double>(tolerance)); \
+            checkFailures++;                                                  \
+        }                                                                     \
+    } while (0)
+
+static inline int checkResult()
+{
+    if (checkFailures > 0)
+    {
+        printf("%d check(s) failed\n", checkFailures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+#endif
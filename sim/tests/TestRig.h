@@ -0,0 +1,68 @@
+#ifndef TestRig_h
+#define TestRig_h
+
+#include "MotorController.h"
+#include "I2CBusManager.h"
+#include "../MotorSimulator.h"
+#include "../FlashEmulator.h"
+
+// The firmware's control objects wired up as in wmc.ino, but against the
+// simulated motor and flash. step() runs one control period the way the
+// scheduler does: the tick, the encoder and controller updates, then the
+// bus manager's slack work.
+struct TestRig {
+    static const uint8_t RPWM_PIN = 14;
+    static const uint8_t LPWM_PIN = 12;
+    static const uint8_t REN_PIN = 13;
+    static const uint8_t LEN_PIN = 15;
+    static const unsigned long PERIOD_MICROS = MotorController::SampleTime * 1000UL;
+
+    MotorSimulator sim;
+    I2CBusManager bus;
+    Hal hal;
+    FlashEmulator flash;
+    EEPROMConfig config;
+    Encoder encoder;
+    AHT21Sensor aht21Sensor;
+    MotorController controller;
+
+    TestRig(const MotorParameters &parameters = MotorParameters())
+        : sim(RPWM_PIN, LPWM_PIN, REN_PIN, LEN_PIN, parameters), bus(sim, sim),
+          hal(bus, sim, sim, sim, sim, sim), config(flash), encoder(hal, 0x36),
+          aht21Sensor(hal), controller(hal, config, aht21Sensor, encoder)
+    {
+        hostSetClock(sim);
+    }
+
+    void begin(Encoder::Source source = Encoder::SOURCE_I2C)
+    {
+        config.begin();
+        bus.setClock(400000);
+        bus.setPointerHold(0x36, Encoder::RAW_ANGLE_REG);
+        bus.begin();
+        encoder.begin(source);
+        aht21Sensor.begin();
+        controller.init(RPWM_PIN, LPWM_PIN, REN_PIN, LEN_PIN);
+    }
+
+    // To the next tick, then one control step
+    void step()
+    {
+        sim.advanceMicros(PERIOD_MICROS - sim.micros() % PERIOD_MICROS);
+        encoder.sample(sim.micros());
+        encoder.update();
+        controller.update();
+        aht21Sensor.update();
+        bus.service();
+    }
+
+    void run(unsigned long ms)
+    {
+        for (unsigned long i = 0; i < ms * 1000 / PERIOD_MICROS; i++)
+        {
+            step();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "Check.h"
+#include "TestRig.h"
+
+// /autotune end to end on the simulated motor: the step test through the
+// controller, the fitted model against the simulator's physics, the gains
+// stored in flash, and a speed step closed with them.
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+
+    CHECK(rig.controller.startAutoTune(20, 50, 0));
+    for (int i = 0; i < 2000 && rig.controller.getAutoTuner().isRunning(); i++) // Up to 10s
+    {
+        rig.step();
+    }
+    AutoTuner &tuner = rig.controller.getAutoTuner();
+    CHECK(tuner.getState() == AutoTuner::COMPLETE);
+    const AutoTuner::Result &result = tuner.getResult();
+    printf("model: gain %.3f, time constant %.1fms, dead time %.1fms; gains kp %.3f ki %.3f kd %.3f kf %.3f\n",
+           result.gain, result.timeConstant * 1000, result.deadTime * 1000, result.kp, result.ki, result.kd, result.kf);
+
+    // Against the motor's mechanical time constant, R.J / (Kt^2 + R.b), and
+    // no-load speed read back through the uncalibrated 3500 RPM scale. The
+    // fit sees the motor through the speed estimate's filter, which adds lag.
+    MotorParameters motor;
+    double timeConstant = motor.resistance * motor.inertia /
+                          (motor.torqueConstant * motor.torqueConstant + motor.resistance * motor.viscousFriction);
+    double noLoadRPM = motor.supplyVoltage / motor.torqueConstant * 60 / (2 * M_PI);
+    printf("motor: time constant %.1fms, gain %.3f\n", timeConstant * 1000, noLoadRPM / 3500);
+    CHECK(result.timeConstant > 0.8 * timeConstant);
+    CHECK(result.timeConstant + result.deadTime < 3 * timeConstant);
+    CHECK_NEAR(result.gain, noLoadRPM / 3500, 0.2 * noLoadRPM / 3500);
+    CHECK(result.kp > 0 && result.ki > 0);
+
+    // Stored: a fresh config on the same flash reads the tuned gains back
+    EEPROMConfig reloaded(rig.flash);
+    reloaded.begin();
+    PIDGains stored;
+    CHECK(reloaded.readPIDGains(stored));
+    CHECK_NEAR(stored.kp, result.kp, 1e-4);
+    CHECK_NEAR(stored.ki, result.ki, 1e-4);
+    CHECK_NEAR(stored.kf, result.kf, 1e-4);
+
+    // The tuned loop settles a speed step within a second
+    const double target = 1500;
+    rig.controller.setTargetSpeed(target);
+    unsigned long settledMs = 0;
+    for (int i = 0; i < 400; i++)
+    {
+        rig.step();
+        if (fabs(rig.sim.getSpeedRPM() - target) > 0.05 * target)
+        {
+            settledMs = 0;
+        }
+        else if (settledMs == 0)
+        {
+            settledMs = (i + 1) * MotorController::SampleTime;
+        }
+    }
+    printf("tuned step 0 -> %.0f RPM: settled (5%%) after %lums, final %.0f RPM\n", target, settledMs,
+           rig.sim.getSpeedRPM());
+    CHECK(settledMs > 0 && settledMs < 1000);
+    CHECK_NEAR(rig.sim.getSpeedRPM(), target, 0.02 * target);
+    return checkResult();
+}
@@ -0,0 +1,114 @@
+#include "Check.h"
+#include "TestRig.h"
+#include <math.h>
+
+// Calibration on the simulated motor, with and without the sweep, then the
+// same speed steps closed by the same proportional gain with each result
+// as the feed-forward: the sweep's SpeedTable or the straight line up to
+// the calibrated maximum. With no integral, what is left is the
+// feed-forward's own error: the table has to track the steps more closely
+// and settle them, where the line leaves an offset.
+
+static const float TARGETS[] = {300, 1200, 2500, 800, -1000};
+static const unsigned long HOLD_MS = 1500;
+
+// Runs a calibration to the end; false if it did not complete
+static bool calibrate(TestRig &rig, bool sweep)
+{
+    hostSetClock(rig.sim);
+    rig.controller.startCalibration(false, sweep);
+    for (int ms = 0; ms < 60000 && rig.controller.getCalibrator().isRunning(); ms += 100)
+    {
+        rig.run(100);
+    }
+    return rig.controller.getCalibrator().getPhase() == Calibrator::COMPLETE;
+}
+
+struct Tracking {
+    double meanError;   // |RPM| over each hold, averaged
+    double worstSettle; // ms to stay within 2% (at least 10 RPM) of a target
+};
+
+static Tracking trackSteps(TestRig &rig)
+{
+    Tracking tracking = {0, 0};
+    int samples = 0;
+    hostSetClock(rig.sim); // The other rig bound its own
+    rig.controller.setPIDValues(1, 0, 0); // No integral to make up for the feed-forward
+    rig.controller.setTargetSpeed(0);
+    rig.run(3000); // The sweep ends at full speed in reverse
+    for (float target : TARGETS)
+    {
+        rig.controller.setTargetSpeed(target);
+        double band = max(10.0, 0.02 * fabs(target));
+        unsigned long lastOutside = 0;
+        for (unsigned long ms = MotorController::SampleTime; ms <= HOLD_MS; ms += MotorController::SampleTime)
+        {
+            rig.step();
+            double error = fabs(rig.sim.getSpeedRPM() - target);
+            tracking.meanError += error;
+            samples++;
+            if (error > band)
+            {
+                lastOutside = ms;
+            }
+        }
+        tracking.worstSettle = max(tracking.worstSettle, static_cast<double>(lastOutside));
+    }
+    tracking.meanError /= samples;
+    return tracking;
+}
+
+// A geared motor: friction takes a good share of the duty at low speed, so
+// a straight line through zero falls short there
+static MotorParameters gearedMotor()
+{
+    MotorParameters parameters;
+    parameters.coulombFriction = 0.03;
+    parameters.viscousFriction = 1.0e-4;
+    return parameters;
+}
+
+int main()
+{
+    TestRig table(gearedMotor());
+    table.begin();
+    CHECK(calibrate(table, true));
+    const SpeedTable *speedTable = table.controller.getSpeedTable();
+    CHECK(speedTable != nullptr && speedTable->isValid());
+    if (speedTable == nullptr)
+    {
+        return checkResult();
+    }
+    const SpeedCurve &forward = speedTable->forward;
+    printf("sweep: min %.0f RPM, max %.0f RPM; forward deadband %u, %u -> %d RPM ... %u -> %d RPM\n",
+           table.controller.getCalibrator().getMinimumSpeed(), table.controller.getCalibrator().getMaximumSpeed(),
+           forward.deadband, forward.duty[0], forward.rpm[0], forward.duty[SpeedCurve::POINTS - 1],
+           forward.rpm[SpeedCurve::POINTS - 1]);
+    for (int i = 1; i < SpeedCurve::POINTS; i++)
+    {
+        CHECK(forward.rpm[i] > forward.rpm[i - 1] && speedTable->reverse.rpm[i] > speedTable->reverse.rpm[i - 1]);
+    }
+    CHECK(forward.deadband > 0);
+    CHECK_NEAR(forward.rpm[SpeedCurve::POINTS - 1], table.controller.getCalibrator().getMaximumSpeed(),
+               0.03 * table.controller.getCalibrator().getMaximumSpeed());
+    CHECK(table.controller.getPIDGains().kf == 1);
+
+    // The same motor calibrated without the sweep: the linear map, at full strength
+    TestRig linear(gearedMotor());
+    linear.begin();
+    CHECK(calibrate(linear, false));
+    CHECK(linear.controller.getSpeedTable() == nullptr);
+    linear.controller.setFeedForwardGain(1);
+
+    Tracking withTable = trackSteps(table);
+    Tracking withLine = trackSteps(linear);
+    printf("steps to %.0f, %.0f, %.0f, %.0f and %.0f RPM: table mean error %.1f RPM, settled within %.0fms; "
+           "linear map %.1f RPM, %.0fms\n",
+           TARGETS[0], TARGETS[1], TARGETS[2], TARGETS[3], TARGETS[4], withTable.meanError, withTable.worstSettle,
+           withLine.meanError, withLine.worstSettle);
+    CHECK(withTable.meanError < 0.7 * withLine.meanError);
+    CHECK(withTable.worstSettle < withLine.worstSettle);
+    CHECK(withTable.worstSettle < HOLD_MS);
+    return checkResult();
+}
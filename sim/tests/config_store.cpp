@@ -0,0 +1,212 @@
+#include "Check.h"
+#include "EEPROMConfig.h"
+#include "../FlashEmulator.h"
+#include <string.h>
+
+// The config log on the emulated flash: a power cut at every byte of a save
+// and flipped bits in a stored record fall back to the previous settings,
+// the old EEPROM layout is carried over on the first boot, and the erase
+// and write counts stay at one write per save and one erase per sector.
+
+struct Settings {
+    uint32_t counter;
+    char name[56];
+};
+
+static const size_t RECORD_SIZE = 16 + sizeof(Settings); // Header plus payload
+static const size_t RECORDS_PER_SECTOR = FlashEmulator::SECTOR_SIZE / RECORD_SIZE;
+
+static bool save(ConfigStore &store, uint32_t counter)
+{
+    Settings settings = {};
+    settings.counter = counter;
+    snprintf(settings.name, sizeof(settings.name), "record %lu", static_cast<unsigned long>(counter));
+    return store.save(&settings, sizeof(settings), 1);
+}
+
+// A fresh store on the same flash, as after a reboot
+static uint32_t reload(FlashEmulator &flash, uint32_t *corruptRecords = nullptr)
+{
+    ConfigStore store(flash);
+    Settings settings = {};
+    uint16_t version = 0;
+    bool found = store.load(&settings, sizeof(settings), version);
+    if (corruptRecords != nullptr)
+    {
+        *corruptRecords = store.getCorruptRecords();
+    }
+    if (!found)
+    {
+        return 0;
+    }
+    char expected[sizeof(settings.name)];
+    snprintf(expected, sizeof(expected), "record %lu", static_cast<unsigned long>(settings.counter));
+    CHECK(strcmp(settings.name, expected) == 0); // Never a mix of two records
+    CHECK(version == 1);
+    return settings.counter;
+}
+
+static void powerCuts()
+{
+    for (size_t cut = 0; cut < RECORD_SIZE; cut++)
+    {
+        FlashEmulator flash;
+        ConfigStore store(flash);
+        CHECK(save(store, 1));
+        CHECK(save(store, 2));
+        flash.cutPowerAfter(cut);
+        CHECK(!save(store, 3));
+        CHECK(store.getFailedSaves() == 1);
+        CHECK(reload(flash) == 2);
+
+        // The torn record is left behind and the next save is still found
+        CHECK(save(store, 4));
+        CHECK(reload(flash) == 4);
+    }
+}
+
+static void flippedBits()
+{
+    FlashEmulator flash;
+    ConfigStore store(flash);
+    for (uint32_t counter = 1; counter <= 3; counter++)
+    {
+        CHECK(save(store, counter));
+    }
+
+    // Payload of the newest record, in sector 1 after the first save
+    flash.flipBit(1, 2 * RECORD_SIZE + 16 + 10, 3);
+    uint32_t corrupt = 0;
+    CHECK(reload(flash, &corrupt) == 2);
+    CHECK(corrupt == 1);
+
+    // Its header: the sequence is under the CRC too
+    flash.flipBit(1, RECORD_SIZE + 4, 0);
+    CHECK(reload(flash, &corrupt) == 1);
+    CHECK(corrupt == 2);
+
+    // A save after the damage is found again
+    CHECK(save(store, 4));
+    CHECK(reload(flash) == 4);
+}
+
+static void wear()
+{
+    FlashEmulator flash;
+    ConfigStore store(flash);
+    const uint32_t saves = 10 * RECORDS_PER_SECTOR + 7;
+    for (uint32_t counter = 1; counter <= saves; counter++)
+    {
+        uint32_t erases = store.getEraseCount();
+        CHECK(save(store, counter));
+        CHECK(store.getEraseCount() - erases <= 1);
+    }
+    printf("%lu saves of %lu bytes: %lu writes, %lu erases (sector 0 %lu, sector 1 %lu)\n",
+           static_cast<unsigned long>(saves), static_cast<unsigned long>(RECORD_SIZE),
+           static_cast<unsigned long>(store.getWriteCount()), static_cast<unsigned long>(store.getEraseCount()),
+           flash.getEraseCount(0), flash.getEraseCount(1));
+    CHECK(store.getWriteCount() == saves);
+    CHECK(flash.getWriteCount(0) + flash.getWriteCount(1) == saves);
+    CHECK(store.getEraseCount() == 1 + (saves - 1) / RECORDS_PER_SECTOR); // One per filled sector
+    CHECK(flash.getEraseCount(0) + flash.getEraseCount(1) == store.getEraseCount());
+    CHECK(reload(flash) == saves);
+}
+
+// Writes a value at a byte offset of the old EEPROM layout
+template <typename T>
+static void putLegacy(FlashEmulator &flash, int offset, const T &value)
+{
+    memcpy(flash.data(0) + offset, &value, sizeof(value));
+}
+
+static void migration()
+{
+    FlashEmulator flash;
+    uint8_t *legacy = flash.data(0);
+    memset(legacy, 0, 512);
+    strcpy(reinterpret_cast<char *>(legacy), "workshop");
+    strcpy(reinterpret_cast<char *>(legacy + 32), "secret");
+    legacy[99] = 0xAA;
+    memcpy(legacy + 100, "0123456789abcdef0123456789abcdef0123", 36);
+    putLegacy(flash, 137, 55.0f);
+    putLegacy(flash, 141, static_cast<int32_t>(3200));
+    putLegacy(flash, 145, 11.5f);
+    strcpy(reinterpret_cast<char *>(legacy + 149), "lathe");
+    putLegacy(flash, 170, 120.0);
+    putLegacy(flash, 178, 3400.0);
+    legacy[186] = 0; // Calibrated
+    legacy[187] = 0xA5;
+    PIDGains gains = {1.5f, 4, 0.01f, 0.2f};
+    putLegacy(flash, 188, gains);
+    legacy[204] = 0xFF; // No speed table
+
+    EEPROMConfig config(flash);
+    config.begin();
+    char text[65];
+    config.readSSID(text);
+    CHECK(strcmp(text, "workshop") == 0);
+    config.readPassword(text);
+    CHECK(strcmp(text, "secret") == 0);
+    CHECK(config.hasGUID());
+    config.readGUID(text);
+    CHECK(strcmp(text, "0123456789abcdef0123456789abcdef0123") == 0);
+    CHECK(config.readTemperatureCutoff() == 55.0f);
+    CHECK(config.readMaxRPM() == 3200);
+    CHECK(config.readVoltageCutoff() == 11.5f);
+    CHECK(config.readDeviceName() == "lathe");
+    CHECK(!config.readCalibrationState());
+    CHECK(config.readMinOperationalSpeed() == 120.0);
+    CHECK(config.readMaxOperationalSpeed() == 3400.0);
+    PIDGains stored;
+    CHECK(config.readPIDGains(stored));
+    CHECK(memcmp(&stored, &gains, sizeof(gains)) == 0);
+    SpeedTable table;
+    CHECK(!config.readSpeedTable(table));
+    CHECK(config.readFailsafeRamp() == 500); // Newer fields at their defaults
+
+    // Copied into the log in sector 1; the old layout is left alone
+    CHECK(config.getStore().getSequence() == 1);
+    CHECK(flash.getEraseCount(0) == 0 && flash.getWriteCount(0) == 0);
+    CHECK(flash.getWriteCount(1) == 1);
+    CHECK(strcmp(reinterpret_cast<char *>(legacy), "workshop") == 0);
+
+    // The next boot reads the log and writes nothing
+    EEPROMConfig rebooted(flash);
+    rebooted.begin();
+    CHECK(rebooted.readMaxRPM() == 3200);
+    CHECK(rebooted.readDeviceName() == "lathe");
+    CHECK(flash.getWriteCount(1) == 1);
+}
+
+static void failedCommit()
+{
+    FlashEmulator flash;
+    EEPROMConfig config(flash);
+    config.begin();
+    CHECK(flash.getWriteCount(0) + flash.getWriteCount(1) == 0); // A blank flash is not written at boot
+
+    config.writeMaxRPM(2000);
+    CHECK(config.commit());
+    config.writeMaxRPM(2500);
+    flash.cutPowerAfter(8);
+    CHECK(!config.commit());
+    CHECK(config.getStore().getFailedSaves() == 1);
+
+    // Still dirty: the next commit writes it
+    CHECK(config.commit());
+    CHECK(config.commit()); // Nothing left to save
+    CHECK(config.getStore().getWriteCount() == 3);
+    EEPROMConfig rebooted(flash);
+    rebooted.begin();
+    CHECK(rebooted.readMaxRPM() == 2500);
+}
+
+int main()
+{
+    powerCuts();
+    flippedBits();
+    wear();
+    migration();
+    failedCommit();
+    return checkResult();
+}
@@ -0,0 +1,119 @@
+#include "Check.h"
+#include "TestRig.h"
+#include "DashboardSocket.h"
+#include <string>
+
+// The /dashboard WebSocket against browsers that behave and one that stops
+// acking. Time only moves in the simulated socket when it would block on
+// the ESP8266, so service() must take none: a stalled browser is dropped
+// without waiting, and one that closes politely gets its close frame.
+
+static const uint16_t PORT = 81;
+static const unsigned long MAX_SERVICE_MICROS = 1000; // Well under a control period
+
+struct Feed {
+    TestRig &rig;
+    DashboardSocket &dashboard;
+    unsigned long worstMicros;
+
+    // Steps the loop with the socket in its slack time
+    void run(unsigned long ms)
+    {
+        for (unsigned long i = 0; i < ms / MotorController::SampleTime; i++)
+        {
+            rig.step();
+            unsigned long start = rig.sim.micros();
+            dashboard.service();
+            unsigned long spent = rig.sim.micros() - start;
+            worstMicros = spent > worstMicros ? spent : worstMicros;
+        }
+    }
+};
+
+// Text frames in what the server sent, after the handshake response if it
+// is there, and whether there was a close frame
+static int countFrames(const std::string &received, bool *closed)
+{
+    size_t offset = received.compare(0, 5, "HTTP/") == 0 ? received.find("\r\n\r\n") + 4 : 0;
+    int frames = 0;
+    *closed = false;
+    while (offset + 2 <= received.size())
+    {
+        uint8_t opcode = received[offset] & 0x0F;
+        size_t length = received[offset + 1] & 0x7F;
+        frames += opcode == 0x1;
+        *closed = *closed || opcode == 0x8;
+        offset += 2 + length;
+    }
+    return frames;
+}
+
+static void handshake(HostPeer &peer)
+{
+    peer.connect(PORT);
+    peer.send("GET / HTTP/1.1\r\nHost: wmc\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+              "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(600);
+    DashboardSocket dashboard(rig.controller, rig.aht21Sensor);
+    dashboard.begin(PORT, 20);
+    Feed feed = {rig, dashboard, 0};
+
+    // Two browsers streaming; the accept key is RFC 6455's example
+    HostPeer healthy, stalled;
+    handshake(healthy);
+    handshake(stalled);
+    feed.run(1000);
+    std::string received = stalled.receive();
+    bool closed;
+    CHECK(received.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != std::string::npos);
+    CHECK(countFrames(received, &closed) >= 19);
+    CHECK(dashboard.getClientCount() == 2);
+
+    // One stops acking: its send buffer fills, pushes to it are skipped and
+    // it is dropped after STALL_TIMEOUT_MS while the other carries on
+    stalled.setStalled(true);
+    healthy.receive();
+    feed.run(DashboardSocket::STALL_TIMEOUT_MS + 5000);
+    int healthyFrames = countFrames(healthy.receive(), &closed);
+    printf("stalled browser: %lu frames skipped, %zu bytes unacked when dropped, %s; the other took %d frames; "
+           "service() waited up to %luus\n",
+           dashboard.getFramesSkipped(), stalled.inFlight(), stalled.wasAborted() ? "reset" : "closed",
+           healthyFrames, feed.worstMicros);
+    CHECK(dashboard.getFramesSkipped() > 0);
+    CHECK(!stalled.isOpen());
+    CHECK(stalled.wasAborted());
+    CHECK(dashboard.getClientCount() == 1);
+    CHECK(healthyFrames >= 10000 / 50 - 2);
+    CHECK(feed.worstMicros < MAX_SERVICE_MICROS);
+
+    // The healthy one closes: it gets the close frame back and a clean close
+    static const uint8_t CLOSE_FRAME[] = {0x88, 0x80, 1, 2, 3, 4}; // Masked, empty
+    healthy.send(CLOSE_FRAME, sizeof(CLOSE_FRAME));
+    feed.run(100);
+    countFrames(healthy.receive(), &closed);
+    CHECK(closed);
+    CHECK(!healthy.isOpen());
+    CHECK(!healthy.wasAborted());
+    CHECK(dashboard.getClientCount() == 0);
+
+    // One that closes while it is not acking gets no wait either
+    HostPeer late;
+    handshake(late);
+    feed.run(200);
+    late.setStalled(true);
+    feed.run(200);
+    late.send(CLOSE_FRAME, sizeof(CLOSE_FRAME));
+    feed.run(DashboardSocket::CLOSE_TIMEOUT_MS + 500);
+    printf("close while stalled: %s, service() waited up to %luus\n", late.wasAborted() ? "reset" : "closed",
+           feed.worstMicros);
+    CHECK(!late.isOpen());
+    CHECK(feed.worstMicros < MAX_SERVICE_MICROS);
+    return checkResult();
+}
@@ -0,0 +1,109 @@
+#include "Check.h"
+#include "TestRig.h"
+
+// The encoder's health checks on the simulated AS5600 while the speed loop
+// runs: a single implausible angle is dropped without losing the position,
+// a missing magnet distrusts the encoder and opens the loop on the
+// calibrated linear map, and once the magnet is back the loop closes again
+// without a bump. Uncalibrated, the open loop does not drive the motor.
+
+static const double TARGET = 1000;
+static const double TICKS_PER_RADIAN = 4096 / (2 * M_PI);
+
+// Encoder position against the shaft since a reference point, in ticks
+static double positionError(TestRig &rig, int64_t startPosition, double startAngle)
+{
+    double shaft = (rig.sim.getAngle() - startAngle) * TICKS_PER_RADIAN;
+    return fabs(fabs(static_cast<double>(rig.encoder.getPosition() - startPosition)) - fabs(shaft));
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.startCalibration(false, false); // No sweep: the linear map
+    for (int ms = 0; ms < 60000 && rig.controller.getCalibrator().isRunning(); ms += 100)
+    {
+        rig.run(100);
+    }
+    CHECK(rig.controller.getCalibrator().getPhase() == Calibrator::COMPLETE);
+    CHECK(rig.controller.getSpeedTable() == nullptr);
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(TARGET);
+    rig.run(2000);
+    const Encoder::Health &health = rig.encoder.getHealth();
+    CHECK(rig.encoder.isTrusted());
+    CHECK(!rig.controller.isOpenLoop());
+    unsigned long outliers = health.outliers; // The calibration's full-duty starts may leave some
+
+    // A half-turn jump in one reading is dropped and the count carries on
+    int64_t startPosition = rig.encoder.getPosition();
+    double startAngle = rig.sim.getAngle();
+    rig.sim.glitchAngle(1);
+    rig.run(200);
+    printf("glitch: %lu outlier(s), position off by %.1f ticks, %.0f RPM\n", health.outliers - outliers,
+           positionError(rig, startPosition, startAngle), fabs(rig.encoder.getSpeed()));
+    CHECK(health.outliers == outliers + 1);
+    CHECK(positionError(rig, startPosition, startAngle) < 10);
+    CHECK(rig.encoder.isTrusted());
+    CHECK(!rig.controller.isOpenLoop());
+    CHECK_NEAR(fabs(rig.encoder.getSpeed()), TARGET, 0.05 * TARGET);
+
+    // The magnet goes: STATUS says so and the angle is noise, so the loop
+    // runs open from the duty map and the motor keeps near the target
+    unsigned long distrusts = health.distrusts;
+    unsigned long entries = rig.controller.getOpenLoopEntries();
+    rig.sim.setMagnetMissing(true);
+    rig.run(1000);
+    printf("magnet missing: trusted %d, open loop %d, status 0x%02x, AGC %u, %.0f RPM at duty %d\n",
+           rig.encoder.isTrusted(), rig.controller.isOpenLoop(), health.status, health.agc, rig.sim.getSpeedRPM(),
+           rig.controller.getLastSample().pwm);
+    CHECK(!rig.encoder.isTrusted());
+    CHECK(health.distrusts == distrusts + 1);
+    CHECK(rig.controller.isOpenLoop());
+    CHECK(rig.controller.getOpenLoopEntries() == entries + 1);
+    CHECK(health.status & Encoder::STATUS_MAGNET_WEAK);
+    CHECK_NEAR(rig.sim.getSpeedRPM(), TARGET, 0.2 * TARGET);
+
+    // Back: trusted again, the loop closes from where the open loop left the
+    // duty and settles on the target
+    rig.sim.setMagnetMissing(false);
+    double slowest = rig.sim.getSpeedRPM(), fastest = slowest;
+    unsigned long recoveredMs = 0;
+    for (int i = 0; i < 600; i++) // 3s
+    {
+        rig.step();
+        double rpm = rig.sim.getSpeedRPM();
+        slowest = rpm < slowest ? rpm : slowest;
+        fastest = rpm > fastest ? rpm : fastest;
+        if (recoveredMs == 0 && !rig.controller.isOpenLoop())
+        {
+            recoveredMs = (i + 1) * MotorController::SampleTime;
+        }
+    }
+    printf("magnet back: closed loop after %lums, speed between %.0f and %.0f RPM, final %.0f RPM\n", recoveredMs,
+           slowest, fastest, rig.sim.getSpeedRPM());
+    CHECK(rig.encoder.isTrusted());
+    CHECK(!rig.controller.isOpenLoop());
+    CHECK(recoveredMs > 0 && recoveredMs < 1000);
+    CHECK(slowest > 0.5 * TARGET); // No dip through zero at the handover
+    CHECK_NEAR(rig.sim.getSpeedRPM(), TARGET, 0.02 * TARGET);
+    CHECK_NEAR(fabs(rig.encoder.getSpeed()), TARGET, 0.05 * TARGET);
+    CHECK(health.distrusts == distrusts + 1);
+
+    // Uncalibrated, the map's maximum is a default: the open loop lets the
+    // motor go rather than guess a duty
+    TestRig uncalibrated;
+    uncalibrated.begin();
+    uncalibrated.controller.setPIDValues(1, 5, 0);
+    uncalibrated.controller.setTargetSpeed(TARGET);
+    uncalibrated.run(2000);
+    uncalibrated.sim.setMagnetMissing(true);
+    uncalibrated.run(1000);
+    printf("uncalibrated, magnet missing: open loop %d, duty %d, %.0f RPM\n", uncalibrated.controller.isOpenLoop(),
+           uncalibrated.controller.getLastSample().pwm, uncalibrated.sim.getSpeedRPM());
+    CHECK(uncalibrated.controller.isOpenLoop());
+    CHECK(uncalibrated.controller.getLastSample().pwm == 0);
+    CHECK(uncalibrated.sim.getSpeedRPM() < TARGET);
+    return checkResult();
+}
@@ -0,0 +1,83 @@
+#include "Check.h"
+#include "EncoderSampleQueue.h"
+#include <atomic>
+#include <thread>
+
+// EncoderSampleQueue with the producer and consumer on two threads, which
+// is harsher than the ESP8266's ISR and loop. Every sample's fields are
+// derived from its sequence number, so a half-written slot shows up as a
+// mismatch; a refused push must show up as a gap of the same size. Runs in
+// the normal test pass and, through make tsan, under ThreadSanitizer.
+
+static const uint32_t SAMPLES = 2000000;
+
+static EncoderSample sampleFor(uint32_t sequence)
+{
+    EncoderSample sample;
+    sample.sequence = sequence;
+    sample.timestampMicros = sequence * 5000UL + (sequence % 97);
+    return sample;
+}
+
+int main()
+{
+    EncoderSampleQueue queue;
+    std::atomic<bool> done(false);
+    unsigned long refused = 0;
+
+    std::thread producer([&]() {
+        for (uint32_t sequence = 0; sequence < SAMPLES; sequence++)
+        {
+            // Mostly wait for room, so both sides run flat out against each
+            // other; every so often give up at once, as Encoder::sample() does
+            bool dropAllowed = sequence % 1000 >= 990;
+            while (!queue.push(sampleFor(sequence)))
+            {
+                if (dropAllowed)
+                {
+                    refused++;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    unsigned long received = 0, gaps = 0, torn = 0, reordered = 0;
+    uint32_t expected = 0;
+    EncoderSample sample;
+    for (;;)
+    {
+        bool finished = done.load(std::memory_order_acquire);
+        while (queue.pop(sample))
+        {
+            EncoderSample reference = sampleFor(sample.sequence);
+            torn += sample.timestampMicros != reference.timestampMicros;
+            reordered += sample.sequence < expected;
+            gaps += sample.sequence - expected;
+            expected = sample.sequence + 1;
+            received++;
+            if (received % 4096 == 0)
+            {
+                std::this_thread::yield(); // Fall behind now and then so pushes are refused
+            }
+        }
+        if (finished)
+        {
+            break;
+        }
+        std::this_thread::yield();
+    }
+    producer.join();
+    gaps += SAMPLES - expected; // Refused at the very end
+
+    printf("%lu samples: %lu received, %lu refused, %lu in gaps, %lu torn, %lu out of order\n",
+           static_cast<unsigned long>(SAMPLES), received, refused, gaps, torn, reordered);
+    CHECK(torn == 0);
+    CHECK(reordered == 0);
+    CHECK(received + refused == SAMPLES);
+    CHECK(gaps == refused);
+    CHECK(queue.size() == 0);
+    return checkResult();
+}
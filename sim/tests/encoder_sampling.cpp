@@ -0,0 +1,111 @@
+#include "Check.h"
+#include "TestRig.h"
+#include <stdlib.h>
+
+// Encoder sampling as the firmware does it: sample() at every tick, as the
+// timer interrupt calls it, while the loop that drains the queue runs late
+// by a random number of ticks. The interrupt side must never touch the bus;
+// the loop reads one angle for the ticks it picks up, none may be lost
+// within the queue's capacity and the position must follow the shaft's. A
+// stall longer than that loses exactly the overflow.
+
+static const double TICKS_PER_RADIAN = 4096 / (2 * M_PI);
+static const double MAX_POSITION_ERROR = 10; // Ticks, the shaft turns about 4 during the angle read at 600 RPM
+
+struct Counts {
+    unsigned long taken, skipped, lost, direct;
+};
+
+static Counts counts(Encoder &encoder)
+{
+    Counts counts = {encoder.getSamplesTaken(), encoder.getSamplesSkipped(), encoder.getSamplesLost(),
+                     encoder.getDirectReads()};
+    return counts;
+}
+
+// One tick: time moves to the next period and the interrupt samples
+static void tick(TestRig &rig)
+{
+    rig.sim.advanceMicros(TestRig::PERIOD_MICROS - rig.sim.micros() % TestRig::PERIOD_MICROS);
+    unsigned long transfers = rig.bus.getDirectStats().count;
+    unsigned long now = rig.sim.micros();
+    rig.encoder.sample(now);
+    CHECK(rig.bus.getDirectStats().count == transfers && rig.sim.micros() == now); // Nothing read, no time taken
+}
+
+// The loop catching up on whatever the interrupt queued
+static void loop(TestRig &rig)
+{
+    rig.encoder.update();
+    rig.controller.update();
+    rig.aht21Sensor.update();
+    rig.bus.service();
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(600);
+    rig.run(1000);
+
+    // On time, the angle is read as soon as the control step runs
+    rig.encoder.resetSampleStats();
+    rig.run(200);
+    unsigned long onTimeLatency = rig.encoder.getMaxSampleLatency();
+    CHECK(rig.encoder.getSamplesTaken() == 200 / MotorController::SampleTime);
+    CHECK(onTimeLatency < 200); // One register read at 400kHz
+
+    srand(3);
+    Counts before = counts(rig.encoder);
+    double startAngle = rig.sim.getAngle();
+    int64_t startPosition = rig.encoder.getPosition();
+    unsigned long ticks = 0, loops = 0;
+    double worstError = 0;
+    for (int i = 0; i < 2000; i++)
+    {
+        int late = rand() % EncoderSampleQueue::CAPACITY; // Up to a full queue of backlog
+        for (int t = 0; t <= late; t++)
+        {
+            tick(rig);
+            ticks++;
+        }
+        loop(rig);
+        loops++;
+        double shaft = (rig.sim.getAngle() - startAngle) * TICKS_PER_RADIAN;
+        double error = fabs(fabs(static_cast<double>(rig.encoder.getPosition() - startPosition)) - fabs(shaft));
+        worstError = error > worstError ? error : worstError;
+    }
+    Counts after = counts(rig.encoder);
+    printf("%lu ticks drained late in %lu passes: taken %lu, skipped %lu, lost %lu, direct reads %lu; worst position "
+           "error %.1f ticks; latency %luus on time, %luus late\n",
+           ticks, loops, after.taken - before.taken, after.skipped - before.skipped, after.lost - before.lost,
+           after.direct - before.direct, worstError, onTimeLatency, rig.encoder.getMaxSampleLatency());
+    CHECK(after.taken - before.taken == loops); // One angle a pass
+    CHECK(after.skipped - before.skipped == ticks - loops);
+    CHECK(after.lost == before.lost);
+    CHECK(after.direct == before.direct);
+    CHECK(worstError < MAX_POSITION_ERROR);
+    CHECK_NEAR(fabs(rig.encoder.getSpeed()), rig.sim.getSpeedRPM(), 0.05 * 600);
+
+    // A stall of twelve ticks overflows the eight-slot queue by four. The
+    // gap shows once the next tick arrives.
+    before = counts(rig.encoder);
+    for (int t = 0; t < 12; t++)
+    {
+        tick(rig);
+    }
+    loop(rig);
+    tick(rig);
+    loop(rig);
+    after = counts(rig.encoder);
+    printf("12 tick stall: taken %lu, skipped %lu, lost %lu\n", after.taken - before.taken,
+           after.skipped - before.skipped, after.lost - before.lost);
+    CHECK(after.taken - before.taken == 2);
+    CHECK(after.skipped - before.skipped == EncoderSampleQueue::CAPACITY - 1);
+    CHECK(after.lost - before.lost == 12 - EncoderSampleQueue::CAPACITY);
+    double shaft = (rig.sim.getAngle() - startAngle) * TICKS_PER_RADIAN;
+    CHECK(fabs(fabs(static_cast<double>(rig.encoder.getPosition() - startPosition)) - fabs(shaft)) < MAX_POSITION_ERROR);
+    return checkResult();
+}
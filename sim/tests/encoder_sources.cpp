@@ -0,0 +1,92 @@
+#include "Check.h"
+#include "TestRig.h"
+#include <chrono>
+
+// The three encoder sources on the simulated AS5600: /encoder/benchmark's
+// figures for each, in simulated time along with what a read costs on this
+// machine, run a slice at a time between control steps as the slack task
+// does, then each source closing the speed loop, slowly enough for the
+// once a second cross-check against the bus and then at speed.
+
+static const char *sourceNames[] = {"i2c", "analog", "pwm"};
+
+static void checkSource(Encoder::Source source)
+{
+    TestRig rig;
+    rig.sim.setOutOnA0(source == Encoder::SOURCE_ANALOG);
+    rig.begin(source);
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.run(100); // A few PWM frames
+
+    const int samples = 200;
+    CHECK(rig.encoder.startBenchmark(samples));
+    CHECK(!rig.encoder.startBenchmark(samples)); // One run at a time
+    auto start = std::chrono::steady_clock::now();
+    unsigned long longestSlice = 0;
+    int steps = 0;
+    while (rig.encoder.getBenchmarkRun().running)
+    {
+        rig.step();
+        unsigned long sliceStart = rig.sim.micros();
+        rig.encoder.serviceBenchmark();
+        longestSlice = max(longestSlice, rig.sim.micros() - sliceStart);
+        steps++;
+    }
+    double hostNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (3 * samples);
+    const Encoder::BenchmarkRun &run = rig.encoder.getBenchmarkRun();
+    const Encoder::Benchmark &result = run.results[source];
+    printf("%-6s %d/%d reads, %.1fus and %lu cycles each, up to %luHz; %d steps, slices up to %luus; "
+           "%.0fns a read and step on the host\n",
+           sourceNames[source], result.samples, samples, result.microsPerSample,
+           static_cast<unsigned long>(result.cyclesPerSample), result.maxRateHz, steps, longestSlice, hostNanos);
+    CHECK(result.samples == samples);
+    CHECK(run.runs == 1);
+    CHECK(longestSlice < Encoder::BENCHMARK_SLICE_MICROS + 200); // One read past the slice at most
+    CHECK(result.maxRateHz > 0);
+
+    // Slow, so the OUT reading is compared with the bus every second
+    rig.controller.setTargetSpeed(40);
+    rig.run(5000);
+    const Encoder::CrossCheck &crossCheck = rig.encoder.getCrossCheck();
+    printf("%-6s at %.0f RPM: %lu cross-checks, offset %d, last error %d, worst %d ticks\n", sourceNames[source],
+           rig.sim.getSpeedRPM(), crossCheck.count, crossCheck.offset, crossCheck.lastError, crossCheck.maxError);
+
+    // Fast: the loop holds speed on this source alone
+    rig.controller.setTargetSpeed(1500);
+    rig.run(3000);
+    printf("%-6s at 1500 RPM: simulated %.0f RPM, estimated %.0f RPM\n", sourceNames[source], rig.sim.getSpeedRPM(),
+           fabs(rig.encoder.getSpeed()));
+    CHECK_NEAR(rig.sim.getSpeedRPM(), 1500, 0.03 * 1500);
+    CHECK_NEAR(fabs(rig.encoder.getSpeed()), rig.sim.getSpeedRPM(), 0.03 * 1500);
+    CHECK(rig.encoder.isTrusted());
+
+    if (source == Encoder::SOURCE_I2C)
+    {
+        CHECK(crossCheck.count == 0); // Nothing to compare against
+        CHECK(result.microsPerSample > 40 && result.microsPerSample < 200); // Three bytes at 400kHz and the bus overhead
+        CHECK(result.maxRateHz > 5000);
+    }
+    else
+    {
+        CHECK(crossCheck.count >= 4);
+        CHECK(abs(crossCheck.maxError) <= (source == Encoder::SOURCE_ANALOG ? 16 : 4));
+    }
+    if (source == Encoder::SOURCE_ANALOG)
+    {
+        CHECK_NEAR(result.microsPerSample, MotorParameters().adcMicros, 1); // The conversion alone
+        CHECK(result.maxRateHz > 5000);
+    }
+    if (source == Encoder::SOURCE_PWM)
+    {
+        CHECK(result.microsPerSample < 40); // No bus transfer or conversion
+        CHECK(result.maxRateHz == 920); // One angle per PWM frame
+    }
+}
+
+int main()
+{
+    checkSource(Encoder::SOURCE_I2C);
+    checkSource(Encoder::SOURCE_ANALOG);
+    checkSource(Encoder::SOURCE_PWM);
+    return checkResult();
+}
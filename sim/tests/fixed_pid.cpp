@@ -0,0 +1,201 @@
+#include "Check.h"
+#include "FixedPID.h"
+#include "../MotorSimulator.h"
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+
+// FixedPID against the PID_v1 library it replaced: the same outputs step
+// for step while neither saturates, the same step response on the simulated
+// motor, limits that move without disturbing the integral, and the cost of
+// a compute() on this machine.
+
+// PID_v1 1.2.1 Compute() and SetOutputLimits() for DIRECT, proportional on
+// error, with the gains already scaled to the sample time as SetTunings()
+// leaves them
+class ReferencePID {
+public:
+    ReferencePID(double kp, double ki, double kd, double sampleTime)
+        : _kp(kp), _ki(ki * sampleTime), _kd(kd / sampleTime), _outputSum(0), _lastInput(0), _output(0),
+          _outMin(-1023), _outMax(1023) {}
+
+    void setOutputLimits(double min, double max)
+    {
+        if (min >= max)
+        {
+            return;
+        }
+        _outMin = min;
+        _outMax = max;
+        _output = _output > max ? max : _output < min ? min : _output;
+        _outputSum = _outputSum > max ? max : _outputSum < min ? min : _outputSum;
+    }
+
+    double compute(double setpoint, double input)
+    {
+        double error = setpoint - input;
+        double dInput = input - _lastInput;
+        _outputSum += _ki * error;
+        _outputSum = _outputSum > _outMax ? _outMax : _outputSum < _outMin ? _outMin : _outputSum;
+        double output = _kp * error + _outputSum - _kd * dInput;
+        _output = output > _outMax ? _outMax : output < _outMin ? _outMin : output;
+        _lastInput = input;
+        return _output;
+    }
+
+    double getOutputSum() const { return _outputSum; }
+
+private:
+    double _kp, _ki, _kd;
+    double _outputSum, _lastInput, _output, _outMin, _outMax;
+};
+
+static const float SAMPLE_TIME = 0.005f;
+static const int32_t PWM_LIMIT = 1023L << FixedPID::FRACTION_BITS;
+
+static void stepForStep()
+{
+    ReferencePID reference(2, 0.1, 0.1, SAMPLE_TIME); // The firmware's defaults
+    FixedPID pid;
+    pid.setOutputLimits(-PWM_LIMIT, PWM_LIMIT);
+    pid.setTunings(2, 0.1f, 0.1f, SAMPLE_TIME);
+
+    srand(2);
+    double setpoint = 0, noise = 0, worst = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        // A wandering setpoint and an input that follows it with noise,
+        // gentle enough that neither the output nor the integral saturates
+        setpoint += (rand() % 21 - 10) * 0.5;
+        setpoint = setpoint > 300 ? 300 : setpoint < -300 ? -300 : setpoint;
+        noise = 0.9 * noise + (rand() % 21 - 10);
+        double input = setpoint + noise;
+        // Inputs on the fixed-point grid so only the arithmetic differs
+        input = FixedPID::toFloat(FixedPID::fromFloat(input));
+        setpoint = FixedPID::toFloat(FixedPID::fromFloat(setpoint));
+        double expected = reference.compute(setpoint, input);
+        double actual = FixedPID::toFloat(pid.compute(FixedPID::fromFloat(setpoint), FixedPID::fromFloat(input)));
+        worst = fabs(actual - expected) > worst ? fabs(actual - expected) : worst;
+    }
+    printf("step for step: worst difference %.5f duty over 100000 steps\n", worst);
+    CHECK(worst < 0.01);
+}
+
+// Speed in PWM units as MotorController scales it before calibration
+static double speedUnits(MotorSimulator &sim)
+{
+    return sim.getSpeedRPM() * 1023 / 3500;
+}
+
+static void drive(MotorSimulator &sim, double duty)
+{
+    int pwm = static_cast<int>(lround(duty));
+    sim.setDuty(14, pwm > 0 ? pwm : 0);
+    sim.setDuty(12, pwm < 0 ? -pwm : 0);
+}
+
+struct Response {
+    double absoluteError; // Integral of |error|, duty.s
+    double finalSpeed;    // RPM
+};
+
+template <typename Compute>
+static Response stepResponse(Compute compute)
+{
+    MotorSimulator sim(14, 12, 13, 15);
+    sim.write(13, 1); // Enable both half-bridges
+    sim.write(15, 1);
+    Response response = {0, 0};
+    for (int i = 0; i < 1200; i++) // 0 -> 1500 RPM, then -1000 RPM
+    {
+        double setpoint = (i < 600 ? 1500 : -1000) * 1023 / 3500.0;
+        double input = speedUnits(sim);
+        drive(sim, compute(setpoint, input));
+        sim.advanceMicros(5000);
+        response.absoluteError += fabs(setpoint - input) * SAMPLE_TIME;
+    }
+    response.finalSpeed = sim.getSpeedRPM();
+    return response;
+}
+
+static void controlQuality()
+{
+    ReferencePID reference(1, 5, 0.002, SAMPLE_TIME);
+    Response expected = stepResponse([&](double setpoint, double input) { return reference.compute(setpoint, input); });
+
+    FixedPID pid;
+    pid.setOutputLimits(-PWM_LIMIT, PWM_LIMIT);
+    pid.setTunings(1, 5, 0.002f, SAMPLE_TIME);
+    Response actual = stepResponse([&](double setpoint, double input) {
+        return FixedPID::toFloat(pid.compute(FixedPID::fromFloat(setpoint), FixedPID::fromFloat(input)));
+    });
+
+    printf("step response: |error| integral PID_v1 %.2f, FixedPID %.2f; final %.1f / %.1f RPM\n",
+           expected.absoluteError, actual.absoluteError, expected.finalSpeed, actual.finalSpeed);
+    CHECK(actual.absoluteError <= expected.absoluteError * 1.05); // Anti-windup may only help
+    CHECK_NEAR(actual.finalSpeed, expected.finalSpeed, 10);
+    CHECK_NEAR(actual.finalSpeed, -1000, 20);
+}
+
+// Derating moves the limits a little every step; while the output is within
+// them, the integral must not change
+static void movingLimits()
+{
+    FixedPID pid;
+    pid.setOutputLimits(-PWM_LIMIT, PWM_LIMIT);
+    pid.setTunings(2, 5, 0.1f, SAMPLE_TIME);
+    for (int i = 0; i < 200; i++)
+    {
+        pid.compute(FixedPID::fromFloat(400), FixedPID::fromFloat(380));
+    }
+    int32_t integral = pid.getIntegral();
+    for (int limit = 1023; limit > 900; limit--)
+    {
+        pid.setOutputLimits(-(static_cast<int32_t>(limit) << FixedPID::FRACTION_BITS), static_cast<int32_t>(limit) << FixedPID::FRACTION_BITS);
+    }
+    CHECK(pid.getIntegral() == integral);
+
+    // Below the integral it is clamped, as PID_v1 does
+    pid.setOutputLimits(-FixedPID::fromFloat(50), FixedPID::fromFloat(50));
+    CHECK(pid.getIntegral() <= FixedPID::fromFloat(50));
+    CHECK(pid.getOutput() <= FixedPID::fromFloat(50));
+    CHECK(FixedPID::toFloat(pid.compute(FixedPID::fromFloat(400), FixedPID::fromFloat(380))) <= 50);
+}
+
+static void benchmark()
+{
+    const int iterations = 10000000;
+    FixedPID pid;
+    pid.setOutputLimits(-PWM_LIMIT, PWM_LIMIT);
+    pid.setTunings(2, 0.1f, 0.1f, SAMPLE_TIME);
+    ReferencePID reference(2, 0.1, 0.1, SAMPLE_TIME);
+
+    volatile int32_t fixedSink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        fixedSink = fixedSink + pid.compute((i & 0x3ffff) - 0x20000, ((i * 7) & 0x3ffff) - 0x20000);
+    }
+    double fixedNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    volatile double doubleSink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        doubleSink = doubleSink + reference.compute(((i & 0x3ffff) - 0x20000) / 65536.0, (((i * 7) & 0x3ffff) - 0x20000) / 65536.0);
+    }
+    double doubleNanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+    // This machine has an FPU, so the gap is far smaller than on the ESP8266,
+    // where every double operation is a soft-float call
+    printf("compute() on the host: FixedPID %.1fns, PID_v1 doubles %.1fns\n", fixedNanos, doubleNanos);
+}
+
+int main()
+{
+    stepForStep();
+    controlQuality();
+    movingLimits();
+    benchmark();
+    return checkResult();
+}
@@ -0,0 +1,307 @@
+#include "Check.h"
+#include "TestRig.h"
+#include "CommandChannel.h"
+#include "GroupChannel.h"
+#include <math.h>
+
+// Three controllers on one simulated network, each a CPU of its own with a
+// clock that is offset from the others and drifts: the firmware's
+// ControlScheduler and GroupChannel run on each, in turn, a few
+// microseconds of true time at a time. A coordinator in the test syncs
+// them as apitest/groupClient.js does, keeping the exchange with the
+// shortest round trip, and the ticks are checked to converge onto the
+// group clock, drift off it and come back with a second sync; then a group
+// frame starts all three motors on one tick.
+
+static const unsigned long PERIOD_MICROS = TestRig::PERIOD_MICROS;
+static const unsigned long SLICE_MICROS = 10; // True time between turns
+static const uint16_t GROUP_PORT = 5603;     // As wmc.ino
+static const IPAddress GROUP_ADDRESS(239, 255, 87, 67);
+static const IPAddress COORDINATOR_ADDRESS(192, 168, 4, 2);
+static const int CONTROLLERS = 3;
+static const int SYNC_EXCHANGES = 5;
+
+// True time, which the coordinator's clock is and so the group clock
+static unsigned long trueMicros = 0;
+
+struct Controller {
+    TestRig rig;
+    HostCpu cpu;
+    ControlScheduler scheduler;
+    CommandChannel commandChannel;
+    GroupChannel groupChannel;
+    double offsetMicros; // Local clock at true time 0
+    double rate;         // Local microseconds per true one
+    unsigned long appliedAt; // True time of the tick a group command was applied on, 0 until then
+
+    Controller(int index, double offset, double driftPpm, unsigned long startMicros)
+        : cpu(rig.sim), scheduler(PERIOD_MICROS), commandChannel(rig.controller),
+          groupChannel(commandChannel, scheduler, rig.config), offsetMicros(offset), rate(1 + driftPpm * 1e-6),
+          appliedAt(0)
+    {
+        hostSelectCpu(cpu);
+        rig.begin();
+        rig.controller.setPIDValues(1, 5, 0);
+        groupChannel.setGroups(1);
+        groupChannel.begin(IPAddress(192, 168, 4, 10 + index), GROUP_ADDRESS, GROUP_PORT);
+        scheduler.setControlTask([this]() {
+            groupChannel.poll();
+            groupChannel.update();
+            rig.encoder.sample(scheduler.getLastTickMicros()); // The tick hook's work: a hook has no controller to go to here
+            rig.encoder.update();
+            rig.controller.update();
+        });
+        scheduler.addSlackTask([this]() { groupChannel.poll(); }, 200, "group");
+        // Powered up at true time startMicros, busy until then
+        rig.sim.advanceMicros(lround(offsetMicros + startMicros * rate) - rig.sim.micros());
+        scheduler.begin();
+    }
+
+    unsigned long toTrue(unsigned long local) const { return lround((local - offsetMicros) / rate); }
+
+    // Catches the local clock up with true time, taking the timer interrupt
+    // when it falls due, and runs one pass of the loop. A pass that took
+    // longer (a bus read) leaves the clock ahead: the CPU is still busy
+    // until true time catches up, and sees nothing sent meanwhile.
+    void turn()
+    {
+        unsigned long local = lround(offsetMicros + trueMicros * rate);
+        if (static_cast<long>(local - rig.sim.micros()) < 0)
+        {
+            return;
+        }
+        hostSelectCpu(cpu);
+        scheduler.attachTimer();
+        rig.sim.advanceMicros(local - rig.sim.micros());
+        hostServiceTimer();
+        scheduler.run();
+        if (appliedAt == 0 && rig.controller.getLastSample().targetRPM != 0)
+        {
+            appliedAt = toTrue(scheduler.getLastTickMicros());
+        }
+    }
+
+    // Where the last tick fell from a period boundary of the group clock
+    long truePhase() const
+    {
+        long phase = toTrue(scheduler.getLastTickMicros()) % PERIOD_MICROS;
+        return phase >= static_cast<long>(PERIOD_MICROS / 2) ? phase - PERIOD_MICROS : phase;
+    }
+};
+
+static Controller *controllers[CONTROLLERS];
+
+static void advance(unsigned long micros)
+{
+    for (unsigned long end = trueMicros + micros; static_cast<long>(end - trueMicros) > 0;)
+    {
+        trueMicros += SLICE_MICROS;
+        for (Controller *controller : controllers)
+        {
+            controller->turn();
+        }
+    }
+}
+
+static void putU32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// A sync message and its reply, the true time it arrived in *received
+static bool exchange(WiFiUDP &udp, IPAddress address, GroupChannel::SyncType type, uint32_t value, uint8_t *reply,
+                     unsigned long *received)
+{
+    uint8_t message[8] = {'W', 'S', GroupChannel::GROUP_VERSION, static_cast<uint8_t>(type)};
+    putU32(message + 4, value);
+    udp.beginPacket(address, GROUP_PORT);
+    udp.write(message, sizeof(message));
+    udp.endPacket();
+    for (int i = 0; i < 1000 && udp.parsePacket() == 0; i++)
+    {
+        advance(SLICE_MICROS);
+    }
+    *received = trueMicros;
+    return udp.read(reply, 16) >= 8 && reply[3] == type + 1;
+}
+
+// NTP-like: the offset from the exchange with the shortest round trip,
+// sent back to the controller. Returns the round trip.
+static long sync(WiFiUDP &udp, int index, long *offsetError)
+{
+    IPAddress address(192, 168, 4, 10 + index);
+    long bestDelay = 0, bestOffset = 0;
+    for (int i = 0; i < SYNC_EXCHANGES; i++)
+    {
+        uint8_t reply[16];
+        unsigned long t1 = trueMicros, t4;
+        if (!exchange(udp, address, GroupChannel::TIME_REQUEST, t1, reply, &t4))
+        {
+            return -1;
+        }
+        int32_t t2 = getU32(reply + 8), t3 = getU32(reply + 12);
+        long offset = ((t2 - static_cast<int32_t>(t1)) + (t3 - static_cast<int32_t>(t4))) / 2;
+        long delay = static_cast<long>(t4 - t1) - (t3 - t2);
+        if (i == 0 || delay < bestDelay)
+        {
+            bestDelay = delay;
+            bestOffset = offset;
+        }
+        advance(1000);
+    }
+    uint8_t ack[16];
+    unsigned long arrived;
+    CHECK(exchange(udp, address, GroupChannel::TIME_SET, static_cast<uint32_t>(bestOffset), ack, &arrived));
+    // The true offset when it was set
+    const Controller &controller = *controllers[index];
+    *offsetError = bestOffset - lround(controller.offsetMicros + arrived * (controller.rate - 1));
+    return bestDelay;
+}
+
+// Largest distance between two controllers' last ticks, in group time
+static long tickSkew()
+{
+    long low = 0, high = 0;
+    for (int i = 0; i < CONTROLLERS; i++)
+    {
+        long phase = controllers[i]->truePhase();
+        low = i == 0 || phase < low ? phase : low;
+        high = i == 0 || phase > high ? phase : high;
+    }
+    return high - low;
+}
+
+// The worst tickSkew() over a stretch, checked every tick
+static long worstSkewOver(unsigned long micros)
+{
+    long worst = 0;
+    for (unsigned long elapsed = 0; elapsed < micros; elapsed += PERIOD_MICROS)
+    {
+        advance(PERIOD_MICROS);
+        worst = max(worst, tickSkew());
+    }
+    return worst;
+}
+
+static void syncAll(WiFiUDP &coordinator)
+{
+    for (int i = 0; i < CONTROLLERS; i++)
+    {
+        long offsetError = 0;
+        long delay = sync(coordinator, i, &offsetError);
+        printf("controller %d: offset %ld, off by %ldus, round trip %ldus\n", i, controllers[i]->groupChannel.getOffset(),
+               offsetError, delay);
+        CHECK(delay >= 0);
+        hostSelectCpu(controllers[i]->cpu); // isSynced() reads its own millis()
+        CHECK(controllers[i]->groupChannel.isSynced());
+        CHECK(labs(offsetError) <= 2 * static_cast<long>(SLICE_MICROS));
+    }
+}
+
+int main()
+{
+    // Offsets, drifts and power-up times well beyond a crystal's spread, so
+    // nothing lines up by chance: a and b drift 75us a second apart
+    Controller a(0, 2000000, 40, 0), b(1, 31234567, -35, 1700), c(2, 7777777, 10, 3300);
+    controllers[0] = &a;
+    controllers[1] = &b;
+    controllers[2] = &c;
+    WiFiUDP coordinator;
+    coordinator.setLocalAddress(COORDINATOR_ADDRESS);
+    coordinator.begin(5700);
+
+    advance(500000);
+    long before = tickSkew();
+    CHECK(before > static_cast<long>(PERIOD_MICROS / 4));
+
+    // The slew halves the phase error every tick: sampled as it converges
+    syncAll(coordinator);
+    long phaseErrors[12];
+    for (long &phaseError : phaseErrors)
+    {
+        advance(PERIOD_MICROS);
+        phaseError = labs(c.groupChannel.getPhaseError());
+    }
+    printf("controller 2 phase error a tick at a time:");
+    for (long phaseError : phaseErrors)
+    {
+        printf(" %ld", phaseError);
+    }
+    printf("us\n");
+    CHECK(phaseErrors[11] <= 2 * static_cast<long>(SLICE_MICROS));
+
+    // Settled: the ticks a few slices apart, which is as finely as the
+    // interrupt is taken here
+    advance(100000);
+    long worstPhaseError = 0;
+    long settledSkew = 0;
+    for (unsigned long elapsed = 0; elapsed < 200000; elapsed += PERIOD_MICROS)
+    {
+        advance(PERIOD_MICROS);
+        settledSkew = max(settledSkew, tickSkew());
+        for (Controller *controller : controllers)
+        {
+            worstPhaseError = max(worstPhaseError, labs(controller->groupChannel.getPhaseError()));
+        }
+    }
+    CHECK(settledSkew <= 4 * static_cast<long>(SLICE_MICROS));
+    CHECK(worstPhaseError <= 2 * static_cast<long>(SLICE_MICROS));
+
+    // Left alone the clocks drift apart, and a sync brings them back
+    advance(1700000);
+    long driftedSkew = worstSkewOver(100000);
+    syncAll(coordinator);
+    advance(100000);
+    long resyncedSkew = worstSkewOver(200000);
+    printf("tick skew %ldus before sync, at most %ldus settled, %ldus two seconds on, %ldus synced again; "
+           "phase errors at most %ldus\n",
+           before, settledSkew, driftedSkew, resyncedSkew, worstPhaseError);
+    CHECK(driftedSkew > 100); // 75us a second between a and b
+    CHECK(resyncedSkew <= 4 * static_cast<long>(SLICE_MICROS));
+    for (Controller *controller : controllers)
+    {
+        CHECK(controller->scheduler.getMissedDeadlines() == 0);
+    }
+
+    // A group frame to start them all 20ms on, repeated as senders do
+    uint8_t frame[GroupChannel::GROUP_HEADER_SIZE + CommandChannel::COMMAND_SIZE] = {
+        'W', 'G', GroupChannel::GROUP_VERSION, 1};
+    uint32_t activateAt = trueMicros + 20000;
+    putU32(frame + 4, 1);
+    frame[8] = 1;
+    putU32(frame + 12, activateAt);
+    frame[16] = CommandChannel::SPEED;
+    float speed = 600;
+    memcpy(frame + 20, &speed, sizeof(speed));
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        coordinator.beginPacket(GROUP_ADDRESS, GROUP_PORT);
+        coordinator.write(frame, sizeof(frame));
+        coordinator.endPacket();
+        advance(2000);
+    }
+    advance(30000);
+    unsigned long first = a.appliedAt, last = a.appliedAt;
+    for (Controller *controller : controllers)
+    {
+        CHECK(controller->appliedAt != 0);
+        CHECK(controller->groupChannel.getStats().applied == 1);
+        CHECK(controller->groupChannel.getStats().duplicates == 2);
+        CHECK(controller->groupChannel.getStats().late == 0);
+        first = min(first, controller->appliedAt);
+        last = max(last, controller->appliedAt);
+    }
+    printf("group start at %lu: applied from %lu to %lu, %luus apart\n", static_cast<unsigned long>(activateAt), first,
+           last, last - first);
+    CHECK(labs(static_cast<long>(first - activateAt)) <= static_cast<long>(PERIOD_MICROS / 2));
+    CHECK(last - first <= 4 * SLICE_MICROS);
+    return checkResult();
+}
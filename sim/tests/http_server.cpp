@@ -0,0 +1,113 @@
+#include "Check.h"
+#include "HttpServer.h"
+#include "../MotorSimulator.h"
+#include <string>
+
+// HttpServer against browsers that take their responses and ones that stop
+// acking partway. Time only moves in the simulated socket when it would
+// block on the ESP8266, so handleClient() must take none: a stalled
+// response is given up with a reset after its timeout, never by waiting in
+// stop(), and one the browser took is closed cleanly.
+
+static const uint16_t PORT = 80;
+static const unsigned long MAX_PASS_MICROS = 1000; // Well under a control period
+static const size_t BIG_BODY = 20000;              // Several send buffers
+
+struct Loop {
+    MotorSimulator &sim;
+    HttpServer &server;
+    unsigned long worstMicros;
+
+    // A handleClient() pass every control period
+    void run(unsigned long ms)
+    {
+        for (unsigned long i = 0; i < ms / 5; i++)
+        {
+            sim.advanceMicros(5000);
+            unsigned long start = sim.micros();
+            server.handleClient();
+            unsigned long spent = sim.micros() - start;
+            worstMicros = spent > worstMicros ? spent : worstMicros;
+        }
+    }
+};
+
+static void request(HostPeer &peer, const char *path, bool keepAlive)
+{
+    peer.connect(PORT);
+    std::string text = std::string("GET ") + path + " HTTP/1.1\r\nHost: wmc\r\n" +
+                       (keepAlive ? "" : "Connection: close\r\n") + "\r\n";
+    peer.send(text.c_str());
+}
+
+int main()
+{
+    MotorSimulator sim(14, 12, 13, 15);
+    hostSetClock(sim);
+    HttpServer server(PORT);
+    int sentCallbacks = 0;
+    server.on("/small", HttpServer::METHOD_GET, [&]() {
+        server.whenSent([&]() { sentCallbacks++; });
+        server.send(200, "text/plain", "small");
+    });
+    server.on("/big", HttpServer::METHOD_GET, [&]() {
+        size_t *left = new size_t(BIG_BODY);
+        server.whenSent([&, left]() {
+            sentCallbacks++;
+            delete left;
+        });
+        server.sendStream(200, "text/plain", BIG_BODY, [left](uint8_t *buffer, size_t size) {
+            size_t length = min(size, *left);
+            memset(buffer, 'x', length);
+            *left -= length;
+            return length;
+        });
+    });
+    server.begin();
+    Loop loop = {sim, server, 0};
+
+    // Taken in full: closed with stop() once acked
+    HostPeer good;
+    request(good, "/big", false);
+    loop.run(100);
+    std::string received = good.receive();
+    CHECK(received.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    CHECK(received.size() - (received.find("\r\n\r\n") + 4) == BIG_BODY);
+    CHECK(!good.isOpen());
+    CHECK(!good.wasAborted());
+    CHECK(sentCallbacks == 1);
+
+    // Stalled partway through the body: reset after WRITE_TIMEOUT_MS
+    HostPeer stalledBody;
+    request(stalledBody, "/big", false);
+    stalledBody.setStalled(true); // After the first send buffer
+    loop.run(HttpServer::WRITE_TIMEOUT_MS + 500);
+    printf("stalled in the body: %s with %zu bytes in flight; handleClient() waited up to %luus\n",
+           stalledBody.wasAborted() ? "reset" : "closed", stalledBody.inFlight(), loop.worstMicros);
+    CHECK(!stalledBody.isOpen());
+    CHECK(stalledBody.wasAborted());
+    CHECK(sentCallbacks == 2);
+
+    // Stalled with the whole response in flight: CLOSING times out
+    HostPeer stalledClose;
+    request(stalledClose, "/small", false);
+    stalledClose.setStalled(true);
+    loop.run(HttpServer::WRITE_TIMEOUT_MS + 500);
+    printf("stalled while closing: %s; handleClient() waited up to %luus\n",
+           stalledClose.wasAborted() ? "reset" : "closed", loop.worstMicros);
+    CHECK(!stalledClose.isOpen());
+    CHECK(stalledClose.wasAborted());
+    CHECK(sentCallbacks == 3);
+
+    // Kept alive with its response unacked: the idle timeout resets it
+    HostPeer stalledIdle;
+    request(stalledIdle, "/nowhere", true);
+    stalledIdle.setStalled(true);
+    loop.run(HttpServer::KEEP_ALIVE_TIMEOUT_MS + 500);
+    CHECK(!stalledIdle.isOpen());
+    CHECK(stalledIdle.wasAborted());
+
+    CHECK(server.getConnectionCount() == 0);
+    CHECK(loop.worstMicros < MAX_PASS_MICROS);
+    return checkResult();
+}
@@ -0,0 +1,89 @@
+#include "Check.h"
+#include "MotionProfile.h"
+#include <math.h>
+
+// MotionProfile on moves that float positions could not follow: ten
+// thousand turns at 3000 RPM, starting 700,000 turns from zero, sampled
+// every control period. The reference must never step back, must advance by
+// the cruise velocity's share of a period to the tick while cruising, and
+// must end exactly on the target. Then a short triangular move backwards.
+
+static const unsigned long PERIOD_MICROS = 5000;
+static const float TICKS_PER_RPM = 4096 / 60.0f; // Ticks a second at 1 RPM
+
+struct Walk {
+    int64_t worstStep;      // Furthest a cruise step strayed from velocity * period, ticks
+    bool backwards;         // The reference ever moved against the move
+    bool ended;             // It reached the target and stayed there
+    double seconds;
+};
+
+static Walk walk(const MotionProfile &profile, int64_t start, float cruiseVelocity)
+{
+    Walk result = {0, false, false, 0};
+    int direction = profile.getTarget() >= start ? 1 : -1;
+    int64_t last = start;
+    unsigned long elapsed = 0;
+    for (;; elapsed += PERIOD_MICROS)
+    {
+        int64_t position;
+        float velocity;
+        profile.sample(elapsed, position, velocity);
+        result.backwards = result.backwards || (position - last) * direction < 0;
+        if (fabsf(velocity) == cruiseVelocity && elapsed > 0)
+        {
+            double expected = cruiseVelocity * (PERIOD_MICROS * 1e-6);
+            int64_t stray = llabs((position - last) * direction - llround(expected));
+            result.worstStep = stray > result.worstStep ? stray : result.worstStep;
+        }
+        last = position;
+        if (velocity == 0 && elapsed > 0)
+        {
+            result.ended = position == profile.getTarget();
+            break;
+        }
+    }
+    result.seconds = elapsed * 1e-6;
+    return result;
+}
+
+int main()
+{
+    MotionProfile profile;
+    const int64_t start = 700000LL * 4096; // Past 2^31
+    const int64_t target = start + 10000LL * 4096;
+    const float velocity = 3000 * TICKS_PER_RPM;
+    const float acceleration = 5000 * TICKS_PER_RPM;
+    profile.plan(start, target, velocity, acceleration);
+    Walk forward = walk(profile, start, velocity);
+    printf("10000 turns from turn 700000: %.2fs (planned %.2fs), cruise steps within %lld ticks, %s, %s\n",
+           forward.seconds, profile.getDuration(), static_cast<long long>(forward.worstStep),
+           forward.backwards ? "stepped back" : "never back", forward.ended ? "ended on target" : "missed the target");
+    CHECK_NEAR(profile.getDuration(), 10000 * 60 / 3000.0 + 3000 / 5000.0, 0.01);
+    CHECK(forward.worstStep <= 1); // 1024 ticks a period, to the rounding
+    CHECK(!forward.backwards);
+    CHECK(forward.ended);
+
+    // Halfway through the cruise, exactly where the motion puts it
+    int64_t position;
+    float reference;
+    double halfway = profile.getDuration() / 2;
+    profile.sample(static_cast<unsigned long>(halfway * 1e6), position, reference);
+    CHECK(llabs(position - (start + target) / 2) <= 1);
+    CHECK(reference == velocity);
+
+    // Short and backwards, from below zero: never reaches the cruise velocity
+    profile.plan(-5, -1005, velocity, acceleration);
+    Walk back = walk(profile, -5, velocity);
+    printf("1000 ticks back from -5: %.3fs, %s, %s\n", back.seconds, back.backwards ? "stepped back" : "never back",
+           back.ended ? "ended on target" : "missed the target");
+    CHECK_NEAR(profile.getDuration(), 2 * sqrt(1000 / acceleration), 1e-6);
+    CHECK(!back.backwards);
+    CHECK(back.ended);
+
+    // Nothing to do holds the target from the start
+    profile.plan(42, 42, velocity, acceleration);
+    profile.sample(0, position, reference);
+    CHECK(position == 42 && reference == 0 && profile.getDuration() == 0);
+    return checkResult();
+}
@@ -0,0 +1,110 @@
+#include "Check.h"
+#include "ControlScheduler.h"
+#include <stdlib.h>
+
+// ControlScheduler on a simulated CPU: time passes one microsecond at a time
+// while a task runs, and the timer0 interrupt fires in between, as it would
+// on the ESP8266. The web slack task stands in for HTTP load, mostly short
+// requests with the odd slow one, and every few seconds interrupts are held
+// off for longer than a period, as a flash erase does. Reports the jitter
+// and missed deadlines, and checks the tick survives the late interrupts.
+
+class CpuClock : public Clock {
+public:
+    CpuClock() : _micros(0) {}
+    unsigned long millis() override { return _micros / 1000; }
+    unsigned long micros() override { return _micros; }
+    void delay(unsigned long ms) override { busy(ms * 1000); }
+    uint32_t cycles() override { return static_cast<uint32_t>(_micros * 80); }
+
+    // Runs for a while with interrupts enabled
+    void busy(unsigned long us)
+    {
+        for (unsigned long i = 0; i < us; i++)
+        {
+            _micros++;
+            hostServiceTimer();
+        }
+    }
+
+    // Runs for a while with interrupts held off; a tick that falls due is
+    // taken late, once they are enabled again
+    void blocked(unsigned long us)
+    {
+        noInterrupts();
+        _micros += us;
+        interrupts();
+        hostServiceTimer();
+    }
+
+private:
+    unsigned long _micros;
+};
+
+static CpuClock cpu;
+static unsigned long controlRuns = 0;
+static unsigned long webRequests = 0;
+
+static void runFor(ControlScheduler &scheduler, unsigned long ms, unsigned long blockedEveryMs)
+{
+    unsigned long end = cpu.millis() + ms;
+    unsigned long nextBlock = cpu.millis() + blockedEveryMs;
+    while (cpu.millis() < end)
+    {
+        scheduler.run();
+        cpu.busy(10); // The SDK between loop() calls
+        if (blockedEveryMs > 0 && cpu.millis() >= nextBlock)
+        {
+            cpu.blocked(12000); // Sector erase, over two periods
+            nextBlock += blockedEveryMs;
+        }
+    }
+}
+
+static void report(const char *name, ControlScheduler &scheduler)
+{
+    printf("%-8s ticks %lu, missed %lu, jitter max %luus, overruns %lu (last %s, %luus late)\n", name,
+           scheduler.getTickCount(), scheduler.getMissedDeadlines(), scheduler.getMaxJitterMicros(),
+           scheduler.getOverruns(), scheduler.getLastOverrunPhase() ? scheduler.getLastOverrunPhase() : "-",
+           scheduler.getLastOverrunLateMicros());
+}
+
+int main()
+{
+    hostSetClock(cpu);
+    srand(1);
+
+    ControlScheduler scheduler(5000);
+    scheduler.setControlTask([]() {
+        controlRuns++;
+        cpu.busy(400 + rand() % 200);
+    });
+    scheduler.addSlackTask([]() {
+        webRequests++;
+        cpu.busy(rand() % 50 == 0 ? 3000 + rand() % 2000 : 200 + rand() % 1300); // Over budget now and then
+    }, 2000, "web");
+    scheduler.addSlackTask([]() { cpu.busy(80); }, 100, "sensor");
+    scheduler.begin();
+
+    // Under HTTP load only, every tick is served
+    runFor(scheduler, 10000, 0);
+    report("load", scheduler);
+    CHECK_NEAR(scheduler.getTickCount(), 2000, 2);
+    CHECK(scheduler.getMissedDeadlines() == 0);
+    CHECK(scheduler.getMaxJitterMicros() < 5000);
+    CHECK(controlRuns == scheduler.getTickCount());
+    CHECK(webRequests > 1000);
+
+    // Interrupts held off for two and a bit periods: the late ISR finds its
+    // next compare value passed and must rearm from now
+    scheduler.resetStats();
+    runFor(scheduler, 10000, 1000);
+    report("blocked", scheduler);
+    CHECK(scheduler.getMissedDeadlines() >= 10); // One or two periods lost in each
+    CHECK_NEAR(scheduler.getTickCount() + scheduler.getMissedDeadlines(), 2000, 20);
+
+    unsigned long ticks = scheduler.getTickCount();
+    runFor(scheduler, 1000, 0);
+    CHECK_NEAR(scheduler.getTickCount() - ticks, 200, 2); // Still ticking
+    return checkResult();
+}
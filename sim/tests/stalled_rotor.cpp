@@ -0,0 +1,82 @@
+#include "Check.h"
+#include "TestRig.h"
+
+// The protection against a stalled rotor: the shaft is held while the loop
+// asks for speed. With a rating the floor duty can hold, derating brings the
+// current down to about the rating and keeps it there; with one it cannot,
+// the motor trips and is freed. Once it has cooled, a new command drives it.
+
+static CurrentLimits limits(float ratedCurrent)
+{
+    CurrentLimits limits;
+    limits.ratedCurrent = ratedCurrent;
+    limits.peakCurrent = 50; // Above the 40A stall current, so only the I^2.t model acts
+    limits.thermalTimeConstant = 1;
+    limits.senseAmpsPerCount = 0.0266f;
+    return limits;
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    const Protection &protection = rig.controller.getProtection();
+
+    // Derating: the loop stays saturated at the limit as it moves, and the
+    // current settles near the rating
+    const float rated = 8;
+    rig.controller.setProtection(limits(rated), 0);
+    rig.sim.setLocked(true);
+    rig.controller.setTargetSpeed(1500);
+    float peakCurrent = 0;
+    int belowLimit = 0;
+    for (int i = 0; i < 2000; i++) // 10s, ten thermal time constants
+    {
+        rig.step();
+        peakCurrent = fabs(rig.sim.getCurrent()) > peakCurrent ? fabs(rig.sim.getCurrent()) : peakCurrent;
+        int limit = static_cast<int>(1023 * protection.getScale() + 0.5f);
+        belowLimit += i >= 100 && abs(rig.controller.getLastSample().pwm) < limit; // Saturated after the first 0.5s
+    }
+    double stalledCurrent = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        rig.step();
+        stalledCurrent += fabs(rig.sim.getCurrent()) / 200;
+    }
+    printf("stalled, %.0fA rated: peak %.1fA, settled at %.2fA, load %.2f, duty scale %.3f, %d steps under the limit\n",
+           rated, peakCurrent, stalledCurrent, protection.getLoad(), protection.getScale(), belowLimit);
+    CHECK(peakCurrent > 30);
+    CHECK(!protection.isTripped());
+    CHECK(protection.getScale() < 0.3f);
+    CHECK_NEAR(stalledCurrent, rated, 0.1 * rated);
+    CHECK(belowLimit == 0); // The moving limit never knocked the integral back
+
+    // A rating below what even the floor duty draws: the load is well over 1
+    // and the bridge is freed
+    rig.controller.setProtection(limits(3), 0);
+    unsigned long tripMs = 0;
+    for (int i = 0; i < 2000 && tripMs == 0; i++)
+    {
+        rig.step();
+        tripMs = protection.isTripped() ? (i + 1) * MotorController::SampleTime : 0;
+    }
+    rig.step();
+    printf("stalled, 3A rated: tripped (%s) after %lums\n", Protection::faultName(protection.getFault()), tripMs);
+    CHECK(tripMs > 0);
+    CHECK(protection.getFault() == Protection::OVERLOAD);
+    CHECK(protection.getScale() == 0);
+    CHECK(rig.sim.getCurrent() == 0);
+
+    // Cooled, it stays free until told otherwise
+    rig.sim.setLocked(false);
+    rig.run(5000);
+    CHECK(!protection.isTripped());
+    CHECK(rig.sim.getCurrent() == 0);
+    CHECK(rig.sim.getSpeedRPM() == 0);
+    rig.controller.setTargetSpeed(300);
+    rig.run(3000);
+    printf("after cooling: %.0f RPM at %.2fA\n", rig.sim.getSpeedRPM(), fabs(rig.sim.getCurrent()));
+    CHECK(!protection.isTripped());
+    CHECK(rig.sim.getSpeedRPM() > 200);
+    return checkResult();
+}
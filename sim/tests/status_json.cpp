@@ -0,0 +1,178 @@
+#include "Check.h"
+#include "TestRig.h"
+#include "JsonWriter.h"
+#include <chrono>
+#include <new>
+
+// JsonWriter against the String concatenation getStatusJson() it replaced,
+// kept below as it was: both render the fields that status had from the
+// same values, byte for byte, and each is timed with its heap allocations
+// counted. Then the firmware's full status, rendered into the server's
+// buffer from a running motor, allocates nothing either.
+
+static const size_t STATUS_BUFFER_SIZE = 1280; // ServerManager's
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *block = malloc(size);
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void operator delete(void *block) noexcept
+{
+    free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+    free(block);
+}
+
+struct StatusValues {
+    const char *serialNumber;
+    bool isCalibrated;
+    double kp, ki, kd;
+    const char *direction;
+    double minSpeed, maxSpeed;
+    long position;
+    double actualSpeed, targetSpeed, actualSpeedRPM, targetSpeedRPM;
+    float temperature, humidity;
+};
+
+// MotorController::getStatusJson() before JsonWriter, the members read
+// from the values
+static String stringStatus(const StatusValues &v, String FIRMWARE_VERSION, String message)
+{
+    String json = "{";
+    json += "\"firmwareVersion\":\"" + FIRMWARE_VERSION + "\",";
+    json += "\"serialNumber\":\"" + String(v.serialNumber) + "\",";
+    json += "\"calibrated\":" + String(!v.isCalibrated ? "true" : "false") + ",";
+    json += "\"pid\":{\"kp\":" + String(v.kp) + ",\"ki\":" + String(v.ki) + ",\"kd\":" + String(v.kd) + "},";
+    json += "\"direction\":\"" + String(v.direction) + "\",";
+    json += "\"minSpeed\":" + String(v.minSpeed) + ",";
+    json += "\"maxSpeed\":" + String(v.maxSpeed) + ",";
+    json += "\"position\":" + String(v.position) + ",";
+    json += "\"actualSpeed\":" + String(v.actualSpeed) + ",";
+    json += "\"targetSpeed\":" + String(v.targetSpeed) + ",";
+    json += "\"actualSpeedRPM\":" + String(v.actualSpeedRPM) + ",";
+    json += "\"targetSpeedRPM\":" + String(v.targetSpeedRPM) + ",";
+    json += "\"temperature\":" + String(v.temperature) + ",";
+    json += "\"humidity\":" + String(v.humidity) + ",";
+    json += "\"message\":\"" + String(message) + "\"";
+    json += "}";
+    return json;
+}
+
+// The same fields as the first writeStatusJson() wrote them
+static void writerStatus(JsonWriter &json, const StatusValues &v, const char *firmwareVersion, const char *message)
+{
+    json.beginObject();
+    json.addString("firmwareVersion", firmwareVersion);
+    json.addString("serialNumber", v.serialNumber);
+    json.addBool("calibrated", !v.isCalibrated);
+    json.beginObject("pid");
+    json.addNumber("kp", v.kp);
+    json.addNumber("ki", v.ki);
+    json.addNumber("kd", v.kd);
+    json.endObject();
+    json.addString("direction", v.direction);
+    json.addNumber("minSpeed", v.minSpeed);
+    json.addNumber("maxSpeed", v.maxSpeed);
+    json.addInteger("position", v.position);
+    json.addNumber("actualSpeed", v.actualSpeed);
+    json.addNumber("targetSpeed", v.targetSpeed);
+    json.addNumber("actualSpeedRPM", v.actualSpeedRPM);
+    json.addNumber("targetSpeedRPM", v.targetSpeedRPM);
+    json.addNumber("temperature", v.temperature);
+    json.addNumber("humidity", v.humidity);
+    json.addString("message", message);
+    json.endObject();
+}
+
+static double nanosSince(std::chrono::steady_clock::time_point start, int count)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+int main()
+{
+    static const StatusValues values[] = {
+        {"WMC-0001", false, 0.5, 2.0, 0.0, "CW", 10, 3000, 0, 0, 0, 0, 0, 21.5f, 40.25f},
+        {"WMC-0001", true, 1.25, 5.0, 0.01, "CCW", 10, 3000, -123456, -512.5, -600, -1499.87, -1500, -5.125f, 99.9f},
+        {"", false, 0, 0, 0, "", 0, 0, 2147483647L, 1023, 1023, 2999.995, 3000, 85, 0},
+    };
+    char buffer[STATUS_BUFFER_SIZE];
+    for (const StatusValues &v : values)
+    {
+        String expected = stringStatus(v, "0.1.4", "ok");
+        JsonWriter json(buffer, sizeof(buffer));
+        writerStatus(json, v, "0.1.4", "ok");
+        CHECK(!json.overflowed());
+        CHECK(expected == json.c_str());
+        if (expected != json.c_str())
+        {
+            printf("String:     %s\nJsonWriter: %s\n", expected.c_str(), json.c_str());
+        }
+    }
+
+    // Each rendered a few thousand times from the running motor's values
+    const int renders = 20000;
+    const StatusValues &v = values[1];
+    unsigned long before = allocations;
+    size_t stringBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < renders; i++)
+    {
+        stringBytes += stringStatus(v, "0.1.4", "ok").length();
+    }
+    double stringNanos = nanosSince(start, renders);
+    double stringAllocations = static_cast<double>(allocations - before) / renders;
+
+    before = allocations;
+    size_t writerBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < renders; i++)
+    {
+        JsonWriter json(buffer, sizeof(buffer));
+        writerStatus(json, v, "0.1.4", "ok");
+        writerBytes += json.length();
+    }
+    double writerNanos = nanosSince(start, renders);
+    unsigned long writerAllocations = allocations - before;
+    printf("%zu bytes: String %.0fns and %.1f allocations a render, JsonWriter %.0fns and %lu allocations in all\n",
+           stringBytes / renders, stringNanos, stringAllocations, writerNanos, writerAllocations);
+    CHECK(writerBytes == stringBytes);
+    CHECK(stringAllocations > 10); // A temporary String for nearly every piece
+    CHECK(writerAllocations == 0);
+
+    // Today's status, fields and all, as /status renders it
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(600);
+    rig.run(2000);
+    String firmwareVersion("0.1.4");
+    before = allocations;
+    size_t statusBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < renders; i++)
+    {
+        JsonWriter json(buffer, sizeof(buffer));
+        json.beginObject();
+        rig.controller.writeStatusFields(json, firmwareVersion, "ok");
+        json.endObject();
+        CHECK(!json.overflowed());
+        statusBytes = json.length();
+    }
+    double statusNanos = nanosSince(start, renders);
+    printf("full status: %zu of %zu bytes, %.0fns and %lu allocations in all\n", statusBytes, sizeof(buffer),
+           statusNanos, allocations - before);
+    CHECK(allocations == before);
+    return checkResult();
+}
@@ -0,0 +1,133 @@
+#include "Check.h"
+#include "TestRig.h"
+#include "ServerManager.h"
+#include <string>
+
+// /status polling through the web server as the firmware wires it: with
+// the motor at rest, polls that send the ETag back get 304s however long
+// apart, a command changes the ETag, and ?since= returns only the fields
+// that changed after the sequence a poller last saw.
+
+static const uint16_t PORT = 80;
+
+struct Response {
+    int code;
+    std::string etag;
+    std::string body;
+};
+
+struct Web {
+    TestRig &rig;
+    HttpServer &server;
+
+    Response get(const char *path, const std::string &etag = "")
+    {
+        HostPeer browser;
+        browser.connect(PORT);
+        std::string request = std::string("GET ") + path + " HTTP/1.1\r\nConnection: close\r\n";
+        if (!etag.empty())
+        {
+            request += "If-None-Match: " + etag + "\r\n";
+        }
+        browser.send((request + "\r\n").c_str());
+        std::string received;
+        for (int i = 0; i < 20 && browser.isOpen(); i++)
+        {
+            rig.step();
+            server.handleClient();
+            received += browser.receive();
+        }
+        received += browser.receive();
+
+        Response response = {0, "", ""};
+        sscanf(received.c_str(), "HTTP/1.1 %d", &response.code);
+        size_t header = received.find("ETag: ");
+        if (header != std::string::npos)
+        {
+            response.etag = received.substr(header + 6, received.find("\r\n", header) - header - 6);
+        }
+        size_t body = received.find("\r\n\r\n");
+        response.body = body != std::string::npos ? received.substr(body + 4) : "";
+        return response;
+    }
+};
+
+static unsigned long sequenceOf(const Response &response)
+{
+    size_t at = response.body.find("\"sequence\":");
+    return at != std::string::npos ? strtoul(response.body.c_str() + at + 11, nullptr, 10) : 0;
+}
+
+static bool has(const Response &response, const char *key)
+{
+    return response.body.find(std::string("\"") + key + "\":") != std::string::npos;
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    ControlScheduler scheduler(TestRig::PERIOD_MICROS);
+    TelemetryStream telemetry(1000 / MotorController::SampleTime);
+    CommandChannel commandChannel(rig.controller);
+    GroupChannel groupChannel(commandChannel, scheduler, rig.config);
+    HttpServer server(PORT);
+    ServerManager serverManager(server, rig.controller, scheduler, telemetry, commandChannel, groupChannel, rig.bus,
+                                "0.1.4");
+    serverManager.setupEndpoints();
+    server.begin();
+    Web web = {rig, server};
+    rig.run(3000); // The first AHT21 reading is in
+
+    // At rest: the second poll, a second later, is a 304 though idleMs moved
+    Response first = web.get("/status");
+    rig.run(1000);
+    Response second = web.get("/status", first.etag);
+    Response fields = web.get("/status?fields=position,temperature");
+    rig.run(3000);
+    Response fieldsAgain = web.get("/status?fields=position,temperature", fields.etag);
+    printf("at rest: %d then %d for the full status (ETag %s), %d then %d for two fields\n", first.code, second.code,
+           first.etag.c_str(), fields.code, fieldsAgain.code);
+    CHECK(first.code == 200);
+    CHECK(has(first, "failsafe") && has(first, "protection") && has(first, "watchdog"));
+    CHECK(first.etag == "\"" + std::to_string(sequenceOf(first)) + "\"");
+    CHECK(second.code == 304);
+    CHECK(second.body.empty());
+    CHECK(fields.code == 200);
+    CHECK(fieldsAgain.code == 304);
+
+    // A command changes the failsafe fields and, as it saves them, the
+    // config counters, and nothing else
+    CHECK(web.get("/failsafe?timeout=5000").code == 200);
+    Response changed = web.get("/status", first.etag);
+    char path[48];
+    snprintf(path, sizeof(path), "/status?since=%lu", sequenceOf(first));
+    Response delta = web.get(path);
+    printf("after /failsafe: %d with ETag %s; since %lu: %s\n", changed.code, changed.etag.c_str(), sequenceOf(first),
+           delta.body.c_str());
+    CHECK(changed.code == 200);
+    CHECK(changed.etag != first.etag);
+    CHECK(sequenceOf(changed) > sequenceOf(first));
+    CHECK(delta.code == 200);
+    CHECK(has(delta, "failsafe"));
+    CHECK(has(delta, "config"));
+    CHECK(!has(delta, "position") && !has(delta, "temperature") && !has(delta, "pid") && !has(delta, "protection"));
+    CHECK(web.get("/status?fields=position,temperature", fields.etag).code == 304); // Not among the fields asked for
+
+    // Nothing since the latest, and a sequence from before a restart
+    snprintf(path, sizeof(path), "/status?since=%lu", sequenceOf(changed));
+    Response nothing = web.get(path);
+    snprintf(path, sizeof(path), "/status?since=%lu", sequenceOf(first) - 1000000);
+    Response stale = web.get(path);
+    CHECK(nothing.body == "{\"sequence\":" + std::to_string(sequenceOf(changed)) + "}");
+    CHECK(has(stale, "position") && has(stale, "failsafe"));
+
+    // Running, the speed changes the ETag from poll to poll
+    rig.controller.setPIDValues(1, 5, 0);
+    web.get("/speed?value=600");
+    rig.run(2000);
+    Response running = web.get("/status");
+    rig.run(100);
+    CHECK(web.get("/status", running.etag).code == 200);
+    return checkResult();
+}
@@ -0,0 +1,65 @@
+#include "Check.h"
+#include "TestRig.h"
+#include <chrono>
+
+// Smoke test of the host build: a speed step on the simulated motor,
+// reporting the step response, the settle time and what a control step
+// costs on this machine. The default gains take tens of seconds to remove
+// the last of the error on the simulated 775, so a quicker set is used.
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+
+    const double target = 1500;
+    rig.controller.setTargetSpeed(target);
+
+    double peak = 0;
+    unsigned long riseMs = 0, settleMs = 0;
+    double worstStepNanos = 0, totalNanos = 0;
+    const int steps = 3000 / MotorController::SampleTime; // 3s
+    for (int i = 0; i < steps; i++)
+    {
+        rig.sim.advanceMicros(TestRig::PERIOD_MICROS - rig.sim.micros() % TestRig::PERIOD_MICROS);
+        rig.encoder.sample(rig.sim.micros());
+        auto start = std::chrono::steady_clock::now();
+        rig.encoder.update();
+        rig.controller.update();
+        double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        rig.aht21Sensor.update();
+        rig.bus.service();
+
+        totalNanos += nanos;
+        worstStepNanos = nanos > worstStepNanos ? nanos : worstStepNanos;
+        double rpm = rig.sim.getSpeedRPM();
+        unsigned long ms = (i + 1) * MotorController::SampleTime;
+        peak = rpm > peak ? rpm : peak;
+        if (riseMs == 0 && rpm >= 0.9 * target)
+        {
+            riseMs = ms;
+        }
+        if (fabs(rpm - target) > 0.05 * target)
+        {
+            settleMs = 0;
+        }
+        else if (settleMs == 0)
+        {
+            settleMs = ms;
+        }
+    }
+
+    double finalRPM = rig.sim.getSpeedRPM();
+    printf("step 0 -> %.0f RPM: rise %lums, settle (5%%) %lums, overshoot %.1f%%, final %.0f RPM\n",
+           target, riseMs, settleMs, (peak - target) / target * 100, finalRPM);
+    printf("control step on the host: mean %.0fns, worst %.0fns\n", totalNanos / steps, worstStepNanos);
+
+    CHECK(riseMs > 0 && riseMs < 200);
+    CHECK(settleMs > 0 && settleMs < 1000);
+    CHECK(peak < 1.5 * target);
+    CHECK_NEAR(finalRPM, target, 0.02 * target);
+    CHECK_NEAR(rig.controller.getLastSample().speedRPM, finalRPM, 0.02 * target);
+    CHECK(rig.encoder.isTrusted());
+    return checkResult();
+}
@@ -0,0 +1,152 @@
+#include "Check.h"
+#include "TestRig.h"
+#include "TelemetryStream.h"
+#include <math.h>
+
+// The UDP telemetry as a client gets it: frames published every control
+// step while the speed loop runs are decoded and checked against the
+// simulated motor at that step, at the full rate and decimated, and the
+// subscriber table's limits are exercised.
+
+static const uint16_t TELEMETRY_PORT = 5600; // As wmc.ino
+static const uint16_t CLIENT_PORT = 6000;
+static const double TICKS_PER_RADIAN = -4096 / (2 * M_PI); // The magnet reads the shaft the other way round
+
+struct Frame {
+    uint32_t sequence;
+    uint32_t timestamp;
+    uint16_t rawAngle;
+    int16_t pwm;
+    float speedRPM;
+    float targetRPM;
+    float output;
+};
+
+static uint32_t getU32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static float getFloat(const uint8_t *p)
+{
+    uint32_t bits = getU32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The next frame waiting on the socket; false if none or it is malformed
+static bool receiveFrame(WiFiUDP &udp, Frame &frame)
+{
+    uint8_t data[64];
+    int size = udp.parsePacket();
+    if (size == 0)
+    {
+        return false;
+    }
+    CHECK(size == static_cast<int>(TelemetryStream::FRAME_SIZE));
+    udp.read(data, sizeof(data));
+    CHECK(udp.remotePort() == TELEMETRY_PORT);
+    if (size != static_cast<int>(TelemetryStream::FRAME_SIZE) || data[0] != 'W' || data[1] != 'T' ||
+        data[2] != TelemetryStream::TELEMETRY_VERSION || data[3] != 0)
+    {
+        return false;
+    }
+    frame.sequence = getU32(data + 4);
+    frame.timestamp = getU32(data + 8);
+    frame.rawAngle = data[12] | (data[13] << 8);
+    frame.pwm = static_cast<int16_t>(data[14] | (data[15] << 8));
+    frame.speedRPM = getFloat(data + 16);
+    frame.targetRPM = getFloat(data + 20);
+    frame.output = getFloat(data + 24);
+    return true;
+}
+
+// Angle difference in ticks, either way round the turn
+static int angleError(int a, int b)
+{
+    int difference = (a - b) & 4095;
+    return difference > 2048 ? difference - 4096 : difference;
+}
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(600);
+    const unsigned long controlRateHz = 1000 / MotorController::SampleTime;
+    TelemetryStream telemetry(controlRateHz);
+    telemetry.begin(TELEMETRY_PORT);
+
+    IPAddress client(192, 168, 4, 2);
+    WiFiUDP fullRate, decimated;
+    fullRate.setLocalAddress(client);
+    decimated.setLocalAddress(client);
+    fullRate.begin(CLIENT_PORT);
+    decimated.begin(CLIENT_PORT + 1);
+    CHECK(telemetry.subscribe(client, CLIENT_PORT, 0)); // 0 is the control rate
+    CHECK(telemetry.subscribe(client, CLIENT_PORT + 1, 50));
+    CHECK(telemetry.subscribe(client, CLIENT_PORT + 1, 50)); // Updates, takes no slot
+    CHECK(telemetry.getSubscriberCount() == 2);
+
+    // Every frame against the motor as it was at that step
+    const int steps = 2 * controlRateHz;
+    int frames = 0, decimatedFrames = 0;
+    uint32_t nextSequence = 0;
+    int worstAngle = 0;
+    double worstSpeed = 0;
+    for (int i = 0; i < steps; i++)
+    {
+        rig.step();
+        int simAngle = static_cast<long>(floor(rig.sim.getAngle() * TICKS_PER_RADIAN)) & 4095;
+        double simSpeed = rig.sim.getSpeedRPM();
+        const ControlSample &sample = rig.controller.getLastSample();
+        telemetry.publish(sample);
+
+        Frame frame;
+        CHECK(receiveFrame(fullRate, frame));
+        CHECK(!receiveFrame(fullRate, frame)); // One a step
+        frames++;
+        CHECK(frame.sequence == nextSequence++);
+        CHECK(frame.timestamp == static_cast<uint32_t>(sample.timestampMicros));
+        CHECK(frame.timestamp / 1000 == rig.sim.millis()); // This step's
+        CHECK(frame.rawAngle == sample.rawAngle && frame.rawAngle < 4096);
+        CHECK(frame.pwm == sample.pwm);
+        CHECK(frame.speedRPM == sample.speedRPM && frame.targetRPM == 600 && frame.output == sample.output);
+        CHECK(frame.pwm == 0 || (frame.pwm > 0) == (rig.sim.getVoltage() > 0)); // Sign is the direction
+        worstAngle = max(worstAngle, abs(angleError(frame.rawAngle, simAngle)));
+        if (i >= steps / 2) // Settled
+        {
+            worstSpeed = max(worstSpeed, fabs(frame.speedRPM - simSpeed));
+        }
+
+        while (receiveFrame(decimated, frame))
+        {
+            CHECK(frame.sequence == static_cast<uint32_t>(decimatedFrames));
+            decimatedFrames++;
+        }
+    }
+    printf("%d frames at %luHz, %d at 50Hz: worst angle error %d ticks, worst settled speed error %.1f RPM\n",
+           frames, controlRateHz, decimatedFrames, worstAngle, worstSpeed);
+    CHECK(decimatedFrames == steps / (controlRateHz / 50));
+    CHECK(worstAngle <= 12); // What the shaft turns after the read, about 40 ticks a millisecond
+    CHECK(worstSpeed < 0.03 * 600);
+    CHECK(telemetry.getDroppedFrames() == 0);
+
+    // Unsubscribed: nothing more; the table holds MAX_SUBSCRIBERS
+    CHECK(telemetry.unsubscribe(client, CLIENT_PORT));
+    CHECK(!telemetry.unsubscribe(client, CLIENT_PORT));
+    rig.step();
+    telemetry.publish(rig.controller.getLastSample());
+    Frame frame;
+    CHECK(!receiveFrame(fullRate, frame));
+    CHECK(receiveFrame(decimated, frame));
+    for (int i = 0; i < TelemetryStream::MAX_SUBSCRIBERS - 1; i++)
+    {
+        CHECK(telemetry.subscribe(client, CLIENT_PORT + 2 + i, 10));
+    }
+    CHECK(!telemetry.subscribe(client, CLIENT_PORT + 10, 10));
+    CHECK(telemetry.getSubscriberCount() == TelemetryStream::MAX_SUBSCRIBERS);
+    return checkResult();
+}
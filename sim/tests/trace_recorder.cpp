@@ -0,0 +1,47 @@
+#include "Check.h"
+#include "TestRig.h"
+
+// The trace recorder's cost figures while the speed loop runs: steps with
+// nothing to record must not count towards them, arming starts them over,
+// and a long armed wait cannot wrap the cycle total.
+
+int main()
+{
+    TestRig rig;
+    rig.begin();
+    rig.controller.setPIDValues(1, 5, 0);
+    rig.controller.setTargetSpeed(600);
+    TraceRecorder &trace = rig.controller.getTraceRecorder();
+
+    // Idle: every step calls record(), none of them stores a sample
+    rig.run(1000);
+    CHECK(trace.getRecordCount() == 0);
+    CHECK(trace.getAverageRecordCycles() == 0);
+
+    // A capture, then steps past its end
+    trace.arm(TraceRecorder::TRIGGER_IMMEDIATE, 0, 0);
+    rig.run(2000);
+    CHECK(trace.getState() == TraceRecorder::COMPLETE);
+    CHECK(trace.getRecordCount() == TraceRecorder::CAPACITY);
+    CHECK(trace.getAverageRecordCycles() <= trace.getMaxRecordCycles()); // Both 0 here: the simulated clock stands still within a step
+
+    // Armed again: the figures start over
+    trace.arm(TraceRecorder::TRIGGER_SETPOINT, 0, 16);
+    CHECK(trace.getRecordCount() == 0 && trace.getMaxRecordCycles() == 0 && trace.getAverageRecordCycles() == 0);
+    rig.run(100);
+    CHECK(trace.getRecordCount() == 100 / MotorController::SampleTime);
+
+    // Costs that would pass 2^32 in all, as an armed wait of hours adds up
+    TraceRecorder recorder;
+    recorder.arm(TraceRecorder::TRIGGER_SETPOINT, 0, 16);
+    TraceSample sample = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(recorder.record(sample));
+        recorder.addRecordCycles(3000000000u);
+    }
+    CHECK(recorder.getAverageRecordCycles() == 3000000000u);
+    recorder.disarm();
+    CHECK(!recorder.record(sample));
+    return checkResult();
+}
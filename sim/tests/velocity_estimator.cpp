@@ -0,0 +1,152 @@
+#include "Check.h"
+#include "VelocityEstimator.h"
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+
+// The three speed estimators on the same encoder positions, sampled every
+// control period: a speed step, then a ramp read through a noisy
+// quantised angle and held at the top. Prints each one's lag, noise and
+// cost on this machine; the observer and the least squares fit must lag
+// less than the original low pass. Last, switching into least squares
+// must give a fresh speed on the next sample rather than the old one.
+
+static const unsigned long PERIOD_MICROS = 5000;
+static const double TICKS_PER_RPM = 4096 / 60.0; // Ticks a second at 1 RPM
+static const char *modeNames[] = {"lowpass", "observer", "lsq"};
+
+struct Result {
+    double stepRiseMs;   // To 90% of a speed step
+    double rampLagMs;    // How far behind a speed ramp it runs
+    double noiseRPM;     // RMS about the true speed, held
+    double hostNanos;    // An update on this machine
+};
+
+// Angle noise, as the AS5600 gives at speed, in whole ticks
+static int angleNoise(unsigned &state, int lsb)
+{
+    state = state * 1664525u + 1013904223u;
+    return static_cast<int>(state >> 16) % (2 * lsb + 1) - lsb;
+}
+
+static Result measure(VelocityEstimator::Mode mode)
+{
+    Result result = {0, 0, 0, 0};
+    VelocityEstimator estimator;
+    estimator.reset(0, 0);
+    estimator.setMode(mode);
+
+    // Still for 100ms, then a step to 1000 RPM
+    const double stepRPM = 1000;
+    double position = 0;
+    unsigned long time = 0;
+    for (int i = 1; i <= 100; i++)
+    {
+        time += PERIOD_MICROS;
+        bool moving = i > 20;
+        position += moving ? stepRPM * TICKS_PER_RPM * PERIOD_MICROS / 1e6 : 0;
+        float rpm = estimator.update(static_cast<int64_t>(floor(position)), time) / TICKS_PER_RPM;
+        if (moving && result.stepRiseMs == 0 && rpm >= 0.9 * stepRPM)
+        {
+            result.stepRiseMs = (i - 20) * PERIOD_MICROS / 1000.0;
+        }
+    }
+
+    // From rest, up to 3000 RPM in a second through +/-2 ticks of noise,
+    // then held there for half a second
+    estimator.reset(0, 0);
+    estimator.setMode(mode);
+    const double slope = 3000; // RPM/s
+    double speed = 0, lagSum = 0, noiseSum = 0;
+    int lagCount = 0, noiseCount = 0;
+    unsigned noise = 1;
+    position = 0;
+    time = 0;
+    for (int i = 1; i <= 300; i++)
+    {
+        time += PERIOD_MICROS;
+        double dt = PERIOD_MICROS / 1e6;
+        double nextSpeed = i <= 200 ? speed + slope * dt : speed;
+        position += (speed + nextSpeed) / 2 * TICKS_PER_RPM * dt;
+        speed = nextSpeed;
+        int64_t reading = static_cast<int64_t>(floor(position)) + angleNoise(noise, 2);
+        double error = speed - estimator.update(reading, time) / TICKS_PER_RPM;
+        if (i > 100 && i <= 200) // The second half of the ramp, past the start-up
+        {
+            lagSum += error;
+            lagCount++;
+        }
+        if (i > 240) // Held, past the transient at the top
+        {
+            noiseSum += error * error;
+            noiseCount++;
+        }
+    }
+    result.rampLagMs = lagSum / lagCount / slope * 1000;
+    result.noiseRPM = sqrt(noiseSum / noiseCount);
+
+    const int updates = 200000;
+    int64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < updates; i++)
+    {
+        sink += static_cast<int64_t>(estimator.update(i * 3413 + (i & 3), time + i * PERIOD_MICROS));
+    }
+    result.hostNanos =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / updates;
+    if (sink == 42)
+    {
+        printf("\n"); // Keeps the loop
+    }
+    return result;
+}
+
+int main()
+{
+    Result results[3];
+    for (int mode = VelocityEstimator::LOW_PASS; mode <= VelocityEstimator::LEAST_SQUARES; mode++)
+    {
+        Result &r = results[mode];
+        r = measure(static_cast<VelocityEstimator::Mode>(mode));
+        printf("%-8s step to 90%% in %.0fms, ramp lag %.1fms, noise %.1f RPM RMS held at 3000 RPM, "
+               "%.1fns an update on the host\n", modeNames[mode], r.stepRiseMs, r.rampLagMs, r.noiseRPM, r.hostNanos);
+        CHECK(r.stepRiseMs > 0);
+    }
+    const Result &lowPass = results[VelocityEstimator::LOW_PASS];
+    for (int mode = VelocityEstimator::TRACKING_OBSERVER; mode <= VelocityEstimator::LEAST_SQUARES; mode++)
+    {
+        CHECK(results[mode].stepRiseMs < lowPass.stepRiseMs);
+        CHECK(fabs(results[mode].rampLagMs) < lowPass.rampLagMs);
+    }
+    CHECK_NEAR(lowPass.rampLagMs, 45, 10);                                     // About 1/0.1 - 1 periods
+    CHECK_NEAR(results[VelocityEstimator::LEAST_SQUARES].rampLagMs, 17.5, 5); // Half the window
+    CHECK_NEAR(results[VelocityEstimator::TRACKING_OBSERVER].rampLagMs, 2000 / (2 * M_PI * 10), 5); // 2/bandwidth
+
+    // Turning steadily, switched from the low pass while it still lags:
+    // the first least squares update is the true speed, not the old one
+    const int64_t ticksPerPeriod = 341; // 1000 RPM
+    VelocityEstimator estimator;
+    estimator.reset(0, 0);
+    int64_t position = 0;
+    unsigned long time = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        position += ticksPerPeriod;
+        time += PERIOD_MICROS;
+        estimator.update(position, time);
+    }
+    float before = estimator.getSpeed();
+    estimator.setMode(VelocityEstimator::LEAST_SQUARES);
+    position += ticksPerPeriod;
+    time += PERIOD_MICROS;
+    float after = estimator.update(position, time);
+    float expected = ticksPerPeriod * 1e6f / PERIOD_MICROS;
+    printf("low pass at %.0f ticks/s, least squares on the next sample %.0f, true %.0f\n", before, after, expected);
+    CHECK(before < 0.5f * expected);
+    CHECK_NEAR(after, expected, 1);
+
+    // And after a reset, straight away too
+    estimator.reset(position, time);
+    CHECK_NEAR(estimator.update(position + ticksPerPeriod, time + PERIOD_MICROS), expected, 1);
+    return checkResult();
+}
@@ -0,0 +1,85 @@
+const fs = require('fs')
+const path = require('path')
+const zlib = require('zlib')
+const crypto = require('crypto')
+
+// Compresses the web UI into PROGMEM arrays for the firmware. Run after
+// changing anything in this folder and commit the generated files:
+//
+//   node web/build.js           writes WebAssets.h and WebAssets.cpp
+//   node web/build.js --check   fails unless the generated arrays inflate
+//                               back to the current sources byte for byte
+//
+// The ETag is a hash of the uncompressed source, so it only changes when
+// the page does, whatever zlib version built it.
+
+const ASSETS = [
+  { name: 'CONFIG_PAGE', file: 'config.html', type: 'text/html' },
+  { name: 'SETUP_PAGE', file: 'setup.html', type: 'text/html' },
+  { name: 'DASHBOARD_PAGE', file: 'dashboard.html', type: 'text/html' }
+]
+
+const ROOT = path.join(__dirname, '..')
+const HEADER = path.join(ROOT, 'WebAssets.h')
+const SOURCE = path.join(ROOT, 'WebAssets.cpp')
+const BANNER = '// Generated by web/build.js from the files in web/. Do not edit.\n'
+
+function etagOf (source) {
+  return '"' + crypto.createHash('sha1').update(source).digest('hex').slice(0, 16) + '"'
+}
+
+function hexBytes (data) {
+  const lines = []
+  for (let i = 0; i < data.length; i += 16) {
+    const row = Array.from(data.subarray(i, i + 16), (b) => '0x' + b.toString(16).padStart(2, '0'))
+    lines.push('    ' + row.join(', ') + ',')
+  }
+  return lines.join('\n')
+}
+
+function generate () {
+  let header = BANNER + '#ifndef WebAssets_h\n#define WebAssets_h\n\n#include "WebAsset.h"\n\n'
+  let source = BANNER + '#include "WebAssets.h"\n'
+  for (const asset of ASSETS) {
+    const raw = fs.readFileSync(path.join(__dirname, asset.file))
+    const gzip = zlib.gzipSync(raw, { level: 9 })
+    header += `extern const WebAsset ${asset.name}; // ${asset.file}, ${raw.length} bytes, ${gzip.length} gzipped\n`
+    source += `\nstatic const uint8_t ${asset.name}_DATA[] PROGMEM = {\n${hexBytes(gzip)}\n};\n`
+    source += `const WebAsset ${asset.name} = {"${asset.type}", ${asset.name}_DATA, sizeof(${asset.name}_DATA), "${etagOf(raw).replace(/"/g, '\\"')}"};\n`
+  }
+  header += '\n#endif\n'
+  return { header, source }
+}
+
+// Reads the arrays back out of WebAssets.cpp, as the firmware would serve them
+function check () {
+  const generated = fs.readFileSync(SOURCE, 'utf8')
+  let failed = false
+  for (const asset of ASSETS) {
+    const raw = fs.readFileSync(path.join(__dirname, asset.file))
+    const array = new RegExp(`${asset.name}_DATA\\[\\] PROGMEM = \\{([^}]*)\\}`).exec(generated)
+    const record = new RegExp(`const WebAsset ${asset.name} = \\{"([^"]*)", \\w+, \\w+\\(\\w+\\), "\\\\"(\\w+)\\\\""\\}`).exec(generated)
+    if (!array || !record) {
+      console.log(`${asset.name}: missing from WebAssets.cpp`)
+      failed = true
+      continue
+    }
+    const served = Buffer.from(array[1].match(/0x[0-9a-f]{2}/g).map((b) => parseInt(b, 16)))
+    const problems = []
+    if (!zlib.gunzipSync(served).equals(raw)) problems.push('content differs from ' + asset.file)
+    if (record[1] !== asset.type) problems.push('content type ' + record[1])
+    if ('"' + record[2] + '"' !== etagOf(raw)) problems.push('stale ETag')
+    console.log(`${asset.name}: ${problems.length ? problems.join(', ') : 'ok'} (${raw.length} -> ${served.length} bytes)`)
+    failed = failed || problems.length > 0
+  }
+  return !failed
+}
+
+if (process.argv.includes('--check')) {
+  process.exit(check() ? 0 : 1)
+} else {
+  const { header, source } = generate()
+  fs.writeFileSync(HEADER, header)
+  fs.writeFileSync(SOURCE, source)
+  for (const asset of ASSETS) console.log(`${asset.name}: ${asset.file}`)
+}
@@ -1,33 +1,59 @@
 #include <Arduino.h>
-#include <ESP8266WebServer.h>
 #include <ArduinoOTA.h>
 #include <ESP8266WiFi.h>
 #include <ESP8266mDNS.h>
+#include <Wire.h>
 
 #include "MotorController.h"
 #include "SerialNumberManager.h"
+#include "HttpServer.h"
 #include "APManager.h"
 #include "ServerManager.h"
 #include "EEPROMConfig.h"
 #include "AHT21Sensor.h"
 #include "Encoder.h"
+#include "ControlScheduler.h"
+#include "ArduinoHAL.h"
+#include "TelemetryStream.h"
+#include "CommandChannel.h"
+#include "GroupChannel.h"
+#include "DashboardSocket.h"
+#include "I2CBusManager.h"
 
 #define SSID_SIZE 32
 #define PASSWORD_SIZE 64
 #define MAX_ATTEMPTS 10
-
-#define GUID_LENGTH 36                // Length of the GUID string
-#define GUID_START 100                // EEPROM address to store the GUID
-#define GUID_MARKER 0xAA              // Example marker value
-#define MARKER_START (GUID_START - 1) // Assuming there's a byte space before GUID_START
+#define TELEMETRY_PORT 5600
+#define COMMAND_PORT 5602
+#define GROUP_PORT 5603
+#define DASHBOARD_PORT 81
+#define DASHBOARD_RATE_HZ 20
+#define I2C_CLOCK_HZ 400000 // AS5600 runs up to 1MHz, the AHT21 up to 400kHz
+// Where the encoder angle comes from: Encoder::SOURCE_I2C, SOURCE_ANALOG (AS5600
+// OUT on A0 in place of the current sense) or SOURCE_PWM (OUT on RX, see pins.md)
+#define ENCODER_SOURCE Encoder::SOURCE_I2C
 
 const uint8_t AS5600_ADDRESS = 0x36;
+const uint8_t AS5600_OUT_PIN = 3; // RX; Serial is transmit-only with the PWM source
+
+// Hardware bindings shared by the motor, encoder and sensor classes.
+// The bus manager owns Wire; every device goes through it.
+ArduinoI2CBus i2cBus(Wire);
+ArduinoGpio gpio;
+ArduinoPwm pwm;
+ArduinoAnalog analog; // BTS7960 current sense, or the encoder
+ArduinoPulseInput pulseInput(AS5600_OUT_PIN);
+ArduinoClock systemClock;
+ArduinoFlash flash;
+I2CBusManager busManager(i2cBus, systemClock);
+Hal hal(busManager, gpio, pwm, analog, pulseInput, systemClock);
 
-Encoder encoder(AS5600_ADDRESS);
+Encoder encoder(hal, AS5600_ADDRESS);
 
-SerialNumberManager serialNumberManager(GUID_START, GUID_LENGTH, GUID_MARKER);
+EEPROMConfig eepromConfig(flash);
+SerialNumberManager serialNumberManager(eepromConfig);
 
-const String FIRMWARE_VERSION = "0.1.3";
+const String FIRMWARE_VERSION = "0.1.4";
 
 // Define the motor control pins.
 const int rpwmPin = 14; 
@@ -43,16 +69,30 @@ char serialNumber[37];
 bool apMode = false;
 
 
-EEPROMConfig eepromConfig;
-AHT21Sensor aht21Sensor;
+AHT21Sensor aht21Sensor(hal);
 
 // Create an instance of the MotorController class.
-MotorController motorController(eepromConfig, aht21Sensor, encoder);
+MotorController motorController(hal, eepromConfig, aht21Sensor, encoder);
 
-ESP8266WebServer server(80);
+// Encoder read and PID compute run every control period; everything else fits in between.
+ControlScheduler scheduler(MotorController::SampleTime * 1000UL);
+TelemetryStream telemetry(1000 / MotorController::SampleTime);
+CommandChannel commandChannel(motorController);
+GroupChannel groupChannel(commandChannel, scheduler, eepromConfig);
+const IPAddress GROUP_ADDRESS(239, 255, 87, 67);
+DashboardSocket dashboard(motorController, aht21Sensor);
+
+HttpServer server(80);
 APManager apManager("WMC-Config", server, eepromConfig);
 
-ServerManager serverManager(server, motorController, FIRMWARE_VERSION);
+ServerManager serverManager(server, motorController, scheduler, telemetry, commandChannel, groupChannel, busManager, FIRMWARE_VERSION);
+
+// Timer ISR, at each control tick: queues the tick for the control task,
+// which reads the angle. Nothing here runs from flash or waits on the bus.
+void IRAM_ATTR sampleEncoder(unsigned long tickMicros)
+{
+  encoder.sample(tickMicros);
+}
 
 void resetWiFiSettings()
 {
@@ -61,9 +101,20 @@ void resetWiFiSettings()
 
 void setup()
 {
-  Serial.begin(115200);
+  if (ENCODER_SOURCE == Encoder::SOURCE_PWM)
+  {
+    Serial.begin(115200, SERIAL_8N1, SERIAL_TX_ONLY);
+  }
+  else
+  {
+    Serial.begin(115200);
+  }
+  WiFi.persistent(false); // Credentials live in eepromConfig
   eepromConfig.begin();
-  encoder.begin();
+  busManager.setClock(I2C_CLOCK_HZ);
+  busManager.setPointerHold(AS5600_ADDRESS, Encoder::RAW_ANGLE_REG);
+  busManager.begin();
+  encoder.begin(ENCODER_SOURCE);
   
   Serial.println();
   Serial.println("Starting WiFi Motor Controller (WMC) Version " + FIRMWARE_VERSION);
@@ -104,7 +155,38 @@ void setup()
   motorController.init(rpwmPin, lpwmPin, renPin, lenPin);
   // Define routes for commands.
   serverManager.setupEndpoints();
+  telemetry.begin(TELEMETRY_PORT);
+  commandChannel.begin(COMMAND_PORT);
+  groupChannel.begin(WiFi.localIP(), GROUP_ADDRESS, GROUP_PORT);
+  dashboard.begin(DASHBOARD_PORT, DASHBOARD_RATE_HZ);
   initializeOTA(); // Initialize OTA
+  initializeScheduler();
+}
+
+void initializeScheduler()
+{
+  scheduler.setControlTask([]()
+                           {
+                             commandChannel.poll(); // Commands apply to this step
+                             groupChannel.poll();
+                             groupChannel.update();
+                             encoder.update();
+                             motorController.update();
+                             telemetry.publish(motorController.getLastSample());
+                           });
+
+  // Budgets are the typical cost of each task; a task only starts when its
+  // budget fits before the next control tick.
+  scheduler.addSlackTask([]() { server.handleClient(); }, 2000, "web");
+  scheduler.addSlackTask([]() { aht21Sensor.update(); }, 100, "sensor");
+  scheduler.addSlackTask([]() { busManager.service(); }, 500, "i2c"); // Queued AHT21 transfers
+  scheduler.addSlackTask([]() { ArduinoOTA.handle(); }, 500, "ota");
+  scheduler.addSlackTask([]() { groupChannel.poll(); }, 200, "group"); // Sync requests are timestamped on arrival
+  scheduler.addSlackTask([]() { dashboard.service(); }, 300, "dashboard"); // Writes only what the socket can take
+  scheduler.addSlackTask([]() { encoder.serviceBenchmark(); }, 500, "benchmark"); // A slice of reads while /encoder/benchmark runs
+
+  scheduler.setTickHook(sampleEncoder);
+  scheduler.begin();
 }
 
 void loadCredentials(char *ssid, char *password)
@@ -140,7 +222,6 @@ void initializeOTA()
   ArduinoOTA.onStart([]()
                      {
                        Serial.println("OTA Starting Update");
-                       // Add any specific actions you want to perform when OTA starts
                      });
 
   ArduinoOTA.onEnd([]()
@@ -181,11 +262,7 @@ void loop()
     apManager.handleClient();
   }
   else
-  { // TODO: do some timing tests here to see how long it takes to run these command
-    encoder.update();
-    aht21Sensor.update();
-    server.handleClient();
-    motorController.update();
-    ArduinoOTA.handle(); // Handle OTA
+  {
+    scheduler.run(); // Control step on each timer tick, web/sensor/OTA work in the slack time
   }
 }